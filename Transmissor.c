@@ -20,6 +20,7 @@
 #include "hardware/uart.h"
 #include "lib/custom_ir.h"
 #include "lib/ssd1306.h"
+#include "lib/ssd1306_widget.h"
 
 #include "hardware/flash.h"
 #include "hardware/sync.h"
@@ -128,11 +129,18 @@ typedef struct __attribute__((packed)) {
 // ===================== VARIÁVEIS GLOBAIS =====================
 static ssd1306_t ssd;
 static uint32_t last_operation_time = 0;
-static bool ir_operation_pending = false;
-static system_state_t current_state = STATE_OFF;
+// current_state e ir_operation_counter mudam na IRQ do PIO, no fim de cada
+// quadro IR
+static volatile system_state_t current_state = STATE_OFF;
 static system_state_t last_display_state = STATE_MAX;
 static system_state_t last_command_sent = STATE_OFF;
-static uint32_t ir_operation_counter = 0;
+static volatile uint32_t ir_operation_counter = 0;
+static uint32_t reported_ir_operations = 0;
+// Estado de cada quadro concluído, pelo número da operação, para o laço
+// principal reportar um por um mesmo quando vários terminam entre duas
+// passadas (a fila do IR tem só 4 lugares)
+#define IR_OPS_LOG_LEN 8
+static volatile system_state_t ir_ops_log[IR_OPS_LOG_LEN];
 
 // ===================== HELPERS GPIO =====================
 static void init_gpio(void) {
@@ -201,48 +209,45 @@ static void show_boot_diag(ssd1306_t *ssd, bool reboot_wdt, uint32_t count, uint
     ssd1306_send_data(ssd);
 }
 
-// Tela de operação mostrando estado do AC
-static void show_running_state(ssd1306_t *ssd, system_state_t state) {
-    char line[22];
-    draw_frame_base(ssd, true);
-
-    ssd1306_draw_string(ssd, "AC+WDT+UART", 20, 6);
-    
-    // Mostra estado atual do AC
+// Texto do estado do AC na tela de operação
+static const char *state_label(system_state_t state) {
     switch (state) {
-        case STATE_OFF:
-            ssd1306_draw_string(ssd, "AC: OFF", 10, 16);
-            break;
-        case STATE_ON:
-            ssd1306_draw_string(ssd, "AC: ON", 10, 16);
-            break;
-        case STATE_TEMP_20:
-            ssd1306_draw_string(ssd, "AC: 20C", 10, 16);
-            break;
-        case STATE_TEMP_22:
-            ssd1306_draw_string(ssd, "AC: 22C", 10, 16);
-            break;
-        case STATE_FAN_1:
-            ssd1306_draw_string(ssd, "AC: FAN 1", 10, 16);
-            break;
-        case STATE_FAN_2:
-            ssd1306_draw_string(ssd, "AC: FAN 2", 10, 16);
-            break;
-        default:
-            ssd1306_draw_string(ssd, "AC: ???", 10, 16);
-            break;
+        case STATE_OFF:     return "AC: OFF";
+        case STATE_ON:      return "AC: ON";
+        case STATE_TEMP_20: return "AC: 20C";
+        case STATE_TEMP_22: return "AC: 22C";
+        case STATE_FAN_1:   return "AC: FAN 1";
+        case STATE_FAN_2:   return "AC: FAN 2";
+        default:            return "AC: ???";
     }
+}
 
-    // Mostra estatísticas
-    snprintf(line, sizeof(line), "OPS: %lu", (unsigned long)ir_operation_counter);
-    ssd1306_draw_string(ssd, line, 10, 28);
-    
-    snprintf(line, sizeof(line), "RST: %lu", (unsigned long)watchdog_hw->scratch[0]);
-    ssd1306_draw_string(ssd, line, 10, 40);
-    
-    ssd1306_draw_string(ssd, "TX: ATIVO", 10, 52);
+// Tela de operação mostrando estado do AC. É montada uma vez como widgets
+// (mesmo layout de draw_frame_base); depois, a cada chamada, só o estado e os
+// contadores que mudaram são redesenhados e enviados.
+static ssd1306_screen_t running_screen;
+static ssd1306_widget_t running_widgets[8];
+static ssd1306_widget_t *running_state, *running_ops, *running_rst;
 
-    ssd1306_send_data(ssd);
+static void show_running_state(ssd1306_t *ssd, system_state_t state) {
+    if (!running_screen.ssd) {
+        ssd1306_screen_init(&running_screen, ssd, running_widgets, count_of(running_widgets), false);
+        ssd1306_screen_frame(&running_screen, 3, 3, 122, 60, true);
+        ssd1306_screen_hline(&running_screen, 3, 123, 25, true);
+        ssd1306_screen_hline(&running_screen, 3, 123, 37, true);
+        ssd1306_screen_label(&running_screen, &ssd1306_font_8x8, 20, 6, "AC+WDT+UART");
+        running_state = ssd1306_screen_label(&running_screen, &ssd1306_font_8x8, 10, 16, state_label(state));
+        running_ops = ssd1306_screen_counter(&running_screen, &ssd1306_font_8x8, 10, 28, "OPS: ", ir_operation_counter);
+        running_rst = ssd1306_screen_counter(&running_screen, &ssd1306_font_8x8, 10, 40, "RST: ", watchdog_hw->scratch[0]);
+        ssd1306_screen_label(&running_screen, &ssd1306_font_8x8, 10, 52, "TX: ATIVO");
+    }
+
+    ssd1306_label_set(&running_screen, running_state, state_label(state));
+    ssd1306_counter_set(&running_screen, running_ops, ir_operation_counter);
+    ssd1306_counter_set(&running_screen, running_rst, watchdog_hw->scratch[0]);
+    ssd1306_screen_compose(&running_screen);
+
+    ssd1306_send_data_async(ssd); // retorna já; o DMA termina o envio
 }
 
 // Tela de falha
@@ -271,7 +276,7 @@ static uint8_t calculate_checksum(telemetry_data_t *data) {
     return sum;
 }
 
-static void send_telemetry(void) {
+static void send_telemetry_op(system_state_t state, uint32_t ir_operations) {
     telemetry_data_t telem = {0};
     
     // Preenche header e footer
@@ -279,13 +284,13 @@ static void send_telemetry(void) {
     telem.footer = TELEM_FOOTER;
     
     // Preenche dados do sistema
-    telem.ac_state = current_state;
+    telem.ac_state = state;
     telem.last_command = last_command_sent;
-    telem.ir_pending = ir_operation_pending ? 1 : 0;
+    telem.ir_pending = ir_pending();
     telem.uptime_ms = to_ms_since_boot(get_absolute_time());
     telem.wdt_resets = persist.wdt_count;
     telem.last_fault = persist.last_fault;
-    telem.ir_operations = ir_operation_counter;
+    telem.ir_operations = ir_operations;
     
     // Calcula checksum
     telem.checksum = calculate_checksum(&telem);
@@ -294,9 +299,12 @@ static void send_telemetry(void) {
     uart_write_blocking(UART_ID, (uint8_t*)&telem, sizeof(telemetry_data_t));
 }
 
+static void send_telemetry(void) {
+    send_telemetry_op(current_state, ir_operation_counter);
+}
+
 // ===================== CONTROLE IR COM PROTEÇÃO =====================
 static bool execute_ir_command_safe(system_state_t new_state) {
-    ir_operation_pending = true;
     last_operation_time = to_ms_since_boot(get_absolute_time());
     
     printf("Executando comando IR para estado: %d\n", new_state);
@@ -333,63 +341,80 @@ static bool execute_ir_command_safe(system_state_t new_state) {
         }
     }
     
-    // Executa comando IR apropriado para os demais estados
+    // Enfileira o comando IR apropriado para os demais estados. O estado, o
+    // contador e o LED só mudam quando o quadro termina (on_ir_frame_done).
+    ir_command_t cmd;
     switch (new_state) {
         case STATE_OFF:
             printf("Comando: DESLIGAR AC\n");
-            turn_off_ac();
-            gpio_put(LED_PIN, 0);
+            cmd = IR_CMD_OFF;
             break;
             
         case STATE_ON:
             printf("Comando: LIGAR AC\n");
-            turn_on_ac();
-            gpio_put(LED_PIN, 1);
+            cmd = IR_CMD_ON;
             break;
             
         case STATE_TEMP_20:
             printf("Comando: TEMPERATURA 20C\n");
-            set_temp_20c();
-            gpio_put(LED_PIN, 1);
+            cmd = IR_CMD_TEMP_20;
             break;
             
         case STATE_FAN_1:
             printf("Comando: VENTILADOR NIVEL 1\n");
-            set_fan_level_1();
-            gpio_put(LED_PIN, 1);
+            cmd = IR_CMD_FAN_1;
             break;
             
         case STATE_FAN_2:
             printf("Comando: VENTILADOR NIVEL 2\n");
-            set_fan_level_2();
-            gpio_put(LED_PIN, 1);
+            cmd = IR_CMD_FAN_2;
             break;
             
         default:
             printf("Estado invalido\n");
-            ir_operation_pending = false;
             return false;
     }
     
-    // Feed do watchdog APÓS a operação IR
-    watchdog_update();
-    
-    // Delay para garantir transmissão completa
-    sleep_ms(100);
-    
-    ir_operation_pending = false;
-    current_state = new_state;
-    ir_operation_counter++;
-    
-    printf("Comando IR executado (Total: %lu ops)\n", 
-           (unsigned long)ir_operation_counter);
-    
-    // Transmite telemetria após comando bem-sucedido
-    send_telemetry();
+    if (!ir_send_command_async(cmd, new_state)) {
+        printf("Fila IR cheia (%u pendentes), comando descartado\n", ir_pending());
+        return false;
+    }
     
+    printf("Comando IR na fila (%u pendentes)\n", ir_pending());
     return true;
 }
 
+// Fim de um quadro IR, na IRQ do PIO. Só registra; o laço principal
+// percebe o contador novo e faz o resto.
+static void on_ir_frame_done(void *ctx, uint32_t tag) {
+    (void)ctx;
+    current_state = (system_state_t)tag;
+    ir_ops_log[ir_operation_counter % IR_OPS_LOG_LEN] = current_state;
+    ir_operation_counter++;
+}
+
+// Reporta cada quadro concluído desde a última passada, na ordem, com o
+// estado que ele enviou
+static void report_ir_operations(void) {
+    uint32_t count = ir_operation_counter;
+    if (count == reported_ir_operations)
+        return;
+    // Mais quadros do que o registro guarda: os mais antigos só entram na
+    // contagem
+    if (count - reported_ir_operations > IR_OPS_LOG_LEN)
+        reported_ir_operations = count - IR_OPS_LOG_LEN;
+    while (reported_ir_operations != count) {
+        system_state_t state = ir_ops_log[reported_ir_operations % IR_OPS_LOG_LEN];
+        ++reported_ir_operations;
+        printf("Comando IR executado (Total: %lu ops)\n", 
+               (unsigned long)reported_ir_operations);
+        
+        // Transmite telemetria após comando bem-sucedido
+        send_telemetry_op(state, reported_ir_operations);
+    }
+    gpio_put(LED_PIN, current_state != STATE_OFF);
+}
+
 // ===================== FUNÇÕES DE FALHA SIMULADA =====================
 static void trigger_infinite_loop_fault(void) {
     printf("\n!!! FALHA 1: LOOP INFINITO !!!\n");
@@ -651,6 +676,7 @@ int main() {
             sleep_ms(100);
         }
     }
+    ir_set_done_callback(on_ir_frame_done, NULL);
     printf("✓ Sistema IR inicializado\n");
 
     // ===== HABILITA WATCHDOG =====
@@ -675,6 +701,9 @@ int main() {
         // ===== PROCESSA COMANDOS SERIAL =====
         process_uart_input();
 
+        // ===== QUADROS IR CONCLUÍDOS =====
+        report_ir_operations();
+
         // ===== TRANSMISSÃO PERIÓDICA DE TELEMETRIA =====
         if (absolute_time_diff_us(get_absolute_time(), next_telemetry) <= 0) {
             send_telemetry();
@@ -690,8 +719,9 @@ int main() {
         }
 
         // ===== ATUALIZA DISPLAY PERIODICAMENTE =====
-        if (absolute_time_diff_us(get_absolute_time(), next_display) <= 0 || 
-            last_display_state != current_state) {
+        // Se o envio anterior ainda estiver no barramento, tenta na próxima volta
+        if ((absolute_time_diff_us(get_absolute_time(), next_display) <= 0 || 
+             last_display_state != current_state) && !ssd1306_busy(&ssd)) {
             
             show_running_state(&ssd, current_state);
             last_display_state = current_state;
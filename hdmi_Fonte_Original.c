@@ -19,6 +19,8 @@
 #include "dvi_serialiser.h"
 #include "./include/common_dvi_pin_configs.h"
 #include "tmds_encode_font_2bpp.h"
+#include "font_expand_2bpp.h"
+#include "tmds_encode_pio.h"
 
 // Inclusão do arquivo de fonte
 #include "./assets/font_8x8.h"
@@ -34,14 +36,27 @@
 
 struct dvi_inst dvi0;
 
+// 1: o core 1 só expande fonte + cores para 2bpp, e três SMs do pio1 fazem a
+// codificação TMDS (uma por plano de cor). 0: codificação TMDS toda na CPU.
+// Canais de DMA: o DVI já ocupa 6 (controle + dados para cada uma das 3
+// lanes), e cada codificador PIO ocupa mais 2 (TX e RX). Com 1 os 12 canais
+// do RP2040 ficam todos em uso e qualquer outro dma_claim_unused_channel(true)
+// (ex.: o flush assíncrono do SSD1306) entra em pânico.
+#ifndef USE_PIO_TMDS_ENCODE
+#define USE_PIO_TMDS_ENCODE 0
+#endif
+
+#if USE_PIO_TMDS_ENCODE
+struct tmds_pio_encoder tmds_enc[3];
+// Dois buffers de níveis: a CPU expande a linha y enquanto o PIO codifica y-1
+static uint32_t levelbuf[2][3 * FRAME_WIDTH / 16];
+#endif
+
 // Definições do terminal de caracteres
 #define CHAR_COLS (FRAME_WIDTH / FONT_CHAR_WIDTH)
 #define CHAR_ROWS (FRAME_HEIGHT / FONT_CHAR_HEIGHT)
 
-// Buffers para caracteres e cores
-#define COLOUR_PLANE_SIZE_WORDS (CHAR_ROWS * CHAR_COLS * 4 / 32)
-char charbuf[CHAR_ROWS * CHAR_COLS];
-uint32_t colourbuf[3 * COLOUR_PLANE_SIZE_WORDS];
+#include "./include/text_double_buffer.h"
 
 // Uso do botão B para o BOOTSEL
 #define botaoB 6
@@ -53,7 +68,7 @@ void gpio_irq_handler(uint gpio, uint32_t events) {
 static inline void set_char(uint x, uint y, char c) {
     if (x >= CHAR_COLS || y >= CHAR_ROWS)
         return;
-    charbuf[x + y * CHAR_COLS] = c;
+    planes_back->charbuf[x + y * CHAR_COLS] = c;
 }
 
 // Função para definir a cor de um caractere (formato RGB222)
@@ -65,7 +80,7 @@ static inline void set_colour(uint x, uint y, uint8_t fg, uint8_t bg) {
     uint word_index = char_index / 8;
     for (int plane = 0; plane < 3; ++plane) {
         uint32_t fg_bg_combined = (fg & 0x3) | (bg << 2 & 0xc);
-        colourbuf[word_index] = (colourbuf[word_index] & ~(0xfu << bit_index)) | (fg_bg_combined << bit_index);
+        planes_back->colourbuf[word_index] = (planes_back->colourbuf[word_index] & ~(0xfu << bit_index)) | (fg_bg_combined << bit_index);
         fg >>= 2;
         bg >>= 2;
         word_index += COLOUR_PLANE_SIZE_WORDS;
@@ -107,14 +122,52 @@ void draw_border() {
 void core1_main() {
     dvi_register_irqs_this_core(&dvi0, DMA_IRQ_0);
     dvi_start(&dvi0);
+#if USE_PIO_TMDS_ENCODE
+    struct text_planes *front = &planes[0];
+    uint32_t *tmds_prev = NULL;
+    while (true) {
+        front = text_frame_start(front);
+        for (uint y = 0; y < FRAME_HEIGHT; ++y) {
+            uint32_t *lv = levelbuf[y & 1];
+            font_expand_2bpp(
+                (const uint8_t*)&front->charbuf[y / FONT_CHAR_HEIGHT * CHAR_COLS],
+                &front->colourbuf[y / FONT_CHAR_HEIGHT * (COLOUR_PLANE_SIZE_WORDS / CHAR_ROWS)],
+                COLOUR_PLANE_SIZE_WORDS,
+                lv,
+                FRAME_WIDTH,
+                (const uint8_t*)&font_8x8[y % FONT_CHAR_HEIGHT * FONT_N_CHARS] - FONT_FIRST_ASCII
+            );
+            // Entrega a linha anterior assim que o PIO terminar, antes de pegar
+            // outro buffer TMDS (senão podemos segurar o próximo da fila)
+            if (tmds_prev) {
+                for (int plane = 0; plane < 3; ++plane)
+                    tmds_encode_pio_wait(&tmds_enc[plane]);
+                queue_add_blocking(&dvi0.q_tmds_valid, &tmds_prev);
+            }
+            uint32_t *tmdsbuf;
+            queue_remove_blocking(&dvi0.q_tmds_free, &tmdsbuf);
+            for (int plane = 0; plane < 3; ++plane) {
+                tmds_encode_pio_start(
+                    &tmds_enc[plane],
+                    lv + plane * (FRAME_WIDTH / 16),
+                    tmdsbuf + plane * (FRAME_WIDTH / DVI_SYMBOLS_PER_WORD),
+                    FRAME_WIDTH
+                );
+            }
+            tmds_prev = tmdsbuf;
+        }
+    }
+#else
+    struct text_planes *front = &planes[0];
     while (true) {
+        front = text_frame_start(front);
         for (uint y = 0; y < FRAME_HEIGHT; ++y) {
             uint32_t *tmdsbuf;
             queue_remove_blocking(&dvi0.q_tmds_free, &tmdsbuf);
             for (int plane = 0; plane < 3; ++plane) {
                 tmds_encode_font_2bpp(
-                    (const uint8_t*)&charbuf[y / FONT_CHAR_HEIGHT * CHAR_COLS],
-                    &colourbuf[y / FONT_CHAR_HEIGHT * (COLOUR_PLANE_SIZE_WORDS / CHAR_ROWS) + plane * COLOUR_PLANE_SIZE_WORDS],
+                    (const uint8_t*)&front->charbuf[y / FONT_CHAR_HEIGHT * CHAR_COLS],
+                    &front->colourbuf[y / FONT_CHAR_HEIGHT * (COLOUR_PLANE_SIZE_WORDS / CHAR_ROWS) + plane * COLOUR_PLANE_SIZE_WORDS],
                     tmdsbuf + plane * (FRAME_WIDTH / DVI_SYMBOLS_PER_WORD),
                     FRAME_WIDTH,
                     (const uint8_t*)&font_8x8[y % FONT_CHAR_HEIGHT * FONT_N_CHARS] - FONT_FIRST_ASCII
@@ -123,6 +176,7 @@ void core1_main() {
             queue_add_blocking(&dvi0.q_tmds_valid, &tmdsbuf);
         }
     }
+#endif
 }
 
 // Função principal do Core 0 (lógica principal)
@@ -142,6 +196,11 @@ int __not_in_flash("main") main() {
     dvi0.timing = &DVI_TIMING;
     dvi0.ser_cfg = picodvi_dvi_cfg;
     dvi_init(&dvi0, next_striped_spin_lock_num(), next_striped_spin_lock_num());
+#if USE_PIO_TMDS_ENCODE
+    // O serializador DVI usa o pio0, então os codificadores ficam no pio1
+    tmds_encode_2bpp_pio_init(tmds_enc, 3, pio1);
+    font_expand_2bpp_init();
+#endif
 
     // Limpa a tela inteira com fundo preto uma única vez no início
     for (uint y = 0; y < CHAR_ROWS; ++y) {
@@ -153,6 +212,8 @@ int __not_in_flash("main") main() {
 
     // Desenha a borda
     draw_border();
+    // O core 1 ainda não está rodando, então dá para copiar direto para o front
+    memcpy(&planes[0], planes_back, sizeof(struct text_planes));
 
     // Inicia o hardware do ADC
     adc_init();
@@ -201,6 +262,9 @@ int __not_in_flash("main") main() {
             set_colour(current_x, start_y, 0x0c, 0x00); // Texto verde, fundo preto
         }
 
+        // Mostra a linha inteira de uma vez (sem números pela metade)
+        text_commit();
+
         // Pausa para controlar a taxa de atualização da tela
         sleep_ms(100);
     }
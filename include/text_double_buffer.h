@@ -0,0 +1,59 @@
+#ifndef _TEXT_DOUBLE_BUFFER_H
+#define _TEXT_DOUBLE_BUFFER_H
+
+// Planos de caracteres e cores do terminal de texto, em buffer duplo. Quem
+// inclui define CHAR_COLS e CHAR_ROWS antes; cada programa inclui este
+// arquivo uma vez só (os buffers são static).
+
+#include <string.h>
+#include "pico.h"
+#include "hardware/sync.h"
+
+#if !defined(CHAR_COLS) || !defined(CHAR_ROWS)
+#error "defina CHAR_COLS e CHAR_ROWS antes de incluir text_double_buffer.h"
+#endif
+
+// Buffers para caracteres e cores
+#define COLOUR_PLANE_SIZE_WORDS (CHAR_ROWS * CHAR_COLS * 4 / 32)
+struct text_planes {
+    char charbuf[CHAR_ROWS * CHAR_COLS];
+    uint32_t colourbuf[3 * COLOUR_PLANE_SIZE_WORDS];
+};
+
+// Buffer duplo: o core 1 codifica sempre do "front" e o core 0 escreve sempre
+// no "back". text_commit() publica o back em planes_pending, e o core 1 só o
+// adota no início do próximo quadro que ele codifica (y == 0). A troca não é
+// feita na IRQ de vblank porque o core 1 trabalha algumas linhas à frente da
+// saída: quando a IRQ entra no vblank, as primeiras linhas do próximo quadro
+// já podem ter sido codificadas com o buffer antigo.
+static struct text_planes planes[2];
+static struct text_planes *planes_back = &planes[1];      // só o core 0
+static struct text_planes *volatile planes_pending = NULL;
+
+// Publica tudo o que foi escrito desde o último commit, de uma vez. Espera o
+// core 1 adotar o buffer (no máximo um quadro), depois copia o novo front para
+// o antigo, que vira o novo back, para as próximas escritas partirem do que
+// está na tela.
+static void text_commit(void) {
+    struct text_planes *committed = planes_back;
+    __dmb();
+    planes_pending = committed;
+    while (planes_pending)
+        tight_loop_contents();
+    __dmb();
+    planes_back = committed == &planes[0] ? &planes[1] : &planes[0];
+    memcpy(planes_back, committed, sizeof(struct text_planes));
+}
+
+// Chamado pelo core 1 no início de cada quadro
+static inline struct text_planes *__not_in_flash_func(text_frame_start)(struct text_planes *front) {
+    struct text_planes *pending = planes_pending;
+    if (pending) {
+        front = pending;
+        __dmb();
+        planes_pending = NULL;
+    }
+    return front;
+}
+
+#endif
@@ -5,138 +5,65 @@
 
 #include "pico/stdlib.h"
 #include "stdio.h"
-#include "hardware/pwm.h"
+#include <string.h>
+#include "hardware/pio.h"
 #include "hardware/gpio.h"
 #include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/clocks.h"
+#include "ir_carrier.pio.h"
+#include "custom_ir.h"
 
 // Definies
-#define IR_CARRIER_FREQ 38000
+#define IR_DEFAULT_CARRIER_HZ 38000
+// Intervalo no ar depois de cada quadro, o mesmo que o sleep_ms(100) que
+// seguia cada comando
+#define IR_FRAME_GAP_US 100000
 
-// Variveis globais PWM e DMA
-static uint pwm_slice;
-static uint pwm_channel;
+// Variveis globais PIO e DMA
+static PIO ir_pio;
+static uint ir_sm;
 static bool ir_initialized = false;
 static int dma_channel = -1;
 
-// Buffer para nveis PWM (ON/OFF)
-#define MAX_PWM_BUFFER 2048
-static uint16_t pwm_levels[MAX_PWM_BUFFER];
-static uint32_t pwm_count = 0;
+// Fila de quadros; a agenda do quadro no ar fica dentro dela
+static ir_queue_t ir_queue;
+
+// Divisor atual do PIO, calculado a partir do clk_sys
+static ir_carrier_config_t ir_carrier;
 
 // ============================================================================
-// SINAIS IR (mantidos do cdigo original)
+// SINAIS IR
 // ============================================================================
 
-static const uint16_t rawSignal_off[] = {
-    3603, 1758, 360, 1359, 404, 1362, 405, 344, 423, 352, 426, 348, 
-    404, 1335, 429, 345, 427, 348, 413, 1338, 404, 1361, 404, 345, 
-    427, 1312, 429, 345, 426, 348, 421, 1319, 428, 1335, 362, 426, 
-    406, 1334, 403, 1333, 405, 345, 427, 347, 408, 1358, 403, 344, 
-    407, 368, 390, 1361, 403, 373, 426, 349, 403, 372, 410, 364, 
-    426, 349, 427, 347, 427, 348, 391, 423, 406, 345, 425, 349, 
-    426, 348, 426, 349, 404, 370, 403, 372, 411, 364, 413, 401, 
-    406, 343, 426, 349, 427, 348, 403, 371, 412, 1354, 403, 344, 
-    426, 349, 415, 399, 405, 344, 403, 372, 403, 1338, 427, 1334, 
-    404, 345, 404, 371, 414, 360, 416, 1336, 403, 1362, 404, 1333, 
-    406, 343, 413, 363, 410, 364, 402, 373, 426, 349, 415, 399, 
-    404, 345, 403, 372, 404, 1336, 427, 1335, 404, 1334, 404, 345, 
-    403, 372, 415, 399, 405, 344, 403, 372, 403, 372, 402, 372, 
-    402, 373, 402, 373, 402, 372, 416, 398, 405, 345, 427, 348, 
-    425, 350, 426, 348, 427, 348, 427, 348, 428, 347, 415, 398, 
-    381, 394, 381, 394, 380, 394, 380, 395, 380, 395, 378, 396, 
-    378, 397, 398, 391, 352, 423, 352, 422, 352, 423, 376, 399, 
-    379, 395, 383, 392, 383, 392, 399, 367, 405, 370, 404, 1331, 
-    402, 1336, 401, 376, 401, 373, 401, 374, 399, 1337, 414
+// Payloads de ir_protocol_ac (sem o checksum), decodificados das capturas
+// originais por tools/ir_infer.py. O byte 7  31 - temperatura em C.
+#define AC_TEMP_BYTE 7
+#define AC_TEMP_MIN  16
+#define AC_TEMP_MAX  31
+
+static const uint8_t ac_off[13] = {
+    0x23, 0xCB, 0x26, 0x01, 0x00, 0x20, 0x18, 0x07, 0x38, 0x00, 0x00, 0x00, 0x00
 };
 
-static const uint16_t rawSignal_on[] = {
-    3585, 1762, 354, 1393, 411, 1328, 413, 342, 392, 383, 364, 411, 
-    388, 1369, 409, 346, 365, 410, 445, 1326, 414, 1324, 412, 344, 
-    389, 1368, 408, 347, 366, 409, 365, 1393, 408, 1329, 386, 384, 
-    364, 1393, 410, 1329, 409, 346, 364, 411, 364, 1392, 386, 370, 
-    365, 410, 444, 1327, 410, 346, 363, 412, 363, 412, 363, 411, 
-    364, 410, 364, 411, 364, 411, 442, 347, 364, 410, 365, 410, 
-    363, 411, 391, 384, 364, 411, 365, 410, 363, 411, 447, 342, 
-    365, 410, 364, 1392, 409, 348, 364, 410, 390, 1366, 410, 347, 
-    391, 384, 444, 1326, 411, 1327, 412, 344, 395, 380, 395, 1361, 
-    410, 347, 394, 381, 395, 379, 446, 1324, 384, 1353, 391, 367, 
-    399, 1356, 411, 347, 398, 377, 400, 374, 401, 374, 444, 344, 
-    402, 1353, 414, 344, 403, 372, 403, 372, 429, 1325, 415, 345, 
-    429, 349, 439, 362, 413, 361, 416, 368, 403, 372, 380, 394, 
-    379, 396, 378, 397, 376, 399, 390, 377, 402, 369, 401, 398, 
-    378, 374, 400, 374, 399, 375, 399, 375, 396, 380, 407, 381, 
-    390, 384, 366, 409, 364, 411, 365, 409, 366, 409, 386, 388, 
-    389, 386, 378, 411, 364, 411, 363, 412, 362, 412, 363, 412, 
-    364, 410, 364, 411, 363, 412, 375, 1396, 343, 413, 360, 414, 
-    361, 1396, 343, 1396, 342, 1396, 340, 1398, 340, 416, 368
+static const uint8_t ac_on[13] = {
+    0x23, 0xCB, 0x26, 0x01, 0x00, 0x24, 0x13, 0x0B, 0x22, 0x00, 0x00, 0x00, 0x00
 };
 
-static const uint16_t temp_para_22[] = {
-    3609, 1760, 381, 1338, 403, 1363, 404, 344, 404, 371, 403, 372, 
-    404, 1336, 427, 345, 403, 372, 415, 1335, 404, 1362, 405, 344, 
-    404, 1360, 404, 344, 404, 371, 403, 1362, 403, 1334, 389, 399, 
-    405, 1313, 425, 1334, 405, 344, 403, 372, 403, 1361, 404, 344, 
-    403, 372, 419, 1334, 428, 346, 402, 372, 403, 372, 403, 372, 
-    403, 372, 402, 372, 403, 372, 419, 372, 427, 345, 403, 372, 
-    402, 372, 403, 372, 403, 372, 402, 372, 403, 373, 419, 370, 
-    428, 345, 404, 1361, 404, 344, 403, 372, 423, 1341, 404, 346, 
-    428, 318, 444, 1338, 428, 1334, 403, 370, 381, 394, 380, 1333, 
-    405, 1333, 403, 397, 354, 421, 361, 1365, 400, 400, 353, 422, 
-    377, 1336, 399, 401, 382, 393, 381, 394, 383, 392, 393, 371, 
-    405, 1331, 404, 373, 403, 372, 402, 1333, 403, 374, 400, 375, 
-    398, 376, 410, 379, 396, 378, 394, 381, 392, 383, 389, 385, 
-    391, 384, 391, 384, 392, 382, 379, 410, 390, 385, 364, 411, 
-    363, 411, 363, 412, 365, 410, 389, 386, 362, 413, 375, 414, 
-    360, 414, 362, 414, 361, 414, 359, 416, 358, 435, 340, 435, 
-    340, 438, 350, 436, 338, 437, 337, 437, 337, 438, 337, 438, 
-    336, 439, 335, 440, 335, 482, 306, 1404, 333, 1406, 331, 1432, 
-    306, 445, 329, 470, 305, 445, 330, 469, 305, 1444, 303
+static const uint8_t ac_temp_22[13] = {
+    0x23, 0xCB, 0x26, 0x01, 0x00, 0x24, 0x33, 0x09, 0x12, 0x00, 0x00, 0x00, 0x00
 };
 
-static const uint16_t temp_para_20[] = {
-    3611, 1759, 364, 1356, 428, 1314, 428, 344, 427, 317, 461, 300, 
-    474, 1308, 430, 345, 427, 349, 421, 1327, 405, 1339, 428, 344, 
-    412, 1326, 428, 346, 427, 348, 427, 1311, 430, 1312, 386, 424, 
-    406, 1308, 429, 1311, 428, 344, 403, 371, 427, 1312, 429, 345, 
-    410, 364, 417, 1334, 404, 373, 422, 352, 427, 348, 428, 347, 
-    426, 349, 427, 347, 427, 348, 392, 422, 405, 345, 428, 346, 
-    428, 346, 427, 348, 427, 349, 426, 347, 410, 365, 417, 397, 
-    406, 344, 428, 1311, 429, 344, 403, 372, 427, 1311, 429, 345, 
-    403, 373, 415, 1336, 429, 1336, 403, 345, 404, 372, 404, 1337, 
-    426, 1334, 404, 346, 404, 396, 399, 1325, 429, 1311, 429, 371, 
-    377, 1335, 405, 395, 353, 422, 351, 423, 352, 424, 400, 388, 
-    383, 1329, 400, 401, 385, 389, 386, 1326, 402, 400, 385, 389, 
-    409, 345, 446, 341, 403, 370, 406, 370, 404, 369, 404, 371, 
-    402, 373, 401, 373, 401, 373, 443, 349, 396, 376, 395, 380, 
-    393, 382, 390, 384, 391, 384, 392, 383, 392, 383, 379, 430, 
-    370, 384, 364, 410, 362, 413, 363, 412, 367, 408, 389, 386, 
-    361, 414, 378, 430, 342, 433, 342, 415, 360, 433, 340, 434, 
-    340, 435, 339, 435, 340, 438, 350, 1399, 338, 438, 337, 437, 
-    337, 1401, 337, 439, 335, 440, 335, 440, 334, 1439, 307
+static const uint8_t ac_temp_20[13] = {
+    0x23, 0xCB, 0x26, 0x01, 0x00, 0x24, 0x33, 0x0B, 0x12, 0x00, 0x00, 0x00, 0x00
 };
 
-static const uint16_t fan_1[] = {
-    3612, 1760, 430, 1315, 426, 1288, 446, 353, 426, 349, 426, 349, 
-    426, 1284, 449, 354, 425, 350, 433, 1319, 424, 1286, 449, 353, 
-    426, 1285, 448, 353, 427, 349, 425, 1285, 448, 1290, 462, 354, 
-    426, 1286, 448, 1289, 448, 354, 426, 349, 425, 1285, 447, 356, 
-    426, 349, 434, 1317, 424, 351, 426, 349, 425, 349, 426, 349, 
-    426, 349, 425, 350, 425, 350, 435, 353, 425, 350, 424, 350, 
-    425, 350, 425, 349, 425, 350, 425, 350, 424, 351, 436, 353, 
-    425, 349, 424, 1287, 353, 449, 422, 353, 422, 1287, 375, 428, 
-    420, 355, 437, 1315, 351, 1360, 373, 429, 415, 359, 418, 1293, 
-    374, 1364, 373, 429, 384, 391, 438, 351, 416, 1294, 376, 426, 
-    379, 1332, 376, 426, 353, 422, 354, 420, 378, 397, 439, 350, 
-    382, 1328, 398, 405, 352, 422, 353, 1358, 399, 403, 353, 421, 
-    354, 421, 439, 350, 380, 394, 376, 399, 353, 422, 353, 421, 
-    379, 396, 353, 422, 353, 422, 438, 351, 380, 394, 378, 397, 
-    376, 398, 378, 397, 377, 398, 377, 397, 379, 396, 437, 352, 
-    380, 394, 380, 395, 378, 397, 379, 395, 381, 394, 382, 393, 
-    384, 390, 434, 355, 413, 362, 413, 361, 414, 360, 416, 359, 
-    415, 360, 416, 358, 417, 358, 427, 362, 417, 357, 417, 358, 
-    417, 1295, 439, 362, 415, 361, 414, 338, 434, 1299, 449
+static const uint8_t ac_fan_1[13] = {
+    0x23, 0xCB, 0x26, 0x01, 0x00, 0x24, 0x33, 0x0A, 0x12, 0x00, 0x00, 0x00, 0x00
 };
 
+// Captura que no segue o protocolo (215 duraes, espaos de 2,1 ms e
+// checksum errado), mantida como RAW at ser regravada
 static const uint16_t fan_2[] = {
     3612, 2002, 181, 1323, 419, 1292, 447, 353, 420, 354, 421, 354, 
     420, 1320, 421, 352, 420, 2108, 420, 1291, 448, 353, 420, 1319, 
@@ -158,107 +85,227 @@ static const uint16_t fan_2[] = {
     421, 1293, 445, 353, 420, 354, 421, 354, 422, 1293, 452
 };
 
+// Cada comando  um payload de ir_protocol_ac ou um sinal RAW
+static const struct {
+    const uint8_t* payload;
+    const uint16_t* signal;
+    size_t length;
+} ir_commands[IR_CMD_MAX] = {
+    [IR_CMD_OFF]     = { ac_off },
+    [IR_CMD_ON]      = { ac_on },
+    [IR_CMD_TEMP_22] = { ac_temp_22 },
+    [IR_CMD_TEMP_20] = { ac_temp_20 },
+    [IR_CMD_FAN_1]   = { ac_fan_1 },
+    [IR_CMD_FAN_2]   = { NULL, fan_2, sizeof(fan_2) / sizeof(uint16_t) },
+};
+
 // ============================================================================
-// CONVERSO: Sinal RAW ? Buffer PWM
+// SADA: Agenda ? DMA ? PIO
 // ============================================================================
 
-bool prepare_pwm_buffer(const uint16_t* raw_signal, size_t raw_length) {
-    pwm_count = 0;
-    uint16_t pwm_wrap = pwm_hw->slice[pwm_slice].top;
-    uint16_t pwm_on = pwm_wrap / 2;   // 50% duty = carrier ON
-    uint16_t pwm_off = 0;              // 0% duty = carrier OFF
-    
-    for (size_t i = 0; i < raw_length && pwm_count < MAX_PWM_BUFFER; i++) {
-        uint16_t duration_us = raw_signal[i];
-        bool is_on = (i % 2 == 0);  // Par=ON, mpar=OFF
-        
-        // Cada ~26us = 1 ciclo PWM em 38kHz
-        uint16_t num_cycles = duration_us / 26;
-        if (num_cycles < 1) num_cycles = 1;
-        
-        uint16_t level = is_on ? pwm_on : pwm_off;
-        
-        for (uint16_t j = 0; j < num_cycles && pwm_count < MAX_PWM_BUFFER; j++) {
-            pwm_levels[pwm_count++] = level;
-        }
-    }
-    
-    return pwm_count > 0;
+static void ir_pio_start(void* ctx, const uint32_t* schedule, size_t length) {
+    (void)ctx;
+    dma_channel_transfer_from_buffer_now(dma_channel, schedule, length);
+}
+
+static const ir_output_t ir_output_pio = {
+    .start = ir_pio_start
+};
+
+// O PIO sinaliza a IRQ quando termina o espao final do quadro, ou seja,
+// quando o quadro inteiro j saiu (o DMA termina antes, com entradas ainda
+// no FIFO)
+static void ir_pio_irq_handler(void) {
+    pio_interrupt_clear(ir_pio, ir_sm);
+    ir_queue_frame_done(&ir_queue);
 }
 
 // ============================================================================
 // INICIALIZAO
 // ============================================================================
 
+// Carrega o programa da portadora no primeiro PIO com espao e um SM livre.
+// O PIO0 fica por ltimo porque  o usado pelo DVI.
+static bool claim_ir_pio(uint* offset) {
+    PIO candidates[] = { pio1, pio0 };
+    for (size_t i = 0; i < count_of(candidates); i++) {
+        PIO pio = candidates[i];
+        if (!pio_can_add_program(pio, &ir_carrier_program))
+            continue;
+        int sm = pio_claim_unused_sm(pio, false);
+        if (sm < 0)
+            continue;
+        ir_pio = pio;
+        ir_sm = sm;
+        *offset = pio_add_program(pio, &ir_carrier_program);
+        return true;
+    }
+    return false;
+}
+
+// Calcula o divisor para a portadora com o clk_sys atual
+static bool solve_carrier(uint32_t carrier_hz, ir_carrier_config_t* cfg) {
+    if (carrier_hz < IR_CARRIER_MIN_HZ || carrier_hz > IR_CARRIER_MAX_HZ ||
+        !ir_carrier_solve(clock_get_hz(clk_sys), carrier_hz, cfg)) {
+        printf("ERRO: Portadora de %lu Hz impossvel com clk_sys a %lu Hz\n",
+               (unsigned long)carrier_hz, (unsigned long)clock_get_hz(clk_sys));
+        return false;
+    }
+    return true;
+}
+
+static void report_carrier(void) {
+    printf("IR portadora: %lu.%03lu Hz (pedida %lu), clk_sys %lu Hz, divisor %u + %u/256, erro %+ld ppm, jitter %lu ns\n",
+           (unsigned long)(ir_carrier.carrier_mhz / 1000), (unsigned long)(ir_carrier.carrier_mhz % 1000),
+           (unsigned long)ir_carrier.carrier_hz, (unsigned long)ir_carrier.sys_hz,
+           ir_carrier.div_int, ir_carrier.div_frac, (long)ir_carrier.error_ppm,
+           (unsigned long)ir_carrier.jitter_ns);
+}
+
 bool custom_ir_init(uint gpio_pin) {
-    // Configurar PWM
-    gpio_set_function(gpio_pin, GPIO_FUNC_PWM);
-    pwm_slice = pwm_gpio_to_slice_num(gpio_pin);
-    pwm_channel = pwm_gpio_to_channel(gpio_pin);
-    
-    pwm_config config = pwm_get_default_config();
-    pwm_config_set_clkdiv(&config, 1.0f);
-    
-    // Para 38kHz: 125MHz / 38kHz ? 3289
-    uint16_t wrap_value = (125000000 / IR_CARRIER_FREQ) - 1;
-    pwm_config_set_wrap(&config, wrap_value);
-    
-    pwm_init(pwm_slice, &config, true);
-    pwm_set_chan_level(pwm_slice, pwm_channel, 0);  // Comea desligado
-    
+    if (!solve_carrier(IR_DEFAULT_CARRIER_HZ, &ir_carrier))
+        return false;
+    // Configurar PIO: 8 ciclos por perodo da portadora
+    uint offset;
+    if (!claim_ir_pio(&offset)) {
+        printf("ERRO: Sem PIO livre para o IR\n");
+        return false;
+    }
+    // Comea desligado
+    ir_carrier_program_init(ir_pio, ir_sm, offset, gpio_pin, ir_carrier.div_int, ir_carrier.div_frac);
     // Configurar DMA
     dma_channel = dma_claim_unused_channel(true);
-    
     dma_channel_config c = dma_channel_get_default_config(dma_channel);
-    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
-    channel_config_set_read_increment(&c, true);    // L do buffer sequencialmente
-    channel_config_set_write_increment(&c, false);  // Sempre escreve no mesmo reg PWM
-    channel_config_set_dreq(&c, DREQ_PWM_WRAP0 + pwm_slice);  // Sincroniza com PWM
-    
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);    // L a agenda sequencialmente
+    channel_config_set_write_increment(&c, false);  // Sempre escreve no TX FIFO
+    channel_config_set_dreq(&c, pio_get_dreq(ir_pio, ir_sm, true));  // Sincroniza com o FIFO
     dma_channel_configure(
         dma_channel,
         &c,
-        &pwm_hw->slice[pwm_slice].cc,  // Escreve no registrador CC do PWM
+        &ir_pio->txf[ir_sm],  // Escreve no TX FIFO do SM
         NULL,   // Origem ser definida depois
         0,      // Contagem ser definida depois
         false   // No inicia ainda
     );
-    
+    // Fila e IRQ de fim de quadro (IRQ 1 do PIO; a 0 fica para quem mais
+    // usar o bloco)
+    ir_queue_init(&ir_queue, &ir_output_pio, NULL, ir_carrier.pio_hz, IR_FRAME_GAP_US);
+    uint irq = pio_get_index(ir_pio) ? PIO1_IRQ_1 : PIO0_IRQ_1;
+    pio_interrupt_clear(ir_pio, ir_sm);
+    pio_set_irq1_source_enabled(ir_pio, pis_interrupt0 + ir_sm, true);
+    irq_set_exclusive_handler(irq, ir_pio_irq_handler);
+    irq_set_enabled(irq, true);
     ir_initialized = true;
-    
-    printf("IR DMA inicializado: PWM slice=%d, DMA chan=%d\n", pwm_slice, dma_channel);
-    
+    printf("IR DMA inicializado: PIO%d SM=%d, DMA chan=%d\n", pio_get_index(ir_pio), ir_sm, dma_channel);
+    report_carrier();
     return true;
 }
 
 // ============================================================================
-// ENVIO COM DMA
+// ENVIO ASSNCRONO
 // ============================================================================
 
-void send_raw_signal(const uint16_t* signal, size_t length) {
-    if (!ir_initialized) {
+static bool ir_ready(void) {
+    if (!ir_initialized)
         printf("ERRO: IR no inicializado!\n");
+    return ir_initialized;
+}
+
+bool send_raw_signal_async(const uint16_t* signal, size_t length, uint32_t tag) {
+    return ir_ready() && ir_queue_push(&ir_queue, signal, length, tag);
+}
+
+bool ir_send_command_async(ir_command_t cmd, uint32_t tag) {
+    if (cmd >= IR_CMD_MAX || !ir_ready())
+        return false;
+    if (ir_commands[cmd].payload)
+        return ir_queue_push_protocol(&ir_queue, &ir_protocol_ac, ir_commands[cmd].payload, tag);
+    return ir_queue_push(&ir_queue, ir_commands[cmd].signal, ir_commands[cmd].length, tag);
+}
+
+bool ir_set_temp_async(uint8_t celsius, uint32_t tag) {
+    if (celsius < AC_TEMP_MIN || celsius > AC_TEMP_MAX || !ir_ready())
+        return false;
+    uint8_t payload[sizeof(ac_temp_20)];
+    memcpy(payload, ac_temp_20, sizeof(payload));
+    payload[AC_TEMP_BYTE] = AC_TEMP_MAX - celsius;
+    return ir_queue_push_protocol(&ir_queue, &ir_protocol_ac, payload, tag);
+}
+
+void ir_set_done_callback(ir_done_callback_t done, void* ctx) {
+    ir_queue_set_callback(&ir_queue, done, ctx);
+}
+
+uint8_t ir_pending(void) {
+    return ir_queue_pending(&ir_queue);
+}
+
+const ir_queue_stats_t* ir_stats(void) {
+    return &ir_queue.stats;
+}
+
+void ir_wait(void) {
+    while (ir_queue_pending(&ir_queue))
+        tight_loop_contents();
+}
+
+// ============================================================================
+// PORTADORA
+// ============================================================================
+
+// Espera a fila esvaziar e troca o divisor. O SM est parado no pull, ento
+// o novo divisor vale a partir do prximo quadro, e as agendas passam a ser
+// calculadas com a frequncia real do PIO.
+static bool apply_carrier(uint32_t carrier_hz) {
+    ir_carrier_config_t cfg;
+    if (!ir_ready() || !solve_carrier(carrier_hz, &cfg))
+        return false;
+    ir_wait();
+    if (!ir_queue_set_pio_hz(&ir_queue, cfg.pio_hz))
+        return false;
+    pio_sm_set_clkdiv_int_frac(ir_pio, ir_sm, cfg.div_int, cfg.div_frac);
+    pio_sm_clkdiv_restart(ir_pio, ir_sm);
+    ir_carrier = cfg;
+    report_carrier();
+    return true;
+}
+
+bool ir_set_carrier(uint32_t carrier_hz) {
+    return apply_carrier(carrier_hz);
+}
+
+bool ir_clock_changed(void) {
+    return apply_carrier(ir_carrier.carrier_hz);
+}
+
+const ir_carrier_config_t* ir_carrier_info(void) {
+    return &ir_carrier;
+}
+
+// ============================================================================
+// ENVIO BLOQUEANTE
+// ============================================================================
+
+// Espera a fila esvaziar, enfileira o comando e espera o quadro sair
+static void send_command(ir_command_t cmd) {
+    ir_wait();
+    if (!ir_send_command_async(cmd, 0))
         return;
-    }
-    
-    // Preparar buffer PWM
-    if (!prepare_pwm_buffer(signal, length)) {
-        printf("ERRO: Falha ao preparar buffer\n");
+    printf("Transmitindo %u entradas via DMA...", (unsigned)ir_queue.frames[ir_queue.head].length);
+    ir_wait();
+    printf(" OK!\n");
+}
+
+void send_raw_signal(const uint16_t* signal, size_t length) {
+    // Espera a fila esvaziar, enfileira e espera o quadro sair
+    ir_wait();
+    if (!send_raw_signal_async(signal, length, 0)) {
+        printf("ERRO: Sinal com mais de %d duraes\n", IR_QUEUE_SCHEDULE_MAX - 1);
         return;
     }
-    
-    printf("Transmitindo %lu valores PWM via DMA...", pwm_count);
-    
-    // Configurar e iniciar DMA
-    dma_channel_set_read_addr(dma_channel, pwm_levels, false);
-    dma_channel_set_trans_count(dma_channel, pwm_count, true);  // true = inicia
-    
-    // Aguardar concluso
-    dma_channel_wait_for_finish_blocking(dma_channel);
-    
-    // Desligar PWM
-    pwm_set_chan_level(pwm_slice, pwm_channel, 0);
-    
+    printf("Transmitindo %u entradas via DMA...", (unsigned)ir_queue.frames[ir_queue.head].length);
+    ir_wait();
     printf(" OK!\n");
 }
 
@@ -268,32 +315,32 @@ void send_raw_signal(const uint16_t* signal, size_t length) {
 
 void turn_off_ac() {
     printf("Comando: DESLIGAR AC\n");
-    send_raw_signal(rawSignal_off, sizeof(rawSignal_off) / sizeof(uint16_t));
+    send_command(IR_CMD_OFF);
 }
 
 void turn_on_ac() {
     printf("Comando: LIGAR AC\n");
-    send_raw_signal(rawSignal_on, sizeof(rawSignal_on) / sizeof(uint16_t));
+    send_command(IR_CMD_ON);
 }
 
 void set_temp_22c() {
     printf("Comando: TEMPERATURA 22C\n");
-    send_raw_signal(temp_para_22, sizeof(temp_para_22) / sizeof(uint16_t));
+    send_command(IR_CMD_TEMP_22);
 }
 
 void set_temp_20c() {
     printf("Comando: TEMPERATURA 20C\n");
-    send_raw_signal(temp_para_20, sizeof(temp_para_20) / sizeof(uint16_t));
+    send_command(IR_CMD_TEMP_20);
 }
 
 void set_fan_level_1() {
     printf("Comando: VENTILADOR NVEL 1\n");
-    send_raw_signal(fan_1, sizeof(fan_1) / sizeof(uint16_t));
+    send_command(IR_CMD_FAN_1);
 }
 
 void set_fan_level_2() {
     printf("Comando: VENTILADOR NVEL 2\n");
-    send_raw_signal(fan_2, sizeof(fan_2) / sizeof(uint16_t));
+    send_command(IR_CMD_FAN_2);
 }
 
 void ir_demo() {
@@ -8,21 +8,102 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "ir_queue.h"
 
 /**
- * Inicializa o sistema IR com DMA
+ * Comandos gravados do AC
+ */
+typedef enum {
+    IR_CMD_OFF,
+    IR_CMD_ON,
+    IR_CMD_TEMP_22,
+    IR_CMD_TEMP_20,
+    IR_CMD_FAN_1,
+    IR_CMD_FAN_2,
+    IR_CMD_MAX
+} ir_command_t;
+
+// Faixa aceita para a portadora; os receptores comuns so de 36, 38, 40 ou
+// 56 kHz
+#define IR_CARRIER_MIN_HZ 30000
+#define IR_CARRIER_MAX_HZ 60000
+
+/**
+ * Inicializa o sistema IR com DMA, com portadora de 38 kHz calculada a partir
+ * do clk_sys atual
  * @param gpio_pin Pino GPIO para sada IR
  * @return true se inicializado com sucesso
  */
 bool custom_ir_init(uint gpio_pin);
 
 /**
- * Envia um sinal RAW via DMA
- * @param signal Array de timings em microsegundos
- * @param length Tamanho do array
+ * Troca a portadora. Espera a fila esvaziar antes.
+ * @return false se a frequncia estiver fora da faixa ou no houver divisor
+ */
+bool ir_set_carrier(uint32_t carrier_hz);
+
+/**
+ * Recalcula o divisor depois de uma mudana do clk_sys (set_sys_clock_khz).
+ * Chame ir_wait() antes de mudar o clock, seno o quadro no ar sai com os
+ * tempos errados.
+ */
+bool ir_clock_changed(void);
+
+/**
+ * Divisor e erro da portadora atual
+ */
+const ir_carrier_config_t* ir_carrier_info(void);
+
+/**
+ * Envia um sinal RAW via DMA e PIO, uma entrada de agenda por marca/espao,
+ * e s retorna quando ele termina
+ * @param signal Array de timings em microsegundos (marca, espao, ...)
+ * @param length Tamanho do array, no mximo 511
  */
 void send_raw_signal(const uint16_t* signal, size_t length);
 
+/**
+ * Enfileira um sinal RAW e retorna na hora. Os quadros saem em ordem, com
+ * 100 ms de intervalo entre eles.
+ * @param signal Array de timings; no  copiado, tem que durar at o envio
+ * @param length Tamanho do array, no mximo 511
+ * @param tag Valor entregue ao callback quando o quadro terminar
+ * @return false se a fila estiver cheia (IR_QUEUE_LEN quadros)
+ */
+bool send_raw_signal_async(const uint16_t* signal, size_t length, uint32_t tag);
+
+/**
+ * Enfileira um dos comandos gravados, como send_raw_signal_async()
+ */
+bool ir_send_command_async(ir_command_t cmd, uint32_t tag);
+
+/**
+ * Enfileira o comando de temperatura do AC, gerado pelo protocolo
+ * @param celsius De 16 a 31
+ * @return false se a temperatura for invlida ou a fila estiver cheia
+ */
+bool ir_set_temp_async(uint8_t celsius, uint32_t tag);
+
+/**
+ * Define a funo chamada, dentro da IRQ do PIO, no fim de cada quadro
+ */
+void ir_set_done_callback(ir_done_callback_t done, void* ctx);
+
+/**
+ * Quadros na fila, contando o que est no ar
+ */
+uint8_t ir_pending(void);
+
+/**
+ * Totais da fila: aceitos, enviados e recusados
+ */
+const ir_queue_stats_t* ir_stats(void);
+
+/**
+ * Espera a fila esvaziar
+ */
+void ir_wait(void);
+
 /**
  * Funes de convenincia para controle do AC
  */
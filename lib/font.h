@@ -101,4 +101,103 @@ static uint8_t font[] = {
 0x00, 0x41, 0x41, 0x77, 0x3E, 0x08, 0x08, 0x00, // }
 0x02, 0x03, 0x01, 0x03, 0x02, 0x03, 0x01, 0x00  // ~
 
-};
\ No newline at end of file
+};
+
+// Métrica proporcional de cada caractere: primeira coluna usada e largura
+static const uint8_t font_metrics[] = {
+0, 3, //  
+3, 2, // !
+1, 5, // "
+0, 7, // #
+0, 7, // $
+0, 7, // %
+0, 7, // &
+1, 3, // '
+2, 4, // (
+2, 4, // )
+0, 8, // *
+1, 6, // +
+2, 3, // ,
+1, 6, // -
+3, 2, // .
+0, 7, // /
+0, 7, // 0
+1, 6, // 1
+0, 7, // 2
+0, 7, // 3
+0, 7, // 4
+0, 7, // 5
+0, 7, // 6
+0, 7, // 7
+0, 7, // 8
+0, 7, // 9
+3, 2, // :
+2, 3, // ;
+1, 5, // <
+1, 6, // =
+2, 5, // >
+1, 6, // ?
+0, 7, // @
+0, 7, // A
+0, 7, // B
+0, 7, // C
+0, 7, // D
+0, 7, // E
+0, 7, // F
+0, 7, // G
+0, 7, // H
+1, 6, // I
+0, 7, // J
+0, 7, // K
+0, 7, // L
+0, 7, // M
+0, 7, // N
+0, 7, // O
+0, 7, // P
+0, 7, // Q
+0, 7, // R
+0, 7, // S
+0, 8, // T
+0, 7, // U
+0, 7, // V
+0, 7, // W
+0, 7, // X
+0, 7, // Y
+0, 7, // Z
+2, 4, // [
+0, 7, // "\"
+2, 4, // ]
+0, 7, // ^
+0, 8, // _
+3, 3, // `
+0, 7, // a
+0, 7, // b
+0, 7, // c
+0, 7, // d
+0, 7, // e
+1, 6, // f
+0, 7, // g
+0, 7, // h
+2, 4, // i
+0, 7, // j
+0, 7, // k
+2, 4, // l
+0, 7, // m
+0, 7, // n
+0, 7, // o
+0, 7, // p
+0, 7, // q
+0, 7, // r
+0, 7, // s
+1, 6, // t
+0, 7, // u
+0, 7, // v
+0, 7, // w
+0, 7, // x
+0, 7, // y
+0, 7, // z
+1, 6, // {
+3, 2, // |
+1, 6, // }
+0, 7, // ~
+};
@@ -0,0 +1,292 @@
+// Fonte 16x16: a fonte 8x8 de font.h com cada pixel dobrado. Cada caractere
+// tem 32 bytes: as 16 colunas da página de cima e depois as da de baixo.
+static const uint8_t font_large[] = {
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, //  
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // !
+0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // "
+0x30, 0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x30, 0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x30, 0x30, 0x00, 0x00,
+0x03, 0x03, 0x3F, 0x3F, 0x3F, 0x3F, 0x03, 0x03, 0x3F, 0x3F, 0x3F, 0x3F, 0x03, 0x03, 0x00, 0x00, // #
+0x30, 0x30, 0xFC, 0xFC, 0xCC, 0xCC, 0xCF, 0xCF, 0xCF, 0xCF, 0xCC, 0xCC, 0x0C, 0x0C, 0x00, 0x00,
+0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x3C, 0x3C, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, // $
+0x3C, 0x3C, 0x3C, 0x3C, 0x00, 0x00, 0xC0, 0xC0, 0xF0, 0xF0, 0x3C, 0x3C, 0x0C, 0x0C, 0x00, 0x00,
+0x30, 0x30, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x3C, 0x3C, 0x3C, 0x3C, 0x00, 0x00, // %
+0x00, 0x00, 0xCC, 0xCC, 0xFF, 0xFF, 0xF3, 0xF3, 0x3F, 0x3F, 0xCC, 0xCC, 0xC0, 0xC0, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x33, 0x33, 0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, // &
+0x00, 0x00, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // '
+0x00, 0x00, 0x00, 0x00, 0xF0, 0xF0, 0xFC, 0xFC, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, // (
+0x00, 0x00, 0x00, 0x00, 0x03, 0x03, 0x0F, 0x0F, 0xFC, 0xFC, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, // )
+0xC0, 0xC0, 0xCC, 0xCC, 0xFC, 0xFC, 0xF0, 0xF0, 0xF0, 0xF0, 0xFC, 0xFC, 0xCC, 0xCC, 0xC0, 0xC0,
+0x00, 0x00, 0x0C, 0x0C, 0x0F, 0x0F, 0x03, 0x03, 0x03, 0x03, 0x0F, 0x0F, 0x0C, 0x0C, 0x00, 0x00, // *
+0x00, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xFC, 0xFC, 0xFC, 0xFC, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x0F, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // +
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0xC0, 0xC0, 0xFC, 0xFC, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // ,
+0x00, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // -
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x3C, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // .
+0x00, 0x00, 0x00, 0x00, 0xC0, 0xC0, 0xF0, 0xF0, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00,
+0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // /
+0xFC, 0xFC, 0xFF, 0xFF, 0xC3, 0xC3, 0xF3, 0xF3, 0x3F, 0x3F, 0xFF, 0xFF, 0xFC, 0xFC, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x33, 0x33, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // 0
+0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, // 1
+0x0C, 0x0C, 0xCF, 0xCF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x3C, 0x3C, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, // 2
+0x03, 0x03, 0x03, 0x03, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x3C, 0x3C, 0x00, 0x00,
+0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // 3
+0xFC, 0xFC, 0xFC, 0xFC, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00,
+0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x3F, 0x3F, 0x3F, 0x3F, 0x03, 0x03, 0x00, 0x00, // 4
+0x3F, 0x3F, 0x3F, 0x3F, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xF3, 0xF3, 0xC3, 0xC3, 0x00, 0x00,
+0x0C, 0x0C, 0x3C, 0x3C, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // 5
+0xFC, 0xFC, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0x00, 0x00, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // 6
+0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0xC3, 0xC3, 0xFF, 0xFF, 0x3F, 0x3F, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x3C, 0x3C, 0x3F, 0x3F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 7
+0x3C, 0x3C, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x3C, 0x3C, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // 8
+0x3C, 0x3C, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xFC, 0xFC, 0x00, 0x00,
+0x00, 0x00, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // 9
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x3C, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x3C, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // :
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x3C, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0xC0, 0xC0, 0xFC, 0xFC, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // ;
+0x00, 0x00, 0xC0, 0xC0, 0xF0, 0xF0, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, // <
+0x00, 0x00, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00,
+0x00, 0x00, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00, // =
+0x00, 0x00, 0x00, 0x00, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, // >
+0x00, 0x00, 0x0C, 0x0C, 0x0F, 0x0F, 0xC3, 0xC3, 0xF3, 0xF3, 0x3F, 0x3F, 0x0C, 0x0C, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // ?
+0xFC, 0xFC, 0xFF, 0xFF, 0x03, 0x03, 0xF3, 0xF3, 0xF3, 0xF3, 0xFF, 0xFF, 0xFC, 0xFC, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x00, 0x00, // @
+0xF0, 0xF0, 0xFC, 0xFC, 0x0F, 0x0F, 0x03, 0x03, 0x0F, 0x0F, 0xFC, 0xFC, 0xF0, 0xF0, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, // A
+0xFF, 0xFF, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x3C, 0x3C, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // B
+0xFC, 0xFC, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x0F, 0x0F, 0x0C, 0x0C, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3C, 0x3C, 0x0C, 0x0C, 0x00, 0x00, // C
+0xFF, 0xFF, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, 0x0F, 0x0F, 0xFC, 0xFC, 0xF0, 0xF0, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, // D
+0xFF, 0xFF, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, // E
+0xFF, 0xFF, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // F
+0xFC, 0xFC, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x0F, 0x0F, 0x0C, 0x0C, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x33, 0x33, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // G
+0xFF, 0xFF, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, // H
+0x00, 0x00, 0x03, 0x03, 0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00,
+0x00, 0x00, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, // I
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00,
+0x0C, 0x0C, 0x3C, 0x3C, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // J
+0xFF, 0xFF, 0xFF, 0xFF, 0xC0, 0xC0, 0xF0, 0xF0, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x30, 0x30, 0x00, 0x00, // K
+0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, // L
+0xFF, 0xFF, 0xFF, 0xFF, 0xFC, 0xFC, 0xF0, 0xF0, 0xFC, 0xFC, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x03, 0x03, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, // M
+0xFF, 0xFF, 0xFF, 0xFF, 0x3C, 0x3C, 0xF0, 0xF0, 0xC0, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x03, 0x03, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, // N
+0xFC, 0xFC, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0xFF, 0xFF, 0xFC, 0xFC, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // O
+0xFF, 0xFF, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x3C, 0x3C, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // P
+0xFC, 0xFC, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0xFF, 0xFF, 0xFC, 0xFC, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x3F, 0x3F, 0x3C, 0x3C, 0xFF, 0xFF, 0xCF, 0xCF, 0x00, 0x00, // Q
+0xFF, 0xFF, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x3C, 0x3C, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x30, 0x30, 0x00, 0x00, // R
+0x3C, 0x3C, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xCF, 0xCF, 0x0C, 0x0C, 0x00, 0x00,
+0x0C, 0x0C, 0x3C, 0x3C, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // S
+0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // T
+0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, // U
+0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00,
+0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x3C, 0x3C, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, // V
+0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x3C, 0x3C, 0x0F, 0x0F, 0x3C, 0x3C, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // W
+0x0F, 0x0F, 0x3F, 0x3F, 0xF0, 0xF0, 0xC0, 0xC0, 0xF0, 0xF0, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00,
+0x3C, 0x3C, 0x3F, 0x3F, 0x03, 0x03, 0x00, 0x00, 0x03, 0x03, 0x3F, 0x3F, 0x3C, 0x3C, 0x00, 0x00, // X
+0x3F, 0x3F, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xFF, 0xFF, 0x3F, 0x3F, 0x00, 0x00,
+0x30, 0x30, 0x30, 0x30, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // Y
+0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0xC3, 0xC3, 0xF3, 0xF3, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00,
+0x30, 0x30, 0x3C, 0x3C, 0x3F, 0x3F, 0x33, 0x33, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, // Z
+0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, // [
+0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x00, 0x00, // "\"
+0x00, 0x00, 0x00, 0x00, 0x03, 0x03, 0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, // ]
+0xC0, 0xC0, 0xF0, 0xF0, 0x3C, 0x3C, 0x0F, 0x0F, 0x3C, 0x3C, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // ^
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, // _
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // `
+0x00, 0x00, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+0x0C, 0x0C, 0x3F, 0x3F, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, // a
+0xFF, 0xFF, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // b
+0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3C, 0x3C, 0x0C, 0x0C, 0x00, 0x00, // c
+0x00, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, // d
+0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x03, 0x03, 0x00, 0x00, // e
+0x00, 0x00, 0xC0, 0xC0, 0xFC, 0xFC, 0xFF, 0xFF, 0xC3, 0xC3, 0x0F, 0x0F, 0x0C, 0x0C, 0x00, 0x00,
+0x00, 0x00, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // f
+0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00,
+0xC3, 0xC3, 0xCF, 0xCF, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xFF, 0xFF, 0x3F, 0x3F, 0x00, 0x00, // g
+0xFF, 0xFF, 0xFF, 0xFF, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, // h
+0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0xF3, 0xF3, 0xF3, 0xF3, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, // i
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF3, 0xF3, 0xF3, 0xF3, 0x00, 0x00,
+0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xFF, 0xFF, 0x3F, 0x3F, 0x00, 0x00, // j
+0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x03, 0x03, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x30, 0x30, 0x00, 0x00, // k
+0x00, 0x00, 0x00, 0x00, 0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, // l
+0xF0, 0xF0, 0xF0, 0xF0, 0xC0, 0xC0, 0xC0, 0xC0, 0xF0, 0xF0, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x03, 0x03, 0x3F, 0x3F, 0x03, 0x03, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, // m
+0xF0, 0xF0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, // n
+0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // o
+0xF0, 0xF0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+0xFF, 0xFF, 0xFF, 0xFF, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, // p
+0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00,
+0x03, 0x03, 0x0F, 0x0F, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, // q
+0xF0, 0xF0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // r
+0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00,
+0x30, 0x30, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x3F, 0x0C, 0x0C, 0x00, 0x00, // s
+0x00, 0x00, 0x30, 0x30, 0x30, 0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, // t
+0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, // u
+0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00,
+0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x3C, 0x3C, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, // v
+0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00,
+0x0F, 0x0F, 0x3F, 0x3F, 0x3C, 0x3C, 0x0F, 0x0F, 0x3C, 0x3C, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, // w
+0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00, 0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x00, 0x00,
+0x30, 0x30, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x30, 0x30, 0x00, 0x00, // x
+0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00,
+0xC3, 0xC3, 0xCF, 0xCF, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xFF, 0xFF, 0x3F, 0x3F, 0x00, 0x00, // y
+0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xF0, 0xF0, 0x30, 0x30, 0x00, 0x00,
+0x30, 0x30, 0x3C, 0x3C, 0x3F, 0x3F, 0x33, 0x33, 0x33, 0x33, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, // z
+0x00, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xFC, 0xFC, 0x3F, 0x3F, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, // {
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // |
+0x00, 0x00, 0x03, 0x03, 0x03, 0x03, 0x3F, 0x3F, 0xFC, 0xFC, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00,
+0x00, 0x00, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // }
+0x0C, 0x0C, 0x0F, 0x0F, 0x03, 0x03, 0x0F, 0x0F, 0x0C, 0x0C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 // ~
+};
+
+static const uint8_t font_large_metrics[] = {
+0, 6, //  
+6, 4, // !
+2, 10, // "
+0, 14, // #
+0, 14, // $
+0, 14, // %
+0, 14, // &
+2, 6, // '
+4, 8, // (
+4, 8, // )
+0, 16, // *
+2, 12, // +
+4, 6, // ,
+2, 12, // -
+6, 4, // .
+0, 14, // /
+0, 14, // 0
+2, 12, // 1
+0, 14, // 2
+0, 14, // 3
+0, 14, // 4
+0, 14, // 5
+0, 14, // 6
+0, 14, // 7
+0, 14, // 8
+0, 14, // 9
+6, 4, // :
+4, 6, // ;
+2, 10, // <
+2, 12, // =
+4, 10, // >
+2, 12, // ?
+0, 14, // @
+0, 14, // A
+0, 14, // B
+0, 14, // C
+0, 14, // D
+0, 14, // E
+0, 14, // F
+0, 14, // G
+0, 14, // H
+2, 12, // I
+0, 14, // J
+0, 14, // K
+0, 14, // L
+0, 14, // M
+0, 14, // N
+0, 14, // O
+0, 14, // P
+0, 14, // Q
+0, 14, // R
+0, 14, // S
+0, 16, // T
+0, 14, // U
+0, 14, // V
+0, 14, // W
+0, 14, // X
+0, 14, // Y
+0, 14, // Z
+4, 8, // [
+0, 14, // "\"
+4, 8, // ]
+0, 14, // ^
+0, 16, // _
+6, 6, // `
+0, 14, // a
+0, 14, // b
+0, 14, // c
+0, 14, // d
+0, 14, // e
+2, 12, // f
+0, 14, // g
+0, 14, // h
+4, 8, // i
+0, 14, // j
+0, 14, // k
+4, 8, // l
+0, 14, // m
+0, 14, // n
+0, 14, // o
+0, 14, // p
+0, 14, // q
+0, 14, // r
+0, 14, // s
+2, 12, // t
+0, 14, // u
+0, 14, // v
+0, 14, // w
+0, 14, // x
+0, 14, // y
+0, 14, // z
+2, 12, // {
+6, 4, // |
+2, 12, // }
+0, 14, // ~
+};
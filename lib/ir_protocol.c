@@ -0,0 +1,53 @@
+#include "ir_protocol.h"
+
+// Saída de tools/ir_infer.py sobre tools/ir_captures.txt
+const ir_protocol_t ir_protocol_ac = {
+    .header_mark = 3607,
+    .header_space = 1760,
+    .bit_mark = 404,
+    .zero_space = 372,
+    .one_space = 1333,
+    .footer_mark = 391,
+    .length = 14,
+    .lsb_first = true,
+    .checksum = IR_CHECKSUM_SUM
+};
+
+uint8_t ir_protocol_checksum(const ir_protocol_t *p, const uint8_t *payload) {
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < p->length - 1; i++) {
+        if (p->checksum == IR_CHECKSUM_XOR)
+            sum ^= payload[i];
+        else
+            sum += payload[i];
+    }
+    return sum;
+}
+
+size_t ir_protocol_encode(const ir_protocol_t *p, const uint8_t *payload, uint32_t pio_hz, uint32_t gap_us,
+                          uint32_t *out, size_t max) {
+    size_t n = ir_protocol_entries(p);
+    if (n > max || p->length > IR_PROTOCOL_MAX_BYTES)
+        return 0;
+    // Só seis durações distintas: converte uma vez e repete as entradas
+    uint32_t bit_mark = ir_schedule_from_us(true, p->bit_mark, pio_hz);
+    uint32_t bit_space[2] = {
+        ir_schedule_from_us(false, p->zero_space, pio_hz),
+        ir_schedule_from_us(false, p->one_space, pio_hz)
+    };
+    uint8_t payload_len = ir_protocol_payload_len(p);
+    uint32_t *e = out;
+    *e++ = ir_schedule_from_us(true, p->header_mark, pio_hz);
+    *e++ = ir_schedule_from_us(false, p->header_space, pio_hz);
+    for (uint8_t i = 0; i < p->length; i++) {
+        uint8_t byte = i < payload_len ? payload[i] : ir_protocol_checksum(p, payload);
+        for (uint8_t j = 0; j < 8; j++) {
+            bool bit = p->lsb_first ? (byte >> j) & 1 : (byte >> (7 - j)) & 1;
+            *e++ = bit_mark;
+            *e++ = bit_space[bit];
+        }
+    }
+    *e++ = ir_schedule_from_us(true, p->footer_mark, pio_hz);
+    *e++ = ir_schedule_from_us(false, gap_us, pio_hz) | IR_SCHEDULE_END;
+    return n;
+}
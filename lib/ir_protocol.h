@@ -0,0 +1,59 @@
+#ifndef IR_PROTOCOL_H
+#define IR_PROTOCOL_H
+
+// Codificador de quadros IR por protocolo. Em vez das durações capturadas,
+// cada comando guarda só os seus bytes, e o quadro é gerado bit a bit direto
+// na agenda (ir_schedule.h): cabeçalho, um par marca/espaço por bit, o
+// checksum, a marca final e o espaço de fim de quadro. Os tempos e o formato
+// vêm de tools/ir_infer.py rodado sobre as capturas (tools/ir_captures.txt).
+
+#include "ir_schedule.h"
+
+#define IR_PROTOCOL_MAX_BYTES 24
+
+typedef enum {
+    IR_CHECKSUM_NONE,
+    IR_CHECKSUM_SUM,  // soma dos bytes anteriores, módulo 256
+    IR_CHECKSUM_XOR
+} ir_checksum_t;
+
+typedef struct {
+    // Durações em microsegundos
+    uint16_t header_mark, header_space;
+    uint16_t bit_mark;
+    uint16_t zero_space, one_space;
+    uint16_t footer_mark;
+    // Bytes por quadro, contando o checksum (último byte)
+    uint8_t length;
+    bool lsb_first;
+    uint8_t checksum;
+} ir_protocol_t;
+
+// Quadro de 14 bytes do AC (23 CB 26 01 00 ...), com a soma dos 13
+// primeiros no último
+extern const ir_protocol_t ir_protocol_ac;
+
+// Bytes de payload que quem chama fornece
+static inline uint8_t ir_protocol_payload_len(const ir_protocol_t *p) {
+    return p->checksum != IR_CHECKSUM_NONE ? p->length - 1 : p->length;
+}
+
+// Entradas da agenda de um quadro: cabeçalho, bits, marca final e espaço
+// de fim
+static inline size_t ir_protocol_entries(const ir_protocol_t *p) {
+    return 2 + 16 * (size_t)p->length + 2;
+}
+
+uint8_t ir_protocol_checksum(const ir_protocol_t *p, const uint8_t *payload);
+
+/**
+ * Gera a agenda de um quadro
+ * @param payload ir_protocol_payload_len() bytes; o checksum é calculado aqui
+ * @param pio_hz Frequência do PIO (portadora * IR_CARRIER_CYCLES)
+ * @param gap_us Duração do espaço de fim de quadro
+ * @return Número de entradas, ou 0 se não couber em out
+ */
+size_t ir_protocol_encode(const ir_protocol_t *p, const uint8_t *payload, uint32_t pio_hz, uint32_t gap_us,
+                          uint32_t *out, size_t max);
+
+#endif // IR_PROTOCOL_H
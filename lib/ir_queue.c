@@ -0,0 +1,122 @@
+#include <string.h>
+#include "ir_queue.h"
+#if !PICO_NO_HARDWARE
+#include "hardware/sync.h"
+#endif
+
+// ir_queue_push() roda no laço principal e ir_queue_frame_done() na IRQ
+static inline uint32_t queue_lock(void) {
+#if !PICO_NO_HARDWARE
+    return save_and_disable_interrupts();
+#else
+    return 0;
+#endif
+}
+
+static inline void queue_unlock(uint32_t ints) {
+#if !PICO_NO_HARDWARE
+    restore_interrupts(ints);
+#else
+    (void)ints;
+#endif
+}
+
+void ir_queue_init(ir_queue_t *q, const ir_output_t *output, void *ctx, uint32_t pio_hz, uint32_t gap_us) {
+    q->output = output;
+    q->output_ctx = ctx;
+    q->pio_hz = pio_hz;
+    q->gap_us = gap_us;
+    q->done = NULL;
+    q->done_ctx = NULL;
+    q->head = 0;
+    q->count = 0;
+    q->busy = false;
+    q->stats = (ir_queue_stats_t){0};
+}
+
+void ir_queue_set_callback(ir_queue_t *q, ir_done_callback_t done, void *ctx) {
+    uint32_t ints = queue_lock();
+    q->done = done;
+    q->done_ctx = ctx;
+    queue_unlock(ints);
+}
+
+bool ir_queue_set_pio_hz(ir_queue_t *q, uint32_t pio_hz) {
+    uint32_t ints = queue_lock();
+    bool idle = q->count == 0;
+    if (idle)
+        q->pio_hz = pio_hz;
+    queue_unlock(ints);
+    return idle;
+}
+
+// Entrega à saída a agenda do quadro da frente, já pronta
+static void queue_start(ir_queue_t *q) {
+    const ir_frame_t *f = &q->frames[q->head];
+    q->busy = true;
+    q->output->start(q->output_ctx, f->schedule, f->length);
+}
+
+// Reserva o lugar do fim da fila, se houver. A agenda é montada depois, fora
+// da seção crítica; enquanto isso o quadro conta na fila mas não sai, e
+// ir_queue_set_pio_hz() não troca a frequência que o push está usando.
+static ir_frame_t *queue_reserve(ir_queue_t *q, bool fits) {
+    uint32_t ints = queue_lock();
+    ir_frame_t *f = NULL;
+    if (fits && q->count < IR_QUEUE_LEN) {
+        f = &q->frames[(q->head + q->count++) % IR_QUEUE_LEN];
+        f->ready = false;
+    } else {
+        ++q->stats.rejected;
+    }
+    queue_unlock(ints);
+    return f;
+}
+
+// Marca a agenda pronta e, com a saída parada, começa o quadro se ele for o
+// da frente. Se não for, o da frente ainda está sendo montado (o push foi
+// interrompido por um push da IRQ) e este sai depois dele.
+static void queue_commit(ir_queue_t *q, ir_frame_t *f, uint32_t tag) {
+    uint32_t ints = queue_lock();
+    f->tag = tag;
+    f->ready = true;
+    ++q->stats.queued;
+    if (!q->busy && f == &q->frames[q->head])
+        queue_start(q);
+    queue_unlock(ints);
+}
+
+bool ir_queue_push(ir_queue_t *q, const uint16_t *signal, size_t length, uint32_t tag) {
+    // Um sinal que termina numa marca ganha o espaço final
+    ir_frame_t *f = queue_reserve(q, length && length + length % 2 <= IR_QUEUE_SCHEDULE_MAX);
+    if (!f)
+        return false;
+    f->length = ir_schedule_from_raw(signal, length, q->pio_hz, q->gap_us, f->schedule, IR_QUEUE_SCHEDULE_MAX);
+    queue_commit(q, f, tag);
+    return true;
+}
+
+bool ir_queue_push_protocol(ir_queue_t *q, const ir_protocol_t *protocol, const uint8_t *payload, uint32_t tag) {
+    ir_frame_t *f = queue_reserve(q, protocol->length <= IR_PROTOCOL_MAX_BYTES &&
+                                         ir_protocol_entries(protocol) <= IR_QUEUE_SCHEDULE_MAX);
+    if (!f)
+        return false;
+    f->length = ir_protocol_encode(protocol, payload, q->pio_hz, q->gap_us, f->schedule, IR_QUEUE_SCHEDULE_MAX);
+    queue_commit(q, f, tag);
+    return true;
+}
+
+void ir_queue_frame_done(ir_queue_t *q) {
+    if (!q->busy)
+        return;
+    q->busy = false;
+    uint32_t tag = q->frames[q->head].tag;
+    q->head = (q->head + 1) % IR_QUEUE_LEN;
+    ++q->stats.sent;
+    // O próximo quadro sai antes do callback, para não alongar o intervalo.
+    // Se ainda estiver sendo montado, sai no queue_commit() dele.
+    if (--q->count && q->frames[q->head].ready)
+        queue_start(q);
+    if (q->done)
+        q->done(q->done_ctx, tag);
+}
@@ -0,0 +1,101 @@
+#ifndef IR_QUEUE_H
+#define IR_QUEUE_H
+
+// Fila limitada de quadros IR com envio assíncrono. ir_queue_push() e
+// ir_queue_push_protocol() montam a agenda do quadro (ir_schedule.h,
+// ir_protocol.h) no lugar dele na fila e retornam; o quadro da frente vai
+// para a saída. Quando a saída avisa o fim do quadro com
+// ir_queue_frame_done() (no RP2040, a IRQ do PIO) o próximo quadro começa na
+// hora e o callback é chamado, sem depender do laço principal.
+//
+// A agenda é montada fora da seção crítica: com as interrupções desligadas
+// só se reserva o lugar e se atualizam os índices, e a IRQ só entrega à
+// saída uma agenda pronta. Sinais RAW e payloads podem ser reusados assim
+// que o push retorna.
+
+#include "ir_protocol.h"
+
+#ifndef IR_QUEUE_LEN
+#define IR_QUEUE_LEN 4
+#endif
+#define IR_QUEUE_SCHEDULE_MAX 512
+
+// Como a agenda chega ao LED. start inicia a transmissão e retorna na hora;
+// a saída chama ir_queue_frame_done() quando o último espaço termina. ctx é
+// passado de volta em todas as chamadas.
+typedef struct {
+    void (*start)(void *ctx, const uint32_t *schedule, size_t length);
+} ir_output_t;
+
+// Chamado no fim de cada quadro com o tag dado a ir_queue_push(). No RP2040
+// roda dentro da IRQ, então tem que ser curto.
+typedef void (*ir_done_callback_t)(void *ctx, uint32_t tag);
+
+typedef struct {
+    uint32_t schedule[IR_QUEUE_SCHEDULE_MAX];
+    size_t length;      // entradas da agenda
+    uint32_t tag;
+    // Agenda montada; um quadro reservado e ainda não pronto segura os de trás
+    bool ready;
+} ir_frame_t;
+
+typedef struct {
+    uint32_t queued;    // aceitos por ir_queue_push()
+    uint32_t sent;      // concluídos
+    uint32_t rejected;  // fila cheia ou sinal grande demais
+} ir_queue_stats_t;
+
+typedef struct {
+    const ir_output_t *output;
+    void *output_ctx;
+    uint32_t pio_hz;
+    uint32_t gap_us;
+    ir_done_callback_t done;
+    void *done_ctx;
+    ir_frame_t frames[IR_QUEUE_LEN];
+    // count conta os lugares reservados a partir de head, prontos ou não;
+    // frames[head] é o quadro no ar sempre que busy
+    volatile uint8_t head, count;
+    volatile bool busy;
+    ir_queue_stats_t stats;
+} ir_queue_t;
+
+/**
+ * Inicializa a fila vazia
+ * @param pio_hz Frequência real do PIO (ir_carrier_config_t.pio_hz)
+ * @param gap_us Intervalo mínimo depois de cada quadro
+ */
+void ir_queue_init(ir_queue_t *q, const ir_output_t *output, void *ctx, uint32_t pio_hz, uint32_t gap_us);
+
+void ir_queue_set_callback(ir_queue_t *q, ir_done_callback_t done, void *ctx);
+
+/**
+ * Troca a frequência do PIO usada nas próximas agendas, depois de mudar o
+ * divisor ou o clk_sys
+ * @return false se ainda houver quadro na fila; a frequência não muda
+ */
+bool ir_queue_set_pio_hz(ir_queue_t *q, uint32_t pio_hz);
+
+/**
+ * Enfileira um sinal RAW (marca, espaço, ... em microsegundos), iniciando o
+ * envio se a saída estiver livre
+ * @return false se a fila estiver cheia ou o sinal não couber na agenda
+ */
+bool ir_queue_push(ir_queue_t *q, const uint16_t *signal, size_t length, uint32_t tag);
+
+/**
+ * Enfileira um quadro gerado pelo protocolo a partir do payload
+ * (ir_protocol_payload_len() bytes, sem o checksum)
+ * @return false se a fila estiver cheia ou o quadro não couber na agenda
+ */
+bool ir_queue_push_protocol(ir_queue_t *q, const ir_protocol_t *protocol, const uint8_t *payload, uint32_t tag);
+
+// Fim do quadro no ar. Chamada pela saída.
+void ir_queue_frame_done(ir_queue_t *q);
+
+// Quadros na fila, contando o que está no ar
+static inline uint8_t ir_queue_pending(const ir_queue_t *q) {
+    return q->count;
+}
+
+#endif // IR_QUEUE_H
@@ -0,0 +1,35 @@
+#include <string.h>
+#include "ir_queue_host.h"
+
+void ir_queue_host_reset(ir_queue_host_t *out, ir_queue_t *queue) {
+    memset(out, 0, sizeof(*out));
+    out->queue = queue;
+}
+
+static void host_start(void *ctx, const uint32_t *schedule, size_t length) {
+    ir_queue_host_t *out = ctx;
+    if (out->frame_end)
+        ++out->overlap_errors;
+    ir_schedule_host_stats_t st;
+    ir_schedule_host_decode(schedule, length, NULL, 0, &st);
+    out->frame_end = out->now + st.irq_cycle;
+    out->busy_cycles += st.irq_cycle;
+    ++out->frames_started;
+    out->entries_sent += length;
+}
+
+void ir_queue_host_advance(ir_queue_host_t *out, uint64_t cycles) {
+    uint64_t until = out->now + cycles;
+    // ir_queue_frame_done() pode iniciar o próximo quadro, que começa no
+    // ciclo em que o anterior terminou
+    while (out->frame_end && out->frame_end <= until) {
+        out->now = out->frame_end;
+        out->frame_end = 0;
+        ir_queue_frame_done(out->queue);
+    }
+    out->now = until;
+}
+
+const ir_output_t ir_output_host = {
+    .start = host_start
+};
@@ -0,0 +1,40 @@
+#ifndef IR_QUEUE_HOST_H
+#define IR_QUEUE_HOST_H
+
+// Saída IR simulada, para compilar lib/ir_queue.c no host (PICO_NO_HARDWARE)
+// sem PIO nem DMA. ir_output_host recebe as agendas como o DMA receberia, e
+// o tempo só anda em ir_queue_host_advance(): a duração de cada quadro é a
+// do programa ir_carrier.pio executado por ir_schedule_host_decode(), e
+// ir_queue_frame_done() é chamada no ciclo em que o PIO sinalizaria a IRQ.
+// Assim dá para conferir a semântica da fila (ordem, limite, callbacks,
+// reentrada) e o tempo total no ar.
+
+#include "ir_queue.h"
+#include "ir_schedule_host.h"
+
+typedef struct {
+    ir_queue_t *queue;
+    // Ciclos do PIO desde o reset
+    uint64_t now;
+    // Fim do quadro no ar, em ciclos desde o reset; 0 = parado
+    uint64_t frame_end;
+    uint64_t busy_cycles;
+    uint32_t frames_started;
+    uint32_t entries_sent;
+    // Quadros iniciados com outro ainda no ar. A fila nunca deve fazer isso.
+    uint32_t overlap_errors;
+} ir_queue_host_t;
+
+extern const ir_output_t ir_output_host;
+
+// Saída parada, tempo zero. queue é a fila a avisar no fim de cada quadro.
+void ir_queue_host_reset(ir_queue_host_t *out, ir_queue_t *queue);
+
+// Avança o tempo, terminando os quadros que caírem no intervalo
+void ir_queue_host_advance(ir_queue_host_t *out, uint64_t cycles);
+
+static inline bool ir_queue_host_busy(const ir_queue_host_t *out) {
+    return out->frame_end != 0;
+}
+
+#endif // IR_QUEUE_HOST_H
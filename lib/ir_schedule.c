@@ -0,0 +1,64 @@
+#include "ir_schedule.h"
+
+// Ciclos do PIO em torno de cada entrada que não pertencem aos laços: a marca
+// é só o laço; o espaço leva também a instrução final da marca anterior, a
+// própria busca e instrução final, e a busca da próxima marca.
+static uint32_t schedule_periods(bool mark, uint32_t cycles) {
+    uint32_t fixed = mark ? 0 : 2 * IR_SCHEDULE_TAIL_CYCLES + IR_SCHEDULE_SPACE_FETCH_CYCLES +
+                                IR_SCHEDULE_MARK_FETCH_CYCLES;
+    uint32_t periods = cycles > fixed ? (cycles - fixed + IR_CARRIER_CYCLES / 2) / IR_CARRIER_CYCLES : 0;
+    if (periods < 1)
+        periods = 1;
+    if (periods > IR_SCHEDULE_MAX_PERIODS)
+        periods = IR_SCHEDULE_MAX_PERIODS;
+    return periods;
+}
+
+uint32_t ir_schedule_from_us(bool mark, uint32_t us, uint32_t pio_hz) {
+    uint32_t cycles = (uint32_t)(((uint64_t)us * pio_hz + 500000) / 1000000);
+    return ir_schedule_entry(mark, schedule_periods(mark, cycles));
+}
+
+size_t ir_schedule_from_raw(const uint16_t *raw, size_t length, uint32_t pio_hz, uint32_t gap_us,
+                            uint32_t *out, size_t max) {
+    size_t n = length + (length % 2);  // Termina sempre num espaço
+    if (!length || n > max)
+        return 0;
+    for (size_t i = 0; i < length; i++) {
+        bool mark = (i % 2 == 0);  // Par=marca, Ímpar=espaço
+        uint32_t us = raw[i];
+        if (i == n - 1 && us < gap_us)
+            us = gap_us;
+        out[i] = ir_schedule_from_us(mark, us, pio_hz);
+    }
+    if (n > length)
+        out[length] = ir_schedule_from_us(false, gap_us, pio_hz);
+    out[n - 1] |= IR_SCHEDULE_END;
+    return n;
+}
+
+bool ir_carrier_solve(uint32_t sys_hz, uint32_t carrier_hz, ir_carrier_config_t *cfg) {
+    uint64_t pio_target = (uint64_t)carrier_hz * IR_CARRIER_CYCLES;
+    if (!sys_hz || !pio_target)
+        return false;
+    // Divisor em 16.8, arredondado. Com parte inteira 1 a fração tem que ser
+    // 0, então entre 1 e 2 só valem os extremos.
+    uint64_t div = ((uint64_t)sys_hz * 256 + pio_target / 2) / pio_target;
+    if (div < 256 || div > 0xFFFFFF)
+        return false;
+    if (div < 512 && (div & 0xFF))
+        div = div < 384 ? 256 : 512;
+
+    uint64_t scaled = (uint64_t)sys_hz * 256;
+    cfg->sys_hz = sys_hz;
+    cfg->carrier_hz = carrier_hz;
+    cfg->div_int = div >> 8;
+    cfg->div_frac = div & 0xFF;
+    cfg->pio_hz = (scaled + div / 2) / div;
+    cfg->carrier_mhz = (scaled * 1000 + div * IR_CARRIER_CYCLES / 2) / (div * IR_CARRIER_CYCLES);
+    int64_t diff = (int64_t)scaled - (int64_t)(div * pio_target);
+    int64_t den = (int64_t)(div * pio_target);
+    cfg->error_ppm = (diff * 1000000 + (diff < 0 ? -den / 2 : den / 2)) / den;
+    cfg->jitter_ns = cfg->div_frac ? (1000000000u + sys_hz / 2) / sys_hz : 0;
+    return true;
+}
@@ -0,0 +1,99 @@
+#ifndef IR_SCHEDULE_H
+#define IR_SCHEDULE_H
+
+// Agenda run-length do transmissor IR: cada marca (portadora ligada) ou
+// espaço do sinal vira uma única palavra de 32 bits, que o programa
+// ir_carrier.pio transforma na forma de onda. Um sinal de 227 durações ocupa
+// 228 palavras (com o espaço final), qualquer que seja o seu comprimento em
+// períodos da portadora.
+//
+// Formato da entrada:
+//   bit 31    : 1 = marca, 0 = espaço
+//   marca     : bits 30-0 = períodos da portadora - 1
+//   espaço    : bit 30 = fim do quadro, bits 29-0 = períodos - 1
+//
+// Toda agenda termina num espaço com o bit de fim, que garante o intervalo
+// mínimo até o próximo quadro e faz o PIO sinalizar a IRQ quando o quadro
+// inteiro já saiu.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Ciclos do PIO por período da portadora. O PIO roda a
+// portadora * IR_CARRIER_CYCLES.
+#define IR_CARRIER_CYCLES 8
+
+#define IR_SCHEDULE_MARK (1u << 31)
+#define IR_SCHEDULE_END (1u << 30)
+#define IR_SCHEDULE_MAX_PERIODS (1u << 30)
+
+// Ciclos fora dos laços de ir_carrier.pio, todos com o pino em 0: a busca
+// da entrada (pull, out, jmp e os out do contador) e a instrução depois de
+// cada laço. Um espaço entre duas marcas dura IR_CARRIER_CYCLES * n + 11
+// ciclos.
+#define IR_SCHEDULE_MARK_FETCH_CYCLES 4
+#define IR_SCHEDULE_SPACE_FETCH_CYCLES 5
+#define IR_SCHEDULE_TAIL_CYCLES 1
+
+// Divisor do PIO para uma portadora. O divisor é 16.8 em ponto fixo, então
+// a portadora sai com um pequeno erro, e com parte fracionária o PIO alterna
+// entre dois períodos de clock, o que faz as bordas tremerem em um ciclo do
+// clk_sys.
+typedef struct {
+    uint32_t sys_hz;
+    uint32_t carrier_hz;   // pedida
+    uint16_t div_int;      // divisor = div_int + div_frac / 256
+    uint8_t div_frac;
+    uint32_t pio_hz;       // frequência real do PIO, para a agenda
+    uint32_t carrier_mhz;  // portadora real, em milésimos de Hz
+    int32_t error_ppm;     // (real - pedida) / pedida
+    uint32_t jitter_ns;    // 0 se o divisor for inteiro
+} ir_carrier_config_t;
+
+/**
+ * Calcula o divisor do PIO mais próximo para a portadora com o clk_sys dado
+ * @return false se nenhum divisor válido (1 a 65535 + 255/256) chegar lá
+ */
+bool ir_carrier_solve(uint32_t sys_hz, uint32_t carrier_hz, ir_carrier_config_t *cfg);
+
+static inline uint32_t ir_schedule_entry(bool mark, uint32_t periods) {
+    return (mark ? IR_SCHEDULE_MARK : 0) | (periods - 1);
+}
+
+static inline bool ir_schedule_is_mark(uint32_t entry) {
+    return entry & IR_SCHEDULE_MARK;
+}
+
+static inline bool ir_schedule_is_end(uint32_t entry) {
+    return !ir_schedule_is_mark(entry) && (entry & IR_SCHEDULE_END);
+}
+
+static inline uint32_t ir_schedule_periods(uint32_t entry) {
+    uint32_t mask = ir_schedule_is_mark(entry) ? ~IR_SCHEDULE_MARK : IR_SCHEDULE_END - 1;
+    return (entry & mask) + 1;
+}
+
+/**
+ * Entrada de uma marca ou de um espaço entre marcas de us microsegundos
+ * @param pio_hz Frequência do PIO (portadora * IR_CARRIER_CYCLES)
+ */
+uint32_t ir_schedule_from_us(bool mark, uint32_t us, uint32_t pio_hz);
+
+/**
+ * Converte um sinal RAW (marca, espaço, marca, ... em microsegundos) para a
+ * agenda, arredondando cada duração para o número de períodos mais próximo
+ * depois de descontar os ciclos fixos do programa
+ * @param raw Durações em microsegundos, começando por uma marca
+ * @param length Número de durações
+ * @param pio_hz Frequência do PIO (portadora * IR_CARRIER_CYCLES)
+ * @param gap_us Duração mínima do espaço final, acrescentado se o sinal
+ *               terminar numa marca
+ * @param out Agenda
+ * @param max Capacidade de out
+ * @return Número de entradas, ou 0 se o sinal for vazio ou não couber em out
+ */
+size_t ir_schedule_from_raw(const uint16_t *raw, size_t length, uint32_t pio_hz, uint32_t gap_us,
+                            uint32_t *out, size_t max);
+
+#endif // IR_SCHEDULE_H
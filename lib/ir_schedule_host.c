@@ -0,0 +1,138 @@
+#include "ir_schedule_host.h"
+
+// Cópia de ir_carrier.pio. side < 0 = sem side-set.
+enum { OP_PULL, OP_OUT_Y, OP_OUT_X31, OP_OUT_X30, OP_JMP_NOT_Y, OP_NOP, OP_JMP_X_DEC, OP_JMP, OP_IRQ };
+
+static const struct {
+    uint8_t op;
+    int8_t side;
+    uint8_t delay;
+    uint8_t target;
+} ir_carrier_prog[] = {
+    {OP_PULL,      -1, 0, 0},   // entry:       pull block
+    {OP_OUT_Y,     -1, 0, 0},   //              out y, 1
+    {OP_JMP_NOT_Y, -1, 0, 7},   //              jmp !y space_entry
+    {OP_OUT_X31,   -1, 0, 0},   //              out x, 31
+    {OP_NOP,        1, 3, 0},   // mark:        nop side 1 [3]
+    {OP_JMP_X_DEC,  0, 3, 4},   //              jmp x-- mark side 0 [3]
+    {OP_JMP,       -1, 0, 0},   //              jmp entry
+    {OP_OUT_Y,     -1, 0, 0},   // space_entry: out y, 1
+    {OP_OUT_X30,   -1, 0, 0},   //              out x, 30
+    {OP_JMP_X_DEC, -1, 7, 9},   // space:       jmp x-- space [7]
+    {OP_JMP_NOT_Y, -1, 0, 0},   //              jmp !y entry
+    {OP_IRQ,       -1, 0, 0},   //              irq nowait 0 rel
+};
+#define PROG_LEN (sizeof(ir_carrier_prog) / sizeof(ir_carrier_prog[0]))
+
+typedef struct {
+    uint32_t *out;
+    size_t max, n;
+    bool in_mark, started;
+    uint32_t acc;
+} envelope_t;
+
+static void envelope_push(envelope_t *env, uint32_t cycles) {
+    if (env->n < env->max)
+        env->out[env->n] = cycles;
+    ++env->n;
+}
+
+// Um trecho de `cycles` ciclos com o pino em `level`
+static void envelope_run(envelope_t *env, bool level, uint32_t cycles) {
+    const uint32_t half = IR_CARRIER_CYCLES / 2;
+    if (level) {
+        if (!env->in_mark) {
+            if (env->started)
+                envelope_push(env, env->acc);
+            env->in_mark = env->started = true;
+            env->acc = 0;
+        }
+        env->acc += cycles;
+    } else if (!env->in_mark) {
+        env->acc += cycles;
+    } else if (cycles <= half) {
+        env->acc += cycles;
+    } else {
+        envelope_push(env, env->acc + half);
+        env->in_mark = false;
+        env->acc = cycles - half;
+    }
+}
+
+size_t ir_schedule_host_decode(const uint32_t *schedule, size_t length, uint32_t *out, size_t max,
+                               ir_schedule_host_stats_t *stats) {
+    envelope_t env = {out, max, 0, false, false, 0};
+    ir_schedule_host_stats_t st = {0};
+    uint32_t osr = 0, x = 0, y = 0;
+    size_t fifo = 0;
+    uint8_t pc = 0;
+    bool pin = false;
+    bool run_level = false;
+    uint32_t run = 0;
+
+    for (;;) {
+        if (ir_carrier_prog[pc].op == OP_PULL && fifo == length)
+            break;
+        const uint8_t op = ir_carrier_prog[pc].op;
+        uint8_t next = (pc + 1) % PROG_LEN;
+        switch (op) {
+            case OP_PULL:
+                osr = schedule[fifo++];
+                ++st.entries;
+                break;
+            case OP_OUT_Y:
+                y = osr >> 31;
+                osr <<= 1;
+                break;
+            case OP_OUT_X31:
+                x = osr >> 1;
+                osr = 0;
+                break;
+            case OP_OUT_X30:
+                x = osr >> 2;
+                osr = 0;
+                break;
+            case OP_JMP_NOT_Y:
+                if (!y)
+                    next = ir_carrier_prog[pc].target;
+                break;
+            case OP_JMP_X_DEC:
+                if (x--)
+                    next = ir_carrier_prog[pc].target;
+                break;
+            case OP_JMP:
+                next = ir_carrier_prog[pc].target;
+                break;
+            case OP_IRQ:
+                ++st.irqs;
+                st.irq_cycle = st.cycles + 1;
+                break;
+            default:
+                break;
+        }
+        if (ir_carrier_prog[pc].side >= 0) {
+            bool level = ir_carrier_prog[pc].side;
+            if (level && !pin)
+                ++st.pulses;
+            pin = level;
+        }
+        uint32_t cycles = 1 + ir_carrier_prog[pc].delay;
+        st.cycles += cycles;
+        if (pin != run_level && run) {
+            envelope_run(&env, run_level, run);
+            run = 0;
+        }
+        run_level = pin;
+        run += cycles;
+        pc = next;
+    }
+    if (run)
+        envelope_run(&env, run_level, run);
+    // Depois da última marca sobra o jmp de volta ao pull, que só conta como
+    // espaço se a agenda terminar em um
+    if (env.in_mark || (env.started && !ir_schedule_is_mark(schedule[length - 1])))
+        envelope_push(&env, env.acc);
+    if (stats)
+        *stats = st;
+    return env.n < max ? env.n : max;
+}
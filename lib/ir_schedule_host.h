@@ -0,0 +1,41 @@
+#ifndef IR_SCHEDULE_HOST_H
+#define IR_SCHEDULE_HOST_H
+
+// Decodificador da agenda IR para o host: executa ir_carrier.pio instrução
+// por instrução, ciclo a ciclo do PIO, e devolve o envelope que um receptor
+// IR veria. Serve para conferir ir_schedule_from_raw() contra os sinais
+// capturados sem o hardware, e para comparar a saída de outros geradores de
+// agenda com um sinal de referência.
+//
+// Envelope: uma marca vai da primeira subida da portadora até o fim do
+// último período (meio período depois da última descida); o resto é espaço.
+
+#include "ir_schedule.h"
+
+typedef struct {
+    // Ciclos do PIO executados até o SM parar no pull sem dados
+    uint64_t cycles;
+    // Bordas de subida, ou seja, períodos da portadora emitidos
+    uint32_t pulses;
+    // Entradas consumidas do FIFO
+    uint32_t entries;
+    // IRQs de fim de quadro e o ciclo em que a última foi sinalizada
+    uint32_t irqs;
+    uint64_t irq_cycle;
+} ir_schedule_host_stats_t;
+
+/**
+ * Reconstrói o envelope da agenda
+ * @param schedule Agenda, como enviada ao TX FIFO
+ * @param length Número de entradas
+ * @param out Durações alternadas marca, espaço, ... em ciclos do PIO. O
+ *            espaço final, se houver, inclui a instrução depois do laço.
+ *            Pode ser NULL com max 0 quando só stats interessa.
+ * @param max Capacidade de out
+ * @param stats Totais da execução, ou NULL
+ * @return Número de durações escritas em out
+ */
+size_t ir_schedule_host_decode(const uint32_t *schedule, size_t length, uint32_t *out, size_t max,
+                               ir_schedule_host_stats_t *stats);
+
+#endif // IR_SCHEDULE_HOST_H
@@ -1,5 +1,7 @@
+#include <string.h>
 #include "ssd1306.h"
 #include "font.h"
+#include "font_large.h"
 
 void ssd1306_init(ssd1306_t *ssd, uint8_t width, uint8_t height, bool external_vcc, uint8_t address, i2c_inst_t *i2c) {
   ssd->width = width;
@@ -10,13 +12,67 @@ void ssd1306_init(ssd1306_t *ssd, uint8_t width, uint8_t height, bool external_v
   ssd->bufsize = ssd->pages * ssd->width + 1;
   ssd->ram_buffer = calloc(ssd->bufsize, sizeof(uint8_t));
   ssd->ram_buffer[0] = 0x40;
+  ssd->shadow = calloc(ssd->bufsize, sizeof(uint8_t));
+  // Pior caso: cada página numa janela própria, com 7 bytes de comando e o
+  // byte de controle 0x40, mais os NOPs depois de uma interrupção
+  ssd->tx_stream = calloc(ssd->pages * (ssd->width + 8) + 3, sizeof(uint16_t));
+  ssd->tx_busy = false;
+  ssd->resync = false;
+  ssd->dma_chan = -1;
+#if !PICO_NO_HARDWARE
+  ssd1306_set_transport(ssd, &ssd1306_transport_dma, ssd);
+#else
+  ssd1306_set_transport(ssd, &ssd1306_transport_host, &ssd1306_host_dev);
+#endif
   ssd->port_buffer[0] = 0x80;
+  ssd->stats = (ssd1306_stats_t){0};
+  ssd1306_invalidate(ssd);
+}
+
+static void ssd1306_clear_dirty(ssd1306_t *ssd) {
+  for (uint8_t page = 0; page < SSD1306_MAX_PAGES; ++page) {
+    ssd->dirty_x0[page] = 0xff;
+    ssd->dirty_x1[page] = 0;
+  }
+}
+
+void ssd1306_invalidate(ssd1306_t *ssd) {
+  // O conteúdo da RAM do display é desconhecido: a página inteira conta como
+  // alterada, mesmo que seja igual à sombra
+  ssd->shadow_valid = false;
+  for (uint8_t page = 0; page < ssd->pages; ++page) {
+    ssd->dirty_x0[page] = 0;
+    ssd->dirty_x1[page] = ssd->width;
+  }
+}
+
+void ssd1306_set_transport(ssd1306_t *ssd, const ssd1306_transport_t *transport, void *ctx) {
+  ssd1306_wait(ssd);
+  ssd->transport = transport;
+  ssd->transport_ctx = ctx;
+}
+
+// Um envio interrompido pode ter parado entre um comando e seus argumentos, e
+// o display toma os próximos bytes de comando como argumentos. Dois NOPs
+// completam qualquer comando que as janelas usam; o endereço que fica errado
+// é refeito pela janela seguinte.
+static const uint8_t ssd1306_resync_cmd[3] = {0x00, SET_NOP, SET_NOP};
+
+// Toda escrita no barramento passa por aqui, para contar os bytes
+static void ssd1306_write(ssd1306_t *ssd, const uint8_t *buf, size_t len) {
+  if (ssd->resync) {
+    ssd->resync = false;
+    ssd1306_write(ssd, ssd1306_resync_cmd, sizeof(ssd1306_resync_cmd));
+  }
+  ssd->transport->write(ssd->transport_ctx, buf, len);
+  ssd->stats.bus_bytes += len + 1;
+  ++ssd->stats.transactions;
 }
 
 void ssd1306_config(ssd1306_t *ssd) {
   ssd1306_command(ssd, SET_DISP | 0x00);
   ssd1306_command(ssd, SET_MEM_ADDR);
-  ssd1306_command(ssd, 0x01);
+  ssd1306_command(ssd, 0x00); // horizontal
   ssd1306_command(ssd, SET_DISP_START_LINE | 0x00);
   ssd1306_command(ssd, SET_SEG_REMAP | 0x01);
   ssd1306_command(ssd, SET_MUX_RATIO);
@@ -42,76 +98,306 @@ void ssd1306_config(ssd1306_t *ssd) {
 }
 
 void ssd1306_command(ssd1306_t *ssd, uint8_t command) {
+  ssd1306_wait(ssd);
   ssd->port_buffer[1] = command;
-  i2c_write_blocking(
-    ssd->i2c_port,
-    ssd->address,
-    ssd->port_buffer,
-    2,
-    false
-  );
+  ssd1306_write(ssd, ssd->port_buffer, 2);
+}
+
+// Custo fixo de enviar uma janela: transação de comandos (endereço + 7 bytes)
+// e o endereço e o byte de controle da transação de dados
+#define SSD1306_WINDOW_OVERHEAD 10
+
+// Janela de envio: colunas [x0, x1) das páginas [page0, page1]. Os bytes são
+// contíguos em ram_buffer, pois é uma página só ou são páginas inteiras.
+typedef struct {
+  uint8_t x0, x1, page0, page1;
+} ssd1306_window_t;
+
+static inline size_t ssd1306_window_start(const ssd1306_t *ssd, const ssd1306_window_t *w) {
+  return 1 + w->page0 * ssd->width + w->x0;
+}
+
+static inline size_t ssd1306_window_len(const ssd1306_t *ssd, const ssd1306_window_t *w) {
+  return (w->page1 - w->page0) * ssd->width + (w->x1 - w->x0);
+}
+
+// Reduz a faixa suja de uma página às colunas que diferem da sombra. Falso se
+// nada mudou.
+static bool ssd1306_trim_dirty(ssd1306_t *ssd, uint8_t page, uint8_t *x0, uint8_t *x1) {
+  uint8_t a = ssd->dirty_x0[page];
+  uint8_t b = MIN(ssd->dirty_x1[page], ssd->width);
+  if (ssd->shadow_valid) {
+    const uint8_t *buf = &ssd->ram_buffer[1 + page * ssd->width];
+    const uint8_t *old = &ssd->shadow[1 + page * ssd->width];
+    while (a < b && buf[a] == old[a])
+      ++a;
+    while (b > a && buf[b - 1] == old[b - 1])
+      --b;
+  }
+  *x0 = a;
+  *x1 = b;
+  return a < b;
+}
+
+// Decide as janelas a enviar e já as considera enviadas: copia para a sombra
+// e limpa as faixas sujas. Retorna o número de janelas.
+static uint8_t ssd1306_plan(ssd1306_t *ssd, ssd1306_window_t windows[SSD1306_MAX_PAGES]) {
+  uint8_t x0[SSD1306_MAX_PAGES], x1[SSD1306_MAX_PAGES];
+  bool changed[SSD1306_MAX_PAGES];
+  for (uint8_t page = 0; page < ssd->pages; ++page)
+    changed[page] = ssd1306_trim_dirty(ssd, page, &x0[page], &x1[page]);
+
+  // Para cada sequência de páginas alteradas, envia página por página ou,
+  // se sair mais barato, uma janela só com as páginas inteiras
+  uint8_t n = 0;
+  uint8_t page = 0;
+  while (page < ssd->pages) {
+    if (!changed[page]) {
+      ++page;
+      continue;
+    }
+    uint8_t end = page;
+    uint32_t separate = 0;
+    while (end < ssd->pages && changed[end]) {
+      separate += x1[end] - x0[end] + SSD1306_WINDOW_OVERHEAD;
+      ++end;
+    }
+    uint32_t merged = (end - page) * ssd->width + SSD1306_WINDOW_OVERHEAD;
+    if (merged <= separate) {
+      windows[n++] = (ssd1306_window_t){0, ssd->width, page, end - 1};
+    } else {
+      for (uint8_t p = page; p < end; ++p)
+        windows[n++] = (ssd1306_window_t){x0[p], x1[p], p, p};
+    }
+    page = end;
+  }
+
+  for (uint8_t i = 0; i < n; ++i) {
+    size_t start = ssd1306_window_start(ssd, &windows[i]);
+    memcpy(&ssd->shadow[start], &ssd->ram_buffer[start], ssd1306_window_len(ssd, &windows[i]));
+  }
+  ssd->shadow_valid = true;
+  ssd1306_clear_dirty(ssd);
+  ++ssd->stats.flushes;
+  return n;
+}
+
+// Os seis comandos de endereçamento vão numa única transação (byte de
+// controle 0x00 seguido de vários comandos)
+static inline void ssd1306_window_cmd(const ssd1306_window_t *w, uint8_t cmd[7]) {
+  cmd[0] = 0x00;
+  cmd[1] = SET_COL_ADDR;
+  cmd[2] = w->x0;
+  cmd[3] = w->x1 - 1;
+  cmd[4] = SET_PAGE_ADDR;
+  cmd[5] = w->page0;
+  cmd[6] = w->page1;
+}
+
+// Os dados vão precedidos de 0x40, escrito temporariamente no byte anterior
+// da ram_buffer
+static void ssd1306_send_window(ssd1306_t *ssd, const ssd1306_window_t *w) {
+  uint8_t cmd[7];
+  ssd1306_window_cmd(w, cmd);
+  ssd1306_write(ssd, cmd, sizeof(cmd));
+
+  size_t start = ssd1306_window_start(ssd, w);
+  uint8_t saved = ssd->ram_buffer[start - 1];
+  ssd->ram_buffer[start - 1] = 0x40;
+  ssd1306_write(ssd, &ssd->ram_buffer[start - 1], ssd1306_window_len(ssd, w) + 1);
+  ssd->ram_buffer[start - 1] = saved;
 }
 
 void ssd1306_send_data(ssd1306_t *ssd) {
-  ssd1306_command(ssd, SET_COL_ADDR);
-  ssd1306_command(ssd, 0);
-  ssd1306_command(ssd, ssd->width - 1);
-  ssd1306_command(ssd, SET_PAGE_ADDR);
-  ssd1306_command(ssd, 0);
-  ssd1306_command(ssd, ssd->pages - 1);
-  i2c_write_blocking(
-    ssd->i2c_port,
-    ssd->address,
-    ssd->ram_buffer,
-    ssd->bufsize,
-    false
-  );
+  ssd1306_wait(ssd);
+  ssd1306_window_t windows[SSD1306_MAX_PAGES];
+  uint8_t n = ssd1306_plan(ssd, windows);
+  for (uint8_t i = 0; i < n; ++i)
+    ssd1306_send_window(ssd, &windows[i]);
+}
+
+// ----------------------------------------------------------------------------
+// Envio assíncrono
+
+// Acrescenta uma transação (byte de controle e len bytes) à fila de
+// IC_DATA_CMD, com STOP no último byte
+static uint16_t *ssd1306_stream_put(ssd1306_t *ssd, uint16_t *out, uint8_t control, const uint8_t *buf, size_t len) {
+  *out++ = control;
+  for (size_t i = 0; i < len; ++i)
+    *out++ = buf[i];
+  out[-1] |= I2C_IC_DATA_CMD_STOP_BITS;
+  ssd->stats.bus_bytes += len + 2;
+  ++ssd->stats.transactions;
+  return out;
+}
+
+#if !PICO_NO_HARDWARE
+static void ssd1306_i2c_write(void *ctx, const uint8_t *buf, size_t len) {
+  ssd1306_t *ssd = ctx;
+  i2c_write_blocking(ssd->i2c_port, ssd->address, buf, len, false);
+}
+
+static void ssd1306_dma_start(void *ctx, const uint16_t *stream, size_t len) {
+  ssd1306_t *ssd = ctx;
+  if (ssd->dma_chan < 0)
+    ssd->dma_chan = dma_claim_unused_channel(true);
+  i2c_hw_t *hw = i2c_get_hw(ssd->i2c_port);
+  // Como em i2c_write_blocking(): o endereço só muda com o bloco desabilitado
+  hw->enable = 0;
+  hw->tar = ssd->address;
+  hw->enable = 1;
+
+  dma_channel_config c = dma_channel_get_default_config(ssd->dma_chan);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, i2c_get_dreq(ssd->i2c_port, true));
+  dma_channel_configure(ssd->dma_chan, &c, &hw->data_cmd, stream, len, true);
+}
+
+// Termina quando não há mais bytes no DMA, na FIFO nem no barramento
+static int ssd1306_dma_poll(void *ctx) {
+  ssd1306_t *ssd = ctx;
+  i2c_hw_t *hw = i2c_get_hw(ssd->i2c_port);
+  if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+    // NACK ou perda de arbitragem: o bloco descarta a FIFO e fica parado até
+    // a leitura de clr_tx_abrt
+    dma_channel_abort(ssd->dma_chan);
+    (void)hw->clr_tx_abrt;
+    return SSD1306_STREAM_ABORTED;
+  }
+  if (dma_channel_is_busy(ssd->dma_chan))
+    return SSD1306_STREAM_BUSY;
+  if (!(hw->status & I2C_IC_STATUS_TFE_BITS) || (hw->status & I2C_IC_STATUS_MST_ACTIVITY_BITS))
+    return SSD1306_STREAM_BUSY;
+  return SSD1306_STREAM_DONE;
+}
+
+const ssd1306_transport_t ssd1306_transport_i2c = {
+  .write = ssd1306_i2c_write
+};
+
+const ssd1306_transport_t ssd1306_transport_dma = {
+  .write = ssd1306_i2c_write,
+  .stream_start = ssd1306_dma_start,
+  .stream_poll = ssd1306_dma_poll
+};
+#endif
+
+bool ssd1306_send_data_async(ssd1306_t *ssd) {
+  if (ssd1306_busy(ssd))
+    return false;
+  // Transporte sem envio em segundo plano: envia na hora
+  if (!ssd->transport->stream_start) {
+    ssd1306_send_data(ssd);
+    return true;
+  }
+  ssd1306_window_t windows[SSD1306_MAX_PAGES];
+  uint8_t n = ssd1306_plan(ssd, windows);
+  uint16_t *out = ssd->tx_stream;
+  if (ssd->resync) {
+    ssd->resync = false;
+    out = ssd1306_stream_put(ssd, out, ssd1306_resync_cmd[0], &ssd1306_resync_cmd[1], sizeof(ssd1306_resync_cmd) - 1);
+  }
+  for (uint8_t i = 0; i < n; ++i) {
+    uint8_t cmd[7];
+    ssd1306_window_cmd(&windows[i], cmd);
+    out = ssd1306_stream_put(ssd, out, cmd[0], &cmd[1], sizeof(cmd) - 1);
+    out = ssd1306_stream_put(ssd, out, 0x40, &ssd->ram_buffer[ssd1306_window_start(ssd, &windows[i])],
+                             ssd1306_window_len(ssd, &windows[i]));
+  }
+  if (out != ssd->tx_stream) {
+    ssd->tx_busy = true;
+    ssd->transport->stream_start(ssd->transport_ctx, ssd->tx_stream, out - ssd->tx_stream);
+  }
+  return true;
+}
+
+bool ssd1306_busy(ssd1306_t *ssd) {
+  if (!ssd->tx_busy)
+    return false;
+  int status = ssd->transport->stream_poll(ssd->transport_ctx);
+  if (status == SSD1306_STREAM_BUSY)
+    return true;
+  ssd->tx_busy = false;
+  if (status == SSD1306_STREAM_ABORTED) {
+    // O que chegou ao display é desconhecido: a tela toda vai de novo
+    ++ssd->stats.aborts;
+    ssd1306_invalidate(ssd);
+    ssd->resync = true;
+  }
+  return false;
+}
+
+void ssd1306_wait(ssd1306_t *ssd) {
+  while (ssd1306_busy(ssd))
+    tight_loop_contents();
 }
 
 void ssd1306_pixel(ssd1306_t *ssd, uint8_t x, uint8_t y, bool value) {
-  uint16_t index = (y >> 3) + (x << 3) + 1;
+  if (x >= ssd->width || y >= ssd->height)
+    return;
+  uint16_t index = 1 + (y >> 3) * ssd->width + x;
   uint8_t pixel = (y & 0b111);
   if (value)
     ssd->ram_buffer[index] |= (1 << pixel);
   else
     ssd->ram_buffer[index] &= ~(1 << pixel);
+  ssd1306_mark_dirty(ssd, y >> 3, x, x + 1);
 }
 
-/*
-void ssd1306_fill(ssd1306_t *ssd, bool value) {
-  uint8_t byte = value ? 0xFF : 0x00;
-  for (uint8_t i = 1; i < ssd->bufsize; ++i)
-    ssd->ram_buffer[i] = byte;
-}*/
-
 void ssd1306_fill(ssd1306_t *ssd, bool value) {
-    // Itera por todas as posições do display
-    for (uint8_t y = 0; y < ssd->height; ++y) {
-        for (uint8_t x = 0; x < ssd->width; ++x) {
-            ssd1306_pixel(ssd, x, y, value);
-        }
-    }
+  memset(&ssd->ram_buffer[1], value ? 0xFF : 0x00, ssd->bufsize - 1);
+  for (uint8_t page = 0; page < ssd->pages; ++page)
+    ssd1306_mark_dirty(ssd, page, 0, ssd->width);
 }
 
-
-
-void ssd1306_rect(ssd1306_t *ssd, uint8_t top, uint8_t left, uint8_t width, uint8_t height, bool value, bool fill) {
-  for (uint8_t x = left; x < left + width; ++x) {
-    ssd1306_pixel(ssd, x, top, value);
-    ssd1306_pixel(ssd, x, top + height - 1, value);
+// Aplica mask às colunas [x0, x1) de uma página: OR para acender, AND-NOT
+// para apagar
+static inline void ssd1306_page_mask(ssd1306_t *ssd, uint8_t page, uint8_t x0, uint8_t x1, uint8_t mask, bool value) {
+  uint8_t *p = &ssd->ram_buffer[1 + page * ssd->width];
+  if (value) {
+    for (uint8_t x = x0; x < x1; ++x)
+      p[x] |= mask;
+  } else {
+    for (uint8_t x = x0; x < x1; ++x)
+      p[x] &= ~mask;
   }
-  for (uint8_t y = top; y < top + height; ++y) {
-    ssd1306_pixel(ssd, left, y, value);
-    ssd1306_pixel(ssd, left + width - 1, y, value);
+  ssd1306_mark_dirty(ssd, page, x0, x1);
+}
+
+// Preenche o retângulo de colunas [x0, x1) e linhas [y0, y1), já recortado,
+// uma página por vez
+static void ssd1306_fill_area(ssd1306_t *ssd, uint8_t x0, uint8_t x1, uint8_t y0, uint8_t y1, bool value) {
+  if (x0 >= x1 || y0 >= y1)
+    return;
+  uint8_t last = (y1 - 1) >> 3;
+  for (uint8_t page = y0 >> 3; page <= last; ++page) {
+    uint8_t mask = 0xFF;
+    if (page == y0 >> 3)
+      mask &= 0xFF << (y0 & 7);
+    if (page == last)
+      mask &= 0xFF >> (7 - ((y1 - 1) & 7));
+    ssd1306_page_mask(ssd, page, x0, x1, mask, value);
   }
+}
 
+void ssd1306_rect(ssd1306_t *ssd, uint8_t top, uint8_t left, uint8_t width, uint8_t height, bool value, bool fill) {
+  if (!width || !height)
+    return;
+  uint8_t x1 = MIN(left + width, ssd->width);
+  uint8_t y1 = MIN(top + height, ssd->height);
   if (fill) {
-    for (uint8_t x = left + 1; x < left + width - 1; ++x) {
-      for (uint8_t y = top + 1; y < top + height - 1; ++y) {
-        ssd1306_pixel(ssd, x, y, value);
-      }
-    }
+    // Borda e interior têm a mesma cor
+    ssd1306_fill_area(ssd, left, x1, top, y1, value);
+    return;
   }
+  uint8_t right = MIN(left + width - 1, 0xFF);
+  uint8_t bottom = MIN(top + height - 1, 0xFF);
+  ssd1306_hline(ssd, left, right, top, value);
+  ssd1306_hline(ssd, left, right, bottom, value);
+  ssd1306_vline(ssd, left, top, bottom, value);
+  ssd1306_vline(ssd, right, top, bottom, value);
 }
 
 void ssd1306_line(ssd1306_t *ssd, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, bool value) {
@@ -144,39 +430,54 @@ void ssd1306_line(ssd1306_t *ssd, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1
 
 
 void ssd1306_hline(ssd1306_t *ssd, uint8_t x0, uint8_t x1, uint8_t y, bool value) {
-  for (uint8_t x = x0; x <= x1; ++x)
-    ssd1306_pixel(ssd, x, y, value);
+  if (y >= ssd->height || x0 > x1 || x0 >= ssd->width)
+    return;
+  ssd1306_page_mask(ssd, y >> 3, x0, MIN(x1 + 1, ssd->width), 1 << (y & 7), value);
 }
 
 void ssd1306_vline(ssd1306_t *ssd, uint8_t x, uint8_t y0, uint8_t y1, bool value) {
-  for (uint8_t y = y0; y <= y1; ++y)
-    ssd1306_pixel(ssd, x, y, value);
+  if (x >= ssd->width || y0 > y1)
+    return;
+  ssd1306_fill_area(ssd, x, x + 1, y0, MIN(y1 + 1, ssd->height), value);
 }
 
 // Função para desenhar um caractere
+// A fonte já está em colunas (bit 0 em cima), como a RAM do display: cada
+// coluna do glifo é um byte, copiado direto para a página. Com y fora do
+// múltiplo de 8, o byte é dividido entre duas páginas. Como antes, o fundo
+// da célula 8x8 também é escrito.
 void ssd1306_draw_char(ssd1306_t *ssd, char c, uint8_t x, uint8_t y)
 {
-  uint16_t index = 0;
+  // Caractere fora da faixa ASCII imprimível vira espaço
+  uint16_t index = (c >= ' ' && c <= '~') ? (c - ' ') * 8 : 0;
+  if (x >= ssd->width || y >= ssd->height)
+    return;
 
-  // Verifica o caractere e calcula o índice correspondente na fonte
-  if (c >= ' ' && c <= '~') // Verifica se o caractere está na faixa ASCII válida
+  const uint8_t *glyph = &font[index];
+  uint8_t n = MIN(8, ssd->width - x);
+  uint8_t page = y >> 3;
+  uint8_t shift = y & 7;
+  uint8_t *p = &ssd->ram_buffer[1 + page * ssd->width + x];
+
+  if (!shift)
   {
-    index = (c - ' ') * 8; // Calcula o índice baseado na posição do caractere na tabela ASCII
+    memcpy(p, glyph, n);
   }
   else
   {
-    // Caractere inválido, desenha um espaço (ou pode ser tratado de outra forma)
-    index = 0; // Índice 0 corresponde ao caractere "nada" (espaço)
+    uint8_t keep = 0xFF >> (8 - shift);
+    for (uint8_t i = 0; i < n; ++i)
+      p[i] = (p[i] & keep) | (glyph[i] << shift);
   }
+  ssd1306_mark_dirty(ssd, page, x, x + n);
 
-  // Desenha o caractere na tela
-  for (uint8_t i = 0; i < 8; ++i)
+  if (shift && page + 1 < ssd->pages)
   {
-    uint8_t line = font[index + i]; // Acessa a linha correspondente do caractere na fonte
-    for (uint8_t j = 0; j < 8; ++j)
-    {
-      ssd1306_pixel(ssd, x + i, y + j, line & (1 << j)); // Desenha cada pixel do caractere
-    }
+    uint8_t keep = 0xFF << shift;
+    p += ssd->width;
+    for (uint8_t i = 0; i < n; ++i)
+      p[i] = (p[i] & keep) | (glyph[i] >> (8 - shift));
+    ssd1306_mark_dirty(ssd, page + 1, x, x + n);
   }
 }
 
@@ -197,4 +498,146 @@ void ssd1306_draw_string(ssd1306_t *ssd, const char *str, uint8_t x, uint8_t y)
       break;
     }
   }
-}
\ No newline at end of file
+}
+
+// ----------------------------------------------------------------------------
+// Texto com fontes descritas por ssd1306_font_t
+
+const ssd1306_font_t ssd1306_font_8x8 = {
+  .glyphs = font, .metrics = NULL, .first = ' ', .last = '~', .cell_w = 8, .pages = 1, .spacing = 0
+};
+
+const ssd1306_font_t ssd1306_font_prop = {
+  .glyphs = font, .metrics = font_metrics, .first = ' ', .last = '~', .cell_w = 8, .pages = 1, .spacing = 1
+};
+
+const ssd1306_font_t ssd1306_font_large = {
+  .glyphs = font_large, .metrics = font_large_metrics, .first = ' ', .last = '~', .cell_w = 16, .pages = 2,
+  .spacing = 2
+};
+
+// Colunas de um caractere: glifo, primeira coluna, colunas com pixels e
+// avanço total
+static inline const uint8_t *ssd1306_glyph(const ssd1306_font_t *f, char c, uint8_t *col0, uint8_t *n, uint8_t *advance) {
+  uint8_t i = ((uint8_t)c >= f->first && (uint8_t)c <= f->last) ? (uint8_t)c - f->first : 0;
+  if (f->metrics) {
+    *col0 = f->metrics[2 * i];
+    *n = f->metrics[2 * i + 1];
+    *advance = *n + f->spacing;
+  } else {
+    *col0 = 0;
+    *n = *advance = f->cell_w;
+  }
+  return &f->glyphs[i * f->cell_w * f->pages];
+}
+
+uint8_t ssd1306_text_width(const ssd1306_font_t *font, const char *str) {
+  uint16_t w = 0;
+  for (; *str; ++str) {
+    uint8_t col0, n, advance;
+    ssd1306_glyph(font, *str, &col0, &n, &advance);
+    w += advance;
+  }
+  return MIN(w, 0xFF);
+}
+
+// Renderiza str deslocada shift bits para baixo, em pages (+1 se shift)
+// linhas de bytes de SSD1306_TEXT_MAX_W colunas cada, até
+// SSD1306_FONT_MAX_PAGES + 1 linhas. Retorna a largura.
+static uint8_t ssd1306_text_render(const ssd1306_font_t *font, const char *str, uint8_t shift, uint8_t *out) {
+  uint8_t rows = font->pages + (shift ? 1 : 0);
+  uint8_t w = 0;
+  for (; *str && w < SSD1306_TEXT_MAX_W; ++str) {
+    uint8_t col0, n, advance;
+    const uint8_t *glyph = ssd1306_glyph(font, *str, &col0, &n, &advance);
+    for (uint8_t i = 0; i < advance && w < SSD1306_TEXT_MAX_W; ++i, ++w) {
+      uint32_t column = 0;
+      if (i < n) {
+        for (uint8_t p = 0; p < font->pages; ++p)
+          column |= (uint32_t)glyph[p * font->cell_w + col0 + i] << (8 * p);
+      }
+      column <<= shift;
+      for (uint8_t r = 0; r < rows; ++r)
+        out[r * SSD1306_TEXT_MAX_W + w] = column >> (8 * r);
+    }
+  }
+  return w;
+}
+
+// Copia as linhas renderizadas para a ram_buffer. A primeira e a última
+// linha só cobrem parte da página quando o texto não está alinhado.
+static void ssd1306_text_blit(ssd1306_t *ssd, const uint8_t *buf, uint8_t w, uint8_t rows, uint8_t shift, uint8_t x, uint8_t y) {
+  uint8_t n = MIN(w, ssd->width - x);
+  for (uint8_t r = 0; r < rows; ++r) {
+    uint8_t page = (y >> 3) + r;
+    if (page >= ssd->pages)
+      break;
+    uint8_t mask = 0xFF;
+    if (shift && r == 0)
+      mask = 0xFF << shift;
+    else if (shift && r == rows - 1)
+      mask = 0xFF >> (8 - shift);
+    uint8_t *dst = &ssd->ram_buffer[1 + page * ssd->width + x];
+    const uint8_t *src = &buf[r * SSD1306_TEXT_MAX_W];
+    if (mask == 0xFF) {
+      memcpy(dst, src, n);
+    } else {
+      for (uint8_t i = 0; i < n; ++i)
+        dst[i] = (dst[i] & ~mask) | src[i];
+    }
+    ssd1306_mark_dirty(ssd, page, x, x + n);
+  }
+}
+
+// Cache das strings renderizadas, com substituição da menos usada
+typedef struct {
+  const ssd1306_font_t *font;
+  char text[SSD1306_TEXT_CACHE_KEY];
+  uint8_t shift;
+  uint8_t width;
+  uint32_t last_use;
+  uint8_t buf[(SSD1306_FONT_MAX_PAGES + 1) * SSD1306_TEXT_MAX_W];
+} ssd1306_text_entry_t;
+
+static ssd1306_text_entry_t text_cache[SSD1306_TEXT_CACHE_ENTRIES];
+static uint32_t text_cache_clock;
+
+uint8_t ssd1306_text(ssd1306_t *ssd, const ssd1306_font_t *font, const char *str, uint8_t x, uint8_t y) {
+  // Os buffers de render têm SSD1306_FONT_MAX_PAGES + 1 linhas
+  if (x >= ssd->width || y >= ssd->height || font->pages > SSD1306_FONT_MAX_PAGES)
+    return x;
+  uint8_t shift = y & 7;
+  uint8_t rows = font->pages + (shift ? 1 : 0);
+
+  if (strlen(str) >= SSD1306_TEXT_CACHE_KEY) {
+    uint8_t buf[(SSD1306_FONT_MAX_PAGES + 1) * SSD1306_TEXT_MAX_W];
+    uint8_t w = ssd1306_text_render(font, str, shift, buf);
+    ssd1306_text_blit(ssd, buf, w, rows, shift, x, y);
+    return MIN(x + w, 0xFF);
+  }
+
+  ssd1306_text_entry_t *e = NULL;
+  ssd1306_text_entry_t *oldest = &text_cache[0];
+  for (uint i = 0; i < SSD1306_TEXT_CACHE_ENTRIES; ++i) {
+    ssd1306_text_entry_t *c = &text_cache[i];
+    if (c->font == font && c->shift == shift && !strcmp(c->text, str)) {
+      e = c;
+      break;
+    }
+    if (c->last_use < oldest->last_use)
+      oldest = c;
+  }
+  if (e) {
+    ++ssd->stats.text_hits;
+  } else {
+    ++ssd->stats.text_misses;
+    e = oldest;
+    e->font = font;
+    e->shift = shift;
+    strcpy(e->text, str);
+    e->width = ssd1306_text_render(font, str, shift, e->buf);
+  }
+  e->last_use = ++text_cache_clock;
+  ssd1306_text_blit(ssd, e->buf, e->width, rows, shift, x, y);
+  return MIN(x + e->width, 0xFF);
+}
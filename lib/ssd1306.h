@@ -1,6 +1,17 @@
+#ifndef SSD1306_H
+#define SSD1306_H
+
 #include <stdlib.h>
 #include "pico/stdlib.h"
+#if !PICO_NO_HARDWARE
 #include "hardware/i2c.h"
+#include "hardware/dma.h"
+#else
+typedef struct i2c_inst i2c_inst_t;
+#ifndef I2C_IC_DATA_CMD_STOP_BITS
+#define I2C_IC_DATA_CMD_STOP_BITS 0x00000200u
+#endif
+#endif
 
 #define WIDTH 128
 #define HEIGHT 64
@@ -22,22 +33,114 @@ typedef enum {
   SET_DISP_CLK_DIV = 0xD5,
   SET_PRECHARGE = 0xD9,
   SET_VCOM_DESEL = 0xDB,
-  SET_CHARGE_PUMP = 0x8D
+  SET_CHARGE_PUMP = 0x8D,
+  SET_NOP = 0xE3
 } ssd1306_command_t;
 
+#define SSD1306_MAX_PAGES 8
+
+// Contadores do barramento, para medir o custo de cada atualização. bus_bytes
+// inclui o byte de endereço de cada transação.
+typedef struct {
+  uint32_t bus_bytes;
+  uint32_t transactions;
+  uint32_t flushes;
+  // Envios assíncronos interrompidos por NACK (a tela é reenviada inteira)
+  uint32_t aborts;
+  // Strings de ssd1306_text() achadas ou não no cache
+  uint32_t text_hits;
+  uint32_t text_misses;
+} ssd1306_stats_t;
+
+enum {
+  SSD1306_STREAM_DONE = 0,
+  SSD1306_STREAM_BUSY = 1,
+  SSD1306_STREAM_ABORTED = -1
+};
+
+// Como os bytes chegam ao display. write envia uma transação I2C (byte de
+// controle e dados) e só retorna no fim. stream_start inicia o envio de uma
+// fila de palavras no formato de IC_DATA_CMD, com STOP no fim de cada
+// transação, e stream_poll diz se ela terminou; sem stream_start,
+// ssd1306_send_data_async() envia na hora com write. ctx é passado de volta
+// em todas as chamadas.
+typedef struct {
+  void (*write)(void *ctx, const uint8_t *buf, size_t len);
+  void (*stream_start)(void *ctx, const uint16_t *stream, size_t len);
+  int (*stream_poll)(void *ctx);
+} ssd1306_transport_t;
+
+// ram_buffer está em endereçamento horizontal: ram_buffer[0] é o byte de
+// controle 0x40 e o pixel (x, y) fica no bit y % 8 de
+// ram_buffer[1 + (y / 8) * width + x]. shadow tem o mesmo formato e guarda o
+// que já está no display. As funções de desenho marcam, por página, a faixa
+// de colunas [dirty_x0, dirty_x1) alterada; ssd1306_send_data() só envia o
+// que realmente mudou dentro dessas faixas.
+//
+// ssd1306_send_data_async() copia as janelas alteradas para tx_stream, já no
+// formato do registrador IC_DATA_CMD (um uint16_t por byte, com o bit de STOP
+// no fim de cada transação), e com ssd1306_transport_dma o DMA alimenta a
+// FIFO do I2C pelo DREQ de TX.
+// tx_stream funciona como o segundo buffer: a ram_buffer fica livre para
+// desenhar o próximo quadro enquanto o anterior é transmitido.
 typedef struct {
   uint8_t width, height, pages, address;
   i2c_inst_t *i2c_port;
   bool external_vcc;
   uint8_t *ram_buffer;
+  uint8_t *shadow;
+  bool shadow_valid;
   size_t bufsize;
   uint8_t port_buffer[2];
+  uint8_t dirty_x0[SSD1306_MAX_PAGES];
+  uint8_t dirty_x1[SSD1306_MAX_PAGES];
+  const ssd1306_transport_t *transport;
+  void *transport_ctx;
+  uint16_t *tx_stream;
+  bool tx_busy;
+  bool resync; // envio interrompido: o display pode esperar argumentos
+  int dma_chan; // requisitado no primeiro envio por DMA
+  ssd1306_stats_t stats;
 } ssd1306_t;
 
+#if !PICO_NO_HARDWARE
+// Transportes do RP2040, ambos com ctx = o próprio ssd1306_t: I2C bloqueante,
+// e I2C bloqueante mais envio assíncrono por DMA (o padrão)
+extern const ssd1306_transport_t ssd1306_transport_i2c;
+extern const ssd1306_transport_t ssd1306_transport_dma;
+#else
+// Painel simulado de ssd1306_host.c, com ctx = ssd1306_host_dev_t
+extern const ssd1306_transport_t ssd1306_transport_host;
+typedef struct ssd1306_host_dev ssd1306_host_dev_t;
+extern ssd1306_host_dev_t ssd1306_host_dev;
+#endif
+
+// Usa ssd1306_transport_dma no RP2040 e o painel ssd1306_host_dev no host
 void ssd1306_init(ssd1306_t *ssd, uint8_t width, uint8_t height, bool external_vcc, uint8_t address, i2c_inst_t *i2c);
+// Troca o transporte, esperando o envio em andamento
+void ssd1306_set_transport(ssd1306_t *ssd, const ssd1306_transport_t *transport, void *ctx);
 void ssd1306_config(ssd1306_t *ssd);
 void ssd1306_command(ssd1306_t *ssd, uint8_t command);
 void ssd1306_send_data(ssd1306_t *ssd);
+// Inicia o envio do que mudou e retorna sem esperar. Retorna false, sem fazer
+// nada, se o envio anterior ainda não terminou; as alterações continuam
+// marcadas e vão no próximo envio. ssd1306_send_data() e ssd1306_command()
+// esperam o envio em andamento, então a ordem dos comandos é preservada.
+bool ssd1306_send_data_async(ssd1306_t *ssd);
+// Verdadeiro enquanto um envio assíncrono não terminou no barramento
+bool ssd1306_busy(ssd1306_t *ssd);
+void ssd1306_wait(ssd1306_t *ssd);
+// Força o próximo ssd1306_send_data() a reenviar a tela inteira (por exemplo
+// depois de reconfigurar ou resetar o display)
+void ssd1306_invalidate(ssd1306_t *ssd);
+
+// Marca as colunas [x0, x1) da página page como alteradas
+static inline void ssd1306_mark_dirty(ssd1306_t *ssd, uint8_t page, uint8_t x0, uint8_t x1) {
+  if (x0 < ssd->dirty_x0[page])
+    ssd->dirty_x0[page] = x0;
+  if (x1 > ssd->dirty_x1[page])
+    ssd->dirty_x1[page] = x1;
+}
 
 void ssd1306_pixel(ssd1306_t *ssd, uint8_t x, uint8_t y, bool value);
 void ssd1306_fill(ssd1306_t *ssd, bool value);
@@ -46,4 +149,39 @@ void ssd1306_line(ssd1306_t *ssd, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1
 void ssd1306_hline(ssd1306_t *ssd, uint8_t x0, uint8_t x1, uint8_t y, bool value);
 void ssd1306_vline(ssd1306_t *ssd, uint8_t x, uint8_t y0, uint8_t y1, bool value);
 void ssd1306_draw_char(ssd1306_t *ssd, char c, uint8_t x, uint8_t y);
-void ssd1306_draw_string(ssd1306_t *ssd, const char *str, uint8_t x, uint8_t y);
\ No newline at end of file
+void ssd1306_draw_string(ssd1306_t *ssd, const char *str, uint8_t x, uint8_t y);
+
+// Fonte em colunas, no formato da RAM do display: cada caractere tem cell_w
+// colunas de pages bytes, página por página (bit 0 em cima). Com metrics,
+// a fonte é proporcional: para cada caractere, a primeira coluna usada e a
+// largura, seguidas de spacing colunas em branco. ssd1306_text() aceita no
+// máximo SSD1306_FONT_MAX_PAGES páginas (16 pixels de altura); com fontes
+// mais altas não desenha nada.
+#define SSD1306_FONT_MAX_PAGES 2
+typedef struct {
+  const uint8_t *glyphs;
+  const uint8_t *metrics;
+  uint8_t first, last;
+  uint8_t cell_w, pages;
+  uint8_t spacing;
+} ssd1306_font_t;
+
+extern const ssd1306_font_t ssd1306_font_8x8;   // a fonte de draw_char
+extern const ssd1306_font_t ssd1306_font_prop;  // a mesma, proporcional
+extern const ssd1306_font_t ssd1306_font_large; // 16 pixels de altura, proporcional
+
+#define SSD1306_TEXT_MAX_W 128
+#ifndef SSD1306_TEXT_CACHE_ENTRIES
+#define SSD1306_TEXT_CACHE_ENTRIES 8
+#endif
+// Strings a partir deste tamanho não vão para o cache
+#define SSD1306_TEXT_CACHE_KEY 24
+
+// Escreve str em (x, y), sem quebra de linha, e retorna o x depois do texto.
+// Como draw_char, apaga o fundo na altura da fonte. A string é renderizada
+// uma vez, já deslocada para y % 8, e guardada num cache; redesenhar a mesma
+// string com a mesma fonte e o mesmo y % 8 só copia as colunas prontas.
+uint8_t ssd1306_text(ssd1306_t *ssd, const ssd1306_font_t *font, const char *str, uint8_t x, uint8_t y);
+uint8_t ssd1306_text_width(const ssd1306_font_t *font, const char *str);
+
+#endif
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <string.h>
+#include "ssd1306_host.h"
+
+ssd1306_host_dev_t ssd1306_host_dev;
+
+void ssd1306_host_reset(ssd1306_host_dev_t *dev, uint32_t bytes_per_poll) {
+  memset(dev, 0, sizeof(*dev));
+  dev->mem_mode = 2;
+  dev->col1 = 127;
+  dev->page1 = 7;
+  dev->bytes_per_poll = bytes_per_poll;
+}
+
+static uint8_t host_cmd_args(uint8_t cmd) {
+  switch (cmd) {
+    case 0x21: // SET_COL_ADDR
+    case 0x22: // SET_PAGE_ADDR
+      return 2;
+    case 0x20: // SET_MEM_ADDR
+    case 0x81: // SET_CONTRAST
+    case 0xA8: // SET_MUX_RATIO
+    case 0xD3: // SET_DISP_OFFSET
+    case 0xD5: // SET_DISP_CLK_DIV
+    case 0xD9: // SET_PRECHARGE
+    case 0xDA: // SET_COM_PIN_CFG
+    case 0xDB: // SET_VCOM_DESEL
+    case 0x8D: // SET_CHARGE_PUMP
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+static void host_exec(ssd1306_host_dev_t *dev) {
+  switch (dev->cmd) {
+    case 0x20:
+      dev->mem_mode = dev->args[0] & 3;
+      break;
+    case 0x21:
+      dev->col0 = dev->col = dev->args[0] & 127;
+      dev->col1 = dev->args[1] & 127;
+      break;
+    case 0x22:
+      dev->page0 = dev->page = dev->args[0] & 7;
+      dev->page1 = dev->args[1] & 7;
+      break;
+    case 0xAE:
+    case 0xAF:
+      dev->display_on = dev->cmd & 1;
+      break;
+    case 0xA6:
+    case 0xA7:
+      dev->inverted = dev->cmd & 1;
+      break;
+    default:
+      // Endereçamento de página: 0xB0-0xB7 e nibbles da coluna
+      if (dev->cmd >= 0xB0 && dev->cmd <= 0xB7)
+        dev->page = dev->cmd & 7;
+      else if (dev->cmd <= 0x0F)
+        dev->col = (dev->col & 0xF0) | dev->cmd;
+      else if (dev->cmd <= 0x1F)
+        dev->col = ((dev->cmd & 0x07) << 4) | (dev->col & 0x0F);
+      break;
+  }
+}
+
+static void host_command(ssd1306_host_dev_t *dev, uint8_t b) {
+  if (dev->args_left) {
+    dev->args[dev->nargs++] = b;
+    if (--dev->args_left == 0)
+      host_exec(dev);
+    return;
+  }
+  dev->cmd = b;
+  dev->nargs = 0;
+  dev->args_left = host_cmd_args(b);
+  if (!dev->args_left)
+    host_exec(dev);
+}
+
+static void host_data(ssd1306_host_dev_t *dev, uint8_t b) {
+  dev->gram[dev->page][dev->col] = b;
+  if (dev->mem_mode == 0) {
+    if (dev->col == dev->col1) {
+      dev->col = dev->col0;
+      dev->page = dev->page == dev->page1 ? dev->page0 : dev->page + 1;
+    } else {
+      ++dev->col;
+    }
+  } else if (dev->mem_mode == 1) {
+    if (dev->page == dev->page1) {
+      dev->page = dev->page0;
+      dev->col = dev->col == dev->col1 ? dev->col0 : dev->col + 1;
+    } else {
+      ++dev->page;
+    }
+  } else if (dev->col < 127) {
+    ++dev->col;
+  }
+}
+
+static void host_start(ssd1306_host_dev_t *dev) {
+  dev->expect_control = true;
+  ++dev->transactions;
+  ++dev->bytes; // endereço
+}
+
+// Byte de controle: bit 7 (Co) = só o próximo byte, depois outro controle;
+// bit 6 (D/C) = dados
+static void host_byte(ssd1306_host_dev_t *dev, uint8_t b) {
+  ++dev->bytes;
+  if (dev->expect_control) {
+    dev->single = b & 0x80;
+    dev->data_mode = b & 0x40;
+    dev->expect_control = false;
+    return;
+  }
+  if (dev->data_mode)
+    host_data(dev, b);
+  else
+    host_command(dev, b);
+  if (dev->single)
+    dev->expect_control = true;
+}
+
+static void host_write(void *ctx, const uint8_t *buf, size_t len) {
+  ssd1306_host_dev_t *dev = ctx;
+  if (dev->stream_pos < dev->stream_len)
+    ++dev->overlap_errors;
+  host_start(dev);
+  for (size_t i = 0; i < len; ++i)
+    host_byte(dev, buf[i]);
+}
+
+static void host_stream_start(void *ctx, const uint16_t *stream, size_t len) {
+  ssd1306_host_dev_t *dev = ctx;
+  if (dev->stream_pos < dev->stream_len)
+    ++dev->overlap_errors;
+  dev->stream = stream;
+  dev->stream_len = len;
+  dev->stream_pos = 0;
+}
+
+static int host_stream_poll(void *ctx) {
+  ssd1306_host_dev_t *dev = ctx;
+  size_t end = dev->stream_len;
+  if (dev->bytes_per_poll && dev->stream_pos + dev->bytes_per_poll < end)
+    end = dev->stream_pos + dev->bytes_per_poll;
+  // Uma transação começa no primeiro byte e depois de cada STOP
+  for (; dev->stream_pos < end; ++dev->stream_pos) {
+    uint16_t e = dev->stream[dev->stream_pos];
+    if (dev->stream_pos == 0 || (dev->stream[dev->stream_pos - 1] & I2C_IC_DATA_CMD_STOP_BITS))
+      host_start(dev);
+    host_byte(dev, e & 0xFF);
+  }
+  return dev->stream_pos < dev->stream_len ? SSD1306_STREAM_BUSY : SSD1306_STREAM_DONE;
+}
+
+const ssd1306_transport_t ssd1306_transport_host = {
+  .write = host_write,
+  .stream_start = host_stream_start,
+  .stream_poll = host_stream_poll
+};
+
+bool ssd1306_host_pixel(const ssd1306_host_dev_t *dev, uint8_t x, uint8_t y) {
+  bool on = (dev->gram[y >> 3][x] >> (y & 7)) & 1;
+  return on != dev->inverted;
+}
+
+bool ssd1306_host_write_pbm(const ssd1306_host_dev_t *dev, const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return false;
+  // P4: 1 = preto, 8 pixels por byte com o mais à esquerda no bit 7. O
+  // pixel aceso sai preto, como tinta no papel.
+  fprintf(f, "P4\n128 64\n");
+  for (uint8_t y = 0; y < 64; ++y) {
+    uint8_t row[16] = {0};
+    for (uint8_t x = 0; x < 128; ++x) {
+      if (ssd1306_host_pixel(dev, x, y))
+        row[x >> 3] |= 0x80 >> (x & 7);
+    }
+    fwrite(row, 1, sizeof(row), f);
+  }
+  return fclose(f) == 0;
+}
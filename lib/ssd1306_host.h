@@ -0,0 +1,53 @@
+#ifndef SSD1306_HOST_H
+#define SSD1306_HOST_H
+
+// Display SSD1306 simulado, para compilar lib/ssd1306.c no host
+// (PICO_NO_HARDWARE) sem I2C nem DMA. ssd1306_transport_host decodifica o
+// que o driver envia (bytes de controle, comandos com argumentos em
+// transações separadas ou não, dados em endereçamento horizontal, vertical
+// ou de página) para a GRAM de um painel virtual. Assim dá para conferir no
+// host o que chegaria ao display, em que ordem e quando, e salvar a tela
+// como PBM.
+//
+// O envio assíncrono só anda quando consultado: cada stream_poll transmite
+// bytes_per_poll entradas (0 = tudo de uma vez), imitando um barramento mais
+// lento que a CPU.
+
+#include "ssd1306.h"
+
+typedef struct ssd1306_host_dev {
+  uint8_t gram[8][128];
+  uint8_t mem_mode;
+  uint8_t col0, col1, page0, page1;
+  uint8_t col, page;
+  bool display_on;
+  bool inverted;
+
+  // Estado do decodificador. Um comando e seus argumentos podem vir em
+  // transações separadas (byte de controle 0x80).
+  bool expect_control, single, data_mode;
+  uint8_t cmd, args_left, nargs;
+  uint8_t args[2];
+
+  // Envio assíncrono: entradas no formato de IC_DATA_CMD
+  const uint16_t *stream;
+  size_t stream_len, stream_pos;
+  uint32_t bytes_per_poll;
+
+  uint32_t transactions;
+  uint32_t bytes;
+  // Escritas iniciadas com um envio assíncrono ainda em andamento. O driver
+  // nunca deve fazer isso.
+  uint32_t overlap_errors;
+} ssd1306_host_dev_t;
+
+// Painel zerado, em endereçamento de página como após o reset
+void ssd1306_host_reset(ssd1306_host_dev_t *dev, uint32_t bytes_per_poll);
+
+// Pixel visível em (x, y), já considerando o modo invertido (0xA7)
+bool ssd1306_host_pixel(const ssd1306_host_dev_t *dev, uint8_t x, uint8_t y);
+
+// Salva a tela (128x64) como PBM binário. Falso se não conseguiu escrever.
+bool ssd1306_host_write_pbm(const ssd1306_host_dev_t *dev, const char *path);
+
+#endif
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <string.h>
+#include "ssd1306_widget.h"
+
+static void screen_mark(ssd1306_screen_t *scr, uint8_t x, uint8_t y, uint8_t w, uint8_t h) {
+  ssd1306_area_t a = {
+    x, y, MIN(x + w, scr->ssd->width), MIN(y + h, scr->ssd->height)
+  };
+  if (a.x0 >= a.x1 || a.y0 >= a.y1)
+    return;
+  // Junta com uma área que já encosta nesta; se a lista estiver cheia, com a
+  // última
+  ssd1306_area_t *d = NULL;
+  for (uint8_t i = 0; i < scr->n_dirty; ++i) {
+    ssd1306_area_t *o = &scr->dirty[i];
+    if (a.x0 <= o->x1 && o->x0 <= a.x1 && a.y0 <= o->y1 && o->y0 <= a.y1) {
+      d = o;
+      break;
+    }
+  }
+  if (!d && scr->n_dirty == SSD1306_SCREEN_MAX_DIRTY)
+    d = &scr->dirty[scr->n_dirty - 1];
+  if (!d) {
+    scr->dirty[scr->n_dirty++] = a;
+    return;
+  }
+  d->x0 = MIN(d->x0, a.x0);
+  d->y0 = MIN(d->y0, a.y0);
+  d->x1 = MAX(d->x1, a.x1);
+  d->y1 = MAX(d->y1, a.y1);
+}
+
+static void widget_mark(ssd1306_screen_t *scr, const ssd1306_widget_t *w) {
+  screen_mark(scr, w->x, w->y, w->w, w->h);
+}
+
+void ssd1306_screen_init(ssd1306_screen_t *scr, ssd1306_t *ssd, ssd1306_widget_t *widgets, uint8_t max_widgets, bool background) {
+  scr->ssd = ssd;
+  scr->widgets = widgets;
+  scr->n_widgets = 0;
+  scr->max_widgets = max_widgets;
+  scr->background = background;
+  // A composição copia a tela inteira para cá, então sem ela não há tela
+  scr->scratch = calloc(ssd->bufsize, sizeof(uint8_t));
+  if (!scr->scratch)
+    panic("SSD1306 screen scratch allocation failed");
+  scr->pixels_touched = 0;
+  ssd1306_screen_invalidate(scr);
+}
+
+void ssd1306_screen_invalidate(ssd1306_screen_t *scr) {
+  scr->dirty[0] = (ssd1306_area_t){0, 0, scr->ssd->width, scr->ssd->height};
+  scr->n_dirty = 1;
+}
+
+static ssd1306_widget_t *screen_add(ssd1306_screen_t *scr, uint8_t type, uint8_t x, uint8_t y, uint8_t w, uint8_t h, bool value) {
+  if (scr->n_widgets == scr->max_widgets)
+    return NULL;
+  ssd1306_widget_t *wd = &scr->widgets[scr->n_widgets++];
+  memset(wd, 0, sizeof(*wd));
+  wd->type = type;
+  wd->value = value;
+  wd->x = x;
+  wd->y = y;
+  wd->w = w;
+  wd->h = h;
+  widget_mark(scr, wd);
+  return wd;
+}
+
+ssd1306_widget_t *ssd1306_screen_frame(ssd1306_screen_t *scr, uint8_t x, uint8_t y, uint8_t w, uint8_t h, bool value) {
+  return screen_add(scr, SSD1306_WIDGET_FRAME, x, y, w, h, value);
+}
+
+ssd1306_widget_t *ssd1306_screen_hline(ssd1306_screen_t *scr, uint8_t x0, uint8_t x1, uint8_t y, bool value) {
+  return screen_add(scr, SSD1306_WIDGET_HLINE, x0, y, x1 - x0 + 1, 1, value);
+}
+
+// Atualiza o texto e a largura, marcando a área antiga e a nova
+static void text_update(ssd1306_screen_t *scr, ssd1306_widget_t *w, const char *text) {
+  widget_mark(scr, w);
+  snprintf(w->text, sizeof(w->text), "%s", text);
+  w->w = ssd1306_text_width(w->font, w->text);
+  widget_mark(scr, w);
+}
+
+ssd1306_widget_t *ssd1306_screen_label(ssd1306_screen_t *scr, const ssd1306_font_t *font, uint8_t x, uint8_t y, const char *text) {
+  ssd1306_widget_t *w = screen_add(scr, SSD1306_WIDGET_LABEL, x, y, 0, font->pages * 8, true);
+  if (w) {
+    w->font = font;
+    text_update(scr, w, text);
+  }
+  return w;
+}
+
+ssd1306_widget_t *ssd1306_screen_counter(ssd1306_screen_t *scr, const ssd1306_font_t *font, uint8_t x, uint8_t y, const char *prefix, uint32_t count) {
+  ssd1306_widget_t *w = screen_add(scr, SSD1306_WIDGET_COUNTER, x, y, 0, font->pages * 8, true);
+  if (w) {
+    char text[SSD1306_WIDGET_TEXT];
+    w->font = font;
+    w->prefix = prefix;
+    w->count = count;
+    snprintf(text, sizeof(text), "%s%lu", prefix, (unsigned long)count);
+    text_update(scr, w, text);
+  }
+  return w;
+}
+
+void ssd1306_label_set(ssd1306_screen_t *scr, ssd1306_widget_t *w, const char *text) {
+  if (!strncmp(w->text, text, sizeof(w->text) - 1))
+    return;
+  text_update(scr, w, text);
+}
+
+void ssd1306_counter_set(ssd1306_screen_t *scr, ssd1306_widget_t *w, uint32_t count) {
+  if (w->count == count)
+    return;
+  char text[SSD1306_WIDGET_TEXT];
+  w->count = count;
+  snprintf(text, sizeof(text), "%s%lu", w->prefix, (unsigned long)count);
+  text_update(scr, w, text);
+}
+
+static void widget_draw(ssd1306_t *ssd, const ssd1306_widget_t *w) {
+  switch (w->type) {
+    case SSD1306_WIDGET_FRAME:
+      ssd1306_rect(ssd, w->y, w->x, w->w, w->h, w->value, false);
+      break;
+    case SSD1306_WIDGET_HLINE:
+      ssd1306_hline(ssd, w->x, w->x + w->w - 1, w->y, w->value);
+      break;
+    case SSD1306_WIDGET_LABEL:
+    case SSD1306_WIDGET_COUNTER:
+      ssd1306_text(ssd, w->font, w->text, w->x, w->y);
+      break;
+  }
+}
+
+static bool widget_hits(const ssd1306_widget_t *w, const ssd1306_area_t *a) {
+  return w->x < a->x1 && a->x0 < w->x + w->w && w->y < a->y1 && a->y0 < w->y + w->h;
+}
+
+// Recompõe uma área: guarda as páginas que ela e os widgets que a cruzam
+// ocupam, limpa a área, redesenha esses widgets e devolve tudo o que ficou
+// fora dela
+static void screen_compose_area(ssd1306_screen_t *scr, const ssd1306_area_t *a) {
+  ssd1306_t *ssd = scr->ssd;
+  uint8_t page0 = a->y0 >> 3;
+  uint8_t page1 = (a->y1 - 1) >> 3;
+  uint8_t save0 = page0, save1 = page1;
+  for (uint8_t i = 0; i < scr->n_widgets; ++i) {
+    const ssd1306_widget_t *w = &scr->widgets[i];
+    if (widget_hits(w, a)) {
+      save0 = MIN(save0, w->y >> 3);
+      save1 = MAX(save1, MIN((w->y + w->h - 1) >> 3, ssd->pages - 1));
+    }
+  }
+  uint8_t *ram = &ssd->ram_buffer[1];
+  memcpy(&scr->scratch[save0 * ssd->width], &ram[save0 * ssd->width], (save1 - save0 + 1) * ssd->width);
+
+  ssd1306_rect(ssd, a->y0, a->x0, a->x1 - a->x0, a->y1 - a->y0, scr->background, true);
+  for (uint8_t i = 0; i < scr->n_widgets; ++i) {
+    if (widget_hits(&scr->widgets[i], a))
+      widget_draw(ssd, &scr->widgets[i]);
+  }
+
+  for (uint8_t page = save0; page <= save1; ++page) {
+    uint8_t *row = &ram[page * ssd->width];
+    const uint8_t *old = &scr->scratch[page * ssd->width];
+    if (page < page0 || page > page1) {
+      memcpy(row, old, ssd->width);
+      continue;
+    }
+    uint8_t mask = 0xFF;
+    if (page == page0)
+      mask &= 0xFF << (a->y0 & 7);
+    if (page == page1)
+      mask &= 0xFF >> (7 - ((a->y1 - 1) & 7));
+    memcpy(row, old, a->x0);
+    memcpy(&row[a->x1], &old[a->x1], ssd->width - a->x1);
+    for (uint8_t x = a->x0; x < a->x1; ++x)
+      row[x] = (row[x] & mask) | (old[x] & ~mask);
+  }
+  scr->pixels_touched += (a->x1 - a->x0) * (a->y1 - a->y0);
+}
+
+uint32_t ssd1306_screen_compose(ssd1306_screen_t *scr) {
+  uint32_t before = scr->pixels_touched;
+  for (uint8_t i = 0; i < scr->n_dirty; ++i)
+    screen_compose_area(scr, &scr->dirty[i]);
+  scr->n_dirty = 0;
+  return scr->pixels_touched - before;
+}
@@ -0,0 +1,77 @@
+#ifndef SSD1306_WIDGET_H
+#define SSD1306_WIDGET_H
+
+#include "ssd1306.h"
+
+// Camada de widgets retidos sobre o ssd1306: a tela é montada uma vez com
+// molduras, linhas, rótulos e contadores, e depois só os setters são
+// chamados. Cada setter que muda algo marca o retângulo do widget (o antigo
+// e o novo) como sujo, e ssd1306_screen_compose() redesenha apenas esses
+// retângulos: limpa o fundo, redesenha na ordem de criação os widgets que
+// os cruzam e descarta o que eles desenharam fora do retângulo. Depois é só
+// chamar ssd1306_send_data() ou ssd1306_send_data_async(), que enviam só o
+// que mudou.
+//
+// Os widgets ficam num vetor fornecido por quem chama, e os ponteiros
+// retornados continuam válidos enquanto a tela existir.
+
+#define SSD1306_WIDGET_TEXT 22
+#define SSD1306_SCREEN_MAX_DIRTY 8
+
+typedef enum {
+  SSD1306_WIDGET_FRAME,
+  SSD1306_WIDGET_HLINE,
+  SSD1306_WIDGET_LABEL,
+  SSD1306_WIDGET_COUNTER
+} ssd1306_widget_type_t;
+
+typedef struct {
+  uint8_t type;
+  bool value;
+  // Retângulo ocupado: colunas [x, x + w) e linhas [y, y + h)
+  uint8_t x, y, w, h;
+  const ssd1306_font_t *font;
+  const char *prefix;
+  uint32_t count;
+  char text[SSD1306_WIDGET_TEXT];
+} ssd1306_widget_t;
+
+typedef struct {
+  uint8_t x0, y0, x1, y1;
+} ssd1306_area_t;
+
+typedef struct {
+  ssd1306_t *ssd;
+  ssd1306_widget_t *widgets;
+  uint8_t n_widgets, max_widgets;
+  bool background;
+  ssd1306_area_t dirty[SSD1306_SCREEN_MAX_DIRTY];
+  uint8_t n_dirty;
+  // Cópia das páginas em recomposição, para recortar os widgets
+  uint8_t *scratch;
+  // Pixels recompostos desde o init
+  uint32_t pixels_touched;
+} ssd1306_screen_t;
+
+// A tela começa inteira suja, para a primeira composição desenhar tudo
+void ssd1306_screen_init(ssd1306_screen_t *scr, ssd1306_t *ssd, ssd1306_widget_t *widgets, uint8_t max_widgets, bool background);
+// Marca a tela inteira para ser recomposta, por exemplo depois de desenhar
+// outra coisa direto na ram_buffer
+void ssd1306_screen_invalidate(ssd1306_screen_t *scr);
+
+// Retornam NULL se o vetor de widgets estiver cheio
+ssd1306_widget_t *ssd1306_screen_frame(ssd1306_screen_t *scr, uint8_t x, uint8_t y, uint8_t w, uint8_t h, bool value);
+ssd1306_widget_t *ssd1306_screen_hline(ssd1306_screen_t *scr, uint8_t x0, uint8_t x1, uint8_t y, bool value);
+ssd1306_widget_t *ssd1306_screen_label(ssd1306_screen_t *scr, const ssd1306_font_t *font, uint8_t x, uint8_t y, const char *text);
+// Mostra prefix seguido de count em decimal. prefix não é copiado.
+ssd1306_widget_t *ssd1306_screen_counter(ssd1306_screen_t *scr, const ssd1306_font_t *font, uint8_t x, uint8_t y, const char *prefix, uint32_t count);
+
+// Não marcam nada se o valor não mudou
+void ssd1306_label_set(ssd1306_screen_t *scr, ssd1306_widget_t *w, const char *text);
+void ssd1306_counter_set(ssd1306_screen_t *scr, ssd1306_widget_t *w, uint32_t count);
+
+// Redesenha as áreas sujas na ram_buffer. Retorna o número de pixels
+// recompostos (0 se nada mudou).
+uint32_t ssd1306_screen_compose(ssd1306_screen_t *scr);
+
+#endif
@@ -6,6 +6,9 @@
 #include "dvi_timing.h"
 #include "dvi_serialiser.h"
 #include "tmds_encode.h"
+#if DVI_ENCODE_CYCLE_STATS || DVI_SCANLINE_CALLBACK_WATCHDOG
+#include "util_systick_inline.h"
+#endif
 
 // Time-critical functions pulled into RAM but each in a unique section to
 // allow garbage collection
@@ -30,6 +33,18 @@ void dvi_init(struct dvi_inst *inst, uint spinlock_tmds_queue, uint spinlock_col
 	inst->late_scanline_ctr = 0;
 	inst->tmds_buf_release_next = NULL;
 	inst->tmds_buf_release = NULL;
+	inst->tmds_palette_next = NULL;
+	inst->defer_wptr = 0;
+	inst->defer_rptr = 0;
+	inst->cb_stats = (struct dvi_callback_stats){0};
+	// clk_sys is the bit clock, so 10 cycles per pixel
+	const struct dvi_timing *t = inst->timing;
+	uint32_t line_cycles = 10 * (t->h_front_porch + t->h_sync_width + t->h_back_porch + t->h_active_pixels);
+	inst->cb_stats.budget_cycles = line_cycles * DVI_SCANLINE_CALLBACK_BUDGET_PCT / 100;
+#if DVI_ENCODE_CYCLE_STATS
+	inst->encode_cycles_last = 0;
+	inst->encode_cycles_max = 0;
+#endif
 	queue_init_with_spinlock(&inst->q_tmds_valid,   sizeof(void*),  8, spinlock_tmds_queue);
 	queue_init_with_spinlock(&inst->q_tmds_free,    sizeof(void*),  8, spinlock_tmds_queue);
 	queue_init_with_spinlock(&inst->q_colour_valid, sizeof(void*),  8, spinlock_colour_queue);
@@ -72,6 +87,9 @@ void dvi_register_irqs_this_core(struct dvi_inst *inst, uint irq_num) {
 		dma_irq_privdata[1] = inst;
 		irq_set_exclusive_handler(DMA_IRQ_1, dvi_dma1_irq);
 	}
+#if DVI_SCANLINE_CALLBACK_WATCHDOG
+	systick_cycle_counter_init();
+#endif
 	irq_set_enabled(irq_num, true);
 }
 
@@ -137,15 +155,132 @@ static inline void __dvi_func_x(_dvi_prepare_scanline_16bpp)(struct dvi_inst *in
 	queue_add_blocking_u32(&inst->q_tmds_valid, &tmdsbuf);
 }
 
+#if !DVI_MONOCHROME_TMDS && DVI_SYMBOLS_PER_WORD == 2
+static inline void __dvi_func_x(_dvi_prepare_scanline_palette)(struct dvi_inst *inst, const uint32_t *pixbuf) {
+	uint32_t *tmdsbuf;
+	queue_remove_blocking_u32(&inst->q_tmds_free, &tmdsbuf);
+	// Full resolution, so n_pix is the number of output pixels, and the encoder
+	// handles all three channels in one call.
+	tmds_encode_palette_data(pixbuf, inst->tmds_palette, tmdsbuf, inst->timing->h_active_pixels, inst->palette_bits);
+	queue_add_blocking_u32(&inst->q_tmds_valid, &tmdsbuf);
+}
+
+// Returns a line buffer for unpacked pixels, or NULL if the indexed pixels
+// are already 8bpp and can be encoded in place.
+static uint32_t *_dvi_palette_linebuf_alloc(struct dvi_inst *inst) {
+	if (inst->palette_bits != 2 && inst->palette_bits != 4 && inst->palette_bits != 8)
+		panic("Unsupported palette bit depth %u", inst->palette_bits);
+	if (inst->palette_bits == 8)
+		return NULL;
+	uint32_t *linebuf = malloc(inst->timing->h_active_pixels);
+	if (!linebuf)
+		panic("Palette line buffer allocation failed");
+	return linebuf;
+}
+
+static inline void __dvi_func_x(_dvi_prepare_scanline_palette_packed)(struct dvi_inst *inst, const uint32_t *pixbuf, uint32_t *linebuf) {
+	if (linebuf) {
+		tmds_unpack_palette_pixels(pixbuf, linebuf, inst->timing->h_active_pixels, inst->palette_bits);
+		pixbuf = linebuf;
+	}
+	_dvi_prepare_scanline_palette(inst, pixbuf);
+}
+
+// Only ever called by the encode worker, between frames, so the encoder never
+// sees the palette change in the middle of a frame.
+static inline void __dvi_func(_dvi_palette_frame_start)(struct dvi_inst *inst) {
+	const uint32_t *next = inst->tmds_palette_next;
+	if (next) {
+		inst->tmds_palette = next;
+		inst->tmds_palette_next = NULL;
+	}
+}
+
+void dvi_set_palette(struct dvi_inst *inst, const uint32_t *tmds_palette) {
+	inst->tmds_palette_next = tmds_palette;
+}
+#endif
+
+#if DVI_ENCODE_CYCLE_STATS
+static inline void _dvi_encode_stats_init(void) {
+	systick_cycle_counter_init();
+}
+
+static inline uint32_t _dvi_encode_stats_start(void) {
+	return systick_cycle_count_now();
+}
+
+static inline void __dvi_func(_dvi_encode_stats_end)(struct dvi_inst *inst, uint32_t t0) {
+	uint32_t cycles = systick_cycles_since(t0);
+	inst->encode_cycles_last = cycles;
+	if (cycles > inst->encode_cycles_max)
+		inst->encode_cycles_max = cycles;
+}
+#else
+static inline void _dvi_encode_stats_init(void) {}
+static inline uint32_t _dvi_encode_stats_start(void) {return 0;}
+static inline void _dvi_encode_stats_end(struct dvi_inst *inst, uint32_t t0) {}
+#endif
+
+bool __dvi_func(dvi_defer)(struct dvi_inst *inst, dvi_deferred_fn_t fn, void *arg) {
+	uint wptr = inst->defer_wptr;
+	if (wptr - inst->defer_rptr == DVI_DEFER_QUEUE_SIZE) {
+		++inst->cb_stats.deferred_dropped;
+		return false;
+	}
+	struct dvi_deferred_job *job = &inst->defer_ring[wptr & (DVI_DEFER_QUEUE_SIZE - 1)];
+	job->fn = fn;
+	job->arg = arg;
+	// Job must be visible before the pointer, as the consumer may be on the
+	// other core
+	__dmb();
+	inst->defer_wptr = wptr + 1;
+	return true;
+}
+
+void __dvi_func(dvi_run_deferred)(struct dvi_inst *inst) {
+	uint rptr = inst->defer_rptr;
+	while (rptr != inst->defer_wptr) {
+		__dmb();
+		struct dvi_deferred_job job = inst->defer_ring[rptr & (DVI_DEFER_QUEUE_SIZE - 1)];
+		// Free the slot before running, so the job itself can defer more work
+		inst->defer_rptr = ++rptr;
+		job.fn(job.arg);
+		++inst->cb_stats.deferred_run;
+	}
+}
+
+void dvi_get_callback_stats(const struct dvi_inst *inst, struct dvi_callback_stats *stats) {
+	const volatile struct dvi_callback_stats *src = &inst->cb_stats;
+	stats->calls = src->calls;
+	stats->overruns = src->overruns;
+	stats->max_cycles = src->max_cycles;
+	stats->budget_cycles = src->budget_cycles;
+	stats->deferred_run = src->deferred_run;
+	stats->deferred_dropped = src->deferred_dropped;
+}
+
+void __dvi_func(dvi_encode_scanline_8bpp)(struct dvi_inst *inst, uint32_t *scanbuf) {
+	_dvi_prepare_scanline_8bpp(inst, scanbuf);
+}
+
+void __dvi_func(dvi_encode_scanline_16bpp)(struct dvi_inst *inst, uint32_t *scanbuf) {
+	_dvi_prepare_scanline_16bpp(inst, scanbuf);
+}
+
 // "Worker threads" for TMDS encoding (core enters and never returns, but still handles IRQs)
 
 // Version where each record in q_colour_valid is one scanline:
 void __dvi_func(dvi_scanbuf_main_8bpp)(struct dvi_inst *inst) {
 	uint y = 0;
+	_dvi_encode_stats_init();
 	while (1) {
 		uint32_t *scanbuf;
 		queue_remove_blocking_u32(&inst->q_colour_valid, &scanbuf);
+		uint32_t t0 = _dvi_encode_stats_start();
 		_dvi_prepare_scanline_8bpp(inst, scanbuf);
+		_dvi_encode_stats_end(inst, t0);
+		dvi_run_deferred(inst);
 		queue_add_blocking_u32(&inst->q_colour_free, &scanbuf);
 		++y;
 		if (y == inst->timing->v_active_lines) {
@@ -158,10 +293,14 @@ void __dvi_func(dvi_scanbuf_main_8bpp)(struct dvi_inst *inst) {
 // Ugh copy/paste but it lets us garbage collect the TMDS stuff that is not being used from .scratch_x
 void __dvi_func(dvi_scanbuf_main_16bpp)(struct dvi_inst *inst) {
 	uint y = 0;
+	_dvi_encode_stats_init();
 	while (1) {
 		uint32_t *scanbuf;
 		queue_remove_blocking_u32(&inst->q_colour_valid, &scanbuf);
+		uint32_t t0 = _dvi_encode_stats_start();
 		_dvi_prepare_scanline_16bpp(inst, scanbuf);
+		_dvi_encode_stats_end(inst, t0);
+		dvi_run_deferred(inst);
 		queue_add_blocking_u32(&inst->q_colour_free, &scanbuf);
 		++y;
 		if (y == inst->timing->v_active_lines) {
@@ -171,6 +310,98 @@ void __dvi_func(dvi_scanbuf_main_16bpp)(struct dvi_inst *inst) {
 	__builtin_unreachable();
 }
 
+#if !DVI_MONOCHROME_TMDS && DVI_SYMBOLS_PER_WORD == 2
+void __dvi_func(dvi_scanbuf_main_palette)(struct dvi_inst *inst) {
+	uint y = 0;
+	uint32_t *linebuf = _dvi_palette_linebuf_alloc(inst);
+	_dvi_encode_stats_init();
+	_dvi_palette_frame_start(inst);
+	while (1) {
+		uint32_t *scanbuf;
+		queue_remove_blocking_u32(&inst->q_colour_valid, &scanbuf);
+		uint32_t t0 = _dvi_encode_stats_start();
+		_dvi_prepare_scanline_palette_packed(inst, scanbuf, linebuf);
+		_dvi_encode_stats_end(inst, t0);
+		dvi_run_deferred(inst);
+		queue_add_blocking_u32(&inst->q_colour_free, &scanbuf);
+		++y;
+		if (y == inst->timing->v_active_lines / DVI_VERTICAL_REPEAT) {
+			y = 0;
+			_dvi_palette_frame_start(inst);
+		}
+	}
+	__builtin_unreachable();
+}
+
+void __dvi_func(dvi_framebuf_main_palette)(struct dvi_inst *inst) {
+	uint y = 0;
+	uint32_t *linebuf = _dvi_palette_linebuf_alloc(inst);
+	uint words_per_row = inst->timing->h_active_pixels * inst->palette_bits / 32;
+	_dvi_encode_stats_init();
+	_dvi_palette_frame_start(inst);
+	while (1) {
+		uint32_t *framebuf;
+		queue_peek_blocking_u32(&inst->q_colour_valid, &framebuf);
+		uint32_t t0 = _dvi_encode_stats_start();
+		_dvi_prepare_scanline_palette_packed(inst, framebuf + y * words_per_row, linebuf);
+		_dvi_encode_stats_end(inst, t0);
+		dvi_run_deferred(inst);
+		++y;
+		if (y == inst->timing->v_active_lines / DVI_VERTICAL_REPEAT) {
+			y = 0;
+			// Flip only if there is something to flip to
+			if (queue_get_level(&inst->q_colour_valid) > 1) {
+				queue_remove_blocking_u32(&inst->q_colour_valid, &framebuf);
+				queue_add_blocking_u32(&inst->q_colour_free, &framebuf);
+			}
+			_dvi_palette_frame_start(inst);
+		}
+	}
+	__builtin_unreachable();
+}
+#endif
+
+#if DVI_MONOCHROME_TMDS && DVI_SYMBOLS_PER_WORD == 2
+void __dvi_func(dvi_scanbuf_main_1bpp_pio)(struct dvi_inst *inst, struct tmds_pio_encoder *enc) {
+	uint y = 0;
+	_dvi_encode_stats_init();
+	while (1) {
+		uint32_t *scanbuf;
+		uint32_t *tmdsbuf;
+		queue_remove_blocking_u32(&inst->q_colour_valid, &scanbuf);
+		queue_remove_blocking_u32(&inst->q_tmds_free, &tmdsbuf);
+		uint32_t t0 = _dvi_encode_stats_start();
+		tmds_encode_pio_start(enc, scanbuf, tmdsbuf, inst->timing->h_active_pixels);
+		tmds_encode_pio_wait(enc);
+		_dvi_encode_stats_end(inst, t0);
+		dvi_run_deferred(inst);
+		queue_add_blocking_u32(&inst->q_tmds_valid, &tmdsbuf);
+		queue_add_blocking_u32(&inst->q_colour_free, &scanbuf);
+		++y;
+		if (y == inst->timing->v_active_lines / DVI_VERTICAL_REPEAT) {
+			y = 0;
+		}
+	}
+	__builtin_unreachable();
+}
+#endif
+
+static inline void __dvi_func(_dvi_run_scanline_callback)(struct dvi_inst *inst) {
+#if DVI_SCANLINE_CALLBACK_WATCHDOG
+	uint32_t t0 = systick_cycle_count_now();
+	inst->scanline_callback();
+	uint32_t cycles = systick_cycles_since(t0);
+	struct dvi_callback_stats *stats = &inst->cb_stats;
+	++stats->calls;
+	if (cycles > stats->max_cycles)
+		stats->max_cycles = cycles;
+	if (cycles > stats->budget_cycles)
+		++stats->overruns;
+#else
+	inst->scanline_callback();
+#endif
+}
+
 static void __dvi_func(dvi_dma_irq_handler)(struct dvi_inst *inst) {
 	// Every fourth interrupt marks the start of the horizontal active region. We
 	// now have until the end of this region to generate DMA blocklist for next
@@ -223,7 +454,7 @@ static void __dvi_func(dvi_dma_irq_handler)(struct dvi_inst *inst) {
 				_dvi_load_dma_op(inst->dma_cfg, &inst->dma_list_error);
 			}
 			if (inst->scanline_callback && inst->timing_state.v_ctr % DVI_VERTICAL_REPEAT == DVI_VERTICAL_REPEAT - 1) {
-				inst->scanline_callback();
+				_dvi_run_scanline_callback(inst);
 			}
 			break;
 		case DVI_STATE_SYNC:
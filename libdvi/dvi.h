@@ -10,8 +10,29 @@
 #include "dvi_timing.h"
 #include "dvi_serialiser.h"
 #include "util_queue_u32_inline.h"
+#include "tmds_encode_pio.h"
 
 typedef void (*dvi_callback_t)(void);
+typedef void (*dvi_deferred_fn_t)(void *arg);
+
+struct dvi_deferred_job {
+	dvi_deferred_fn_t fn;
+	void *arg;
+};
+
+// Counters for scanline_callback and the deferred jobs. Each field is only
+// written from one place, so can be read from either core, but a snapshot is
+// not necessarily consistent between fields.
+struct dvi_callback_stats {
+	// Only updated if DVI_SCANLINE_CALLBACK_WATCHDOG:
+	uint32_t calls;
+	uint32_t overruns;
+	uint32_t max_cycles;
+	uint32_t budget_cycles;
+	// Always updated:
+	uint32_t deferred_run;
+	uint32_t deferred_dropped;
+};
 
 struct dvi_inst {
 	// Config ---
@@ -20,6 +41,7 @@ struct dvi_inst {
 	struct dvi_timing_state timing_state;
 	struct dvi_serialiser_cfg ser_cfg;
 	// Called in the DMA IRQ once per scanline -- careful with the run time!
+	// Anything slow should be pushed to the encode worker with dvi_defer().
 	dvi_callback_t scanline_callback;
 
 	// State ---
@@ -46,6 +68,29 @@ struct dvi_inst {
 	queue_t q_colour_valid;
 	queue_t q_colour_free;
 
+	// Deferred jobs, posted by the IRQ and run by the encode worker. Single
+	// producer, single consumer, so no locking.
+	struct dvi_deferred_job defer_ring[DVI_DEFER_QUEUE_SIZE];
+	volatile uint defer_wptr;
+	volatile uint defer_rptr;
+	struct dvi_callback_stats cb_stats;
+
+	// Palette mode (dvi_*_main_palette) ---
+	// Bits per pixel of the indexed scanline/framebuffer: 2, 4 or 8. Pixels are
+	// packed least-significant first. The TMDS palette must have been built
+	// for 1 << palette_bits entries with tmds_setup_palette(24)_symbols().
+	uint palette_bits;
+	const uint32_t *tmds_palette;
+	// Written by dvi_set_palette(), picked up by the encode worker at the start
+	// of its next frame, then cleared.
+	const uint32_t *volatile tmds_palette_next;
+
+#if DVI_ENCODE_CYCLE_STATS
+	// Cycles taken by the encode worker for the last scanline, and the worst
+	// case since the last dvi_encode_stats_reset().
+	volatile uint32_t encode_cycles_last;
+	volatile uint32_t encode_cycles_max;
+#endif
 };
 
 // Set up data structures and hardware for DVI.
@@ -69,4 +114,53 @@ void dvi_scanbuf_main_16bpp(struct dvi_inst *inst);
 void dvi_framebuf_main_8bpp(struct dvi_inst *inst);
 void dvi_framebuf_main_16bpp(struct dvi_inst *inst);
 
+// Full-resolution indexed colour, using the palette TMDS encode. Scanline and
+// framebuffer pixels are inst->palette_bits wide (2, 4 or 8 bpp). A 640x480
+// framebuffer at 4bpp is 150 kB. For the framebuffer version, the current
+// framebuffer is retired to q_colour_free at the end of a frame only if
+// another one is waiting behind it on q_colour_valid, so a single framebuffer
+// can be posted once and left there.
+void dvi_scanbuf_main_palette(struct dvi_inst *inst);
+void dvi_framebuf_main_palette(struct dvi_inst *inst);
+
+// Monochrome 1bpp scanbufs (full resolution), encoded by a PIO state machine
+// set up with tmds_encode_1bpp_pio_init(). The worker core only sets up the
+// DMA and then waits for it. Requires DVI_MONOCHROME_TMDS. If the core has
+// better things to do, call tmds_encode_pio_start()/wait() from your own loop
+// instead.
+void dvi_scanbuf_main_1bpp_pio(struct dvi_inst *inst, struct tmds_pio_encoder *enc);
+
+// Encode one half-resolution scanbuf into a buffer from q_tmds_free, and pass
+// it to q_tmds_valid. For encode loops other than the ones above, e.g. the
+// one in dvi_pipeline.c.
+void dvi_encode_scanline_8bpp(struct dvi_inst *inst, uint32_t *scanbuf);
+void dvi_encode_scanline_16bpp(struct dvi_inst *inst, uint32_t *scanbuf);
+
+// Post a job from scanline_callback (or anywhere else on the IRQ core) to run
+// on the encode worker, after the current scanline is handed over. Returns
+// false, and counts a dropped job, if the ring is full.
+bool dvi_defer(struct dvi_inst *inst, dvi_deferred_fn_t fn, void *arg);
+
+// Run any pending deferred jobs. The dvi_*_main workers call this once per
+// scanline; call it yourself if you have your own encode loop.
+void dvi_run_deferred(struct dvi_inst *inst);
+
+// Copy out the callback counters, e.g. for telemetry on core 0
+void dvi_get_callback_stats(const struct dvi_inst *inst, struct dvi_callback_stats *stats);
+
+// Swap in a new TMDS palette at the start of the next frame the encoder
+// produces, so no frame is drawn with a mix of two palettes. The old palette
+// must stay valid until dvi_palette_pending() returns false.
+void dvi_set_palette(struct dvi_inst *inst, const uint32_t *tmds_palette);
+
+static inline bool dvi_palette_pending(const struct dvi_inst *inst) {
+	return inst->tmds_palette_next != NULL;
+}
+
+#if DVI_ENCODE_CYCLE_STATS
+static inline void dvi_encode_stats_reset(struct dvi_inst *inst) {
+	inst->encode_cycles_max = 0;
+}
+#endif
+
 #endif
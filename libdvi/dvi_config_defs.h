@@ -55,6 +55,65 @@
 #error "Unsupported value for DVI_SYMBOLS_PER_WORD"
 #endif
 
+// If 1, the encode workers time each scanline with SysTick and record the
+// last and worst-case cycle counts in the dvi_inst. Costs a few cycles per
+// scanline, and takes over SysTick on the encoding core.
+#ifndef DVI_ENCODE_CYCLE_STATS
+#define DVI_ENCODE_CYCLE_STATS 0
+#endif
+
+// Number of slots in the deferred job ring, which scanline_callback can post
+// to with dvi_defer() so that work is moved out of the DMA IRQ and onto the
+// encode worker, between scanlines. Must be a power of 2.
+#ifndef DVI_DEFER_QUEUE_SIZE
+#define DVI_DEFER_QUEUE_SIZE 8
+#endif
+
+#if DVI_DEFER_QUEUE_SIZE & (DVI_DEFER_QUEUE_SIZE - 1)
+#error "DVI_DEFER_QUEUE_SIZE must be a power of 2"
+#endif
+
+// If 1, time each scanline_callback with SysTick on the IRQ core, and count
+// calls which take longer than DVI_SCANLINE_CALLBACK_BUDGET_PCT percent of a
+// scanline (in clk_sys cycles, assuming clk_sys is running at the bit clock).
+// The DMA has to be reloaded for the next line before the current one
+// finishes, so a callback which regularly goes over budget will show up as
+// red (late) scanlines.
+#ifndef DVI_SCANLINE_CALLBACK_WATCHDOG
+#define DVI_SCANLINE_CALLBACK_WATCHDOG 0
+#endif
+
+#ifndef DVI_SCANLINE_CALLBACK_BUDGET_PCT
+#define DVI_SCANLINE_CALLBACK_BUDGET_PCT 5
+#endif
+
+// Maximum number of stages in a dvi_pipeline (see dvi_pipeline.h)
+#ifndef DVI_PIPELINE_MAX_STAGES
+#define DVI_PIPELINE_MAX_STAGES 8
+#endif
+
+#if DVI_PIPELINE_MAX_STAGES > 255
+#error "DVI_PIPELINE_MAX_STAGES must fit in a byte"
+#endif
+
+// Number of colour scanline buffers the pipeline allocates. With 2, the
+// render core draws line y + 1 while the encode core works on line y. More
+// buffers absorb lines that are unevenly expensive, at the cost of SRAM. The
+// colour queues hold 8 entries, so this can't go higher.
+#ifndef DVI_PIPELINE_N_SCANBUFS
+#define DVI_PIPELINE_N_SCANBUFS 2
+#endif
+
+#if DVI_PIPELINE_N_SCANBUFS < 2 || DVI_PIPELINE_N_SCANBUFS > 8
+#error "DVI_PIPELINE_N_SCANBUFS must be between 2 and 8"
+#endif
+
+// If 1, time every pipeline stage (and the pipeline's TMDS encode) on every
+// scanline. Uses SysTick on both cores, like DVI_ENCODE_CYCLE_STATS.
+#ifndef DVI_PIPELINE_STAGE_STATS
+#define DVI_PIPELINE_STAGE_STATS 0
+#endif
+
 // ----------------------------------------------------------------------------
 // Pixel component layout
 
@@ -140,6 +199,15 @@
 #define TMDS_FULLRES_NO_INTERP_SAVE 0
 #endif
 
+// If 1, the TMDS encoders claim the interpolators through interp_owner.h
+// rather than saving and restoring them on every call, and skip setup if
+// they are still configured from the last call on this core. Other code using
+// the interpolators on the encoding core must then also claim them (the tile
+// and affine sprite code in libsprite do). Implies TMDS_FULLRES_NO_INTERP_SAVE.
+#ifndef TMDS_INTERP_OWNERSHIP
+#define TMDS_INTERP_OWNERSHIP 0
+#endif
+
 // If 1, don't DC-balance the output of full resolution encode. Hilariously
 // noncompliant, but Dell Ultrasharp -- the honey badger of computer monitors
 // -- does not seem to mind (it helps that we DC-couple). Another speed hack,
@@ -0,0 +1,185 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dvi_pipeline.h"
+
+#include "pico.h" // for __not_in_flash_func
+
+#if !PICO_NO_HARDWARE
+#include "dvi.h"
+#endif
+
+#if DVI_PIPELINE_STAGE_STATS
+#if PICO_NO_HARDWARE
+#include <time.h>
+#else
+#include "util_systick_inline.h"
+#endif
+#endif
+
+// Per-line functions go in RAM, each in its own section for garbage collection
+#define __dvi_func(f) __not_in_flash_func(f)
+
+void dvi_pipeline_init(struct dvi_pipeline *pl, uint bpp, uint width, uint height) {
+	memset(pl, 0, sizeof(*pl));
+	pl->bpp = bpp;
+	pl->width = width;
+	pl->height = height;
+}
+
+int dvi_pipeline_add_stage(struct dvi_pipeline *pl, const char *name, enum dvi_pipeline_core core,
+		dvi_pipeline_stage_fn_t render, dvi_pipeline_frame_fn_t frame_start, void *arg) {
+	if (pl->n_stages == DVI_PIPELINE_MAX_STAGES)
+		return -1;
+	uint i = pl->n_stages;
+	// Keep the running order partitioned by core, so each core walks a
+	// contiguous range. Only order[] moves; the stages stay put.
+	uint pos = i;
+	if (core == DVI_PIPELINE_CORE_RENDER) {
+		pos = pl->n_render_stages++;
+		memmove(&pl->order[pos + 1], &pl->order[pos], (i - pos) * sizeof(pl->order[0]));
+	}
+	pl->order[pos] = i;
+	++pl->n_stages;
+	struct dvi_pipeline_stage *s = &pl->stages[i];
+	memset(s, 0, sizeof(*s));
+	s->name = name;
+	s->render = render;
+	s->frame_start = frame_start;
+	s->arg = arg;
+	s->core = core;
+	return i;
+}
+
+#if DVI_PIPELINE_STAGE_STATS
+
+#if PICO_NO_HARDWARE
+static inline void _pl_timer_init(void) {}
+
+static inline uint32_t _pl_timer_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)ts.tv_sec * 1000000000u + (uint32_t)ts.tv_nsec;
+}
+
+static inline uint32_t _pl_timer_since(uint32_t t0) {
+	return _pl_timer_now() - t0;
+}
+#else
+static inline void _pl_timer_init(void) {
+	systick_cycle_counter_init();
+}
+
+static inline uint32_t _pl_timer_now(void) {
+	return systick_cycle_count_now();
+}
+
+static inline uint32_t _pl_timer_since(uint32_t t0) {
+	return systick_cycles_since(t0);
+}
+#endif
+
+static inline void _pl_stats_add(struct dvi_pipeline_stage_stats *st, uint32_t t, uint raster_y) {
+	if (raster_y == 0) {
+		st->frame = st->frame_acc;
+		st->frame_acc = 0;
+	}
+	st->last = t;
+	st->frame_acc += t;
+	if (t > st->max)
+		st->max = t;
+}
+
+void dvi_pipeline_get_stage_stats(const struct dvi_pipeline *pl, uint stage, struct dvi_pipeline_stage_stats *stats) {
+	const volatile struct dvi_pipeline_stage_stats *src = stage < pl->n_stages ?
+		&pl->stages[stage].stats : &pl->encode_stats;
+	stats->last = src->last;
+	stats->max = src->max;
+	stats->frame = src->frame;
+	stats->frame_acc = src->frame_acc;
+}
+
+void dvi_pipeline_stats_reset(struct dvi_pipeline *pl) {
+	for (uint i = 0; i < pl->n_stages; ++i)
+		pl->stages[i].stats.max = 0;
+	pl->encode_stats.max = 0;
+}
+
+#else
+static inline void _pl_timer_init(void) {}
+static inline uint32_t _pl_timer_now(void) {return 0;}
+#endif
+
+void __dvi_func(dvi_pipeline_run_line)(struct dvi_pipeline *pl, enum dvi_pipeline_core core, uint32_t *scanbuf, uint raster_y) {
+	uint first = core == DVI_PIPELINE_CORE_RENDER ? 0 : pl->n_render_stages;
+	uint last = core == DVI_PIPELINE_CORE_RENDER ? pl->n_render_stages : pl->n_stages;
+	if (raster_y == 0) {
+		for (uint i = first; i < last; ++i) {
+			struct dvi_pipeline_stage *s = &pl->stages[pl->order[i]];
+			if (s->frame_start)
+				s->frame_start(s->arg);
+		}
+	}
+	for (uint i = first; i < last; ++i) {
+		struct dvi_pipeline_stage *s = &pl->stages[pl->order[i]];
+#if DVI_PIPELINE_STAGE_STATS
+		uint32_t t0 = _pl_timer_now();
+		s->render(s->arg, scanbuf, raster_y, pl->width);
+		_pl_stats_add(&s->stats, _pl_timer_since(t0), raster_y);
+#else
+		s->render(s->arg, scanbuf, raster_y, pl->width);
+#endif
+	}
+}
+
+#if !PICO_NO_HARDWARE
+
+void dvi_pipeline_bind(struct dvi_pipeline *pl, struct dvi_inst *inst) {
+	pl->inst = inst;
+	for (int i = 0; i < DVI_PIPELINE_N_SCANBUFS; ++i) {
+		uint32_t *scanbuf = malloc(pl->width * pl->bpp / 8);
+		if (!scanbuf)
+			panic("Pipeline scanbuf allocation failed");
+		pl->scanbuf[i] = scanbuf;
+		queue_add_blocking_u32(&inst->q_colour_free, &scanbuf);
+	}
+}
+
+void __dvi_func(dvi_pipeline_render_frame)(struct dvi_pipeline *pl) {
+	struct dvi_inst *inst = pl->inst;
+	_pl_timer_init();
+	for (uint y = 0; y < pl->height; ++y) {
+		uint32_t *scanbuf;
+		queue_remove_blocking_u32(&inst->q_colour_free, &scanbuf);
+		dvi_pipeline_run_line(pl, DVI_PIPELINE_CORE_RENDER, scanbuf, y);
+		queue_add_blocking_u32(&inst->q_colour_valid, &scanbuf);
+	}
+}
+
+void __dvi_func(dvi_pipeline_encode_main)(struct dvi_pipeline *pl) {
+	struct dvi_inst *inst = pl->inst;
+	uint y = 0;
+	_pl_timer_init();
+	while (1) {
+		uint32_t *scanbuf;
+		queue_remove_blocking_u32(&inst->q_colour_valid, &scanbuf);
+		dvi_pipeline_run_line(pl, DVI_PIPELINE_CORE_ENCODE, scanbuf, y);
+		uint32_t t0 = _pl_timer_now();
+		if (pl->bpp == 16)
+			dvi_encode_scanline_16bpp(inst, scanbuf);
+		else
+			dvi_encode_scanline_8bpp(inst, scanbuf);
+#if DVI_PIPELINE_STAGE_STATS
+		_pl_stats_add(&pl->encode_stats, _pl_timer_since(t0), y);
+#else
+		(void)t0;
+#endif
+		dvi_run_deferred(inst);
+		queue_add_blocking_u32(&inst->q_colour_free, &scanbuf);
+		if (++y == pl->height)
+			y = 0;
+	}
+	__builtin_unreachable();
+}
+
+#endif
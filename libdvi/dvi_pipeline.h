@@ -0,0 +1,134 @@
+#ifndef _DVI_PIPELINE_H
+#define _DVI_PIPELINE_H
+
+// Scanline render pipeline. Rather than each app writing its own render and
+// encode loops, register a list of stages once -- e.g. background tiles, then
+// sprites, then a text overlay -- and the pipeline runs them in order into
+// each colour scanline buffer, then TMDS encodes the result.
+//
+// Each stage is pinned to one of two cores:
+//
+// - DVI_PIPELINE_CORE_RENDER stages run in dvi_pipeline_render_frame(), on
+//   whichever core calls it, which works one line ahead of the encoder (more
+//   if DVI_PIPELINE_N_SCANBUFS > 2).
+//
+// - DVI_PIPELINE_CORE_ENCODE stages run on the encode worker,
+//   dvi_pipeline_encode_main(), immediately before each line is encoded. This
+//   is for cheap stages that want to use the encode core's spare time.
+//
+// Stages on each core run in the order they were added, and all render-core
+// stages run before any encode-core stages on a given line. So adding a layer
+// is one dvi_pipeline_add_stage() call.
+//
+// The stage list and dvi_pipeline_run_line() don't touch any hardware besides
+// SysTick, and build with PICO_NO_HARDWARE, so a set of stages can be run and
+// timed on the host without the DVI side.
+
+#include "pico/types.h"
+#include "dvi_config_defs.h"
+
+struct dvi_inst;
+
+enum dvi_pipeline_core {
+	DVI_PIPELINE_CORE_RENDER = 0,
+	DVI_PIPELINE_CORE_ENCODE = 1
+};
+
+// Draw line raster_y into scanbuf, which is raster_w pixels of the pipeline's
+// bpp. Stages draw over whatever the previous stages left, so the first stage
+// must write every pixel.
+typedef void (*dvi_pipeline_stage_fn_t)(void *arg, uint32_t *scanbuf, uint raster_y, uint raster_w);
+
+// Called on the stage's core before it draws line 0 of each frame, e.g. to
+// pick up a newly committed buffer or call sprite_atlas_frame().
+typedef void (*dvi_pipeline_frame_fn_t)(void *arg);
+
+// Clock cycles on the device (SysTick), nanoseconds on the host. Each stage's
+// stats are only written by that stage's core.
+struct dvi_pipeline_stage_stats {
+	uint32_t last;
+	uint32_t max;
+	// Total over the last complete frame, and the running total for this one
+	uint32_t frame;
+	uint32_t frame_acc;
+};
+
+struct dvi_pipeline_stage {
+	const char *name;
+	dvi_pipeline_stage_fn_t render;
+	dvi_pipeline_frame_fn_t frame_start; // may be NULL
+	void *arg;
+	uint core;
+#if DVI_PIPELINE_STAGE_STATS
+	struct dvi_pipeline_stage_stats stats;
+#endif
+};
+
+struct dvi_pipeline {
+	uint bpp;
+	uint width;
+	uint height;
+	// Stages in the order they were added, so a stage's index never changes
+	uint n_stages;
+	uint n_render_stages;
+	struct dvi_pipeline_stage stages[DVI_PIPELINE_MAX_STAGES];
+	// Indices into stages[] in running order: render-core stages are
+	// order[0, n_render_stages), encode-core stages follow
+	uint8_t order[DVI_PIPELINE_MAX_STAGES];
+
+	// Set by dvi_pipeline_bind()
+	struct dvi_inst *inst;
+	uint32_t *scanbuf[DVI_PIPELINE_N_SCANBUFS];
+#if DVI_PIPELINE_STAGE_STATS
+	struct dvi_pipeline_stage_stats encode_stats;
+#endif
+};
+
+// bpp is 8 or 16. For DVI output, width and height are normally
+// h_active_pixels / 2 and v_active_lines / DVI_VERTICAL_REPEAT.
+void dvi_pipeline_init(struct dvi_pipeline *pl, uint bpp, uint width, uint height);
+
+// Append a stage to those already on its core. Returns the stage index (for
+// dvi_pipeline_get_stage_stats()), or -1 if the pipeline is full. Indices
+// count up from 0 in the order stages are added, whichever core they're on,
+// and stay valid. Don't add stages once the pipeline is running.
+int dvi_pipeline_add_stage(struct dvi_pipeline *pl, const char *name, enum dvi_pipeline_core core,
+	dvi_pipeline_stage_fn_t render, dvi_pipeline_frame_fn_t frame_start, void *arg);
+
+// Run one core's stages for one line, calling their frame_start hooks first
+// if raster_y is 0. This is what the loops below call for each line. Also
+// usable directly, e.g. to drive the stages on the host.
+void dvi_pipeline_run_line(struct dvi_pipeline *pl, enum dvi_pipeline_core core, uint32_t *scanbuf, uint raster_y);
+
+#if DVI_PIPELINE_STAGE_STATS
+// Copy out a stage's timings. Stage index n_stages gives the TMDS encode.
+void dvi_pipeline_get_stage_stats(const struct dvi_pipeline *pl, uint stage, struct dvi_pipeline_stage_stats *stats);
+
+void dvi_pipeline_stats_reset(struct dvi_pipeline *pl);
+#endif
+
+#if !PICO_NO_HARDWARE
+// Allocate (malloc()) the colour scanline buffers and put them on the DVI
+// colour free queue. Call after dvi_init() and before starting either loop.
+// The DVI instance must not be given any other colour buffers.
+void dvi_pipeline_bind(struct dvi_pipeline *pl, struct dvi_inst *inst);
+
+// Render one whole frame with the render-core stages, handing each line to
+// the encode worker as it's finished, then return. Blocks whenever the
+// encoder is DVI_PIPELINE_N_SCANBUFS lines behind, so this naturally runs at
+// the display frame rate, and a typical core 0 loop is just:
+//
+//   while (true) {
+//       update_game_state();
+//       dvi_pipeline_render_frame(&pipeline);
+//   }
+void dvi_pipeline_render_frame(struct dvi_pipeline *pl);
+
+// Encode worker, replacing dvi_scanbuf_main_8bpp/16bpp: core enters and
+// doesn't leave, but still responds to IRQs. For each line, runs the
+// encode-core stages, TMDS encodes, runs any deferred jobs, and returns the
+// buffer to the render core.
+void dvi_pipeline_encode_main(struct dvi_pipeline *pl);
+#endif
+
+#endif
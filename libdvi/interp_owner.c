@@ -0,0 +1,3 @@
+#include "interp_owner.h"
+
+uint32_t interp_owner_tag[NUM_CORES][2];
@@ -0,0 +1,51 @@
+#ifndef _INTERP_OWNER_H
+#define _INTERP_OWNER_H
+
+// Per-core record of which code last configured each interpolator. Code which
+// sets up an interpolator claims it with a tag describing the configuration
+// it wants (subsystem in the top byte, plus whatever parameters the
+// configuration depends on). If the tag matches the last claim on this core,
+// the interpolator is still configured that way and setup can be skipped.
+//
+// With TMDS_INTERP_OWNERSHIP=1, the TMDS encoders claim the interpolators
+// instead of saving and restoring them around every call, so scanline
+// rendering (tiles, affine sprites) and encode can share a core: each side
+// only reprograms the control registers when the other side has been there
+// in between. The accumulators and bases which vary from call to call are
+// always written, and are not covered by the tag.
+//
+// Any code which writes interpolator control registers without going
+// through this must call interp_owner_invalidate() afterward. Without
+// TMDS_INTERP_OWNERSHIP, every claim succeeds, so callers always set up the
+// interpolators as before.
+
+#include "pico.h"
+#include "hardware/interp.h"
+#include "hardware/sync.h"
+#include "dvi_config_defs.h"
+
+#define INTERP_OWNER_NONE   0u
+#define INTERP_OWNER_TMDS   (1u << 24)
+#define INTERP_OWNER_TILE   (2u << 24)
+#define INTERP_OWNER_SPRITE (3u << 24)
+
+extern uint32_t interp_owner_tag[NUM_CORES][2];
+
+// Returns true if the caller must (re)configure the interpolator.
+static inline bool interp_claim(uint interp_num, uint32_t tag) {
+#if TMDS_INTERP_OWNERSHIP
+	uint32_t *owner = &interp_owner_tag[get_core_num()][interp_num];
+	if (*owner == tag)
+		return false;
+	*owner = tag;
+#endif
+	return true;
+}
+
+static inline void interp_owner_invalidate(void) {
+	uint core = get_core_num();
+	interp_owner_tag[core][0] = INTERP_OWNER_NONE;
+	interp_owner_tag[core][1] = INTERP_OWNER_NONE;
+}
+
+#endif
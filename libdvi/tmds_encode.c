@@ -2,6 +2,7 @@
 #include "tmds_encode.h"
 #include "hardware/gpio.h"
 #include "hardware/sync.h"
+#include "interp_owner.h"
 
 static const uint32_t __scratch_x("tmds_table") tmds_table[] = {
 #include "tmds_table.h"
@@ -60,38 +61,74 @@ static int __not_in_flash_func(configure_interp_for_addrgen)(interp_hw_t *interp
 	return oops;
 }
 
+#if TMDS_INTERP_OWNERSHIP
+// Left shift that configure_interp_for_addrgen() would return, for when the
+// interpolator is already configured and we skip the call.
+static inline int addrgen_lshift(uint channel_msb, uint pixel_lsb, uint lut_index_width) {
+	int shift_channel_to_index = pixel_lsb + channel_msb - (lut_index_width - 1) - 2;
+	return shift_channel_to_index < 0 ? -shift_channel_to_index : 0;
+}
+
+// Ownership tags: encoder kind in [23:16], then the channel bit positions
+#define TMDS_OWNER_16BPP   (INTERP_OWNER_TMDS | (1u << 16))
+#define TMDS_OWNER_8BPP    (INTERP_OWNER_TMDS | (2u << 16))
+#define TMDS_OWNER_FULLRES (INTERP_OWNER_TMDS | (3u << 16))
+#define TMDS_OWNER_PALETTE (INTERP_OWNER_TMDS | (4u << 16))
+#define tmds_owner_tag(kind, msb, lsb) ((kind) | ((msb) << 8) | (lsb))
+#endif
+
 // Extract up to 6 bits from a buffer of 16 bit pixels, and produce a buffer
 // of TMDS symbols from this colour channel. Number of pixels must be even,
 // pixel buffer must be word-aligned.
 
 void __not_in_flash_func(tmds_encode_data_channel_16bpp)(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix, uint channel_msb, uint channel_lsb) {
+#if TMDS_INTERP_OWNERSHIP
+	int require_lshift = addrgen_lshift(channel_msb, 0, 6);
+	if (interp_claim(0, tmds_owner_tag(TMDS_OWNER_16BPP, channel_msb, channel_lsb)))
+		configure_interp_for_addrgen(interp0_hw, channel_msb, channel_lsb, 0, 16, 6, tmds_table);
+#else
 	interp_hw_save_t interp0_save;
 	interp_save(interp0_hw, &interp0_save);
 	int require_lshift = configure_interp_for_addrgen(interp0_hw, channel_msb, channel_lsb, 0, 16, 6, tmds_table);
+#endif
 	if (require_lshift)
 		tmds_encode_loop_16bpp_leftshift(pixbuf, symbuf, n_pix, require_lshift);
 	else
 		tmds_encode_loop_16bpp(pixbuf, symbuf, n_pix);
+#if !TMDS_INTERP_OWNERSHIP
 	interp_restore(interp0_hw, &interp0_save);
+#endif
 }
 
 // As above, but 8 bits per pixel, multiple of 4 pixels, and still word-aligned.
 void __not_in_flash_func(tmds_encode_data_channel_8bpp)(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix, uint channel_msb, uint channel_lsb) {
-	interp_hw_save_t interp0_save, interp1_save;
-	interp_save(interp0_hw, &interp0_save);
-	interp_save(interp1_hw, &interp1_save);
 	// Note that for 8bpp, some left shift is always required for pixel 0 (any
 	// channel), which destroys some MSBs of pixel 3. To get around this, pixel
 	// data sent to interp1 is *not left-shifted*
+#if TMDS_INTERP_OWNERSHIP
+	uint32_t tag = tmds_owner_tag(TMDS_OWNER_8BPP, channel_msb, channel_lsb);
+	int require_lshift = addrgen_lshift(channel_msb, 0, 6);
+	if (interp_claim(0, tag))
+		configure_interp_for_addrgen(interp0_hw, channel_msb, channel_lsb, 0, 8, 6, tmds_table);
+	if (interp_claim(1, tag))
+		configure_interp_for_addrgen(interp1_hw, channel_msb, channel_lsb, 16, 8, 6, tmds_table);
+	assert(!addrgen_lshift(channel_msb, 16, 6));
+#else
+	interp_hw_save_t interp0_save, interp1_save;
+	interp_save(interp0_hw, &interp0_save);
+	interp_save(interp1_hw, &interp1_save);
 	int require_lshift = configure_interp_for_addrgen(interp0_hw, channel_msb, channel_lsb, 0, 8, 6, tmds_table);
 	int lshift_upper = configure_interp_for_addrgen(interp1_hw, channel_msb, channel_lsb, 16, 8, 6, tmds_table);
 	assert(!lshift_upper); (void)lshift_upper;
+#endif
 	if (require_lshift)	
 		tmds_encode_loop_8bpp_leftshift(pixbuf, symbuf, n_pix, require_lshift);
 	else
 		tmds_encode_loop_8bpp(pixbuf, symbuf, n_pix);
+#if !TMDS_INTERP_OWNERSHIP
 	interp_restore(interp0_hw, &interp0_save);
 	interp_restore(interp1_hw, &interp1_save);
+#endif
 }
 
 // ----------------------------------------------------------------------------
@@ -136,7 +173,7 @@ static int __not_in_flash_func(configure_interp_for_addrgen_fullres)(interp_hw_t
 
 void __not_in_flash_func(tmds_encode_data_channel_fullres_16bpp)(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix, uint channel_msb, uint channel_lsb) {
 	uint core = get_core_num();
-#if !TMDS_FULLRES_NO_INTERP_SAVE
+#if !TMDS_FULLRES_NO_INTERP_SAVE && !TMDS_INTERP_OWNERSHIP
 	interp_hw_save_t interp0_save, interp1_save;
 	interp_save(interp0_hw, &interp0_save);
 	interp_save(interp1_hw, &interp1_save);
@@ -146,9 +183,19 @@ void __not_in_flash_func(tmds_encode_data_channel_fullres_16bpp)(const uint32_t
 	// scratch Y memories. Use X on core 1 and Y on core 0 so the cores don't
 	// tread on each other's toes too much.
 	const uint32_t *lutbase = core ? tmds_table_fullres_x : tmds_table_fullres_y;
+#if TMDS_INTERP_OWNERSHIP
+	// Same shift as the 8bpp/16bpp configuration, with pixel_lsb = 0
+	int lshift_lower = addrgen_lshift(channel_msb, 0, 6);
+	uint32_t tag = tmds_owner_tag(TMDS_OWNER_FULLRES, channel_msb, channel_lsb);
+	if (interp_claim(0, tag))
+		configure_interp_for_addrgen_fullres(interp0_hw, channel_msb, channel_lsb, 6, lutbase);
+	if (interp_claim(1, tag))
+		configure_interp_for_addrgen_fullres(interp1_hw, channel_msb + 16, channel_lsb + 16, 6, lutbase);
+#else
 	int lshift_lower = configure_interp_for_addrgen_fullres(interp0_hw, channel_msb, channel_lsb, 6, lutbase);
 	int lshift_upper = configure_interp_for_addrgen_fullres(interp1_hw, channel_msb + 16, channel_lsb + 16, 6, lutbase);
 	assert(!lshift_upper); (void)lshift_upper;
+#endif
 	if (lshift_lower) {
 		(core ?
 			tmds_fullres_encode_loop_16bpp_leftshift_x :
@@ -161,7 +208,7 @@ void __not_in_flash_func(tmds_encode_data_channel_fullres_16bpp)(const uint32_t
 			tmds_fullres_encode_loop_16bpp_y
 		)(pixbuf, symbuf, n_pix);
 	}
-#if !TMDS_FULLRES_NO_INTERP_SAVE
+#if !TMDS_FULLRES_NO_INTERP_SAVE && !TMDS_INTERP_OWNERSHIP
 	interp_restore(interp0_hw, &interp0_save);
 	interp_restore(interp1_hw, &interp1_save);
 #endif
@@ -243,21 +290,7 @@ void tmds_setup_palette24_symbols(const uint32_t *palette, uint32_t *tmds_palett
 	}
 }
 
-// Encode palette data for all 3 channels.
-// pixbuf is an array of n_pix 8-bit wide pixels containing palette values (32-bit word aligned)
-// tmds_palette is a palette of TMDS symbols produced by tmds_setup_palette_symbols
-// symbuf is 3*n_pix 32-bit words, this function writes the symbol values for each of the channels to it.
-void __not_in_flash_func(tmds_encode_palette_data)(const uint32_t *pixbuf, const uint32_t *tmds_palette, uint32_t *symbuf, size_t n_pix, uint32_t palette_bits) {
-	uint core = get_core_num();
-#if !TMDS_FULLRES_NO_INTERP_SAVE
-	interp_hw_save_t interp0_save, interp1_save;
-	interp_save(interp0_hw, &interp0_save);
-	interp_save(interp1_hw, &interp1_save);
-#endif
-
-	interp0_hw->base[2] = (uint32_t)tmds_palette;
-	interp1_hw->base[2] = (uint32_t)tmds_palette;
-
+static void __not_in_flash_func(configure_interp_for_palette)(uint32_t palette_bits) {
 	// Lane 0 on both interpolators masks the palette bits, starting at bit 2,
 	// The second interpolator also shifts to read the 2nd or 4th byte of the word.
 	interp0_hw->ctrl[0] =
@@ -275,6 +308,34 @@ void __not_in_flash_func(tmds_encode_palette_data)(const uint32_t *pixbuf, const
 		(palette_bits + 2) * ((1 << SIO_INTERP0_CTRL_LANE0_MASK_LSB_LSB) | (1 << SIO_INTERP0_CTRL_LANE0_MASK_MSB_LSB));
 	interp0_hw->ctrl[1] = ctrl_lane_1;
 	interp1_hw->ctrl[1] = ctrl_lane_1;
+}
+
+// Encode palette data for all 3 channels.
+// pixbuf is an array of n_pix 8-bit wide pixels containing palette values (32-bit word aligned)
+// tmds_palette is a palette of TMDS symbols produced by tmds_setup_palette_symbols
+// symbuf is 3*n_pix 32-bit words, this function writes the symbol values for each of the channels to it.
+void __not_in_flash_func(tmds_encode_palette_data)(const uint32_t *pixbuf, const uint32_t *tmds_palette, uint32_t *symbuf, size_t n_pix, uint32_t palette_bits) {
+	uint core = get_core_num();
+#if !TMDS_FULLRES_NO_INTERP_SAVE && !TMDS_INTERP_OWNERSHIP
+	interp_hw_save_t interp0_save, interp1_save;
+	interp_save(interp0_hw, &interp0_save);
+	interp_save(interp1_hw, &interp1_save);
+#endif
+
+	interp0_hw->base[2] = (uint32_t)tmds_palette;
+	interp1_hw->base[2] = (uint32_t)tmds_palette;
+
+#if TMDS_INTERP_OWNERSHIP
+	// Control registers depend only on palette_bits (bases are rewritten below
+	// for each channel regardless)
+	uint32_t tag = tmds_owner_tag(TMDS_OWNER_PALETTE, 0, palette_bits);
+	bool reconfigure = interp_claim(0, tag);
+	reconfigure = interp_claim(1, tag) || reconfigure;
+	if (reconfigure)
+		configure_interp_for_palette(palette_bits);
+#else
+	configure_interp_for_palette(palette_bits);
+#endif
 
 	if (core) {
 		tmds_palette_encode_loop_x(pixbuf, symbuf, n_pix);
@@ -298,8 +359,37 @@ void __not_in_flash_func(tmds_encode_palette_data)(const uint32_t *pixbuf, const
 		tmds_palette_encode_loop_y(pixbuf, symbuf + n_pix, n_pix);
 	}
 
-#if !TMDS_FULLRES_NO_INTERP_SAVE
+#if !TMDS_FULLRES_NO_INTERP_SAVE && !TMDS_INTERP_OWNERSHIP
 	interp_restore(interp0_hw, &interp0_save);
 	interp_restore(interp1_hw, &interp1_save);
 #endif
 }
+
+// The palette encode loop wants one byte per pixel, so 2bpp and 4bpp pixels
+// must be spread out into a buffer of n_pix bytes first. Pixels are
+// least-significant first in each word. This is a handful of ALU ops per 4
+// pixels, small next to the encode itself.
+void __not_in_flash_func(tmds_unpack_palette_pixels)(const uint32_t *src, uint32_t *dst, uint n_pix, uint bits) {
+	if (bits == 4) {
+		for (uint i = 0; i < n_pix / 8; ++i) {
+			uint32_t w = src[i];
+			uint32_t lo = w & 0xffffu;
+			uint32_t hi = w >> 16;
+			lo = (lo | lo << 8) & 0x00ff00ffu;
+			hi = (hi | hi << 8) & 0x00ff00ffu;
+			*dst++ = (lo | lo << 4) & 0x0f0f0f0fu;
+			*dst++ = (hi | hi << 4) & 0x0f0f0f0fu;
+		}
+	}
+	else {
+		for (uint i = 0; i < n_pix / 16; ++i) {
+			uint32_t w = src[i];
+			for (int j = 0; j < 4; ++j) {
+				uint32_t b = w & 0xffu;
+				w >>= 8;
+				b = (b | b << 12) & 0x000f000fu;
+				*dst++ = (b | b << 6) & 0x03030303u;
+			}
+		}
+	}
+}
@@ -11,6 +11,7 @@ void tmds_encode_data_channel_fullres_16bpp(const uint32_t *pixbuf, uint32_t *sy
 void tmds_setup_palette_symbols(const uint16_t *palette, uint32_t *symbuf, size_t n_palette);
 void tmds_setup_palette24_symbols(const uint32_t *palette, uint32_t *symbuf, size_t n_palette);
 void tmds_encode_palette_data(const uint32_t *pixbuf, const uint32_t *tmds_palette, uint32_t *symbuf, size_t n_pix, uint32_t palette_bits);
+void tmds_unpack_palette_pixels(const uint32_t *src, uint32_t *dst, uint n_pix, uint bits);
 
 // Functions from tmds_encode.S
 
@@ -0,0 +1,61 @@
+#include "hardware/dma.h"
+
+#include "tmds_encode_pio.h"
+#include "tmds_encode_1bpp.pio.h"
+#include "tmds_encode_2bpp.pio.h"
+
+static void tmds_encode_pio_dma_init(struct tmds_pio_encoder *enc) {
+	enc->dma_chan_tx = dma_claim_unused_channel(true);
+	enc->dma_chan_rx = dma_claim_unused_channel(true);
+
+	dma_channel_config c = dma_channel_get_default_config(enc->dma_chan_tx);
+	channel_config_set_dreq(&c, pio_get_dreq(enc->pio, enc->sm, true));
+	dma_channel_configure(enc->dma_chan_tx, &c, &enc->pio->txf[enc->sm], NULL, 0, false);
+
+	c = dma_channel_get_default_config(enc->dma_chan_rx);
+	channel_config_set_read_increment(&c, false);
+	channel_config_set_write_increment(&c, true);
+	channel_config_set_dreq(&c, pio_get_dreq(enc->pio, enc->sm, false));
+	dma_channel_configure(enc->dma_chan_rx, &c, NULL, &enc->pio->rxf[enc->sm], 0, false);
+}
+
+void tmds_encode_1bpp_pio_init(struct tmds_pio_encoder *enc, PIO pio) {
+#if DVI_1BPP_BIT_REVERSE
+	panic("PIO 1bpp encode does not support DVI_1BPP_BIT_REVERSE");
+#endif
+	enc->pio = pio;
+	enc->sm = pio_claim_unused_sm(pio, true);
+	enc->pix_per_word = 32;
+	// The SM stalls on an empty OSR at the start of an even pixel, so it stays
+	// aligned to pixel pairs across calls as long as n_pix is a multiple of 32.
+	enc->prog_offs = tmds_encode_1bpp_init(pio, enc->sm);
+	tmds_encode_pio_dma_init(enc);
+}
+
+void tmds_encode_2bpp_pio_init(struct tmds_pio_encoder *enc, uint n_enc, PIO pio) {
+	uint offset = pio_add_program(pio, &tmds_encode_2bpp_program);
+	for (uint i = 0; i < n_enc; ++i) {
+		enc[i].pio = pio;
+		enc[i].sm = pio_claim_unused_sm(pio, true);
+		enc[i].prog_offs = offset;
+		enc[i].pix_per_word = 16;
+		tmds_encode_2bpp_program_init(pio, enc[i].sm, offset);
+		tmds_encode_pio_dma_init(&enc[i]);
+	}
+}
+
+void __not_in_flash_func(tmds_encode_pio_start)(struct tmds_pio_encoder *enc, const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) {
+	// Arm the output side first so the RX FIFO never backs up into the SM
+	dma_channel_set_write_addr(enc->dma_chan_rx, symbuf, false);
+	dma_channel_set_trans_count(enc->dma_chan_rx, n_pix / 2, true);
+	dma_channel_set_read_addr(enc->dma_chan_tx, pixbuf, false);
+	dma_channel_set_trans_count(enc->dma_chan_tx, n_pix / enc->pix_per_word, true);
+}
+
+bool __not_in_flash_func(tmds_encode_pio_busy)(const struct tmds_pio_encoder *enc) {
+	return dma_channel_is_busy(enc->dma_chan_rx);
+}
+
+void __not_in_flash_func(tmds_encode_pio_wait)(const struct tmds_pio_encoder *enc) {
+	dma_channel_wait_for_finish_blocking(enc->dma_chan_rx);
+}
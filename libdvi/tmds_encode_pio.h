@@ -0,0 +1,46 @@
+#ifndef _TMDS_ENCODE_PIO_H_
+#define _TMDS_ENCODE_PIO_H_
+
+#include "hardware/pio.h"
+#include "dvi_config_defs.h"
+
+// TMDS encode offloaded to a spare PIO state machine. One DMA channel feeds
+// pixels into the TX FIFO, another drains symbols from the RX FIFO straight
+// into the TMDS buffer, so the CPU only pays for the setup. Output is in the
+// same format as the CPU encoders: two symbols per word, least-significant
+// first, n_pix / 2 words in total.
+
+struct tmds_pio_encoder {
+	PIO pio;
+	uint sm;
+	uint prog_offs;
+	uint dma_chan_tx;
+	uint dma_chan_rx;
+	// Pixels in each 32-bit input word, i.e. 32 / bpp
+	uint pix_per_word;
+};
+
+// Claim a state machine on pio and two DMA channels, and load the 1bpp
+// program (11 instructions). Pixels are bitwise little-endian, so this is only
+// valid with DVI_1BPP_BIT_REVERSE == 0. The program takes 10 cycles per pair
+// of pixels at clk_sys, 3200 cycles for a 640 pixel line.
+void tmds_encode_1bpp_pio_init(struct tmds_pio_encoder *enc, PIO pio);
+
+// Set up n_enc encoders on pio, sharing one copy of the 2bpp program (25
+// instructions). Pixels are 2bpp levels, least-significant first, and are
+// encoded with the same symbols as tmds_encode_2bpp(). The program takes ~9.5
+// cycles per pixel at clk_sys, so one encoder per colour plane is needed for
+// 640 pixel RGB222 (each plane needs ~6100 of the 8000 cycles in a line).
+void tmds_encode_2bpp_pio_init(struct tmds_pio_encoder *enc, uint n_enc, PIO pio);
+
+// Start encoding n_pix pixels from pixbuf into symbuf, and return
+// immediately. n_pix must be a multiple of pix_per_word. The previous encode
+// on this encoder must have finished.
+void tmds_encode_pio_start(struct tmds_pio_encoder *enc, const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix);
+
+// True whilst symbols are still being written to symbuf
+bool tmds_encode_pio_busy(const struct tmds_pio_encoder *enc);
+
+void tmds_encode_pio_wait(const struct tmds_pio_encoder *enc);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef _UTIL_SYSTICK_INLINE_H
+#define _UTIL_SYSTICK_INLINE_H
+
+// Cheap cycle counting using the SysTick of whichever core calls these. SysTick
+// is a 24-bit down-counter, so intervals must be shorter than 2^24 cycles
+// (~130 ms at 125 MHz), which is plenty for timing a scanline.
+
+#include "hardware/structs/systick.h"
+
+// Free-running from clk_sys, full reload range. Call once on each core that
+// wants to count cycles (SysTick is per-core).
+static inline void systick_cycle_counter_init(void) {
+	systick_hw->csr = 0;
+	systick_hw->rvr = M0PLUS_SYST_RVR_BITS;
+	systick_hw->cvr = 0;
+	systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+}
+
+static inline uint32_t systick_cycle_count_now(void) {
+	return systick_hw->cvr;
+}
+
+// Cycles elapsed since a value returned by systick_cycle_count_now()
+static inline uint32_t systick_cycles_since(uint32_t start) {
+	return (start - systick_hw->cvr) & M0PLUS_SYST_RVR_BITS;
+}
+
+#endif
@@ -15,6 +15,34 @@ typedef struct sprite {
 	bool vflip;
 } sprite_t;
 
+// Per-frame setup for an affine-transformed sprite, from
+// sprite_affine_prepare8/16(). Everything which depends only on the sprite
+// and the transform is done once, so per-scanline setup is a few 32-bit
+// multiply-adds. Transforms with no rotation or shear (i.e. scale, flip,
+// translate) are drawn without the interpolator, and the range of screen
+// columns which land inside the texture is found in advance. Must be
+// re-prepared if the sprite's size, image or transform change (x and y can
+// change freely).
+typedef struct sprite_affine {
+	const sprite_t *sp;
+	affine_transform_t atrans;
+	uint32_t interp_ctrl[2];
+	bool scale_only;
+	// Sprite-relative columns [tex_x0, tex_x1) which sample inside the texture
+	// (only if scale_only)
+	int16_t tex_x0;
+	int16_t tex_x1;
+} sprite_affine_t;
+
+// Opacity metadata (one word per row after the pixel data) is
+// {solid, start[14:0], end[15:0]}, for the row's opaque span [start, end) in
+// texture space. Mirror it for a horizontally flipped sprite.
+static inline uint32_t sprite_mirror_metadata(uint32_t meta, uint size) {
+	uint start = (meta >> 16) & 0x7fff;
+	uint end = meta & 0xffff;
+	return (meta & (1u << 31)) | (size - end) << 16 | (size - start);
+}
+
 // ----------------------------------------------------------------------------
 // Functions from sprite.S
 
@@ -28,12 +56,51 @@ void sprite_blit8_alpha(uint8_t *dst, const uint8_t *src, uint len);
 void sprite_blit16(uint16_t *dst, const uint16_t *src, uint len);
 void sprite_blit16_alpha(uint16_t *dst, const uint16_t *src, uint len);
 
+// Same result as the _alpha blits above, but mostly a word at a time. Faster
+// on long spans, slower on short ones; see sprite_blit8/16_alpha_auto().
+void sprite_blit8_alpha_swar(uint8_t *dst, const uint8_t *src, uint len);
+void sprite_blit16_alpha_swar(uint16_t *dst, const uint16_t *src, uint len);
+
+// As above, but horizontally mirrored: dst[i] = src[len - 1 - i]
+void sprite_blit8_hflip(uint8_t *dst, const uint8_t *src, uint len);
+void sprite_blit8_alpha_hflip(uint8_t *dst, const uint8_t *src, uint len);
+void sprite_blit16_hflip(uint16_t *dst, const uint16_t *src, uint len);
+void sprite_blit16_alpha_hflip(uint16_t *dst, const uint16_t *src, uint len);
+
 // These are just inner loops, and require INTERP0 to be configured before calling:
 void sprite_ablit8_loop(uint8_t *dst, uint len);
 void sprite_ablit8_alpha_loop(uint8_t *dst, uint len);
 void sprite_ablit16_loop(uint16_t *dst, uint len);
 void sprite_ablit16_alpha_loop(uint16_t *dst, uint len);
 
+// Spans at least this long go to the word-at-a-time alpha blits. Below this,
+// their setup costs more than the per-pixel loop. At 16bpp they only win if
+// src and dst are equally word-aligned (else every source word is shifted
+// together from two loads), so misaligned spans always go per-pixel.
+// test/test_sprite_swar.py measures both, and the crossovers these are based
+// on, for sprite-like transparency (opaque and clear in runs).
+#ifndef SPRITE_BLIT8_SWAR_MIN_LEN
+#define SPRITE_BLIT8_SWAR_MIN_LEN 32
+#endif
+
+#ifndef SPRITE_BLIT16_SWAR_MIN_LEN
+#define SPRITE_BLIT16_SWAR_MIN_LEN 64
+#endif
+
+static inline void sprite_blit8_alpha_auto(uint8_t *dst, const uint8_t *src, uint len) {
+	if (len >= SPRITE_BLIT8_SWAR_MIN_LEN)
+		sprite_blit8_alpha_swar(dst, src, len);
+	else
+		sprite_blit8_alpha(dst, src, len);
+}
+
+static inline void sprite_blit16_alpha_auto(uint16_t *dst, const uint16_t *src, uint len) {
+	if (len >= SPRITE_BLIT16_SWAR_MIN_LEN && !(((uintptr_t)dst ^ (uintptr_t)src) & 2))
+		sprite_blit16_alpha_swar(dst, src, len);
+	else
+		sprite_blit16_alpha(dst, src, len);
+}
+
 // ----------------------------------------------------------------------------
 // Functions from sprite.c
 
@@ -45,4 +112,12 @@ void sprite_sprite16(uint16_t *scanbuf, const sprite_t *sp, uint raster_y, uint
 void sprite_asprite8(uint8_t *scanbuf, const sprite_t *sp, const affine_transform_t atrans, uint raster_y, uint raster_w);
 void sprite_asprite16(uint16_t *scanbuf, const sprite_t *sp, const affine_transform_t atrans, uint raster_y, uint raster_w);
 
+// As above, with the per-frame work done up front. Same output as
+// sprite_asprite8/16: pixels which sample outside the texture are left
+// alone by both (the interpolator loops skip them on OVERF), not wrapped.
+void sprite_affine_prepare8(sprite_affine_t *aff, const sprite_t *sp, const affine_transform_t atrans);
+void sprite_affine_prepare16(sprite_affine_t *aff, const sprite_t *sp, const affine_transform_t atrans);
+void sprite_asprite8_prepared(uint8_t *scanbuf, const sprite_affine_t *aff, uint raster_y, uint raster_w);
+void sprite_asprite16_prepared(uint16_t *scanbuf, const sprite_affine_t *aff, uint raster_y, uint raster_w);
+
 #endif
@@ -0,0 +1,168 @@
+#include <string.h>
+
+#include "sprite_atlas.h"
+
+#include "pico.h" // for __not_in_flash
+
+#define __ram_func(foo) __not_in_flash(#foo) foo
+
+static inline uint _sprite_atlas_pixel_bytes(const sprite_atlas_t *atlas) {
+	return atlas->flags & SPRITE_ATLAS_16BPP ? 2 : 1;
+}
+
+static uint32_t _sprite_atlas_image_bytes(const sprite_atlas_t *atlas, const sprite_atlas_entry_t *e) {
+	uint size = 1u << e->log_size;
+	uint32_t bytes = size * size * _sprite_atlas_pixel_bytes(atlas);
+	if (e->flags & SPRITE_ATLAS_ENTRY_METADATA)
+		bytes += size * sizeof(uint32_t);
+	return bytes;
+}
+
+uint32_t sprite_atlas_max_image_bytes(const sprite_atlas_t *atlas) {
+	uint32_t max = 0;
+	for (uint i = 0; i < atlas->n_entries; ++i)
+		max = MAX(max, _sprite_atlas_image_bytes(atlas, &atlas->entries[i]));
+	return (max + 3) & ~3u;
+}
+
+void sprite_atlas_cache_init(sprite_atlas_cache_t *cache, const sprite_atlas_t *atlas, void *slot_mem,
+		uint32_t slot_bytes, uint n_slots) {
+	assert(atlas->magic == SPRITE_ATLAS_MAGIC);
+	assert(!(slot_bytes & 3) && slot_bytes >= sprite_atlas_max_image_bytes(atlas));
+	assert(n_slots <= SPRITE_ATLAS_MAX_SLOTS);
+	cache->atlas = atlas;
+	cache->slot_mem = slot_mem;
+	cache->slot_bytes = slot_bytes;
+	cache->n_slots = n_slots;
+	// Start at 1 so that empty slots (frame 0) are never "in use"
+	cache->frame = 1;
+	for (uint i = 0; i < n_slots; ++i) {
+		cache->slot_entry[i] = SPRITE_ATLAS_NO_ENTRY;
+		cache->slot_frame[i] = 0;
+	}
+	memset(&cache->stats, 0, sizeof(cache->stats));
+}
+
+// Unpack n_pix pixels. The repeat runs use the asm fills, which is where
+// most of the pixels in typical sprites (transparent borders, flat colour)
+// end up.
+static void __ram_func(_sprite_atlas_unpack8)(uint8_t *dst, const uint8_t *src, uint n_pix) {
+	while (n_pix) {
+		uint c = *src++;
+		// A run past the end of the image (bad data) is cut short, rather
+		// than overrunning the slot
+		uint run = MIN(c < 128 ? c + 1 : c - 126, n_pix);
+		if (c < 128) {
+			memcpy(dst, src, run);
+			src += run;
+		}
+		else {
+			sprite_fill8(dst, *src++, run);
+		}
+		dst += run;
+		n_pix -= run;
+	}
+}
+
+static void __ram_func(_sprite_atlas_unpack16)(uint16_t *dst, const uint8_t *src, uint n_pix) {
+	while (n_pix) {
+		uint c = *src++;
+		uint run = MIN(c < 128 ? c + 1 : c - 126, n_pix);
+		if (c < 128) {
+			memcpy(dst, src, run * sizeof(uint16_t));
+			src += run * sizeof(uint16_t);
+		}
+		else {
+			sprite_fill16(dst, src[0] | src[1] << 8, run);
+			src += sizeof(uint16_t);
+		}
+		dst += run;
+		n_pix -= run;
+	}
+}
+
+static void _sprite_atlas_unpack(const sprite_atlas_t *atlas, const sprite_atlas_entry_t *e, void *dst) {
+	const uint8_t *src = (const uint8_t*)atlas + e->offset;
+	uint32_t bytes = _sprite_atlas_image_bytes(atlas, e);
+	if (!(e->flags & SPRITE_ATLAS_ENTRY_RLE))
+		memcpy(dst, src, bytes);
+	else if (atlas->flags & SPRITE_ATLAS_16BPP)
+		_sprite_atlas_unpack16(dst, src, bytes / sizeof(uint16_t));
+	else
+		_sprite_atlas_unpack8(dst, src, bytes);
+}
+
+static int _sprite_atlas_find(const sprite_atlas_cache_t *cache, uint entry) {
+	for (uint i = 0; i < cache->n_slots; ++i)
+		if (cache->slot_entry[i] == entry)
+			return i;
+	return -1;
+}
+
+// Least recently used slot not in use this frame, or -1
+static int _sprite_atlas_victim(const sprite_atlas_cache_t *cache) {
+	int victim = -1;
+	for (uint i = 0; i < cache->n_slots; ++i) {
+		if (cache->slot_frame[i] == cache->frame)
+			continue;
+		if (victim < 0 || cache->slot_frame[i] < cache->slot_frame[victim])
+			victim = i;
+	}
+	return victim;
+}
+
+static int _sprite_atlas_load(sprite_atlas_cache_t *cache, uint entry) {
+	int slot = _sprite_atlas_victim(cache);
+	if (slot < 0) {
+		++cache->stats.full;
+		return -1;
+	}
+	if (cache->slot_entry[slot] != SPRITE_ATLAS_NO_ENTRY)
+		++cache->stats.evictions;
+	_sprite_atlas_unpack(cache->atlas, &cache->atlas->entries[entry], cache->slot_mem + slot * cache->slot_bytes);
+	cache->slot_entry[slot] = entry;
+	return slot;
+}
+
+const void *sprite_atlas_get(sprite_atlas_cache_t *cache, uint entry) {
+	if (entry >= cache->atlas->n_entries)
+		return NULL;
+	int slot = _sprite_atlas_find(cache, entry);
+	if (slot >= 0) {
+		++cache->stats.hits;
+	}
+	else {
+		++cache->stats.misses;
+		slot = _sprite_atlas_load(cache, entry);
+		if (slot < 0)
+			return NULL;
+	}
+	cache->slot_frame[slot] = cache->frame;
+	return cache->slot_mem + slot * cache->slot_bytes;
+}
+
+bool sprite_atlas_bind(sprite_atlas_cache_t *cache, sprite_t *sp, uint entry) {
+	const void *img = sprite_atlas_get(cache, entry);
+	if (!img)
+		return false;
+	const sprite_atlas_entry_t *e = &cache->atlas->entries[entry];
+	sp->img = img;
+	sp->log_size = e->log_size;
+	sp->has_opacity_metadata = !!(e->flags & SPRITE_ATLAS_ENTRY_METADATA);
+	return true;
+}
+
+uint sprite_atlas_prefetch(sprite_atlas_cache_t *cache, const uint16_t *entries, uint n, uint max_unpack) {
+	uint unpacked = 0;
+	for (uint i = 0; i < n && unpacked < max_unpack; ++i) {
+		if (entries[i] >= cache->atlas->n_entries || _sprite_atlas_find(cache, entries[i]) >= 0)
+			continue;
+		int slot = _sprite_atlas_load(cache, entries[i]);
+		if (slot < 0)
+			break;
+		cache->slot_frame[slot] = cache->frame;
+		++cache->stats.prefetched;
+		++unpacked;
+	}
+	return unpacked;
+}
@@ -0,0 +1,112 @@
+#ifndef _SPRITE_ATLAS_H
+#define _SPRITE_ATLAS_H
+
+#include "pico/types.h"
+#include "sprite.h"
+
+// Sprite atlas: many sprite images, run-length compressed, in one blob which
+// can stay in flash (generated by sprite_atlas_pack.py). Sprites can only be
+// drawn from addressable, uncompressed memory, so images are unpacked on
+// demand into a cache of fixed-size SRAM slots, with least-recently-used
+// eviction.
+//
+// The cache is driven from the frame loop, not from the scanline renderer:
+// once per frame, call sprite_atlas_frame(), then sprite_atlas_bind() for
+// each sprite to be drawn this frame. Anything bound in the current frame is
+// never evicted, so img pointers stay valid until the next
+// sprite_atlas_frame(). With spare time at the end of a frame, pass the
+// next frame's sprite list to sprite_atlas_prefetch() to unpack ahead of
+// time.
+//
+// Atlas layout (all little-endian, word-aligned):
+//
+//   sprite_atlas_t header
+//   sprite_atlas_entry_t entries[n_entries]
+//   packed images, each starting on a word boundary
+//
+// Each image unpacks to the same layout as a plain sprite image: size x size
+// pixels, followed by one opacity metadata word per row if it has them.
+// Packed images are PackBits-style runs of whole pixels: a control byte c,
+// then either c + 1 literal pixels (c < 128) or one pixel to be repeated
+// c - 126 times (c >= 128). Pixels are stored little-endian.
+
+#define SPRITE_ATLAS_MAGIC 0x54415053u // "SPAT"
+
+// sprite_atlas_t flags
+#define SPRITE_ATLAS_16BPP 0x1u
+
+// sprite_atlas_entry_t flags
+#define SPRITE_ATLAS_ENTRY_RLE      0x1u // else stored unpacked
+#define SPRITE_ATLAS_ENTRY_METADATA 0x2u
+
+typedef struct sprite_atlas_entry {
+	uint32_t offset; // from start of atlas
+	uint32_t packed_bytes;
+	uint8_t log_size;
+	uint8_t flags;
+	uint16_t reserved;
+} sprite_atlas_entry_t;
+
+typedef struct sprite_atlas {
+	uint32_t magic;
+	uint16_t n_entries;
+	uint16_t flags;
+	sprite_atlas_entry_t entries[];
+} sprite_atlas_t;
+
+#ifndef SPRITE_ATLAS_MAX_SLOTS
+#define SPRITE_ATLAS_MAX_SLOTS 32
+#endif
+
+#define SPRITE_ATLAS_NO_ENTRY 0xffffu
+
+typedef struct sprite_atlas_stats {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t evictions;
+	uint32_t prefetched;
+	// Requests which failed because every slot was in use this frame
+	uint32_t full;
+} sprite_atlas_stats_t;
+
+typedef struct sprite_atlas_cache {
+	const sprite_atlas_t *atlas;
+	uint8_t *slot_mem;
+	uint32_t slot_bytes;
+	uint n_slots;
+	uint32_t frame;
+	uint16_t slot_entry[SPRITE_ATLAS_MAX_SLOTS];
+	uint32_t slot_frame[SPRITE_ATLAS_MAX_SLOTS];
+	sprite_atlas_stats_t stats;
+} sprite_atlas_cache_t;
+
+// Bytes needed for one slot to hold any image in the atlas (a multiple of 4)
+uint32_t sprite_atlas_max_image_bytes(const sprite_atlas_t *atlas);
+
+// slot_mem is n_slots * slot_bytes, word-aligned. slot_bytes must be a
+// multiple of 4 and at least sprite_atlas_max_image_bytes(atlas).
+void sprite_atlas_cache_init(sprite_atlas_cache_t *cache, const sprite_atlas_t *atlas, void *slot_mem,
+	uint32_t slot_bytes, uint n_slots);
+
+// Start a new frame: images bound in the previous frame become evictable.
+static inline void sprite_atlas_frame(sprite_atlas_cache_t *cache) {
+	++cache->frame;
+}
+
+// Get the unpacked image for an atlas entry, unpacking it if necessary, and
+// mark it as in use this frame. Returns NULL if the entry is out of range,
+// or all slots are in use this frame.
+const void *sprite_atlas_get(sprite_atlas_cache_t *cache, uint entry);
+
+// As above, and point sp->img, sp->log_size and sp->has_opacity_metadata at
+// the result. Returns false (and leaves sp unchanged) on failure.
+bool sprite_atlas_bind(sprite_atlas_cache_t *cache, sprite_t *sp, uint entry);
+
+// Unpack up to max_unpack of the listed entries which are not already
+// cached, without evicting anything in use this frame. Returns the number
+// unpacked. Prefetched images count as in use for the rest of this frame (so
+// one prefetch doesn't evict another), which is why this is meant for the
+// end of a frame.
+uint sprite_atlas_prefetch(sprite_atlas_cache_t *cache, const uint16_t *entries, uint n, uint max_unpack);
+
+#endif
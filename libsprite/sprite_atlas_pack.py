@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+
+# Pack sprite images into an atlas for sprite_atlas.c, emitted as a C header
+# containing one word-aligned byte array.
+#
+# Input images are raw little-endian pixels in the display format (RAGB2132
+# for 8bpp, RGAB5515 for 16bpp, alpha in bit 5), size x size, where size is a
+# power of two. Entries are numbered in command line order, and a #define is
+# emitted for each, named after the file.
+#
+# Example:
+#   sprite_atlas_pack.py --bpp 16 --metadata --name game_atlas -o game_atlas.h \
+#       ship.bin rock0.bin rock1.bin
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+MAGIC = 0x54415053
+ATLAS_16BPP = 0x1
+ENTRY_RLE = 0x1
+ENTRY_METADATA = 0x2
+ALPHA_MASK = 1 << 5
+HEADER_BYTES = 8
+ENTRY_BYTES = 12
+
+def read_pixels(path, bpp):
+	data = open(path, "rb").read()
+	pixbytes = bpp // 8
+	if len(data) % pixbytes:
+		sys.exit(f"{path}: length is not a whole number of pixels")
+	pixels = [int.from_bytes(data[i:i + pixbytes], "little") for i in range(0, len(data), pixbytes)]
+	size = int(round(len(pixels) ** 0.5))
+	if size * size != len(pixels) or size & (size - 1):
+		sys.exit(f"{path}: not a square power-of-two image ({len(pixels)} pixels)")
+	return size, pixels
+
+# One word per row: {solid, start[14:0], end[15:0]}, opaque span [start, end)
+def opacity_metadata(size, pixels):
+	words = []
+	for y in range(size):
+		row = pixels[y * size:(y + 1) * size]
+		opaque = [x for x in range(size) if row[x] & ALPHA_MASK]
+		if not opaque:
+			words.append(0)
+			continue
+		start, end = opaque[0], opaque[-1] + 1
+		solid = len(opaque) == end - start
+		words.append((solid << 31) | (start << 16) | end)
+	return words
+
+# PackBits over whole pixels: c < 128 -> c + 1 literals, c >= 128 -> next
+# pixel repeated c - 126 times. Runs of 2 are only worth it between other runs.
+def rle(pixels, pixbytes):
+	out = bytearray()
+	literals = []
+	def flush():
+		while literals:
+			chunk = literals[:128]
+			del literals[:128]
+			out.append(len(chunk) - 1)
+			for p in chunk:
+				out.extend(p.to_bytes(pixbytes, "little"))
+	i = 0
+	n = len(pixels)
+	while i < n:
+		run = 1
+		while i + run < n and run < 129 and pixels[i + run] == pixels[i]:
+			run += 1
+		if run >= 3 or (run == 2 and not literals):
+			flush()
+			out.append(run + 126)
+			out.extend(pixels[i].to_bytes(pixbytes, "little"))
+		else:
+			literals.extend(pixels[i:i + run])
+		i += run
+	flush()
+	return bytes(out)
+
+def unrle(data, pixbytes, n):
+	pixels = []
+	i = 0
+	while len(pixels) < n:
+		c = data[i]
+		i += 1
+		if c < 128:
+			for _ in range(c + 1):
+				pixels.append(int.from_bytes(data[i:i + pixbytes], "little"))
+				i += pixbytes
+		else:
+			pixels.extend([int.from_bytes(data[i:i + pixbytes], "little")] * (c - 126))
+			i += pixbytes
+	return pixels
+
+def pack(paths, bpp, metadata):
+	pixbytes = bpp // 8
+	entries = []
+	blobs = []
+	offset = HEADER_BYTES + ENTRY_BYTES * len(paths)
+	for path in paths:
+		size, pixels = read_pixels(path, bpp)
+		units = list(pixels)
+		flags = 0
+		if metadata:
+			flags |= ENTRY_METADATA
+			for w in opacity_metadata(size, pixels):
+				# Metadata is packed as pixels too (2 or 4 per word)
+				units.extend((w >> (8 * pixbytes * k)) & ((1 << bpp) - 1) for k in range(4 // pixbytes))
+		raw = b"".join(u.to_bytes(pixbytes, "little") for u in units)
+		packed = rle(units, pixbytes)
+		assert unrle(packed, pixbytes, len(units)) == units
+		if len(packed) < len(raw):
+			flags |= ENTRY_RLE
+			blob = packed
+		else:
+			blob = raw
+		entries.append((offset, len(blob), size.bit_length() - 1, flags, len(raw)))
+		blob += bytes(-len(blob) % 4)
+		blobs.append(blob)
+		offset += len(blob)
+	out = bytearray(struct.pack("<IHH", MAGIC, len(paths), ATLAS_16BPP if bpp == 16 else 0))
+	for e in entries:
+		out += struct.pack("<IIBBH", e[0], e[1], e[2], e[3], 0)
+	for b in blobs:
+		out += b
+	return bytes(out), entries
+
+def c_name(s):
+	return re.sub(r"\W", "_", s).upper()
+
+def write_header(f, name, data, entries, paths):
+	guard = f"_{c_name(name)}_H"
+	f.write(f"#ifndef {guard}\n#define {guard}\n\n")
+	f.write(f"// Generated by sprite_atlas_pack.py, do not edit\n\n")
+	for i, path in enumerate(paths):
+		stem = os.path.splitext(os.path.basename(path))[0]
+		f.write(f"#define {c_name(name)}_{c_name(stem)} {i}\n")
+	f.write(f"\n// {len(data)} bytes, {sum(e[4] for e in entries)} bytes unpacked\n")
+	f.write(f"static const uint8_t __attribute__((aligned(4))) {name}[] = {{\n")
+	for i in range(0, len(data), 16):
+		f.write("\t" + " ".join(f"0x{b:02x}," for b in data[i:i + 16]) + "\n")
+	f.write("};\n\n#endif\n")
+
+if __name__ == "__main__":
+	parser = argparse.ArgumentParser(description="Pack raw sprite images into a sprite_atlas_t")
+	parser.add_argument("images", nargs="+")
+	parser.add_argument("--bpp", type=int, choices=(8, 16), default=16)
+	parser.add_argument("--metadata", action="store_true", help="append opacity metadata to each image")
+	parser.add_argument("--name", default="sprite_atlas")
+	parser.add_argument("-o", "--output", required=True)
+	args = parser.parse_args()
+	data, entries = pack(args.images, args.bpp, args.metadata)
+	with open(args.output, "w") as f:
+		write_header(f, args.name, data, entries, args.images)
+	unpacked = sum(e[4] for e in entries)
+	print(f"{len(entries)} images, {unpacked} -> {len(data)} bytes ({100 * len(data) / unpacked:.0f}%)")
@@ -0,0 +1,92 @@
+#include "sprite_bins.h"
+
+#include "pico.h" // for __not_in_flash
+
+#define __ram_func(foo) __not_in_flash(#foo) foo
+
+void sprite_bins_init(sprite_bins_t *bins, uint log_band_height, uint n_bands,
+		uint16_t *band_start, uint16_t *entries, uint max_entries) {
+	bins->sprites = NULL;
+	bins->band_start = band_start;
+	bins->entries = entries;
+	bins->n_bands = n_bands;
+	bins->max_entries = max_entries;
+	bins->log_band_height = log_band_height;
+	bins->n_dropped = 0;
+	for (uint i = 0; i <= n_bands; ++i)
+		band_start[i] = 0;
+}
+
+// Range of bands touched by a sprite, as [b0, b1). Empty if off-screen.
+static inline void _sprite_band_range(const sprite_bins_t *bins, const sprite_t *sp, int *b0, int *b1) {
+	int y0 = MAX(0, sp->y);
+	int y1 = MIN(sp->y + (1 << sp->log_size), bins->n_bands << bins->log_band_height);
+	if (y1 <= y0) {
+		*b0 = *b1 = 0;
+		return;
+	}
+	*b0 = y0 >> bins->log_band_height;
+	*b1 = ((y1 - 1) >> bins->log_band_height) + 1;
+}
+
+// Counting sort: count sprites per band, prefix sum to get each band's
+// start, then place sprites in order. Placing in sprite order keeps each band
+// in depth order for free.
+void sprite_bins_build(sprite_bins_t *bins, const sprite_t *sprites, uint n_sprites) {
+	uint16_t *band_start = bins->band_start;
+	uint n_bands = bins->n_bands;
+	bins->sprites = sprites;
+
+	// Count into band_start[b + 1], and stop at the first sprite which would
+	// overflow the entry list.
+	for (uint b = 0; b <= n_bands; ++b)
+		band_start[b] = 0;
+	uint total = 0;
+	uint n_used = 0;
+	for (; n_used < n_sprites; ++n_used) {
+		int b0, b1;
+		_sprite_band_range(bins, &sprites[n_used], &b0, &b1);
+		if (total + (b1 - b0) > bins->max_entries)
+			break;
+		total += b1 - b0;
+		for (int b = b0; b < b1; ++b)
+			++band_start[b + 1];
+	}
+	bins->n_dropped = n_sprites - n_used;
+
+	for (uint b = 1; b <= n_bands; ++b)
+		band_start[b] += band_start[b - 1];
+
+	// Fill, using band_start[b] as the write pointer for band b. Afterward it
+	// points at the end of band b, i.e. the start of band b + 1, so shuffle
+	// back down by one.
+	for (uint i = 0; i < n_used; ++i) {
+		int b0, b1;
+		_sprite_band_range(bins, &sprites[i], &b0, &b1);
+		for (int b = b0; b < b1; ++b)
+			bins->entries[band_start[b]++] = i;
+	}
+	for (uint b = n_bands; b > 0; --b)
+		band_start[b] = band_start[b - 1];
+	band_start[0] = 0;
+}
+
+void __ram_func(sprite_bins_render8)(uint8_t *scanbuf, const sprite_bins_t *bins, uint raster_y, uint raster_w) {
+	uint band = raster_y >> bins->log_band_height;
+	if (band >= bins->n_bands)
+		return;
+	const uint16_t *entry = bins->entries + bins->band_start[band];
+	const uint16_t *end = bins->entries + bins->band_start[band + 1];
+	while (entry < end)
+		sprite_sprite8(scanbuf, &bins->sprites[*entry++], raster_y, raster_w);
+}
+
+void __ram_func(sprite_bins_render16)(uint16_t *scanbuf, const sprite_bins_t *bins, uint raster_y, uint raster_w) {
+	uint band = raster_y >> bins->log_band_height;
+	if (band >= bins->n_bands)
+		return;
+	const uint16_t *entry = bins->entries + bins->band_start[band];
+	const uint16_t *end = bins->entries + bins->band_start[band + 1];
+	while (entry < end)
+		sprite_sprite16(scanbuf, &bins->sprites[*entry++], raster_y, raster_w);
+}
@@ -0,0 +1,46 @@
+#ifndef _SPRITE_BINS_H
+#define _SPRITE_BINS_H
+
+#include "pico/types.h"
+#include "sprite.h"
+
+// Calling sprite_sprite8/16 for every sprite on every scanline costs one
+// intersection test per sprite per line, even though most sprites are on few
+// lines. Instead, bucket the sprite list once per frame into bands of
+// 2^log_band_height scanlines, and per scanline only visit the sprites in the
+// current band.
+//
+// Within each band, sprites stay in their original order (index 0 is drawn
+// first, so is furthest back). Sorting by x instead would break the drawing
+// order of overlapping sprites.
+//
+// All storage is supplied by the caller, so it can be static:
+//   band_start: n_bands + 1 entries
+//   entries:    one entry per (sprite, band) pair. A sprite of height h
+//               touches at most h / band_height + 1 bands.
+
+typedef struct sprite_bins {
+	const sprite_t *sprites;
+	uint16_t *band_start;
+	uint16_t *entries;
+	uint16_t n_bands;
+	uint16_t max_entries;
+	uint8_t log_band_height;
+	// Sprites left out of the last build because entries was full. These are
+	// always the frontmost sprites (highest indices).
+	uint16_t n_dropped;
+} sprite_bins_t;
+
+void sprite_bins_init(sprite_bins_t *bins, uint log_band_height, uint n_bands,
+	uint16_t *band_start, uint16_t *entries, uint max_entries);
+
+// Call once per frame, after moving sprites and before rendering the first
+// scanline. The sprite array must stay valid (and unchanged) until the frame
+// has been rendered.
+void sprite_bins_build(sprite_bins_t *bins, const sprite_t *sprites, uint n_sprites);
+
+// Render all sprites which intersect this scanline, in order.
+void sprite_bins_render8(uint8_t *scanbuf, const sprite_bins_t *bins, uint raster_y, uint raster_w);
+void sprite_bins_render16(uint16_t *scanbuf, const sprite_bins_t *bins, uint raster_y, uint raster_w);
+
+#endif
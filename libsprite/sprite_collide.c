@@ -0,0 +1,175 @@
+#include "sprite_collide.h"
+
+// Alpha is bit 5 in both formats (see sprite_asm_const.h, which is asm-only)
+#define SPRITE_ALPHA_MASK (1u << 5)
+
+void sprite_collide_init(sprite_collide_t *coll, uint log_cell, uint cells_x, uint cells_y,
+		uint16_t *cell_start, uint16_t *entries, uint max_entries, uint pixel_bytes) {
+	coll->cell_start = cell_start;
+	coll->entries = entries;
+	coll->cells_x = cells_x;
+	coll->cells_y = cells_y;
+	coll->max_entries = max_entries;
+	coll->log_cell = log_cell;
+	coll->pixel_bytes = pixel_bytes;
+	coll->pixel_exact = false;
+	coll->n_dropped = 0;
+	coll->stats = (sprite_collide_stats_t){0};
+	for (uint i = 0; i <= cells_x * cells_y; ++i)
+		cell_start[i] = 0;
+}
+
+// ----------------------------------------------------------------------------
+// Narrowphase
+
+// Opaque span of one row of a sprite, as sprite-relative x [*x0, *x1). y is
+// the sprite-relative screen row, so flips are applied here. Returns true if
+// the span has no holes.
+static inline bool _row_span(const sprite_t *sp, int y, uint pixel_bytes, int *x0, int *x1) {
+	int size = 1 << sp->log_size;
+	if (!sp->has_opacity_metadata) {
+		*x0 = 0;
+		*x1 = size;
+		return true;
+	}
+	if (sp->vflip)
+		y = size - 1 - y;
+	uint32_t meta = ((const uint32_t*)((const uint8_t*)sp->img + size * size * pixel_bytes))[y];
+	if (sp->hflip)
+		meta = sprite_mirror_metadata(meta, size);
+	*x0 = (meta >> 16) & 0x7fff;
+	*x1 = meta & 0xffff;
+	return !!(meta & (1u << 31));
+}
+
+static inline bool _pixel_opaque(const sprite_t *sp, int x, int y, uint pixel_bytes) {
+	int size = 1 << sp->log_size;
+	if (sp->hflip)
+		x = size - 1 - x;
+	if (sp->vflip)
+		y = size - 1 - y;
+	uint idx = (y << sp->log_size) + x;
+	uint pix = pixel_bytes == 2 ? ((const uint16_t*)sp->img)[idx] : ((const uint8_t*)sp->img)[idx];
+	return !!(pix & SPRITE_ALPHA_MASK);
+}
+
+bool sprite_collide_pair(const sprite_t *a, const sprite_t *b, uint pixel_bytes, bool pixel_exact) {
+	int y0 = MAX(a->y, b->y);
+	int y1 = MIN(a->y + (1 << a->log_size), b->y + (1 << b->log_size));
+	if (y1 <= y0)
+		return false;
+	if (MIN(a->x + (1 << a->log_size), b->x + (1 << b->log_size)) <= MAX(a->x, b->x))
+		return false;
+	for (int y = y0; y < y1; ++y) {
+		int ax0, ax1, bx0, bx1;
+		bool a_solid = _row_span(a, y - a->y, pixel_bytes, &ax0, &ax1);
+		bool b_solid = _row_span(b, y - b->y, pixel_bytes, &bx0, &bx1);
+		int x0 = MAX(a->x + ax0, b->x + bx0);
+		int x1 = MIN(a->x + ax1, b->x + bx1);
+		if (x1 <= x0)
+			continue;
+		if (!pixel_exact || (a_solid && b_solid))
+			return true;
+		for (int x = x0; x < x1; ++x) {
+			if ((a_solid || _pixel_opaque(a, x - a->x, y - a->y, pixel_bytes)) &&
+					(b_solid || _pixel_opaque(b, x - b->x, y - b->y, pixel_bytes)))
+				return true;
+		}
+	}
+	return false;
+}
+
+// ----------------------------------------------------------------------------
+// Broadphase
+
+static inline int _cell_coord(int v, uint log_cell, uint n_cells) {
+	return MIN(MAX(v >> (int)log_cell, 0), (int)n_cells - 1);
+}
+
+// Range of cells touched by a sprite, as [*cx0, *cx1] x [*cy0, *cy1] (inclusive)
+static inline void _sprite_cell_range(const sprite_collide_t *coll, const sprite_t *sp,
+		int *cx0, int *cx1, int *cy0, int *cy1) {
+	int size = 1 << sp->log_size;
+	*cx0 = _cell_coord(sp->x, coll->log_cell, coll->cells_x);
+	*cx1 = _cell_coord(sp->x + size - 1, coll->log_cell, coll->cells_x);
+	*cy0 = _cell_coord(sp->y, coll->log_cell, coll->cells_y);
+	*cy1 = _cell_coord(sp->y + size - 1, coll->log_cell, coll->cells_y);
+}
+
+// Counting sort of (sprite, cell) pairs, as in sprite_bins_build(), so each
+// cell lists its sprites in increasing index order.
+static void _sprite_collide_build(sprite_collide_t *coll, const sprite_t *sprites, uint n) {
+	uint16_t *cell_start = coll->cell_start;
+	uint n_cells = coll->cells_x * coll->cells_y;
+	for (uint c = 0; c <= n_cells; ++c)
+		cell_start[c] = 0;
+	uint total = 0;
+	uint n_used = 0;
+	for (; n_used < n; ++n_used) {
+		int cx0, cx1, cy0, cy1;
+		_sprite_cell_range(coll, &sprites[n_used], &cx0, &cx1, &cy0, &cy1);
+		uint count = (cx1 - cx0 + 1) * (cy1 - cy0 + 1);
+		if (total + count > coll->max_entries)
+			break;
+		total += count;
+		for (int cy = cy0; cy <= cy1; ++cy)
+			for (int cx = cx0; cx <= cx1; ++cx)
+				++cell_start[cy * coll->cells_x + cx + 1];
+	}
+	coll->n_dropped = n - n_used;
+
+	for (uint c = 1; c <= n_cells; ++c)
+		cell_start[c] += cell_start[c - 1];
+
+	for (uint i = 0; i < n_used; ++i) {
+		int cx0, cx1, cy0, cy1;
+		_sprite_cell_range(coll, &sprites[i], &cx0, &cx1, &cy0, &cy1);
+		for (int cy = cy0; cy <= cy1; ++cy)
+			for (int cx = cx0; cx <= cx1; ++cx)
+				coll->entries[cell_start[cy * coll->cells_x + cx]++] = i;
+	}
+	for (uint c = n_cells; c > 0; --c)
+		cell_start[c] = cell_start[c - 1];
+	cell_start[0] = 0;
+}
+
+uint sprite_collide_find(sprite_collide_t *coll, const sprite_t *sprites, uint n,
+		sprite_contact_t *contacts, uint max_contacts) {
+	_sprite_collide_build(coll, sprites, n);
+	sprite_collide_stats_t stats = {0};
+	uint n_contacts = 0;
+	const uint16_t *entries = coll->entries;
+	for (int cy = 0; cy < coll->cells_y; ++cy) {
+		for (int cx = 0; cx < coll->cells_x; ++cx) {
+			uint c = cy * coll->cells_x + cx;
+			uint end = coll->cell_start[c + 1];
+			for (uint i = coll->cell_start[c]; i < end; ++i) {
+				const sprite_t *a = &sprites[entries[i]];
+				int a_size = 1 << a->log_size;
+				for (uint j = i + 1; j < end; ++j) {
+					const sprite_t *b = &sprites[entries[j]];
+					int b_size = 1 << b->log_size;
+					++stats.pairs_checked;
+					int x0 = MAX(a->x, b->x);
+					int y0 = MAX(a->y, b->y);
+					if (MIN(a->x + a_size, b->x + b_size) <= x0 || MIN(a->y + a_size, b->y + b_size) <= y0)
+						continue;
+					// Only the cell holding the top-left of the overlap reports the pair
+					if (_cell_coord(x0, coll->log_cell, coll->cells_x) != cx ||
+							_cell_coord(y0, coll->log_cell, coll->cells_y) != cy)
+						continue;
+					++stats.pairs_narrow;
+					if (!sprite_collide_pair(a, b, coll->pixel_bytes, coll->pixel_exact))
+						continue;
+					++stats.contacts;
+					if (n_contacts < max_contacts)
+						contacts[n_contacts++] = (sprite_contact_t){entries[i], entries[j]};
+					else
+						++stats.contacts_dropped;
+				}
+			}
+		}
+	}
+	coll->stats = stats;
+	return n_contacts;
+}
@@ -0,0 +1,74 @@
+#ifndef _SPRITE_COLLIDE_H
+#define _SPRITE_COLLIDE_H
+
+#include "pico/types.h"
+#include "sprite.h"
+
+// Sprite-sprite collision detection, once per frame.
+//
+// Broadphase: sprites are bucketed into a uniform grid of 2^log_cell pixel
+// square cells (a counting sort, as in sprite_bins.c), and only sprites
+// sharing a cell are compared. A pair whose bounding boxes overlap is only
+// considered in the cell holding the top-left corner of that overlap, so it
+// is reported once however many cells the two share. Sprites off the edge of
+// the grid are clamped into the edge cells, so still collide, just with less
+// benefit from the grid. Cells of about the size of the common sprites work
+// best.
+//
+// Narrowphase: for each row where the bounding boxes overlap, the opaque
+// spans from the opacity metadata are compared (honouring hflip and vflip).
+// A sprite without metadata counts as a solid square. A row span which is not
+// solid has holes in it, so overlapping spans are a hit unless pixel_exact is
+// set, in which case the alpha bits within the overlap are checked. That
+// touches pixels, so is much slower, but only happens for pairs which are
+// already very close.
+//
+// All storage is supplied by the caller, so it can be static:
+//   cell_start: cells_x * cells_y + 1 entries
+//   entries:    one entry per (sprite, cell) pair. A sprite of size s
+//               touches at most (s / cell_size + 1)^2 cells.
+
+typedef struct sprite_contact {
+	// a < b, as indices into the sprite array
+	uint16_t a;
+	uint16_t b;
+} sprite_contact_t;
+
+typedef struct sprite_collide_stats {
+	// Pairs sharing a cell, and those that got as far as the narrowphase
+	uint32_t pairs_checked;
+	uint32_t pairs_narrow;
+	uint32_t contacts;
+	// Contacts found after the contact list was full
+	uint32_t contacts_dropped;
+} sprite_collide_stats_t;
+
+typedef struct sprite_collide {
+	uint16_t *cell_start;
+	uint16_t *entries;
+	uint16_t cells_x;
+	uint16_t cells_y;
+	uint16_t max_entries;
+	uint8_t log_cell;
+	// 1 for 8bpp sprites, 2 for 16bpp, to find the metadata after the pixels
+	uint8_t pixel_bytes;
+	bool pixel_exact;
+	// Sprites left out of the last sprite_collide_find() because entries was
+	// full. These are always the highest indices.
+	uint16_t n_dropped;
+	sprite_collide_stats_t stats;
+} sprite_collide_t;
+
+void sprite_collide_init(sprite_collide_t *coll, uint log_cell, uint cells_x, uint cells_y,
+	uint16_t *cell_start, uint16_t *entries, uint max_entries, uint pixel_bytes);
+
+// Find all touching pairs among sprites[0] ... sprites[n - 1], writing up to
+// max_contacts of them, grouped by cell. Returns the number written. Resets
+// the stats.
+uint sprite_collide_find(sprite_collide_t *coll, const sprite_t *sprites, uint n,
+	sprite_contact_t *contacts, uint max_contacts);
+
+// Test a single pair, with no broadphase.
+bool sprite_collide_pair(const sprite_t *a, const sprite_t *b, uint pixel_bytes, bool pixel_exact);
+
+#endif
@@ -0,0 +1,258 @@
+#include <string.h>
+
+#include "sprite_cull.h"
+
+#include "pico.h" // for __not_in_flash
+
+#define __ram_func(foo) __not_in_flash(#foo) foo
+
+typedef struct {
+	uint n_covered;
+	uint n_pieces;
+	// Sprites at the back of the list which did not fit in the scratch space,
+	// and get drawn in full with no culling.
+	uint n_unculled;
+} cull_result_t;
+
+// Get the screen span of a sprite on this scanline, clipped to the raster and
+// to the opaque span from the metadata (if any). False if nothing to draw.
+static inline bool _sprite_row_span(const sprite_t *sp, uint raster_y, uint raster_w, uint pixel_bytes,
+		sprite_cull_piece_t *row) {
+	int size = 1 << sp->log_size;
+	int tex_offs_y = (int)raster_y - sp->y;
+	if ((uint)tex_offs_y >= (uint)size)
+		return false;
+	if (sp->vflip)
+		tex_offs_y = size - 1 - tex_offs_y;
+	int x0 = MAX(0, sp->x);
+	int x1 = MIN(sp->x + size, (int)raster_w);
+	bool solid = false;
+	if (sp->has_opacity_metadata) {
+		uint32_t meta = ((const uint32_t*)((const uint8_t*)sp->img + size * size * pixel_bytes))[tex_offs_y];
+		if (sp->hflip)
+			meta = sprite_mirror_metadata(meta, size);
+		x0 = MAX(x0, sp->x + (int)((meta >> 16) & 0x7fff));
+		x1 = MIN(x1, sp->x + (int)(meta & 0xffff));
+		solid = !!(meta & (1u << 31));
+	}
+	if (x1 <= x0)
+		return false;
+	row->sp = sp;
+	row->x0 = x0;
+	row->x1 = x1;
+	row->tex_offs_y = tex_offs_y;
+	row->solid = solid;
+	return true;
+}
+
+// Add [x0, x1) to the sorted, disjoint covered list, merging with any spans
+// it overlaps or touches. If the list is full, the span is forgotten, which
+// just means less gets culled.
+static uint _covered_insert(sprite_cull_span_t *cov, uint n, int x0, int x1) {
+	uint i = 0;
+	while (i < n && cov[i].x1 < x0)
+		++i;
+	uint j = i;
+	while (j < n && cov[j].x0 <= x1) {
+		x0 = MIN(x0, cov[j].x0);
+		x1 = MAX(x1, cov[j].x1);
+		++j;
+	}
+	if (j == i) {
+		if (n == SPRITE_CULL_MAX_COVERED)
+			return n;
+		memmove(&cov[i + 1], &cov[i], (n - i) * sizeof(cov[0]));
+		++n;
+	}
+	else {
+		memmove(&cov[i + 1], &cov[j], (n - j) * sizeof(cov[0]));
+		n -= j - i - 1;
+	}
+	cov[i].x0 = x0;
+	cov[i].x1 = x1;
+	return n;
+}
+
+// Front-to-back pass: record the parts of each sprite not hidden by solid
+// spans of sprites in front of it. Pieces are recorded front-to-back.
+static cull_result_t __ram_func(_sprite_cull)(sprite_cull_scratch_t *scratch, const sprite_t *sprites,
+		const uint16_t *order, uint n, uint raster_y, uint raster_w, uint pixel_bytes) {
+	sprite_cull_span_t *cov = scratch->covered;
+	sprite_cull_piece_t *pieces = scratch->pieces;
+	uint n_cov = 0;
+	uint n_pieces = 0;
+	int i;
+	for (i = (int)n - 1; i >= 0; --i) {
+		sprite_cull_piece_t row;
+		if (!_sprite_row_span(&sprites[order ? order[i] : i], raster_y, raster_w, pixel_bytes, &row))
+			continue;
+		// Clipping against n_cov spans gives at most n_cov + 1 pieces
+		if (n_pieces + n_cov + 1 > SPRITE_CULL_MAX_PIECES)
+			break;
+		int x = row.x0;
+		for (uint k = 0; k < n_cov && x < row.x1; ++k) {
+			if (cov[k].x1 <= x)
+				continue;
+			if (cov[k].x0 >= row.x1)
+				break;
+			if (cov[k].x0 > x) {
+				pieces[n_pieces] = row;
+				pieces[n_pieces].x0 = x;
+				pieces[n_pieces].x1 = cov[k].x0;
+				++n_pieces;
+			}
+			x = cov[k].x1;
+		}
+		if (x < row.x1) {
+			pieces[n_pieces] = row;
+			pieces[n_pieces].x0 = x;
+			++n_pieces;
+		}
+		if (row.solid)
+			n_cov = _covered_insert(cov, n_cov, row.x0, row.x1);
+	}
+	return (cull_result_t){
+		.n_covered = n_cov,
+		.n_pieces = n_pieces,
+		.n_unculled = i + 1
+	};
+}
+
+// Pixels written by drawing the first n sprites in full (clipped to their
+// opaque spans)
+static uint _sprite_unculled_count(const sprite_t *sprites, const uint16_t *order, uint n, uint raster_y,
+		uint raster_w, uint pixel_bytes) {
+	uint written = 0;
+	for (uint i = 0; i < n; ++i) {
+		sprite_cull_piece_t row;
+		if (_sprite_row_span(&sprites[order ? order[i] : i], raster_y, raster_w, pixel_bytes, &row))
+			written += row.x1 - row.x0;
+	}
+	return written;
+}
+
+// Draw the background wherever it is not covered, widening each gap out to
+// tile boundaries in tile space (the tile loops can't start mid-tile except
+// at the left edge of the raster). Overlapping widened gaps are merged.
+static uint __ram_func(_sprite_cull_bg16)(uint16_t *scanbuf, const tilebg_t *bg, const sprite_cull_span_t *cov,
+		uint n_cov, uint raster_y, uint raster_w) {
+	uint tile_mask = (1u << (3 + (uint)bg->tilesize)) - 1;
+	uint written = 0;
+	int pend0 = 0;
+	int pend1 = -1;
+	int gap0 = 0;
+	for (uint k = 0; k <= n_cov; ++k) {
+		int gap1 = k < n_cov ? cov[k].x0 : (int)raster_w;
+		if (gap1 > gap0) {
+			uint xscroll = tile_xscroll(bg, raster_y);
+			int a = gap0 - (int)((xscroll + gap0) & tile_mask);
+			int b = gap1 + (int)((0u - (xscroll + gap1)) & tile_mask);
+			a = MAX(a, 0);
+			b = MIN(b, (int)raster_w);
+			if (a <= pend1) {
+				pend1 = MAX(pend1, b);
+			}
+			else {
+				if (pend1 > pend0) {
+					tile16_span(scanbuf, bg, raster_y, pend0, pend1);
+					written += pend1 - pend0;
+				}
+				pend0 = a;
+				pend1 = b;
+			}
+		}
+		if (k < n_cov)
+			gap0 = cov[k].x1;
+	}
+	if (pend1 > pend0) {
+		tile16_span(scanbuf, bg, raster_y, pend0, pend1);
+		written += pend1 - pend0;
+	}
+	return written;
+}
+
+uint __ram_func(sprite_cull_render8)(uint8_t *scanbuf, sprite_cull_scratch_t *scratch, const sprite_t *sprites,
+		const uint16_t *order, uint n, uint raster_y, uint raster_w) {
+	cull_result_t res = _sprite_cull(scratch, sprites, order, n, raster_y, raster_w, sizeof(uint8_t));
+	uint written = _sprite_unculled_count(sprites, order, res.n_unculled, raster_y, raster_w, sizeof(uint8_t));
+	for (uint i = 0; i < res.n_unculled; ++i)
+		sprite_sprite8(scanbuf, &sprites[order ? order[i] : i], raster_y, raster_w);
+	for (int k = (int)res.n_pieces - 1; k >= 0; --k) {
+		const sprite_cull_piece_t *p = &scratch->pieces[k];
+		const uint8_t *src = (const uint8_t*)p->sp->img + (p->tex_offs_y << p->sp->log_size);
+		uint len = p->x1 - p->x0;
+		if (p->sp->hflip) {
+			src += (1 << p->sp->log_size) - (p->x1 - p->sp->x);
+			(p->solid ? sprite_blit8_hflip : sprite_blit8_alpha_hflip)(scanbuf + p->x0, src, len);
+		}
+		else {
+			src += p->x0 - p->sp->x;
+			if (p->solid)
+				sprite_blit8(scanbuf + p->x0, src, len);
+			else
+				sprite_blit8_alpha_auto(scanbuf + p->x0, src, len);
+		}
+		written += len;
+	}
+	return written;
+}
+
+uint __ram_func(sprite_cull_render16)(uint16_t *scanbuf, sprite_cull_scratch_t *scratch, const tilebg_t *bg,
+		const sprite_t *sprites, const uint16_t *order, uint n, uint raster_y, uint raster_w) {
+	cull_result_t res = _sprite_cull(scratch, sprites, order, n, raster_y, raster_w, sizeof(uint16_t));
+	uint written = 0;
+	if (bg)
+		written += _sprite_cull_bg16(scanbuf, bg, scratch->covered, res.n_covered, raster_y, raster_w);
+	written += _sprite_unculled_count(sprites, order, res.n_unculled, raster_y, raster_w, sizeof(uint16_t));
+	for (uint i = 0; i < res.n_unculled; ++i)
+		sprite_sprite16(scanbuf, &sprites[order ? order[i] : i], raster_y, raster_w);
+	for (int k = (int)res.n_pieces - 1; k >= 0; --k) {
+		const sprite_cull_piece_t *p = &scratch->pieces[k];
+		const uint16_t *src = (const uint16_t*)p->sp->img + (p->tex_offs_y << p->sp->log_size);
+		uint len = p->x1 - p->x0;
+		if (p->sp->hflip) {
+			src += (1 << p->sp->log_size) - (p->x1 - p->sp->x);
+			(p->solid ? sprite_blit16_hflip : sprite_blit16_alpha_hflip)(scanbuf + p->x0, src, len);
+		}
+		else {
+			src += p->x0 - p->sp->x;
+			if (p->solid)
+				sprite_blit16(scanbuf + p->x0, src, len);
+			else
+				sprite_blit16_alpha_auto(scanbuf + p->x0, src, len);
+		}
+		written += len;
+	}
+	return written;
+}
+
+static inline void _sprite_bins_band(const sprite_bins_t *bins, uint raster_y, const uint16_t **order, uint *n) {
+	uint band = raster_y >> bins->log_band_height;
+	if (band >= bins->n_bands) {
+		*n = 0;
+		*order = NULL;
+		return;
+	}
+	*order = bins->entries + bins->band_start[band];
+	*n = bins->band_start[band + 1] - bins->band_start[band];
+}
+
+uint __ram_func(sprite_bins_cull_render8)(uint8_t *scanbuf, sprite_cull_scratch_t *scratch, const sprite_bins_t *bins,
+		uint raster_y, uint raster_w) {
+	const uint16_t *order;
+	uint n;
+	_sprite_bins_band(bins, raster_y, &order, &n);
+	if (!n)
+		return 0;
+	return sprite_cull_render8(scanbuf, scratch, bins->sprites, order, n, raster_y, raster_w);
+}
+
+uint __ram_func(sprite_bins_cull_render16)(uint16_t *scanbuf, sprite_cull_scratch_t *scratch, const tilebg_t *bg,
+		const sprite_bins_t *bins, uint raster_y, uint raster_w) {
+	const uint16_t *order;
+	uint n;
+	_sprite_bins_band(bins, raster_y, &order, &n);
+	if (!n && !bg)
+		return 0;
+	return sprite_cull_render16(scanbuf, scratch, bg, bins->sprites, order, n, raster_y, raster_w);
+}
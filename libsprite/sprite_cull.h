@@ -0,0 +1,64 @@
+#ifndef _SPRITE_CULL_H
+#define _SPRITE_CULL_H
+
+#include "pico/types.h"
+#include "sprite.h"
+#include "sprite_bins.h"
+#include "tile.h"
+
+// Occlusion-culled scanline compositor. Sprites are walked front-to-back,
+// keeping a list of screen x intervals already covered by a solid span (from
+// the opacity metadata). Each sprite is clipped against that list, and then
+// the visible pieces are drawn back-to-front, so each covered pixel is
+// written once rather than once per layer. An optional tile background at the
+// back is only drawn where no solid sprite span covers it (widened to tile
+// boundaries, as the tile loops require).
+//
+// Sprites without opacity metadata are still clipped by those in front, but
+// never hide anything, as their rows are assumed to have holes.
+//
+// Scratch space is supplied by the caller so that it need not be on the
+// (small) stack. If either list fills up, the compositor degrades to drawing
+// more than necessary, never less.
+
+#ifndef SPRITE_CULL_MAX_COVERED
+#define SPRITE_CULL_MAX_COVERED 16
+#endif
+
+#ifndef SPRITE_CULL_MAX_PIECES
+#define SPRITE_CULL_MAX_PIECES 64
+#endif
+
+typedef struct sprite_cull_span {
+	int16_t x0;
+	int16_t x1;
+} sprite_cull_span_t;
+
+typedef struct sprite_cull_piece {
+	const sprite_t *sp;
+	int16_t x0;
+	int16_t x1;
+	uint16_t tex_offs_y;
+	bool solid;
+} sprite_cull_piece_t;
+
+typedef struct sprite_cull_scratch {
+	sprite_cull_span_t covered[SPRITE_CULL_MAX_COVERED];
+	sprite_cull_piece_t pieces[SPRITE_CULL_MAX_PIECES];
+} sprite_cull_scratch_t;
+
+// Draw sprites[order[0]] ... sprites[order[n - 1]], back to front (order may be
+// NULL to draw sprites[0] ... sprites[n - 1]). bg may be NULL. Returns the
+// number of pixels written, for profiling.
+uint sprite_cull_render8(uint8_t *scanbuf, sprite_cull_scratch_t *scratch, const sprite_t *sprites,
+	const uint16_t *order, uint n, uint raster_y, uint raster_w);
+uint sprite_cull_render16(uint16_t *scanbuf, sprite_cull_scratch_t *scratch, const tilebg_t *bg,
+	const sprite_t *sprites, const uint16_t *order, uint n, uint raster_y, uint raster_w);
+
+// As above, for the sprites in the scanline's band of a sprite_bins_t
+uint sprite_bins_cull_render8(uint8_t *scanbuf, sprite_cull_scratch_t *scratch, const sprite_bins_t *bins,
+	uint raster_y, uint raster_w);
+uint sprite_bins_cull_render16(uint16_t *scanbuf, sprite_cull_scratch_t *scratch, const tilebg_t *bg,
+	const sprite_bins_t *bins, uint raster_y, uint raster_w);
+
+#endif
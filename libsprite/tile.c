@@ -2,6 +2,8 @@
 
 #include "pico.h" // for __not_in_flash
 #include "hardware/interp.h"
+#include "interp_owner.h"
+#include "util_systick_inline.h"
 
 #define __ram_func(foo) __not_in_flash(#foo) foo
 
@@ -14,40 +16,111 @@ static inline void setup_interp_tilemap_ptrs(interp_hw_t *interp, const uint8_t
 	// then add to tilemap row base. Since it's a preincrement, we walk the
 	// initial x back by 1. This isn't a very exciting use of interpolators,
 	// but it saves ~3 core registers for the pixel loops.
-	interp_config c = interp_default_config();
-	interp_config_set_mask(&c, 0, x_msb);
-	interp_set_config(interp, 0, &c);
+	// The control registers only depend on the tilemap width, so are skipped
+	// if nothing else has used this interpolator since the last tile span.
+	if (interp_claim(interp_index(interp), INTERP_OWNER_TILE | x_msb)) {
+		interp_config c = interp_default_config();
+		interp_config_set_mask(&c, 0, x_msb);
+		interp_set_config(interp, 0, &c);
+		interp->ctrl[1] = 0;
+		interp->base[0] = 1;
+	}
 	interp->accum[0] = x0;
-	interp->base[0] = 1;
-	interp->ctrl[1] = 0;
 	interp->base[2] = (uintptr_t)row;
 }
 
-void __ram_func(tile16)(uint16_t *scanbuf, const tilebg_t *bg, uint raster_y, uint raster_w) {
+// Common setup for the span functions: point interp1 at the tilemap row, and
+// return the tileset pointer offset by intra-tile y (in pixels, not bytes) and
+// the start/end points in tile space.
+static inline __attribute__((always_inline)) uint tile_span_setup(const tilebg_t *bg, uint raster_y,
+		uint x0, uint x1, uint *tx0, uint *tx1) {
 	uint size_x_mask = (1u << bg->log_size_x) - 1;
 	uint size_y_mask = (1u << bg->log_size_y) - 1;
 	// Find render start/end point in tile space
 	// Note tx1 may be "past the end" -- that's fine, it's just used for limits
-	uint tx0 = bg->xscroll & size_x_mask;
-	uint tx1 = tx0 + raster_w;
+	*tx0 = (tile_xscroll(bg, raster_y) & size_x_mask) + x0;
+	*tx1 = *tx0 + (x1 - x0);
 	uint ty = (bg->yscroll + raster_y) & size_y_mask;
 
 	const uint8_t *tilemap_row_ty = bg->tilemap + (ty >> tile_log_size(bg->tilesize)
 		<< (bg->log_size_x - tile_log_size(bg->tilesize)));
-	uint tile_x_at_tx0 = tx0 >> tile_log_size(bg->tilesize);
+	uint tile_x_at_tx0 = *tx0 >> tile_log_size(bg->tilesize);
 	uint tile_x_msb = bg->log_size_x - tile_log_size(bg->tilesize) - 1;
 
-	// NOTE this clobbers interp1, currently this will cause issues if you try
-	// to run tile code and certain TMDS encode loops on the same core. Could
-	// be fixed by save/restore, at the cost of some performance.
+	// NOTE this clobbers interp1. Running tile code and the TMDS encode loops
+	// on the same core is fine, as the encoders either save/restore, or (with
+	// TMDS_INTERP_OWNERSHIP) claim the interpolators so we know to reconfigure.
 	setup_interp_tilemap_ptrs(interp1_hw, tilemap_row_ty, tile_x_at_tx0, tile_x_msb);
 
 	// Apply intra-tile y offset in advance, since this will be the same for
 	// all pixels of all tiles we render in this call.
 	uint tilesize = 1u << tile_log_size(bg->tilesize);
-	const uint16_t *tileset_y_offs = (const uint16_t*)bg->tileset +
-		(ty & (tilesize - 1)) * tilesize;
+	return (ty & (tilesize - 1)) * tilesize;
+}
 
+void __ram_func(tile16_span)(uint16_t *scanbuf, const tilebg_t *bg, uint raster_y, uint x0, uint x1) {
+	uint tx0, tx1;
+	uint tileset_y_offs = tile_span_setup(bg, raster_y, x0, x1, &tx0, &tx1);
 	tile16_loop_t loop = (tile16_loop_t)bg->fill_loop;
-	loop(scanbuf, tileset_y_offs, tx0, tx1);
+	loop(scanbuf + x0, (const uint16_t*)bg->tileset + tileset_y_offs, tx0, tx1);
+}
+
+void __ram_func(tile16)(uint16_t *scanbuf, const tilebg_t *bg, uint raster_y, uint raster_w) {
+	tile16_span(scanbuf, bg, raster_y, 0, raster_w);
+}
+
+void __ram_func(tile8_span)(uint8_t *scanbuf, const tilebg_t *bg, uint raster_y, uint x0, uint x1) {
+	uint tx0, tx1;
+	uint tileset_y_offs = tile_span_setup(bg, raster_y, x0, x1, &tx0, &tx1);
+	tile8_loop_t loop = (tile8_loop_t)bg->fill_loop;
+	loop(scanbuf + x0, (const uint8_t*)bg->tileset + tileset_y_offs, tx0, tx1);
+}
+
+void __ram_func(tile8)(uint8_t *scanbuf, const tilebg_t *bg, uint raster_y, uint raster_w) {
+	tile8_span(scanbuf, bg, raster_y, 0, raster_w);
+}
+
+void tile_layers_sort(const tilebg_t **layers, uint n) {
+	// Only a handful of layers, so insertion sort is fine
+	for (uint i = 1; i < n; ++i) {
+		const tilebg_t *l = layers[i];
+		uint j = i;
+		for (; j > 0 && layers[j - 1]->priority > l->priority; --j)
+			layers[j] = layers[j - 1];
+		layers[j] = l;
+	}
+}
+
+void __ram_func(tile16_layers)(uint16_t *scanbuf, const tilebg_t *const *layers, uint n, uint min_priority,
+		uint max_priority, uint raster_y, uint raster_w, uint32_t *layer_cycles) {
+	for (uint i = 0; i < n; ++i) {
+		const tilebg_t *l = layers[i];
+		bool skip = l->priority < min_priority || l->priority > max_priority;
+		if (layer_cycles) {
+			uint32_t t0 = systick_cycle_count_now();
+			if (!skip)
+				tile16(scanbuf, l, raster_y, raster_w);
+			layer_cycles[i] = skip ? 0 : systick_cycles_since(t0);
+		}
+		else if (!skip) {
+			tile16(scanbuf, l, raster_y, raster_w);
+		}
+	}
+}
+
+void __ram_func(tile8_layers)(uint8_t *scanbuf, const tilebg_t *const *layers, uint n, uint min_priority,
+		uint max_priority, uint raster_y, uint raster_w, uint32_t *layer_cycles) {
+	for (uint i = 0; i < n; ++i) {
+		const tilebg_t *l = layers[i];
+		bool skip = l->priority < min_priority || l->priority > max_priority;
+		if (layer_cycles) {
+			uint32_t t0 = systick_cycle_count_now();
+			if (!skip)
+				tile8(scanbuf, l, raster_y, raster_w);
+			layer_cycles[i] = skip ? 0 : systick_cycles_since(t0);
+		}
+		else if (!skip) {
+			tile8(scanbuf, l, raster_y, raster_w);
+		}
+	}
 }
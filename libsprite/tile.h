@@ -21,17 +21,28 @@ typedef void (*tile_loop_t)(void *dst, const void *tileset, uint x0, uint x1);
 // Instead, the creator of the tilebg object explicitly adds references to
 // the appropriate fill routine symbols when configuring the tilebgs.
 
+// For parallax effects, xscroll_line may point to a table of per-scanline x
+// offsets (indexed by raster y, added to xscroll), or be NULL. Layers are
+// composited in order of increasing priority, so higher priorities are
+// further forward; use the alpha fill loops for all but the rearmost layer.
+
 typedef struct tilebg {
 	uint16_t xscroll;
 	uint16_t yscroll;
 	const void *tileset;
 	const uint8_t *tilemap;
+	const int16_t *xscroll_line;
 	uint8_t log_size_x;
 	uint8_t log_size_y;
+	uint8_t priority;
 	tilesize_t tilesize;
 	tile_loop_t fill_loop;
 } tilebg_t;
 
+static inline uint tile_xscroll(const tilebg_t *bg, uint raster_y) {
+	return bg->xscroll_line ? bg->xscroll + bg->xscroll_line[raster_y] : bg->xscroll;
+}
+
 // ----------------------------------------------------------------------------
 // Functions from tile.S
 
@@ -41,12 +52,42 @@ typedef void (*tile8_loop_t)(uint8_t *dst, const uint8_t *tileset, uint x0, uint
 
 void tile16_16px_alpha_loop(uint16_t *dst, const uint16_t *tileset, uint x0, uint x1);
 void tile16_16px_loop(uint16_t *dst, const uint16_t *tileset, uint x0, uint x1);
+void tile16_8px_alpha_loop(uint16_t *dst, const uint16_t *tileset, uint x0, uint x1);
+void tile16_8px_loop(uint16_t *dst, const uint16_t *tileset, uint x0, uint x1);
+
+void tile8_16px_alpha_loop(uint8_t *dst, const uint8_t *tileset, uint x0, uint x1);
+void tile8_16px_loop(uint8_t *dst, const uint8_t *tileset, uint x0, uint x1);
+void tile8_8px_alpha_loop(uint8_t *dst, const uint8_t *tileset, uint x0, uint x1);
+void tile8_8px_loop(uint8_t *dst, const uint8_t *tileset, uint x0, uint x1);
 
 // ----------------------------------------------------------------------------
 // Functions from tile.c
 
 void tile16(uint16_t *scanbuf, const tilebg_t *bg, uint raster_y, uint raster_w);
 
+// Render only screen x in [x0, x1). The fill loops copy pixels up to the first
+// tile boundary without checking x1, so x0 must either be on a tile boundary
+// (in tile space, i.e. after applying xscroll) or be 0 with x1 past the first
+// boundary. x1 can be anywhere.
+void tile16_span(uint16_t *scanbuf, const tilebg_t *bg, uint raster_y, uint x0, uint x1);
 
+void tile8(uint8_t *scanbuf, const tilebg_t *bg, uint raster_y, uint raster_w);
+void tile8_span(uint8_t *scanbuf, const tilebg_t *bg, uint raster_y, uint x0, uint x1);
+
+// Stable sort of a layer list by increasing priority. Call whenever
+// priorities change, rather than every scanline.
+void tile_layers_sort(const tilebg_t **layers, uint n);
+
+// Composite the layers of a sorted list whose priority is in [min_priority,
+// max_priority], back to front. Calling this more than once per scanline
+// with disjoint priority ranges lets sprites be drawn in between layers.
+//
+// If layer_cycles is non-NULL, layer_cycles[i] is set to the SysTick cycle
+// count of layers[i] (0 if skipped). SysTick must already be running from
+// clk_sys with a full reload, e.g. from systick_cycle_counter_init().
+void tile16_layers(uint16_t *scanbuf, const tilebg_t *const *layers, uint n, uint min_priority,
+	uint max_priority, uint raster_y, uint raster_w, uint32_t *layer_cycles);
+void tile8_layers(uint8_t *scanbuf, const tilebg_t *const *layers, uint n, uint min_priority,
+	uint max_priority, uint raster_y, uint raster_w, uint32_t *layer_cycles);
 
 #endif
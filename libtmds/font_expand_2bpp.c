@@ -0,0 +1,46 @@
+#include "pico.h"
+#include "font_expand_2bpp.h"
+
+// Index is {bg[1:0], fg[1:0], 4 font pixels}, entry is those 4 pixels as 2bpp
+// levels. Same index layout as the top bits of the TMDS LUT in
+// tmds_encode_font_2bpp.S.
+static uint8_t font_expand_lut[256];
+
+void font_expand_2bpp_init(void) {
+	for (uint i = 0; i < 256; ++i) {
+		uint fg = (i >> 4) & 0x3;
+		uint bg = (i >> 6) & 0x3;
+		uint8_t levels = 0;
+		for (uint x = 0; x < 4; ++x)
+			levels |= (i & (1u << x) ? fg : bg) << (2 * x);
+		font_expand_lut[i] = levels;
+	}
+}
+
+static inline uint16_t font_expand_char(uint32_t colour, uint font) {
+	const uint8_t *lut = font_expand_lut + ((colour & 0xf) << 4);
+	return lut[font & 0xf] | lut[font >> 4] << 8;
+}
+
+void __not_in_flash_func(font_expand_2bpp)(const uint8_t *charbuf, const uint32_t *colourbuf,
+		uint colour_plane_stride, uint32_t *levelbuf, uint n_pix, const uint8_t *font_line) {
+	uint n_chars = n_pix / 8;
+	uint16_t *out0 = (uint16_t*)levelbuf;
+	uint16_t *out1 = out0 + n_chars;
+	uint16_t *out2 = out1 + n_chars;
+	for (uint i = 0; i < n_chars; i += 8) {
+		uint32_t c0 = colourbuf[0];
+		uint32_t c1 = colourbuf[colour_plane_stride];
+		uint32_t c2 = colourbuf[2 * colour_plane_stride];
+		++colourbuf;
+		for (uint j = 0; j < 8; ++j) {
+			uint font = font_line[*charbuf++];
+			*out0++ = font_expand_char(c0, font);
+			*out1++ = font_expand_char(c1, font);
+			*out2++ = font_expand_char(c2, font);
+			c0 >>= 4;
+			c1 >>= 4;
+			c2 >>= 4;
+		}
+	}
+}
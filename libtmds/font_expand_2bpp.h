@@ -0,0 +1,29 @@
+#ifndef _FONT_EXPAND_2BPP_H
+#define _FONT_EXPAND_2BPP_H
+
+#include "pico/types.h"
+
+// Front half of the PIO text path: expand font bits and per-character 2bpp
+// foreground/background colours into a plain 2bpp level stream for each of
+// the R, G, B planes, which tmds_encode_2bpp_pio_init() encoders turn into
+// TMDS symbols. Same inputs as tmds_encode_font_2bpp(), and the output
+// symbols are identical, but the CPU only writes 2 bits per pixel per plane
+// instead of 10, and reads the character and font bits once for all three
+// planes.
+//
+// colourbuf: colour pairs for plane 0, in the same format as for
+// tmds_encode_font_2bpp(). Planes 1 and 2 follow at colour_plane_stride words
+// apart.
+//
+// levelbuf: output, n_pix / 16 words per plane, planes consecutive. Pixels
+// are least-significant first.
+//
+// n_pix must be a multiple of 64.
+
+// Build the 256-byte LUT. Call once before using font_expand_2bpp().
+void font_expand_2bpp_init(void);
+
+void font_expand_2bpp(const uint8_t *charbuf, const uint32_t *colourbuf,
+	uint colour_plane_stride, uint32_t *levelbuf, uint n_pix, const uint8_t *font_line);
+
+#endif
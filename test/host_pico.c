@@ -0,0 +1,26 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pico.h"
+#include "hardware/interp.h"
+#include "hardware/structs/systick.h"
+
+// Storage behind the pico-sdk shims in test/include
+
+uint host_core_num;
+interp_hw_t host_interp_hw[NUM_CORES][2];
+uint host_interp_saves;
+uint host_interp_restores;
+uint host_interp_configs;
+systick_hw_t host_systick_hw;
+
+void panic(const char *fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	fputs("panic: ", stderr);
+	vfprintf(stderr, fmt, args);
+	fputc('\n', stderr);
+	va_end(args);
+	abort();
+}
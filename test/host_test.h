@@ -0,0 +1,41 @@
+#ifndef _HOST_TEST_H
+#define _HOST_TEST_H
+
+// Minimal checks for the host tests: count failures, keep going, and return
+// the result from main() with test_result().
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int test_failures;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+		++test_failures; \
+	} \
+} while (0)
+
+// Small deterministic PRNG, so failures reproduce across hosts
+static uint32_t test_rand_state = 1;
+
+static inline uint32_t test_rand(void) {
+	test_rand_state ^= test_rand_state << 13;
+	test_rand_state ^= test_rand_state >> 17;
+	test_rand_state ^= test_rand_state << 5;
+	return test_rand_state;
+}
+
+static inline int test_rand_range(int lo, int hi) {
+	return lo + (int)(test_rand() % (uint32_t)(hi - lo + 1));
+}
+
+static inline int test_result(const char *name) {
+	if (test_failures)
+		printf("%s: %d check(s) failed\n", name, test_failures);
+	else
+		printf("%s: ok\n", name);
+	return test_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef _HARDWARE_INTERP_H
+#define _HARDWARE_INTERP_H
+
+// Software model of the RP2040 interpolators, with the pico-sdk API. The
+// registers the libraries write directly (accum, base, ctrl) are plain
+// storage; results are computed when read through interp_peek_*() and
+// interp_pop_*(). BLEND and CLAMP modes are not modelled.
+//
+// The bases are pointer-sized, so a pointer written to BASE2 survives into
+// the full result, and the host stand-ins for the asm loops can dereference
+// it. Lane results are still 32 bits.
+
+#include "pico.h"
+#include "hardware/regs/sio.h"
+
+typedef struct {
+	uint32_t accum[2];
+	uintptr_t base[3];
+	uint32_t ctrl[2];
+} interp_hw_t;
+
+// One pair per core, selected with host_core_num
+extern interp_hw_t host_interp_hw[NUM_CORES][2];
+
+#define interp0_hw (&host_interp_hw[get_core_num()][0])
+#define interp1_hw (&host_interp_hw[get_core_num()][1])
+#define interp0 interp0_hw
+#define interp1 interp1_hw
+
+// Calls to interp_save(), interp_restore() and interp_set_config(), for
+// tests which count interpolator setup work
+extern uint host_interp_saves;
+extern uint host_interp_restores;
+extern uint host_interp_configs;
+
+typedef struct {
+	uint32_t ctrl;
+} interp_config;
+
+typedef struct {
+	uint32_t accum[2];
+	uintptr_t base[3];
+	uint32_t ctrl[2];
+} interp_hw_save_t;
+
+static inline uint interp_index(interp_hw_t *interp) {
+	assert(interp == interp0_hw || interp == interp1_hw);
+	return interp == interp1_hw;
+}
+
+static inline interp_config interp_default_config(void) {
+	interp_config c = {0};
+	c.ctrl = 31u << SIO_INTERP0_CTRL_LANE0_MASK_MSB_LSB;
+	return c;
+}
+
+static inline void interp_config_set_shift(interp_config *c, uint shift) {
+	c->ctrl = (c->ctrl & ~SIO_INTERP0_CTRL_LANE0_SHIFT_BITS) | (shift << SIO_INTERP0_CTRL_LANE0_SHIFT_LSB);
+}
+
+static inline void interp_config_set_mask(interp_config *c, uint mask_lsb, uint mask_msb) {
+	c->ctrl = (c->ctrl & ~(SIO_INTERP0_CTRL_LANE0_MASK_LSB_BITS | SIO_INTERP0_CTRL_LANE0_MASK_MSB_BITS)) |
+		(mask_lsb << SIO_INTERP0_CTRL_LANE0_MASK_LSB_LSB) |
+		(mask_msb << SIO_INTERP0_CTRL_LANE0_MASK_MSB_LSB);
+}
+
+static inline void _interp_config_set_bit(interp_config *c, uint32_t bit, bool on) {
+	c->ctrl = on ? c->ctrl | bit : c->ctrl & ~bit;
+}
+
+static inline void interp_config_set_cross_input(interp_config *c, bool cross_input) {
+	_interp_config_set_bit(c, SIO_INTERP0_CTRL_LANE0_CROSS_INPUT_BITS, cross_input);
+}
+
+static inline void interp_config_set_cross_result(interp_config *c, bool cross_result) {
+	_interp_config_set_bit(c, SIO_INTERP0_CTRL_LANE0_CROSS_RESULT_BITS, cross_result);
+}
+
+static inline void interp_config_set_signed(interp_config *c, bool _signed) {
+	_interp_config_set_bit(c, SIO_INTERP0_CTRL_LANE0_SIGNED_BITS, _signed);
+}
+
+static inline void interp_config_set_add_raw(interp_config *c, bool add_raw) {
+	_interp_config_set_bit(c, SIO_INTERP0_CTRL_LANE0_ADD_RAW_BITS, add_raw);
+}
+
+static inline void interp_config_set_force_bits(interp_config *c, uint bits) {
+	c->ctrl = (c->ctrl & ~SIO_INTERP0_CTRL_LANE0_FORCE_MSB_BITS) | (bits << SIO_INTERP0_CTRL_LANE0_FORCE_MSB_LSB);
+}
+
+static inline void interp_set_config(interp_hw_t *interp, uint lane, interp_config *config) {
+	++host_interp_configs;
+	interp->ctrl[lane] = config->ctrl;
+}
+
+static inline void interp_save(interp_hw_t *interp, interp_hw_save_t *saver) {
+	++host_interp_saves;
+	for (int i = 0; i < 2; ++i) {
+		saver->accum[i] = interp->accum[i];
+		saver->ctrl[i] = interp->ctrl[i];
+	}
+	for (int i = 0; i < 3; ++i)
+		saver->base[i] = interp->base[i];
+}
+
+static inline void interp_restore(interp_hw_t *interp, interp_hw_save_t *saver) {
+	++host_interp_restores;
+	for (int i = 0; i < 2; ++i) {
+		interp->accum[i] = saver->accum[i];
+		interp->ctrl[i] = saver->ctrl[i];
+	}
+	for (int i = 0; i < 3; ++i)
+		interp->base[i] = saver->base[i];
+}
+
+static inline void interp_set_accumulator(interp_hw_t *interp, uint lane, uint32_t val) {
+	interp->accum[lane] = val;
+}
+
+static inline uint32_t interp_get_accumulator(interp_hw_t *interp, uint lane) {
+	return interp->accum[lane];
+}
+
+static inline void interp_add_accumulater(interp_hw_t *interp, uint lane, uint32_t val) {
+	interp->accum[lane] += val;
+}
+
+static inline void interp_set_base(interp_hw_t *interp, uint lane, uint32_t val) {
+	interp->base[lane] = val;
+}
+
+// Shift-and-mask stage of one lane, sign-extended if the lane is signed
+static inline uint32_t _interp_lane_masked(const interp_hw_t *interp, uint lane) {
+	uint32_t ctrl = interp->ctrl[lane];
+	bool cross = ctrl & SIO_INTERP0_CTRL_LANE0_CROSS_INPUT_BITS;
+	uint32_t in = interp->accum[cross ? !lane : lane];
+	uint shift = (ctrl & SIO_INTERP0_CTRL_LANE0_SHIFT_BITS) >> SIO_INTERP0_CTRL_LANE0_SHIFT_LSB;
+	uint lsb = (ctrl & SIO_INTERP0_CTRL_LANE0_MASK_LSB_BITS) >> SIO_INTERP0_CTRL_LANE0_MASK_LSB_LSB;
+	uint msb = (ctrl & SIO_INTERP0_CTRL_LANE0_MASK_MSB_BITS) >> SIO_INTERP0_CTRL_LANE0_MASK_MSB_LSB;
+	uint32_t mask = (msb == 31 ? ~0u : (2u << msb) - 1) & ~((1u << lsb) - 1);
+	uint32_t v = (in >> shift) & mask;
+	if ((ctrl & SIO_INTERP0_CTRL_LANE0_SIGNED_BITS) && msb < 31 && (v >> msb & 1))
+		v |= ~0u << msb;
+	return v;
+}
+
+// CTRL_LANE0 OVERF: set while either accumulator has bits set above its
+// lane's mask, after the shift. Reads of ctrl[0] don't include it, so the
+// host stand-ins for loops which test it call this instead.
+static inline bool host_interp_overf(const interp_hw_t *interp) {
+	for (uint lane = 0; lane < 2; ++lane) {
+		uint32_t ctrl = interp->ctrl[lane];
+		uint shift = (ctrl & SIO_INTERP0_CTRL_LANE0_SHIFT_BITS) >> SIO_INTERP0_CTRL_LANE0_SHIFT_LSB;
+		uint msb = (ctrl & SIO_INTERP0_CTRL_LANE0_MASK_MSB_BITS) >> SIO_INTERP0_CTRL_LANE0_MASK_MSB_LSB;
+		if (msb < 31 && (interp->accum[lane] >> shift) >> (msb + 1))
+			return true;
+	}
+	return false;
+}
+
+static inline uint32_t _interp_lane_result(const interp_hw_t *interp, uint lane) {
+	uint32_t ctrl = interp->ctrl[lane];
+	bool cross = ctrl & SIO_INTERP0_CTRL_LANE0_CROSS_INPUT_BITS;
+	uint32_t add = ctrl & SIO_INTERP0_CTRL_LANE0_ADD_RAW_BITS ?
+		interp->accum[cross ? !lane : lane] : _interp_lane_masked(interp, lane);
+	uint32_t force = (ctrl & SIO_INTERP0_CTRL_LANE0_FORCE_MSB_BITS) >> SIO_INTERP0_CTRL_LANE0_FORCE_MSB_LSB;
+	return (uint32_t)(interp->base[lane] + add) | force << 28;
+}
+
+static inline uint32_t interp_peek_lane_result(interp_hw_t *interp, uint lane) {
+	return _interp_lane_result(interp, lane);
+}
+
+// The lane sum wraps at 32 bits as on the RP2040, and is then treated as a
+// signed offset from BASE2
+static inline uintptr_t interp_peek_full_result(interp_hw_t *interp) {
+	return interp->base[2] + (intptr_t)(int32_t)(_interp_lane_masked(interp, 0) + _interp_lane_masked(interp, 1));
+}
+
+// A pop writes each lane's result back to its accumulator (or to the other
+// lane's, with CROSS_RESULT)
+static inline void _interp_writeback(interp_hw_t *interp) {
+	uint32_t r[2] = {_interp_lane_result(interp, 0), _interp_lane_result(interp, 1)};
+	for (int lane = 0; lane < 2; ++lane) {
+		bool cross = interp->ctrl[lane] & SIO_INTERP0_CTRL_LANE0_CROSS_RESULT_BITS;
+		interp->accum[lane] = r[cross ? !lane : lane];
+	}
+}
+
+static inline uint32_t interp_pop_lane_result(interp_hw_t *interp, uint lane) {
+	uint32_t r = _interp_lane_result(interp, lane);
+	_interp_writeback(interp);
+	return r;
+}
+
+static inline uintptr_t interp_pop_full_result(interp_hw_t *interp) {
+	uintptr_t r = interp_peek_full_result(interp);
+	_interp_writeback(interp);
+	return r;
+}
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef _HARDWARE_PLATFORM_DEFS_H
+#define _HARDWARE_PLATFORM_DEFS_H
+
+// Included from asm as well as C, so keep to #defines.
+
+#define NUM_CORES 2u
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef _HARDWARE_REGS_ADDRESSMAP_H
+#define _HARDWARE_REGS_ADDRESSMAP_H
+
+// RP2040 address map, as used by the asm under test. thumb_emu.py places
+// the interpolators at the same SIO offsets.
+
+#define XIP_BASE  0x10000000
+#define SRAM_BASE 0x20000000
+#define SIO_BASE  0xd0000000
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef _HARDWARE_REGS_SIO_H
+#define _HARDWARE_REGS_SIO_H
+
+// Interpolator register offsets and CTRL fields, matching the RP2040
+// datasheet (the subset the libraries use).
+
+#define SIO_INTERP0_ACCUM0_OFFSET      0x00000080
+#define SIO_INTERP0_ACCUM1_OFFSET      0x00000084
+#define SIO_INTERP0_BASE0_OFFSET       0x00000088
+#define SIO_INTERP0_BASE1_OFFSET       0x0000008c
+#define SIO_INTERP0_BASE2_OFFSET       0x00000090
+#define SIO_INTERP0_POP_LANE0_OFFSET   0x00000094
+#define SIO_INTERP0_POP_LANE1_OFFSET   0x00000098
+#define SIO_INTERP0_POP_FULL_OFFSET    0x0000009c
+#define SIO_INTERP0_PEEK_LANE0_OFFSET  0x000000a0
+#define SIO_INTERP0_PEEK_LANE1_OFFSET  0x000000a4
+#define SIO_INTERP0_PEEK_FULL_OFFSET   0x000000a8
+#define SIO_INTERP0_CTRL_LANE0_OFFSET  0x000000ac
+#define SIO_INTERP0_CTRL_LANE1_OFFSET  0x000000b0
+#define SIO_INTERP0_ACCUM0_ADD_OFFSET  0x000000b4
+#define SIO_INTERP0_ACCUM1_ADD_OFFSET  0x000000b8
+#define SIO_INTERP0_BASE_1AND0_OFFSET  0x000000bc
+#define SIO_INTERP1_ACCUM0_OFFSET      0x000000c0
+
+#define SIO_INTERP0_CTRL_LANE0_SHIFT_LSB        0
+#define SIO_INTERP0_CTRL_LANE0_SHIFT_BITS       0x0000001f
+#define SIO_INTERP0_CTRL_LANE0_MASK_LSB_LSB     5
+#define SIO_INTERP0_CTRL_LANE0_MASK_LSB_BITS    0x000003e0
+#define SIO_INTERP0_CTRL_LANE0_MASK_MSB_LSB     10
+#define SIO_INTERP0_CTRL_LANE0_MASK_MSB_BITS    0x00007c00
+#define SIO_INTERP0_CTRL_LANE0_SIGNED_BITS      0x00008000
+#define SIO_INTERP0_CTRL_LANE0_CROSS_INPUT_BITS 0x00010000
+#define SIO_INTERP0_CTRL_LANE0_CROSS_RESULT_BITS 0x00020000
+#define SIO_INTERP0_CTRL_LANE0_ADD_RAW_BITS     0x00040000
+#define SIO_INTERP0_CTRL_LANE0_FORCE_MSB_LSB    19
+#define SIO_INTERP0_CTRL_LANE0_FORCE_MSB_BITS   0x00180000
+#define SIO_INTERP0_CTRL_LANE0_BLEND_BITS       0x00200000
+#define SIO_INTERP0_CTRL_LANE0_OVERF0_BITS      0x00800000
+#define SIO_INTERP0_CTRL_LANE0_OVERF1_BITS      0x01000000
+#define SIO_INTERP0_CTRL_LANE0_OVERF_LSB        25
+#define SIO_INTERP0_CTRL_LANE0_OVERF_BITS       0x02000000
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef _HARDWARE_STRUCTS_SYSTICK_H
+#define _HARDWARE_STRUCTS_SYSTICK_H
+
+#include "pico.h"
+
+#define M0PLUS_SYST_CSR_ENABLE_BITS    0x00000001
+#define M0PLUS_SYST_CSR_CLKSOURCE_BITS 0x00000004
+#define M0PLUS_SYST_RVR_BITS           0x00ffffff
+
+typedef struct {
+	volatile uint32_t csr;
+	volatile uint32_t rvr;
+	volatile uint32_t cvr;
+	volatile uint32_t calib;
+} systick_hw_t;
+
+// Nothing decrements this: code timed with SysTick on the host reads zero
+// elapsed cycles. Cycle counts come from thumb_emu.py instead.
+extern systick_hw_t host_systick_hw;
+#define systick_hw (&host_systick_hw)
+
+#endif
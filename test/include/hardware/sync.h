@@ -0,0 +1,15 @@
+#ifndef _HARDWARE_SYNC_H
+#define _HARDWARE_SYNC_H
+
+#include "pico.h"
+
+// No interrupts on the host
+static inline uint32_t save_and_disable_interrupts(void) {
+	return 0;
+}
+
+static inline void restore_interrupts(uint32_t status) {
+	(void)status;
+}
+
+#endif
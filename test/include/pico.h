@@ -0,0 +1,12 @@
+#ifndef _PICO_H
+#define _PICO_H
+
+// Host stand-in for the pico-sdk umbrella header. Only what the libraries
+// under test use is provided; everything here builds with the native
+// compiler and runs on the development machine.
+
+#include "pico/types.h"
+#include "pico/config.h"
+#include "pico/platform.h"
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef _PICO_CONFIG_H
+#define _PICO_CONFIG_H
+
+// Included from asm as well as C, so keep to #defines.
+
+#ifndef PICO_NO_HARDWARE
+#define PICO_NO_HARDWARE 1
+#endif
+
+#endif
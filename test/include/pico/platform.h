@@ -0,0 +1,45 @@
+#ifndef _PICO_PLATFORM_H
+#define _PICO_PLATFORM_H
+
+#include "hardware/platform_defs.h"
+
+#ifndef __ASSEMBLER__
+#include <assert.h>
+#include <sched.h>
+#include "pico/types.h"
+
+// Placement attributes are meaningless on the host
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+#define __no_inline_not_in_flash_func(func_name) __attribute__((noinline)) func_name
+#define __time_critical_func(func_name) func_name
+#define __scratch_x(group)
+#define __scratch_y(group)
+#define __force_inline inline __attribute__((always_inline))
+
+#ifndef count_of
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+#endif
+#ifndef MIN
+#define MIN(a, b) ((b) < (a) ? (b) : (a))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#define __compiler_memory_barrier() __asm__ volatile ("" : : : "memory")
+#define __dmb() __sync_synchronize()
+// Spin loops yield, so tests with a thread per core don't starve each other
+#define tight_loop_contents() sched_yield()
+
+// Tests pretend to be either core by setting host_core_num.
+extern uint host_core_num;
+
+static inline uint get_core_num(void) {
+	return host_core_num;
+}
+
+void __attribute__((noreturn)) panic(const char *fmt, ...);
+#endif
+
+#endif
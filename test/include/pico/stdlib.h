@@ -0,0 +1,6 @@
+#ifndef _PICO_STDLIB_H
+#define _PICO_STDLIB_H
+
+#include "pico.h"
+
+#endif
@@ -0,0 +1,218 @@
+"""Assembler and single state machine simulator for the libraries' .pio
+programs, enough to check their output and count cycles on the host.
+
+Covers jmp, in, out, mov, set, push, pull and delays, autopush/autopull and
+the FIFOs. Pins, side-set, wait and irq are not modelled. The TX FIFO never
+runs dry mid-test (the test queues all input up front) and the RX FIFO is
+drained as it fills, so cycle counts are the program's own throughput.
+"""
+import re
+
+MASK = 0xffffffff
+
+
+def _strip(line):
+    return re.split(r';|//', line, 1)[0].strip()
+
+
+def assemble_pio(path, program):
+    """Parse .program <program> from a .pio file. Returns a dict with the
+    instruction list (as tuples), wrap_target and wrap."""
+    insns = []
+    labels = {}
+    wrap_target, wrap = 0, None
+    active = False
+    in_c_block = False
+    for raw in open(path):
+        if raw.startswith('%'):
+            in_c_block = '{' in raw
+            continue
+        if in_c_block:
+            if raw.startswith('%}'):
+                in_c_block = False
+            continue
+        line = _strip(raw)
+        if not line:
+            continue
+        if line.startswith('.program'):
+            active = line.split()[1] == program
+            continue
+        if not active:
+            continue
+        if line == '.wrap_target':
+            wrap_target = len(insns)
+            continue
+        if line == '.wrap':
+            wrap = len(insns) - 1
+            continue
+        if line.startswith('.'):
+            raise Exception('unsupported directive: ' + line)
+        m = re.match(r'(\w+):\s*(.*)', line)
+        if m:
+            labels[m.group(1)] = len(insns)
+            line = m.group(2)
+            if not line:
+                continue
+        delay = 0
+        m = re.match(r'(.*)\[(\d+)\]\s*$', line)
+        if m:
+            line, delay = m.group(1).strip(), int(m.group(2))
+        op, _, args = line.partition(' ')
+        args = [a.strip() for a in args.split(',')] if args else []
+        insns.append((op, args, delay))
+    if not insns:
+        raise Exception('program %s not found in %s' % (program, path))
+    resolved = []
+    for op, args, delay in insns:
+        if op == 'jmp':
+            parts = args[0].split()
+            cond, target = (None, parts[0]) if len(parts) == 1 else parts
+            resolved.append((op, [cond, labels[target] if target in labels else int(target, 0)], delay))
+        else:
+            resolved.append((op, args, delay))
+    return {'insns': resolved, 'wrap_target': wrap_target,
+            'wrap': len(resolved) - 1 if wrap is None else wrap}
+
+
+def _num(s):
+    return int(s, 0)
+
+
+class StateMachine:
+    def __init__(self, prog, out_shift_right=True, autopull=True, pull_thresh=32,
+                 in_shift_right=True, autopush=True, push_thresh=32):
+        self.prog = prog
+        self.pc = 0
+        self.x = self.y = 0
+        self.osr = 0
+        self.osr_count = 32  # empty
+        self.isr = 0
+        self.isr_count = 0
+        self.out_right, self.autopull, self.pull_thresh = out_shift_right, autopull, pull_thresh
+        self.in_right, self.autopush, self.push_thresh = in_shift_right, autopush, push_thresh
+        self.tx = []
+        self.rx = []
+        self.cycles = 0
+
+    def _src(self, name, invert=False, reverse=False):
+        v = {'x': self.x, 'y': self.y, 'null': 0, 'isr': self.isr, 'osr': self.osr}[name]
+        if invert:
+            v = ~v & MASK
+        if reverse:
+            v = int('{:032b}'.format(v)[::-1], 2)
+        return v
+
+    def _push(self):
+        self.rx.append(self.isr)
+        self.isr = 0
+        self.isr_count = 0
+
+    def _pull(self):
+        if not self.tx:
+            return False
+        self.osr = self.tx.pop(0)
+        self.osr_count = 0
+        return True
+
+    def step(self):
+        """Execute one instruction. Returns False if stalled on an empty TX FIFO."""
+        op, args, delay = self.prog['insns'][self.pc]
+        npc = self.pc + 1 if self.pc != self.prog['wrap'] else self.prog['wrap_target']
+        if op == 'out':
+            if self.autopull and self.osr_count >= self.pull_thresh and not self._pull():
+                return False
+            dst, n = args[0], _num(args[1])
+            n32 = n or 32
+            if self.out_right:
+                v = self.osr & ((1 << n32) - 1)
+                self.osr = self.osr >> n32 if n32 < 32 else 0
+            else:
+                v = self.osr >> (32 - n32)
+                self.osr = (self.osr << n32) & MASK
+            self.osr_count = min(32, self.osr_count + n32)
+            if dst == 'x':
+                self.x = v
+            elif dst == 'y':
+                self.y = v
+            elif dst == 'pc':
+                npc = v
+            elif dst == 'isr':
+                self.isr, self.isr_count = v, n32
+            elif dst != 'null':
+                raise Exception('unsupported out destination ' + dst)
+        elif op == 'in':
+            src, n = args[0], _num(args[1])
+            n32 = n or 32
+            v = self._src(src) & ((1 << n32) - 1)
+            if self.in_right:
+                self.isr = ((self.isr >> n32) | (v << (32 - n32))) & MASK if n32 < 32 else v
+            else:
+                self.isr = ((self.isr << n32) | v) & MASK if n32 < 32 else v
+            self.isr_count = min(32, self.isr_count + n32)
+            if self.autopush and self.isr_count >= self.push_thresh:
+                self._push()
+        elif op in ('mov', 'nop'):
+            if op == 'nop':
+                args = ['y', 'y']
+            dst, src = args
+            invert = src[0] in '~!'
+            src = src.lstrip('~!')
+            reverse = src.startswith('::')
+            v = self._src(src.lstrip(':'), invert, reverse)
+            if dst == 'x':
+                self.x = v
+            elif dst == 'y':
+                self.y = v
+            elif dst == 'isr':
+                self.isr, self.isr_count = v, 0
+            elif dst == 'osr':
+                self.osr, self.osr_count = v, 0
+            elif dst == 'pc':
+                npc = v
+            else:
+                raise Exception('unsupported mov destination ' + dst)
+        elif op == 'set':
+            dst, v = args[0], _num(args[1])
+            if dst == 'x':
+                self.x = v
+            elif dst == 'y':
+                self.y = v
+            else:
+                raise Exception('unsupported set destination ' + dst)
+        elif op == 'jmp':
+            cond, target = args
+            take = {
+                None: True,
+                '!x': self.x == 0, '!y': self.y == 0,
+                'x!=y': self.x != self.y,
+                '!osre': self.osr_count < self.pull_thresh,
+            }.get(cond)
+            if cond == 'x--':
+                take = self.x != 0
+                self.x = (self.x - 1) & MASK
+            elif cond == 'y--':
+                take = self.y != 0
+                self.y = (self.y - 1) & MASK
+            elif take is None:
+                raise Exception('unsupported jmp condition %s' % cond)
+            if take:
+                npc = target
+        elif op == 'push':
+            self._push()
+        elif op == 'pull':
+            if not self._pull():
+                return False
+        else:
+            raise Exception('unsupported instruction ' + op)
+        self.pc = npc
+        self.cycles += 1 + delay
+        return True
+
+    def run(self, words):
+        """Feed words into the TX FIFO and run until the SM stalls for lack of
+        input. Returns the RX words produced."""
+        self.tx += words
+        while self.step():
+            pass
+        out, self.rx = self.rx, []
+        return out
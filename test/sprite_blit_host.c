@@ -0,0 +1,110 @@
+#include <string.h>
+
+#include "pico.h"
+#include "hardware/interp.h"
+#include "sprite.h"
+
+// Portable C versions of the sprite.S span functions, so sprite.c and the
+// code built on it (bins, culling, collision, atlas) run on a host. Output is
+// the same as the asm; the asm itself is checked in the thumb_emu.py tests.
+//
+// The affine loops take their addresses from the host model of INTERP0, as
+// the asm does from the real one.
+
+// Alpha is bit 5 in both formats (see sprite_asm_const.h, which is asm-only)
+#define SPRITE_HOST_ALPHA_MASK (1u << 5)
+
+void sprite_fill8(uint8_t *dst, uint8_t colour, uint len) {
+	memset(dst, colour, len);
+}
+
+void sprite_fill16(uint16_t *dst, uint16_t colour, uint len) {
+	for (uint i = 0; i < len; ++i)
+		dst[i] = colour;
+}
+
+void sprite_blit8(uint8_t *dst, const uint8_t *src, uint len) {
+	memcpy(dst, src, len);
+}
+
+void sprite_blit8_alpha(uint8_t *dst, const uint8_t *src, uint len) {
+	for (uint i = 0; i < len; ++i)
+		if (src[i] & SPRITE_HOST_ALPHA_MASK)
+			dst[i] = src[i];
+}
+
+void sprite_blit16(uint16_t *dst, const uint16_t *src, uint len) {
+	memcpy(dst, src, len * sizeof(uint16_t));
+}
+
+void sprite_blit16_alpha(uint16_t *dst, const uint16_t *src, uint len) {
+	for (uint i = 0; i < len; ++i)
+		if (src[i] & SPRITE_HOST_ALPHA_MASK)
+			dst[i] = src[i];
+}
+
+void sprite_blit8_alpha_swar(uint8_t *dst, const uint8_t *src, uint len) {
+	sprite_blit8_alpha(dst, src, len);
+}
+
+void sprite_blit16_alpha_swar(uint16_t *dst, const uint16_t *src, uint len) {
+	sprite_blit16_alpha(dst, src, len);
+}
+
+void sprite_blit8_hflip(uint8_t *dst, const uint8_t *src, uint len) {
+	for (uint i = 0; i < len; ++i)
+		dst[i] = src[len - 1 - i];
+}
+
+void sprite_blit8_alpha_hflip(uint8_t *dst, const uint8_t *src, uint len) {
+	for (uint i = 0; i < len; ++i)
+		if (src[len - 1 - i] & SPRITE_HOST_ALPHA_MASK)
+			dst[i] = src[len - 1 - i];
+}
+
+void sprite_blit16_hflip(uint16_t *dst, const uint16_t *src, uint len) {
+	for (uint i = 0; i < len; ++i)
+		dst[i] = src[len - 1 - i];
+}
+
+void sprite_blit16_alpha_hflip(uint16_t *dst, const uint16_t *src, uint len) {
+	for (uint i = 0; i < len; ++i)
+		if (src[len - 1 - i] & SPRITE_HOST_ALPHA_MASK)
+			dst[i] = src[len - 1 - i];
+}
+
+// Called with each affine loop's arguments before it runs, if set, so a test
+// can capture the INTERP0 state sprite.c left for it
+void (*sprite_host_ablit_hook)(void *dst, uint len, uint pixel_bytes, bool alpha);
+
+// As the asm: pop a texel address per pixel, from the end of the span
+// backward, and skip the pixel if OVERF was set before the pop (the sample is
+// outside the texture)
+static void sprite_host_ablit(uint8_t *dst, uint len, uint pixel_bytes, bool alpha) {
+	if (sprite_host_ablit_hook)
+		sprite_host_ablit_hook(dst, len, pixel_bytes, alpha);
+	interp_hw_t *interp = interp0_hw;
+	for (uint i = len; i-- > 0;) {
+		bool overf = host_interp_overf(interp);
+		const uint8_t *src = (const uint8_t*)interp_pop_full_result(interp);
+		if (overf || (alpha && !(src[0] & SPRITE_HOST_ALPHA_MASK)))
+			continue;
+		memcpy(dst + i * pixel_bytes, src, pixel_bytes);
+	}
+}
+
+void sprite_ablit8_loop(uint8_t *dst, uint len) {
+	sprite_host_ablit(dst, len, 1, false);
+}
+
+void sprite_ablit8_alpha_loop(uint8_t *dst, uint len) {
+	sprite_host_ablit(dst, len, 1, true);
+}
+
+void sprite_ablit16_loop(uint16_t *dst, uint len) {
+	sprite_host_ablit((uint8_t*)dst, len, 2, false);
+}
+
+void sprite_ablit16_alpha_loop(uint16_t *dst, uint len) {
+	sprite_host_ablit((uint8_t*)dst, len, 2, true);
+}
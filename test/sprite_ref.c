@@ -0,0 +1,143 @@
+#include <string.h>
+
+#include "sprite_ref.h"
+
+// Alpha is bit 5 in both formats (see sprite_asm_const.h, which is asm-only)
+#define SPRITE_REF_ALPHA_MASK (1u << 5)
+
+// Reference versions of the sprite functions, a pixel at a time. The
+// non-affine ones honour both flips and the opacity metadata (which only
+// limits the span drawn, and whether alpha is checked).
+
+static inline bool sprite_ref_row(const sprite_t *sp, uint raster_y, uint pixel_bytes, int *tex_y, int *x0,
+		int *x1, bool *solid) {
+	int size = 1u << sp->log_size;
+	int y = (int)raster_y - sp->y;
+	if (y < 0 || y >= size)
+		return false;
+	*tex_y = sp->vflip ? size - 1 - y : y;
+	*x0 = 0;
+	*x1 = size;
+	*solid = false;
+	if (sp->has_opacity_metadata) {
+		uint32_t meta = ((const uint32_t*)((const uint8_t*)sp->img + size * size * pixel_bytes))[*tex_y];
+		int start = (meta >> 16) & 0x7fff;
+		int end = meta & 0xffff;
+		*x0 = sp->hflip ? size - end : start;
+		*x1 = sp->hflip ? size - start : end;
+		*solid = !!(meta & (1u << 31));
+	}
+	return true;
+}
+
+void sprite_sprite8_ref(uint8_t *scanbuf, const sprite_t *sp, uint raster_y, uint raster_w) {
+	int size = 1u << sp->log_size;
+	int tex_y, x0, x1;
+	bool solid;
+	if (!sprite_ref_row(sp, raster_y, sizeof(uint8_t), &tex_y, &x0, &x1, &solid))
+		return;
+	for (int x = x0; x < x1; ++x) {
+		if (sp->x + x < 0 || sp->x + x >= (int)raster_w)
+			continue;
+		uint8_t pix = ((const uint8_t*)sp->img)[tex_y * size + (sp->hflip ? size - 1 - x : x)];
+		if (solid || (pix & SPRITE_REF_ALPHA_MASK))
+			scanbuf[sp->x + x] = pix;
+	}
+}
+
+void sprite_sprite16_ref(uint16_t *scanbuf, const sprite_t *sp, uint raster_y, uint raster_w) {
+	int size = 1u << sp->log_size;
+	int tex_y, x0, x1;
+	bool solid;
+	if (!sprite_ref_row(sp, raster_y, sizeof(uint16_t), &tex_y, &x0, &x1, &solid))
+		return;
+	for (int x = x0; x < x1; ++x) {
+		if (sp->x + x < 0 || sp->x + x >= (int)raster_w)
+			continue;
+		uint16_t pix = ((const uint16_t*)sp->img)[tex_y * size + (sp->hflip ? size - 1 - x : x)];
+		if (solid || (pix & SPRITE_REF_ALPHA_MASK))
+			scanbuf[sp->x + x] = pix;
+	}
+}
+
+// Reference versions of the affine sprite functions, computing each texture
+// coordinate from scratch rather than stepping the interpolator. Matches the
+// asm loops, including their sample position: the loops step backward from
+// the end of the span and pop before each pixel, so screen column x samples
+// the transform at x + 1. Samples outside the texture are clipped, not
+// wrapped, as the loops skip any pixel whose pop had OVERF set.
+
+static inline bool sprite_ref_sample(const sprite_t *sp, const affine_transform_t atrans, int x, int y, uint *idx) {
+	int size = 1u << sp->log_size;
+	int32_t u = mul_fp1616(atrans[0], (x + 1) * AF_ONE) + mul_fp1616(atrans[1], y * AF_ONE) + atrans[2];
+	int32_t v = mul_fp1616(atrans[3], (x + 1) * AF_ONE) + mul_fp1616(atrans[4], y * AF_ONE) + atrans[5];
+	int tu = u >> 16;
+	int tv = v >> 16;
+	if (tu < 0 || tu >= size || tv < 0 || tv >= size)
+		return false;
+	*idx = (tv << sp->log_size) + tu;
+	return true;
+}
+
+void sprite_asprite8_ref(uint8_t *scanbuf, const sprite_t *sp, const affine_transform_t atrans, uint raster_y, uint raster_w) {
+	int size = 1u << sp->log_size;
+	int y = (int)raster_y - sp->y;
+	if (y < 0 || y >= size)
+		return;
+	for (int x = MAX(0, -sp->x); x < size && sp->x + x < (int)raster_w; ++x) {
+		uint idx;
+		if (!sprite_ref_sample(sp, atrans, x, y, &idx))
+			continue;
+		uint8_t pix = ((const uint8_t*)sp->img)[idx];
+		if (pix & SPRITE_REF_ALPHA_MASK)
+			scanbuf[sp->x + x] = pix;
+	}
+}
+
+void sprite_asprite16_ref(uint16_t *scanbuf, const sprite_t *sp, const affine_transform_t atrans, uint raster_y, uint raster_w) {
+	int size = 1u << sp->log_size;
+	int y = (int)raster_y - sp->y;
+	if (y < 0 || y >= size)
+		return;
+	for (int x = MAX(0, -sp->x); x < size && sp->x + x < (int)raster_w; ++x) {
+		uint idx;
+		if (!sprite_ref_sample(sp, atrans, x, y, &idx))
+			continue;
+		uint16_t pix = ((const uint16_t*)sp->img)[idx];
+		if (pix & SPRITE_REF_ALPHA_MASK)
+			scanbuf[sp->x + x] = pix;
+	}
+}
+
+// Words go through memcpy() since src and dst need not be aligned. pixel_bits
+// is 8 or 16; len is in bytes.
+static void sprite_ref_blit_alpha_swar(uint8_t *dst, const uint8_t *src, uint len, uint pixel_bits) {
+	const uint32_t alpha = pixel_bits == 8 ? 0x20202020u : 0x00200020u;
+	uint i = 0;
+	for (; i + 4 <= len; i += 4) {
+		uint32_t s, d;
+		memcpy(&s, src + i, 4);
+		uint32_t a = s & alpha;
+		if (!a)
+			continue;
+		if (a != alpha) {
+			uint32_t m = a >> 5;
+			m = (m << pixel_bits) - m;
+			memcpy(&d, dst + i, 4);
+			s = d ^ ((d ^ s) & m);
+		}
+		memcpy(dst + i, &s, 4);
+	}
+	for (; i < len; i += pixel_bits / 8) {
+		if (src[i] & SPRITE_REF_ALPHA_MASK)
+			memcpy(dst + i, src + i, pixel_bits / 8);
+	}
+}
+
+void sprite_blit8_alpha_swar_ref(uint8_t *dst, const uint8_t *src, uint len) {
+	sprite_ref_blit_alpha_swar(dst, src, len, 8);
+}
+
+void sprite_blit16_alpha_swar_ref(uint16_t *dst, const uint16_t *src, uint len) {
+	sprite_ref_blit_alpha_swar((uint8_t*)dst, (const uint8_t*)src, len * sizeof(uint16_t), 16);
+}
@@ -0,0 +1,19 @@
+#ifndef _SPRITE_REF_H
+#define _SPRITE_REF_H
+
+#include "sprite.h"
+
+// Plain C equivalents of sprite_sprite8/16 and sprite_asprite8/16, which the
+// sprite tests check the library against. Slow (the affine ones do 64-bit
+// multiplies per pixel).
+void sprite_sprite8_ref(uint8_t *scanbuf, const sprite_t *sp, uint raster_y, uint raster_w);
+void sprite_sprite16_ref(uint16_t *scanbuf, const sprite_t *sp, uint raster_y, uint raster_w);
+void sprite_asprite8_ref(uint8_t *scanbuf, const sprite_t *sp, const affine_transform_t atrans, uint raster_y, uint raster_w);
+void sprite_asprite16_ref(uint16_t *scanbuf, const sprite_t *sp, const affine_transform_t atrans, uint raster_y, uint raster_w);
+
+// The word-at-a-time alpha blit in C, for comparing against the asm and the
+// per-pixel blits. Little-endian hosts only.
+void sprite_blit8_alpha_swar_ref(uint8_t *dst, const uint8_t *src, uint len);
+void sprite_blit16_alpha_swar_ref(uint16_t *dst, const uint16_t *src, uint len);
+
+#endif
@@ -0,0 +1,135 @@
+#include <string.h>
+#include <time.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "dvi_pipeline.h"
+
+// Drives the dvi_pipeline stage list with stub stages: running order per
+// core, frame_start hooks, layering into the scanbuf, and that the index
+// returned by dvi_pipeline_add_stage() still names the same stage's timings
+// after stages are added to the other core. Built with
+// DVI_PIPELINE_STAGE_STATS, which times in nanoseconds on the host.
+
+#define WIDTH 16
+#define HEIGHT 3
+// Long enough that no stub stage gets near it by accident
+#define SLOW_NS 2000000u
+
+// Each call appends a letter: the stage's tag from render, lower case from
+// frame_start
+static char trace[64];
+
+static void trace_add(char c) {
+	size_t n = strlen(trace);
+	if (n + 1 < sizeof(trace))
+		trace[n] = c;
+}
+
+typedef struct {
+	char tag;
+	// Pixels [x, WIDTH) are set to tag, or all of them if x is 0
+	uint x;
+	bool slow;
+} stub_t;
+
+static void busy_wait_ns(uint32_t ns) {
+	struct timespec t0, t;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	do
+		clock_gettime(CLOCK_MONOTONIC, &t);
+	while ((t.tv_sec - t0.tv_sec) * 1000000000ll + (t.tv_nsec - t0.tv_nsec) < ns);
+}
+
+static void stub_render(void *arg, uint32_t *scanbuf, uint raster_y, uint raster_w) {
+	const stub_t *st = arg;
+	CHECK(raster_y < HEIGHT && raster_w == WIDTH);
+	trace_add(st->tag);
+	uint8_t *p = (uint8_t*)scanbuf;
+	for (uint x = st->x; x < raster_w; ++x)
+		p[x] = st->tag;
+	if (st->slow)
+		busy_wait_ns(SLOW_NS);
+}
+
+static void stub_frame_start(void *arg) {
+	trace_add(((const stub_t*)arg)->tag + 'a' - 'A');
+}
+
+static void run_line(struct dvi_pipeline *pl, enum dvi_pipeline_core core, uint32_t *scanbuf, uint y) {
+	memset(trace, 0, sizeof(trace));
+	dvi_pipeline_run_line(pl, core, scanbuf, y);
+}
+
+static void test_order_and_indices(void) {
+	// Render stages interleaved with encode stages, as an app might add
+	// them: background, text overlay (encode core), sprites, cursor (encode
+	// core), HUD. The sprite stage is the slow one.
+	static const stub_t stubs[] = {
+		{'B', 0, false}, {'T', 4, false}, {'S', 8, true}, {'C', 12, false}, {'H', 14, false}
+	};
+	static const enum dvi_pipeline_core cores[] = {
+		DVI_PIPELINE_CORE_RENDER, DVI_PIPELINE_CORE_ENCODE, DVI_PIPELINE_CORE_RENDER,
+		DVI_PIPELINE_CORE_ENCODE, DVI_PIPELINE_CORE_RENDER
+	};
+	struct dvi_pipeline pl;
+	dvi_pipeline_init(&pl, 8, WIDTH, HEIGHT);
+	int idx[count_of(stubs)];
+	for (uint i = 0; i < count_of(stubs); ++i) {
+		idx[i] = dvi_pipeline_add_stage(&pl, "stub", cores[i], stub_render,
+			i == 3 ? NULL : stub_frame_start, (void*)&stubs[i]);
+		CHECK(idx[i] == (int)i);
+	}
+	// Every stage is where its index says
+	for (uint i = 0; i < count_of(stubs); ++i)
+		CHECK(pl.stages[idx[i]].arg == &stubs[i] && pl.stages[idx[i]].core == cores[i]);
+
+	uint32_t scanbuf[WIDTH / 4];
+	for (uint frame = 0; frame < 2; ++frame) {
+		for (uint y = 0; y < HEIGHT; ++y) {
+			memset(scanbuf, 0, sizeof(scanbuf));
+			run_line(&pl, DVI_PIPELINE_CORE_RENDER, scanbuf, y);
+			CHECK(!strcmp(trace, y == 0 ? "bshBSH" : "BSH"));
+			// Later stages on a core draw over earlier ones
+			CHECK(!memcmp(scanbuf, "BBBBBBBBSSSSSSHH", WIDTH));
+			run_line(&pl, DVI_PIPELINE_CORE_ENCODE, scanbuf, y);
+			CHECK(!strcmp(trace, y == 0 ? "tTC" : "TC"));
+			// Encode-core stages draw over render-core ones
+			CHECK(!memcmp(scanbuf, "BBBBTTTTTTTTCCCC", WIDTH));
+		}
+	}
+
+	// The timings under the sprite stage's index are the sprite stage's
+	struct dvi_pipeline_stage_stats st;
+	for (uint i = 0; i < count_of(stubs); ++i) {
+		dvi_pipeline_get_stage_stats(&pl, idx[i], &st);
+		if (stubs[i].slow) {
+			CHECK(st.last >= SLOW_NS && st.max >= SLOW_NS);
+			// frame is the total for the last complete frame
+			CHECK(st.frame >= HEIGHT * SLOW_NS);
+		}
+		else {
+			CHECK(st.max < SLOW_NS);
+		}
+	}
+	dvi_pipeline_stats_reset(&pl);
+	dvi_pipeline_get_stage_stats(&pl, idx[2], &st);
+	CHECK(st.max == 0 && st.last >= SLOW_NS);
+}
+
+static void test_full(void) {
+	static const stub_t stub = {'X', 0, false};
+	struct dvi_pipeline pl;
+	dvi_pipeline_init(&pl, 16, WIDTH, HEIGHT);
+	for (uint i = 0; i < DVI_PIPELINE_MAX_STAGES; ++i)
+		CHECK(dvi_pipeline_add_stage(&pl, "stub", i & 1, stub_render, NULL, (void*)&stub) == (int)i);
+	CHECK(dvi_pipeline_add_stage(&pl, "stub", DVI_PIPELINE_CORE_RENDER, stub_render, NULL, (void*)&stub) == -1);
+	CHECK(pl.n_stages == DVI_PIPELINE_MAX_STAGES);
+	CHECK(pl.n_render_stages == (DVI_PIPELINE_MAX_STAGES + 1) / 2);
+}
+
+int main(void) {
+	test_order_and_indices();
+	test_full();
+	return test_result("test_dvi_pipeline");
+}
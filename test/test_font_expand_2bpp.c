@@ -0,0 +1,84 @@
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "font_expand_2bpp.h"
+
+// Checks font_expand_2bpp() against a pixel-at-a-time expansion. "--dump"
+// prints a random line's inputs and levels for test_tmds_encode_pio.py, which
+// encodes the levels with the 2bpp PIO program and compares the symbols with
+// tmds_encode_font_2bpp().
+
+#define N_PIX 640
+#define N_CHARS (N_PIX / 8)
+#define PLANE_STRIDE (N_CHARS / 8 + 3)
+
+static uint8_t charbuf[N_CHARS];
+static uint32_t colourbuf[3 * PLANE_STRIDE];
+static uint8_t font_line[256];
+static uint32_t levelbuf[3 * N_PIX / 16 + 1];
+
+static void random_line(void) {
+	for (uint i = 0; i < N_CHARS; ++i)
+		charbuf[i] = test_rand();
+	for (uint i = 0; i < count_of(colourbuf); ++i)
+		colourbuf[i] = test_rand();
+	for (uint i = 0; i < count_of(font_line); ++i)
+		font_line[i] = test_rand();
+}
+
+static uint expected_level(uint plane, uint x) {
+	uint c = x / 8;
+	uint colour = (colourbuf[plane * PLANE_STRIDE + c / 8] >> (c % 8 * 4)) & 0xf;
+	bool fg = (font_line[charbuf[c]] >> (x % 8)) & 1;
+	return fg ? colour & 0x3 : colour >> 2;
+}
+
+static void test_expand(void) {
+	for (int trial = 0; trial < 100; ++trial) {
+		random_line();
+		levelbuf[3 * N_PIX / 16] = 0x5a5a5a5a;
+		font_expand_2bpp(charbuf, colourbuf, PLANE_STRIDE, levelbuf, N_PIX, font_line);
+		for (uint plane = 0; plane < 3; ++plane) {
+			const uint32_t *lv = levelbuf + plane * N_PIX / 16;
+			for (uint x = 0; x < N_PIX; ++x)
+				CHECK(((lv[x / 16] >> (x % 16 * 2)) & 0x3) == expected_level(plane, x));
+		}
+		CHECK(levelbuf[3 * N_PIX / 16] == 0x5a5a5a5a);
+	}
+}
+
+static void print_bytes(const char *name, const uint8_t *p, uint n) {
+	printf("%s", name);
+	for (uint i = 0; i < n; ++i)
+		printf(" %02x", p[i]);
+	printf("\n");
+}
+
+static void print_words(const char *name, const uint32_t *p, uint n) {
+	printf("%s", name);
+	for (uint i = 0; i < n; ++i)
+		printf(" %08x", p[i]);
+	printf("\n");
+}
+
+static void dump(uint32_t seed) {
+	test_rand_state = seed;
+	random_line();
+	font_expand_2bpp(charbuf, colourbuf, PLANE_STRIDE, levelbuf, N_PIX, font_line);
+	printf("stride %u\n", PLANE_STRIDE);
+	print_bytes("chars", charbuf, N_CHARS);
+	print_words("colours", colourbuf, count_of(colourbuf));
+	print_bytes("font", font_line, count_of(font_line));
+	print_words("levels", levelbuf, 3 * N_PIX / 16);
+}
+
+int main(int argc, char **argv) {
+	font_expand_2bpp_init();
+	if (argc == 3 && !strcmp(argv[1], "--dump")) {
+		dump(strtoul(argv[2], NULL, 0));
+		return 0;
+	}
+	test_expand();
+	return test_result("test_font_expand_2bpp");
+}
@@ -0,0 +1,194 @@
+#include <string.h>
+
+#include "pico.h"
+#include "hardware/interp.h"
+#include "host_test.h"
+#include "interp_owner.h"
+#include "tmds_encode.h"
+#include "dvi_config_defs.h"
+#include "tile.h"
+#include "tile_ref.h"
+
+// Mixed scanlines on one core: an 8bpp tile layer, then 8bpp TMDS encode of
+// the three channels, as an application rendering and encoding on the same
+// core would do. Built once with TMDS_INTERP_OWNERSHIP and once without.
+//
+// The encode loops record the interpolator configuration they were called
+// with, which must match what the encoder sets up from scratch, and the tile
+// output must match tile_ref.c, whichever side last configured the
+// interpolators. Reports interp_save()/interp_restore()/interp_set_config()
+// calls per line. "--dump seed" prints the loop calls, with interpolator
+// state, for test_interp_owner.py to run the asm and count cycles.
+
+#define N_PIX 320
+#define N_LINES 8
+#define N_TILES 16
+
+static const uint channel_msb[3] = {DVI_8BPP_BLUE_MSB, DVI_8BPP_GREEN_MSB, DVI_8BPP_RED_MSB};
+static const uint channel_lsb[3] = {DVI_8BPP_BLUE_LSB, DVI_8BPP_GREEN_LSB, DVI_8BPP_RED_LSB};
+
+static uint32_t scanbuf[N_PIX / 4];
+static uint8_t refbuf[N_PIX];
+// The leftshift loop writes twice as many words as the other (see
+// tmds_encode.S), so give each channel room for that
+static uint32_t symbuf[3][2 * N_PIX];
+static uint8_t tileset[N_TILES * 8 * 8];
+static uint8_t tilemap[(1024 / 8) * (512 / 8)];
+static tilebg_t bg;
+
+// BASE2 is not used by the 8bpp loops, and keeps whatever the tile layer left
+typedef struct {
+	uint32_t ctrl[2][2];
+	uintptr_t base[2][2];
+	int leftshift;
+} encode_state_t;
+
+static encode_state_t fresh_state[3];
+static encode_state_t *capture;
+static uint encode_channel;
+static uint n_mismatched;
+static bool dumping;
+
+static void dump_interp(const interp_hw_t *interp, uintptr_t base2_origin) {
+	printf(" %08x %08x %u %u %u %u %u", interp->ctrl[0], interp->ctrl[1], interp->accum[0], interp->accum[1],
+		(uint)interp->base[0], (uint)interp->base[1], (uint)(interp->base[2] - base2_origin));
+}
+
+static void record_encode(const uint32_t *pixbuf, uint32_t *out, size_t n_pix, int leftshift) {
+	encode_state_t s;
+	memset(&s, 0, sizeof(s));
+	s.leftshift = leftshift;
+	for (uint i = 0; i < 2; ++i) {
+		const interp_hw_t *interp = i ? interp1_hw : interp0_hw;
+		memcpy(s.ctrl[i], interp->ctrl, sizeof(s.ctrl[i]));
+		memcpy(s.base[i], (const void*)interp->base, sizeof(s.base[i]));
+	}
+	if (capture)
+		*capture = s;
+	else if (memcmp(&s, &fresh_state[encode_channel], sizeof(s)))
+		++n_mismatched;
+	if (dumping) {
+		// Bases 0 and 1 point at tmds_table, which the script loads itself
+		printf("encode %u %d %u", encode_channel, leftshift, (uint)n_pix);
+		dump_interp(interp0_hw, 0);
+		dump_interp(interp1_hw, 0);
+		printf("\n");
+	}
+}
+
+void tmds_encode_loop_8bpp(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) {
+	record_encode(pixbuf, symbuf, n_pix, 0);
+}
+
+void tmds_encode_loop_8bpp_leftshift(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix, uint leftshift) {
+	record_encode(pixbuf, symbuf, n_pix, leftshift);
+}
+
+// The other loops in tmds_encode.S are only here to satisfy the linker
+#define HOST_UNAVAILABLE(name) panic(#name " is asm-only")
+void tmds_encode_1bpp(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) { HOST_UNAVAILABLE(tmds_encode_1bpp); }
+void tmds_encode_2bpp(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) { HOST_UNAVAILABLE(tmds_encode_2bpp); }
+void tmds_encode_loop_16bpp(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) { HOST_UNAVAILABLE(tmds_encode_loop_16bpp); }
+void tmds_encode_loop_16bpp_leftshift(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix, uint leftshift) { HOST_UNAVAILABLE(tmds_encode_loop_16bpp_leftshift); }
+void tmds_fullres_encode_loop_16bpp_x(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) { HOST_UNAVAILABLE(tmds_fullres_encode_loop_16bpp_x); }
+void tmds_fullres_encode_loop_16bpp_y(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) { HOST_UNAVAILABLE(tmds_fullres_encode_loop_16bpp_y); }
+void tmds_fullres_encode_loop_16bpp_leftshift_x(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix, uint leftshift) { HOST_UNAVAILABLE(tmds_fullres_encode_loop_16bpp_leftshift_x); }
+void tmds_fullres_encode_loop_16bpp_leftshift_y(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix, uint leftshift) { HOST_UNAVAILABLE(tmds_fullres_encode_loop_16bpp_leftshift_y); }
+void tmds_palette_encode_loop_x(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) { HOST_UNAVAILABLE(tmds_palette_encode_loop_x); }
+void tmds_palette_encode_loop_y(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) { HOST_UNAVAILABLE(tmds_palette_encode_loop_y); }
+
+// Stands in for tile8_8px_loop during --dump, after running it
+static void dump_tile_call(uint8_t *dst, const uint8_t *ts, uint x0, uint x1) {
+	printf("tile %u %u %u %u", (uint)(dst - (uint8_t*)scanbuf), (uint)(ts - tileset), x0, x1);
+	dump_interp(interp1_hw, (uintptr_t)tilemap);
+	printf("\n");
+	tile8_8px_loop(dst, ts, x0, x1);
+}
+
+static void encode_line(uint ch_first, uint ch_last) {
+	for (uint ch = ch_first; ch <= ch_last; ++ch) {
+		encode_channel = ch;
+		tmds_encode_data_channel_8bpp(scanbuf, symbuf[ch], N_PIX, channel_msb[ch], channel_lsb[ch]);
+	}
+}
+
+// Configuration each channel's encoder sets up when nothing else has touched
+// the interpolators
+static void capture_fresh_state(void) {
+	for (uint ch = 0; ch < 3; ++ch) {
+		memset(host_interp_hw, 0, sizeof(host_interp_hw));
+		interp_owner_invalidate();
+		capture = &fresh_state[ch];
+		encode_channel = ch;
+		tmds_encode_data_channel_8bpp(scanbuf, symbuf[ch], N_PIX, channel_msb[ch], channel_lsb[ch]);
+	}
+	capture = NULL;
+}
+
+static void random_bg(void) {
+	for (uint i = 0; i < count_of(tileset); ++i)
+		tileset[i] = test_rand();
+	for (uint i = 0; i < count_of(tilemap); ++i)
+		tilemap[i] = test_rand() % N_TILES;
+	bg = (tilebg_t){
+		.xscroll = test_rand(),
+		.yscroll = test_rand(),
+		.tileset = tileset,
+		.tilemap = tilemap,
+		.log_size_x = 10,
+		.log_size_y = 9,
+		.tilesize = TILESIZE_8,
+		.fill_loop = (tile_loop_t)(dumping ? (tile8_loop_t)dump_tile_call : tile8_8px_loop)
+	};
+}
+
+// Lines encoding channels ch_first to ch_last. With all three channels the
+// encoder's tag changes on every call; with one, only the interpolator the
+// tile layer took in between needs setting up again.
+static void mixed_lines(uint ch_first, uint ch_last) {
+	uint saves = 0, restores = 0, configs = 0;
+	for (uint y = 0; y < N_LINES; ++y) {
+		host_interp_saves = host_interp_restores = host_interp_configs = 0;
+		if (dumping)
+			printf("line\n");
+		tile8((uint8_t*)scanbuf, &bg, y, N_PIX);
+		tile8_span_ref(refbuf, &bg, y, 0, N_PIX, false);
+		CHECK(!memcmp(scanbuf, refbuf, N_PIX));
+		encode_line(ch_first, ch_last);
+		// The first line pays for setting everything up
+		if (y) {
+			saves += host_interp_saves;
+			restores += host_interp_restores;
+			configs += host_interp_configs;
+		}
+	}
+	if (!dumping) {
+		printf("TMDS_INTERP_OWNERSHIP=%d, tile layer + %u-channel 8bpp encode, per line: "
+			"%.1f interp_save(), %.1f interp_restore(), %.1f interp_set_config()\n",
+			TMDS_INTERP_OWNERSHIP, ch_last - ch_first + 1,
+			(double)saves / (N_LINES - 1), (double)restores / (N_LINES - 1), (double)configs / (N_LINES - 1));
+	}
+}
+
+int main(int argc, char **argv) {
+	capture_fresh_state();
+	dumping = argc == 3 && !strcmp(argv[1], "--dump");
+	if (dumping)
+		test_rand_state = strtoul(argv[2], NULL, 0);
+	random_bg();
+	if (dumping) {
+		printf("tileset");
+		for (uint i = 0; i < count_of(tileset); ++i)
+			printf(" %x", tileset[i]);
+		printf("\ntilemap");
+		for (uint i = 0; i < count_of(tilemap); ++i)
+			printf(" %x", tilemap[i]);
+		printf("\n");
+	}
+	mixed_lines(0, 2);
+	mixed_lines(2, 2);
+	if (dumping)
+		return 0;
+	CHECK(n_mismatched == 0);
+	return test_result("test_interp_owner");
+}
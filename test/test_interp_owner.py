@@ -0,0 +1,108 @@
+"""Run mixed scanlines (a tile8_8px_loop layer, then tmds_encode_loop_8bpp for
+three channels, on one core) from test_interp_owner --dump, built with and
+without TMDS_INTERP_OWNERSHIP. Each loop starts from the interpolator state
+the real C setup left, so the encoded symbols check that setup end to end.
+Also reports emulated cycles for the asm side of a mixed line
+with all three channels.
+
+usage: test_interp_owner.py <test_interp_owner> <test_interp_owner_saverestore>
+"""
+import os
+import re
+import subprocess
+import sys
+
+from thumb_emu import Machine, assemble
+
+REPO = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+
+# (msb, lsb) of blue, green, red, as in dvi_config_defs.h
+CHANNELS = [(1, 0), (4, 2), (7, 5)]
+
+
+def tmds_table():
+    with open(os.path.join(REPO, 'libdvi', 'tmds_table.h')) as f:
+        return [int(x, 16) for x in re.findall(r'^(0x[0-9a-f]+)u,', f.read(), re.M)]
+
+
+def set_interp(interp, f, base2):
+    interp.ctrl = [int(f[0], 16), int(f[1], 16)]
+    interp.accum = [int(f[2]), int(f[3])]
+    interp.base = [int(f[4]), int(f[5]), base2]
+
+
+def run(harness, objs, seed):
+    lines = subprocess.check_output([harness, '--dump', str(seed)], text=True).splitlines()
+    m = Machine()
+    m.link(objs)
+    table = tmds_table()
+    table_addr = m.alloc_words(table)
+    scanbuf = m.alloc(bytes(1024))
+    symbufs = [m.alloc(bytes(4096)) for _ in range(3)]
+    failures = 0
+    tile_cycles = n_lines = 0
+    # [channels encoded, encode cycles] per line
+    line_encodes = []
+    outputs = []
+    for text in lines:
+        f = text.split()
+        if f[0] == 'tileset':
+            tileset = m.alloc(bytes(int(x, 16) for x in f[1:]))
+        elif f[0] == 'tilemap':
+            tilemap = m.alloc(bytes(int(x, 16) for x in f[1:]))
+        elif f[0] == 'line':
+            n_lines += 1
+            line_encodes.append([0, 0])
+        elif f[0] == 'tile':
+            dst, ts, x0, x1 = map(int, f[1:5])
+            set_interp(m.interp[1], f[5:12], tilemap + int(f[11]))
+            _, cyc = m.call('tile8_8px_loop', scanbuf + dst, tileset + ts, x0, x1)
+            tile_cycles += cyc
+        elif f[0] == 'encode':
+            ch, leftshift, n_pix = map(int, f[1:4])
+            set_interp(m.interp[0], f[4:11], int(f[10]))
+            set_interp(m.interp[1], f[11:18], int(f[17]))
+            for interp in m.interp:
+                interp.base[0] = interp.base[1] = table_addr
+            if leftshift:
+                _, cyc = m.call('tmds_encode_loop_8bpp_leftshift', scanbuf, symbufs[ch], n_pix, leftshift)
+            else:
+                _, cyc = m.call('tmds_encode_loop_8bpp', scanbuf, symbufs[ch], n_pix)
+            line_encodes[-1][0] += 1
+            line_encodes[-1][1] += cyc
+            msb, lsb = CHANNELS[ch]
+            bits = msb - lsb + 1
+            pixels = m.mem.read_bytes(scanbuf, n_pix)
+            got = m.mem.read_words(symbufs[ch], n_pix)
+            want = [table[((p >> lsb) & ((1 << bits) - 1)) << (6 - bits)] for p in pixels]
+            if got != want:
+                if failures < 5:
+                    x = next(i for i in range(n_pix) if got[i] != want[i])
+                    print('%s seed %d line %d channel %d: wrong symbols from pixel %d'
+                          % (os.path.basename(harness), seed, n_lines - 1, ch, x))
+                failures += 1
+            outputs.append(got)
+    full = [cyc for n, cyc in line_encodes if n == 3]
+    return failures, outputs, tile_cycles / n_lines, sum(full) / len(full)
+
+
+def main():
+    objs = [assemble(os.path.join(REPO, 'libsprite', 'tile.S')),
+            assemble(os.path.join(REPO, 'libdvi', 'tmds_encode.S'))]
+    failures = 0
+    for seed in (1, 2):
+        results = [run(h, objs, seed) for h in sys.argv[1:3]]
+        failures += sum(r[0] for r in results)
+        if results[0][1] != results[1][1]:
+            print('seed %d: output differs with and without TMDS_INTERP_OWNERSHIP' % seed)
+            failures += 1
+    _, _, tile, encode = results[0]
+    print('mixed 320-pixel 8bpp line, asm only: tile layer %d cycles, 3-channel encode %d cycles' % (tile, encode))
+    for o in objs:
+        os.unlink(o)
+    print('test_interp_owner.py: ' + ('%d failure(s)' % failures if failures else 'ok'))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
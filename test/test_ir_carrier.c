@@ -0,0 +1,183 @@
+#include <math.h>
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "ir_protocol.h"
+#include "ir_queue_host.h"
+
+// Varre ir_carrier_solve() de 10 a 420 MHz de clk_sys, em passos de 1 MHz
+// mais os clocks que o SDK e o lado DVI usam, com portadoras de 30 a 60 kHz:
+// - o divisor é válido no hardware (1.0 a 65535 + 255/256, sem fração com
+//   parte inteira 1) e o mais próximo: a frequência cai com o divisor, então
+//   basta que os vizinhos válidos não fiquem mais perto;
+// - pio_hz, a portadora em mHz, o erro em ppm e o jitter batem com a conta
+//   em double, e o erro fica dentro de meio passo do divisor;
+// - um quadro do ir_protocol_ac, agendado com pio_hz e executado no modelo
+//   do ir_carrier.pio, sai com os tempos certos no clk_sys real.
+// Confere também os casos sem divisor possível e a troca de pio_hz na fila.
+// Por fim imprime o divisor e o erro para alguns clocks, ao lado da
+// portadora que o divisor fixo para 125 MHz de antes daria.
+
+static const uint32_t carriers[] = {36000, 38000, 40000, 56000};
+static const uint32_t sdk_clocks[] = {48000000, 125000000, 133000000, 150000000, 200000000, 252000000, 270000000,
+                                      372000000};
+static const uint8_t payload[13] = {0x23, 0xCB, 0x26, 0x01, 0x00, 0x24, 0x13, 0x0B, 0x22, 0, 0, 0, 0};
+
+#define MAX_ENTRIES 256
+
+static bool valid_div(uint64_t div) {
+    return div >= 256 && div <= 0xFFFFFF && (div >= 512 || !(div & 0xFF));
+}
+
+static double carrier_of(uint32_t sys_hz, uint64_t div) {
+    return sys_hz * 256.0 / div / IR_CARRIER_CYCLES;
+}
+
+// Durações nominais do quadro do payload, em microsegundos, sem o espaço de
+// fim
+static size_t nominal_frame(const ir_protocol_t *p, uint32_t *us) {
+    size_t n = 0;
+    us[n++] = p->header_mark;
+    us[n++] = p->header_space;
+    for (uint i = 0; i < p->length; ++i) {
+        uint8_t byte = i < ir_protocol_payload_len(p) ? payload[i] : ir_protocol_checksum(p, payload);
+        for (uint j = 0; j < 8; ++j) {
+            us[n++] = p->bit_mark;
+            us[n++] = byte >> (p->lsb_first ? j : 7 - j) & 1 ? p->one_space : p->zero_space;
+        }
+    }
+    us[n++] = p->footer_mark;
+    return n;
+}
+
+static double worst_frame_us;
+
+static void check_frame(const ir_carrier_config_t *cfg) {
+    uint32_t schedule[MAX_ENTRIES], decoded[MAX_ENTRIES], nominal[MAX_ENTRIES];
+    const ir_protocol_t *p = &ir_protocol_ac;
+    size_t n = ir_protocol_encode(p, payload, cfg->pio_hz, 20000, schedule, MAX_ENTRIES);
+    size_t m = ir_schedule_host_decode(schedule, n, decoded, MAX_ENTRIES, NULL);
+    CHECK(n == m && nominal_frame(p, nominal) == m - 1);
+    // Tempo real: ciclos do PIO vezes o divisor, em ciclos do clk_sys
+    double pio_cycle_us = (cfg->div_int + cfg->div_frac / 256.0) * 1e6 / cfg->sys_hz;
+    double period_us = 1e9 / cfg->carrier_mhz;
+    for (uint i = 0; i + 1 < m; ++i) {
+        double err = fabs(decoded[i] * pio_cycle_us - nominal[i]);
+        CHECK(err <= period_us);
+        worst_frame_us = MAX(worst_frame_us, err);
+    }
+}
+
+static uint sweeps;
+static double worst_ppm;
+
+static void check_solve(uint32_t sys_hz, uint32_t carrier_hz, bool frame) {
+    ir_carrier_config_t cfg;
+    memset(&cfg, 0xAA, sizeof(cfg));
+    if (!ir_carrier_solve(sys_hz, carrier_hz, &cfg)) {
+        CHECK(false);
+        return;
+    }
+    ++sweeps;
+    uint64_t div = cfg.div_int * 256u + cfg.div_frac;
+    CHECK(cfg.sys_hz == sys_hz && cfg.carrier_hz == carrier_hz);
+    CHECK(valid_div(div));
+    double got = carrier_of(sys_hz, div);
+    uint64_t neighbours[] = {div - 1, div + 1, 256, 512};
+    for (uint i = 0; i < count_of(neighbours); ++i) {
+        uint64_t d = neighbours[i];
+        // 256 e 512 só são vizinhos entre si
+        if (valid_div(d) && (i < 2 || div <= 512))
+            CHECK(fabs(carrier_of(sys_hz, d) - carrier_hz) >= fabs(got - carrier_hz));
+    }
+
+    CHECK(fabs(cfg.pio_hz - sys_hz * 256.0 / div) <= 0.5);
+    CHECK(fabs(cfg.carrier_mhz - got * 1000) <= 0.5);
+    double ppm = (got - carrier_hz) / carrier_hz * 1e6;
+    CHECK(fabs(ppm - cfg.error_ppm) <= 0.5);
+    // Meio passo de 1/256 no divisor
+    CHECK(fabs(ppm) <= 0.5e6 / div + 0.5);
+    worst_ppm = MAX(worst_ppm, fabs(ppm));
+    CHECK(cfg.jitter_ns == (cfg.div_frac ? (uint32_t)(1e9 / sys_hz + 0.5) : 0));
+    if (frame)
+        check_frame(&cfg);
+}
+
+static void test_sweep(void) {
+    for (uint32_t mhz = 10; mhz <= 420; ++mhz) {
+        for (uint c = 0; c < count_of(carriers); ++c)
+            check_solve(mhz * 1000000, carriers[c], mhz % 10 == 0);
+        check_solve(mhz * 1000000 + test_rand_range(0, 999999), test_rand_range(30000, 60000), false);
+    }
+    for (uint i = 0; i < count_of(sdk_clocks); ++i)
+        for (uint c = 0; c < count_of(carriers); ++c)
+            check_solve(sdk_clocks[i], carriers[c], true);
+}
+
+static void test_edges(void) {
+    ir_carrier_config_t cfg;
+    CHECK(!ir_carrier_solve(0, 38000, &cfg));
+    CHECK(!ir_carrier_solve(125000000, 0, &cfg));
+    // Precisaria de divisor abaixo de 1
+    CHECK(!ir_carrier_solve(200000, 38000, &cfg));
+    // Acima de 65535 + 255/256
+    CHECK(!ir_carrier_solve(2000000000u, 100, &cfg));
+    // Entre 1 e 2 só valem 1.0 e 2.0: 1.3 arredonda para 1, 1.6 para 2
+    CHECK(ir_carrier_solve(395200, 38000, &cfg) && cfg.div_int == 1 && cfg.div_frac == 0);
+    CHECK(ir_carrier_solve(486400, 38000, &cfg) && cfg.div_int == 2 && cfg.div_frac == 0);
+    CHECK(ir_carrier_solve(304000, 38000, &cfg) && cfg.div_int == 1 && cfg.error_ppm == 0 && cfg.jitter_ns == 0);
+}
+
+// Com um quadro na fila a frequência não muda; com a fila vazia, o quadro
+// seguinte é agendado com a nova
+static void test_queue_rate(void) {
+    ir_carrier_config_t c125, c252;
+    CHECK(ir_carrier_solve(125000000, 38000, &c125));
+    CHECK(ir_carrier_solve(252000000, 38000, &c252));
+    ir_queue_t q;
+    ir_queue_host_t out;
+    ir_queue_init(&q, &ir_output_host, &out, c125.pio_hz, 20000);
+    ir_queue_host_reset(&out, &q);
+    CHECK(ir_queue_push_protocol(&q, &ir_protocol_ac, payload, 0));
+    uint64_t before = out.busy_cycles;
+    CHECK(!ir_queue_set_pio_hz(&q, c252.pio_hz));
+    CHECK(q.pio_hz == c125.pio_hz);
+    while (ir_queue_pending(&q))
+        ir_queue_host_advance(&out, 1000);
+    CHECK(ir_queue_set_pio_hz(&q, c252.pio_hz));
+    CHECK(ir_queue_push_protocol(&q, &ir_protocol_ac, payload, 1));
+    uint64_t after = out.busy_cycles - before;
+    while (ir_queue_pending(&q))
+        ir_queue_host_advance(&out, 1000);
+    // O mesmo quadro dura o mesmo tempo nos dois clocks
+    double us_125 = before * 1e6 / c125.pio_hz, us_252 = after * 1e6 / c252.pio_hz;
+    CHECK(fabs(us_125 - us_252) < 1e6 / 38000);
+    CHECK(out.overlap_errors == 0 && q.stats.sent == 2);
+}
+
+static void report(void) {
+    printf("%u casos, erro máximo %.1f ppm, erro máximo no quadro %.1f us\n", sweeps, worst_ppm, worst_frame_us);
+    // Antes: divisor calculado para 125 MHz qualquer que fosse o clk_sys
+    static const uint32_t show[] = {48000000, 125000000, 133000000, 252000000};
+    for (uint i = 0; i < count_of(show); ++i) {
+        for (uint c = 0; c < count_of(carriers); ++c) {
+            ir_carrier_config_t cfg;
+            ir_carrier_solve(show[i], carriers[c], &cfg);
+            double fixed = show[i] / (125e6 / (carriers[c] * (double)IR_CARRIER_CYCLES)) / IR_CARRIER_CYCLES;
+            printf("%3u MHz %2u kHz: divisor %3u + %3u/256, %lu.%03lu Hz, %+4ld ppm, jitter %u ns; "
+                   "divisor fixo de 125 MHz: %.0f Hz\n",
+                   show[i] / 1000000, carriers[c] / 1000, cfg.div_int, cfg.div_frac,
+                   (unsigned long)(cfg.carrier_mhz / 1000), (unsigned long)(cfg.carrier_mhz % 1000),
+                   (long)cfg.error_ppm, cfg.jitter_ns, fixed);
+        }
+    }
+}
+
+int main(void) {
+    test_sweep();
+    test_edges();
+    test_queue_rate();
+    report();
+    return test_result("test_ir_carrier");
+}
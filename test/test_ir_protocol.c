@@ -0,0 +1,127 @@
+#include <math.h>
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "ir_protocol.h"
+#include "ir_schedule_host.h"
+
+// Confere ir_protocol_encode() passando o quadro pelo modelo do
+// ir_carrier.pio (ir_schedule_host.c): com protocolos e payloads
+// aleatórios, cada duração fica a menos de um período da portadora da
+// nominal, os bits lidos de volta dão os bytes e o checksum, e o quadro
+// termina no espaço de fim com uma IRQ.
+//
+// "--frame b0 b1 ..." gera o quadro do ir_protocol_ac para o payload dado
+// (em hexadecimal, sem o checksum) a 38 kHz e imprime as durações em
+// microsegundos, sem o espaço de fim. test_ir_protocol.py compara essa
+// saída com as capturas de tools/ir_captures.txt.
+
+#define CARRIER_HZ 38000
+#define MAX_ENTRIES (2 + 16 * IR_PROTOCOL_MAX_BYTES + 2)
+
+static uint32_t schedule[MAX_ENTRIES + 1], decoded[MAX_ENTRIES + 1];
+
+static double cycles_us(uint32_t cycles, uint32_t pio_hz) {
+    return cycles * 1e6 / pio_hz;
+}
+
+static void random_protocol(ir_protocol_t *p) {
+    p->header_mark = test_rand_range(2000, 9000);
+    p->header_space = test_rand_range(1000, 4500);
+    p->bit_mark = test_rand_range(300, 700);
+    p->zero_space = test_rand_range(300, 700);
+    p->one_space = p->zero_space + test_rand_range(500, 1500);
+    p->footer_mark = test_rand_range(300, 700);
+    p->length = test_rand_range(1, IR_PROTOCOL_MAX_BYTES);
+    p->lsb_first = test_rand() & 1;
+    p->checksum = p->length > 1 ? test_rand_range(IR_CHECKSUM_NONE, IR_CHECKSUM_XOR) : IR_CHECKSUM_NONE;
+}
+
+static uint8_t ref_checksum(const ir_protocol_t *p, const uint8_t *payload) {
+    uint8_t sum = 0;
+    for (uint i = 0; i + 1 < p->length; ++i)
+        sum = p->checksum == IR_CHECKSUM_XOR ? sum ^ payload[i] : sum + payload[i];
+    return sum;
+}
+
+static void test_random_frames(void) {
+    for (int trial = 0; trial < 3000; ++trial) {
+        ir_protocol_t p;
+        random_protocol(&p);
+        uint32_t carrier = test_rand_range(30000, 60000);
+        uint32_t pio_hz = carrier * IR_CARRIER_CYCLES;
+        uint32_t gap_us = test_rand_range(5000, 100000);
+        uint8_t payload[IR_PROTOCOL_MAX_BYTES];
+        for (uint i = 0; i < IR_PROTOCOL_MAX_BYTES; ++i)
+            payload[i] = test_rand();
+        CHECK(ir_protocol_checksum(&p, payload) == ref_checksum(&p, payload));
+
+        size_t n = ir_protocol_encode(&p, payload, pio_hz, gap_us, schedule, MAX_ENTRIES);
+        CHECK(n == ir_protocol_entries(&p));
+        CHECK(ir_schedule_is_end(schedule[n - 1]));
+        ir_schedule_host_stats_t stats;
+        size_t m = ir_schedule_host_decode(schedule, n, decoded, count_of(decoded), &stats);
+        CHECK(m == n && stats.entries == n && stats.irqs == 1);
+
+        // Um período de tolerância: o arredondamento para períodos inteiros
+        // é de meio, mais o do ajuste pelos ciclos fixos do programa
+        double tol = 1e6 / carrier;
+        uint16_t head[] = {p.header_mark, p.header_space};
+        for (uint i = 0; i < 2; ++i)
+            CHECK(fabs(cycles_us(decoded[i], pio_hz) - head[i]) <= tol);
+        CHECK(fabs(cycles_us(decoded[n - 2], pio_hz) - p.footer_mark) <= tol);
+        CHECK(fabs(cycles_us(decoded[n - 1], pio_hz) - gap_us) <= tol);
+        uint limit = (p.zero_space + p.one_space) / 2;
+        for (uint i = 0; i < p.length; ++i) {
+            uint8_t byte = 0;
+            for (uint j = 0; j < 8; ++j) {
+                double mark = cycles_us(decoded[2 + 16 * i + 2 * j], pio_hz);
+                double space = cycles_us(decoded[3 + 16 * i + 2 * j], pio_hz);
+                bool bit = space >= limit;
+                CHECK(fabs(mark - p.bit_mark) <= tol);
+                CHECK(fabs(space - (bit ? p.one_space : p.zero_space)) <= tol);
+                byte |= bit << (p.lsb_first ? j : 7 - j);
+            }
+            bool is_checksum = p.checksum != IR_CHECKSUM_NONE && i == p.length - 1u;
+            CHECK(byte == (is_checksum ? ref_checksum(&p, payload) : payload[i]));
+        }
+    }
+}
+
+static void test_limits(void) {
+    ir_protocol_t p = ir_protocol_ac;
+    uint8_t payload[IR_PROTOCOL_MAX_BYTES] = {0};
+    size_t n = ir_protocol_entries(&p);
+    CHECK(ir_protocol_payload_len(&p) == 13 && n == 228);
+    CHECK(ir_protocol_encode(&p, payload, CARRIER_HZ * IR_CARRIER_CYCLES, 100000, schedule, n - 1) == 0);
+    CHECK(ir_protocol_encode(&p, payload, CARRIER_HZ * IR_CARRIER_CYCLES, 100000, schedule, n) == n);
+    p.length = IR_PROTOCOL_MAX_BYTES + 1;
+    CHECK(ir_protocol_encode(&p, payload, CARRIER_HZ * IR_CARRIER_CYCLES, 100000, schedule, MAX_ENTRIES) == 0);
+    p.checksum = IR_CHECKSUM_NONE;
+    p.length = 3;
+    CHECK(ir_protocol_payload_len(&p) == 3);
+}
+
+static int frame(int argc, char **argv) {
+    const ir_protocol_t *p = &ir_protocol_ac;
+    uint8_t payload[IR_PROTOCOL_MAX_BYTES];
+    if (argc != ir_protocol_payload_len(p))
+        return 1;
+    for (int i = 0; i < argc; ++i)
+        payload[i] = strtoul(argv[i], NULL, 16);
+    uint32_t pio_hz = CARRIER_HZ * IR_CARRIER_CYCLES;
+    size_t n = ir_protocol_encode(p, payload, pio_hz, 100000, schedule, MAX_ENTRIES);
+    size_t m = ir_schedule_host_decode(schedule, n, decoded, count_of(decoded), NULL);
+    for (size_t i = 0; i + 1 < m; ++i)
+        printf("%.0f%c", cycles_us(decoded[i], pio_hz), i + 2 < m ? ' ' : '\n');
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && !strcmp(argv[1], "--frame"))
+        return frame(argc - 2, argv + 2);
+    test_random_frames();
+    test_limits();
+    return test_result("test_ir_protocol");
+}
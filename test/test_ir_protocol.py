@@ -0,0 +1,93 @@
+"""Confere o ir_protocol_ac de lib/ir_protocol.c contra as capturas de
+tools/ir_captures.txt:
+
+- os tempos, a ordem dos bits e o checksum são os que tools/ir_infer.py
+  infere das capturas;
+- para cada captura que segue o protocolo, o quadro gerado pelo C (o payload
+  lido da captura, passado por ir_protocol_encode() e pelo modelo do
+  ir_carrier.pio, via test_ir_protocol --frame) tem os mesmos bits que a
+  captura, difere do quadro nominal de ir_infer.py em menos de um período da
+  portadora, e fica dentro da tolerância do receptor (25% ou 100 us) sempre
+  que ir_infer.py aceita a captura.
+
+Imprime o erro máximo de cada quadro gerado em relação à captura.
+
+uso: test_ir_protocol.py <caminho do test_ir_protocol>
+"""
+import os
+import re
+import subprocess
+import sys
+
+REPO = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+sys.path.insert(0, os.path.join(REPO, 'tools'))
+
+import ir_infer  # noqa: E402
+
+TOL = 25.0
+SLACK = 100
+# Um período da portadora de 38 kHz, em microsegundos
+PERIOD_US = 1e6 / 38000
+
+
+def c_protocol():
+    """Campos do ir_protocol_ac em lib/ir_protocol.c."""
+    with open(os.path.join(REPO, 'lib', 'ir_protocol.c'), encoding='utf-8') as f:
+        text = f.read()
+    body = re.search(r'ir_protocol_ac = \{(.*?)\};', text, re.S).group(1)
+    fields = dict(re.findall(r'\.(\w+) = (\w+)', body))
+    proto = {k: int(v) for k, v in fields.items() if v.isdigit()}
+    proto['lsb_first'] = fields['lsb_first'] == 'true'
+    proto['checksum'] = None if fields['checksum'] == 'IR_CHECKSUM_NONE' else fields['checksum']
+    return proto
+
+
+def main():
+    harness = sys.argv[1]
+    failures = 0
+    captures = ir_infer.load_captures(ir_infer.DEFAULT_CAPTURES)
+    inferred, results = ir_infer.infer(captures, TOL, SLACK)
+    proto = c_protocol()
+    for key, value in inferred.items():
+        if proto.get(key) != value:
+            print('ir_protocol_ac.%s = %s, ir_infer.py infere %s' % (key, proto.get(key), value))
+            failures += 1
+
+    limit = (proto['zero_space'] + proto['one_space']) / 2
+    decoded = 0
+    for name, raw, payload, reason, in_tol in results:
+        if payload is None:
+            print('%-14s ignorada: %s' % (name, reason))
+            continue
+        decoded += 1
+        out = subprocess.check_output([harness, '--frame'] + ['%x' % b for b in payload], text=True)
+        frame = [int(v) for v in out.split()]
+        nominal = ir_infer.encode(inferred, payload)
+        if len(frame) != len(raw):
+            print('%s: %d durações, captura tem %d' % (name, len(frame), len(raw)))
+            failures += 1
+            continue
+        if ir_infer.bits_of(frame, limit) != ir_infer.bits_of(raw, limit):
+            print('%s: bits diferentes da captura' % name)
+            failures += 1
+        worst = max(abs(g - n) for g, n in zip(frame, nominal))
+        if worst > PERIOD_US:
+            print('%s: %d us do quadro nominal' % (name, worst))
+            failures += 1
+        c_in_tol = ir_infer.matches(frame, raw, TOL, SLACK)
+        if in_tol and not c_in_tol:
+            print('%s: fora da tolerância, ir_infer.py aceita' % name)
+            failures += 1
+        err_us, err_pct = ir_infer.max_error(frame, raw)
+        print('%-14s erro máximo %3d us (%.1f%%)%s' % (name, err_us, err_pct,
+                                                     '' if c_in_tol else ', fora da tolerância'))
+    if decoded < 5:
+        print('só %d capturas seguem o protocolo' % decoded)
+        failures += 1
+
+    print('test_ir_protocol.py: ' + ('%d failure(s)' % failures if failures else 'ok'))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,193 @@
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "ir_queue_host.h"
+
+// Confere a fila de ir_queue.c com a saída simulada de ir_queue_host.c,
+// contra um modelo à parte. Um laço principal que nunca bloqueia enfileira
+// sinais RAW e quadros de protocolo aleatórios, avança o tempo aos poucos e
+// às vezes troca a frequência do PIO; os callbacks às vezes enfileiram
+// outro quadro de dentro da IRQ. A cada passo:
+// - o push é aceito só com lugar na fila e quadro que cabe na agenda;
+// - cada agenda entregue à saída é a do próximo quadro aceito, montada com o
+//   payload e a frequência do momento do push (o payload é copiado; quem
+//   chamou o reusa logo depois);
+// - o quadro começa no push, com a saída livre, ou no ciclo em que o
+//   anterior terminou, e nunca dois no ar;
+// - os callbacks vêm na ordem dos push, com o tag de cada um, no fim de cada
+//   quadro;
+// - ir_queue_pending() e as estatísticas batem com o modelo.
+// Por fim imprime quantos quadros passaram e quanto do tempo o LED ficou
+// ocupado.
+
+#define MAX_FRAMES 4096
+#define MAX_RAW (IR_QUEUE_SCHEDULE_MAX + 8)
+#define SIGNALS 16
+
+static const uint32_t rates[] = {36000 * IR_CARRIER_CYCLES, 38000 * IR_CARRIER_CYCLES, 40000 * IR_CARRIER_CYCLES};
+
+// Quadro aceito, como o modelo o espera
+typedef struct {
+    uint32_t tag;
+    uint32_t schedule[IR_QUEUE_SCHEDULE_MAX];
+    size_t length;
+    uint64_t pushed_at, start, end;
+} expected_t;
+
+static expected_t frames[MAX_FRAMES];
+static uint32_t accepted, started, done, rejected;
+// Quadros que começaram no push, com a saída parada
+static uint32_t idle_starts;
+static uint32_t pio_hz;
+
+static ir_queue_t q;
+static ir_queue_host_t out;
+
+static uint16_t signals[SIGNALS][MAX_RAW];
+static size_t signal_len[SIGNALS];
+
+// ----------------------------------------------------------------------------
+// Saída que confere cada agenda antes de passá-la a ir_output_host
+
+static void record_start(void *ctx, const uint32_t *schedule, size_t length) {
+    CHECK(started < accepted);
+    expected_t *f = &frames[started];
+    CHECK(length == f->length && !memcmp(schedule, f->schedule, length * sizeof(uint32_t)));
+    uint64_t prev_end = started ? frames[started - 1].end : 0;
+    f->start = out.now;
+    CHECK(f->start == MAX(prev_end, f->pushed_at));
+    idle_starts += f->start > prev_end;
+    ir_schedule_host_stats_t st;
+    ir_schedule_host_decode(schedule, length, NULL, 0, &st);
+    f->end = f->start + st.irq_cycle;
+    ++started;
+    ir_output_host.start(ctx, schedule, length);
+}
+
+static const ir_output_t recording = {
+    .start = record_start
+};
+
+// ----------------------------------------------------------------------------
+// Push, no laço ou no callback
+
+static void push_random(void) {
+    bool full = accepted - done == IR_QUEUE_LEN;
+    expected_t *f = &frames[accepted];
+    bool raw = test_rand() & 1;
+    uint k = test_rand_range(0, SIGNALS - 1);
+    uint8_t payload[IR_PROTOCOL_MAX_BYTES];
+    for (uint i = 0; i < count_of(payload); ++i)
+        payload[i] = test_rand();
+    f->tag = test_rand();
+    f->pushed_at = out.now;
+    if (raw)
+        f->length = ir_schedule_from_raw(signals[k], signal_len[k], pio_hz, q.gap_us, f->schedule,
+                                         IR_QUEUE_SCHEDULE_MAX);
+    else
+        f->length = ir_protocol_encode(&ir_protocol_ac, payload, pio_hz, q.gap_us, f->schedule,
+                                       IR_QUEUE_SCHEDULE_MAX);
+    // Conta antes: com a saída livre, o quadro começa dentro do push
+    bool expect = !full && f->length != 0;
+    if (expect)
+        ++accepted;
+    else
+        ++rejected;
+    bool ok = raw ? ir_queue_push(&q, signals[k], signal_len[k], f->tag)
+                  : ir_queue_push_protocol(&q, &ir_protocol_ac, payload, f->tag);
+    CHECK(ok == expect);
+    // O buffer de quem chamou é reusado na hora
+    memset(payload, 0xA5, sizeof(payload));
+}
+
+static uint32_t reentrant;
+
+static void on_done(void *ctx, uint32_t tag) {
+    CHECK(ctx == &q);
+    CHECK(done < started && tag == frames[done].tag && out.now == frames[done].end);
+    // O próximo já saiu; só falta este sair da conta
+    ++done;
+    CHECK(ir_queue_pending(&q) == accepted - done);
+    CHECK(ir_queue_host_busy(&out) == (accepted > done));
+    if (test_rand() % 3 == 0 && accepted < MAX_FRAMES) {
+        ++reentrant;
+        push_random();
+    }
+}
+
+static void random_signals(void) {
+    for (uint k = 0; k < SIGNALS; ++k) {
+        // Nos limites da agenda: 512 durações cabem, 511 + o espaço final
+        // também, 513 não
+        static const size_t edges[] = {IR_QUEUE_SCHEDULE_MAX, IR_QUEUE_SCHEDULE_MAX - 1, IR_QUEUE_SCHEDULE_MAX + 1};
+        signal_len[k] = k < count_of(edges) ? edges[k] : test_rand_range(1, 60);
+        for (size_t i = 0; i < signal_len[k]; ++i)
+            signals[k][i] = test_rand_range(150, k < count_of(edges) ? 300 : 3000);
+    }
+}
+
+static void test_random_loop(void) {
+    random_signals();
+    pio_hz = rates[1];
+    ir_queue_init(&q, &recording, &out, pio_hz, test_rand_range(5000, 100000));
+    ir_queue_host_reset(&out, &q);
+    ir_queue_set_callback(&q, on_done, &q);
+    // Sem nada no ar, o fim de quadro não faz nada
+    ir_queue_frame_done(&q);
+    CHECK(q.stats.sent == 0 && ir_queue_pending(&q) == 0);
+
+    uint64_t steps = 0;
+    while (accepted < MAX_FRAMES - 8) {
+        ++steps;
+        uint pushes = test_rand() % 64 == 0 ? test_rand_range(1, 6) : 0;
+        for (uint i = 0; i < pushes; ++i)
+            push_random();
+        if (test_rand() % 40 == 0) {
+            uint32_t hz = rates[test_rand_range(0, count_of(rates) - 1)];
+            bool idle = accepted == done;
+            CHECK(ir_queue_set_pio_hz(&q, hz) == idle);
+            if (idle)
+                pio_hz = hz;
+            CHECK(q.pio_hz == pio_hz);
+        }
+        // Um passo do laço principal: de nada a uns 20 ms
+        ir_queue_host_advance(&out, test_rand() % 8 ? test_rand_range(0, pio_hz / 50) : 0);
+
+        CHECK(ir_queue_pending(&q) == accepted - done);
+        CHECK(ir_queue_host_busy(&out) == (accepted > done) && started == done + (accepted > done));
+        CHECK(q.stats.queued == accepted && q.stats.sent == done && q.stats.rejected == rejected);
+        CHECK(out.frames_started == started && out.overlap_errors == 0);
+    }
+    while (ir_queue_pending(&q))
+        ir_queue_host_advance(&out, pio_hz / 100);
+    CHECK(done == accepted && started == accepted);
+    CHECK(rejected > 100 && reentrant > 100 && idle_starts > 100);
+    printf("%u quadros (%u enfileirados no callback, %u com a saída parada), %u recusados, %llu passos do laço; "
+           "LED ocupado %.0f%% do tempo\n",
+           accepted, reentrant, idle_starts, rejected, (unsigned long long)steps, 100.0 * out.busy_cycles / out.now);
+}
+
+// Limites fora do laço: tamanho do protocolo e sinal vazio
+static void test_limits(void) {
+    static const uint16_t mark[] = {500};
+    ir_queue_init(&q, &ir_output_host, &out, rates[1], 20000);
+    ir_queue_host_reset(&out, &q);
+    ir_protocol_t too_long = ir_protocol_ac;
+    too_long.length = IR_PROTOCOL_MAX_BYTES + 1;
+    uint8_t payload[IR_PROTOCOL_MAX_BYTES + 1] = {0};
+    CHECK(!ir_queue_push_protocol(&q, &too_long, payload, 0));
+    CHECK(!ir_queue_push(&q, mark, 0, 0));
+    CHECK(q.stats.rejected == 2 && out.frames_started == 0);
+    // Sem callback, a fila anda do mesmo jeito
+    CHECK(ir_queue_push(&q, mark, 1, 0) && ir_queue_push(&q, mark, 1, 1));
+    CHECK(out.frames_started == 1 && ir_queue_pending(&q) == 2);
+    ir_queue_host_advance(&out, rates[1]);
+    CHECK(out.frames_started == 2 && ir_queue_pending(&q) == 0 && q.stats.sent == 2);
+}
+
+int main(void) {
+    test_random_loop();
+    test_limits();
+    return test_result("test_ir_queue");
+}
@@ -0,0 +1,102 @@
+#include <math.h>
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "ir_schedule_host.h"
+
+// Confere ir_schedule_from_raw() passando a agenda pelo modelo do
+// ir_carrier.pio (ir_schedule_host.c): com sinais, portadoras e intervalos
+// aleatórios, a agenda tem uma entrada por duração (mais o espaço final se o
+// sinal termina numa marca), só a última com o bit de fim, e cada duração
+// decodificada fica a menos de um período da portadora da RAW. O PIO emite
+// exatamente os períodos das marcas e sinaliza uma IRQ.
+//
+// "--raw d0 d1 ..." converte as durações dadas (microsegundos) a 38 kHz e
+// imprime o envelope decodificado em microsegundos, com o espaço final.
+// test_ir_schedule.py faz isso com as capturas de tools/ir_captures.txt.
+
+#define CARRIER_HZ 38000
+#define GAP_US 100000
+#define MAX_RAW 512
+
+static uint16_t raw[MAX_RAW];
+static uint32_t schedule[MAX_RAW + 1], decoded[MAX_RAW + 2];
+
+static double cycles_us(uint32_t cycles, uint32_t pio_hz) {
+    return cycles * 1e6 / pio_hz;
+}
+
+static void test_random_signals(void) {
+    for (int trial = 0; trial < 2000; ++trial) {
+        size_t length = test_rand_range(1, MAX_RAW);
+        for (size_t i = 0; i < length; ++i)
+            raw[i] = test_rand() % 8 ? test_rand_range(150, 2000) : test_rand_range(2000, 65535);
+        uint32_t carrier = test_rand_range(30000, 60000);
+        uint32_t pio_hz = carrier * IR_CARRIER_CYCLES;
+        uint32_t gap_us = test_rand_range(0, 200000);
+
+        size_t n = ir_schedule_from_raw(raw, length, pio_hz, gap_us, schedule, MAX_RAW + 1);
+        CHECK(n == length + length % 2);
+        uint32_t mark_periods = 0;
+        for (size_t i = 0; i < n; ++i) {
+            CHECK(ir_schedule_is_mark(schedule[i]) == (i % 2 == 0));
+            CHECK(ir_schedule_is_end(schedule[i]) == (i == n - 1));
+            if (ir_schedule_is_mark(schedule[i]))
+                mark_periods += ir_schedule_periods(schedule[i]);
+        }
+
+        ir_schedule_host_stats_t stats;
+        size_t m = ir_schedule_host_decode(schedule, n, decoded, count_of(decoded), &stats);
+        CHECK(m == n && stats.entries == n && stats.irqs == 1 && stats.pulses == mark_periods);
+        double tol = 1e6 / carrier;
+        for (size_t i = 0; i < m; ++i) {
+            double want = i < length ? raw[i] : gap_us;
+            if (i == n - 1)
+                want = MAX(want, gap_us);
+            CHECK(fabs(cycles_us(decoded[i], pio_hz) - want) <= tol);
+        }
+    }
+}
+
+static void test_entries(void) {
+    for (int i = 0; i < 10000; ++i) {
+        uint32_t periods = test_rand_range(1, IR_SCHEDULE_MAX_PERIODS);
+        bool mark = test_rand() & 1;
+        uint32_t e = ir_schedule_entry(mark, periods);
+        CHECK(ir_schedule_is_mark(e) == mark && ir_schedule_periods(e) == periods && !ir_schedule_is_end(e));
+        if (!mark)
+            CHECK(ir_schedule_is_end(e | IR_SCHEDULE_END) && ir_schedule_periods(e | IR_SCHEDULE_END) == periods);
+    }
+    uint32_t pio_hz = CARRIER_HZ * IR_CARRIER_CYCLES;
+    // Nada é mais curto que um período
+    CHECK(ir_schedule_periods(ir_schedule_from_us(true, 0, pio_hz)) == 1);
+    CHECK(ir_schedule_periods(ir_schedule_from_us(false, 0, pio_hz)) == 1);
+    // Sinal vazio ou que não cabe
+    raw[0] = raw[1] = raw[2] = 500;
+    CHECK(ir_schedule_from_raw(raw, 0, pio_hz, GAP_US, schedule, MAX_RAW) == 0);
+    CHECK(ir_schedule_from_raw(raw, 3, pio_hz, GAP_US, schedule, 3) == 0);
+    CHECK(ir_schedule_from_raw(raw, 3, pio_hz, GAP_US, schedule, 4) == 4);
+    CHECK(ir_schedule_from_raw(raw, 2, pio_hz, GAP_US, schedule, 2) == 2);
+}
+
+static int convert(int argc, char **argv) {
+    if (argc < 1 || argc > MAX_RAW)
+        return 1;
+    for (int i = 0; i < argc; ++i)
+        raw[i] = strtoul(argv[i], NULL, 10);
+    uint32_t pio_hz = CARRIER_HZ * IR_CARRIER_CYCLES;
+    size_t n = ir_schedule_from_raw(raw, argc, pio_hz, GAP_US, schedule, count_of(schedule));
+    size_t m = ir_schedule_host_decode(schedule, n, decoded, count_of(decoded), NULL);
+    for (size_t i = 0; i < m; ++i)
+        printf("%.0f%c", cycles_us(decoded[i], pio_hz), i + 1 < m ? ' ' : '\n');
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && !strcmp(argv[1], "--raw"))
+        return convert(argc - 2, argv + 2);
+    test_random_signals();
+    test_entries();
+    return test_result("test_ir_schedule");
+}
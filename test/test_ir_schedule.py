@@ -0,0 +1,68 @@
+"""Confere ir_schedule_from_raw() de lib/ir_schedule.c contra as capturas de
+tools/ir_captures.txt: cada captura, convertida a 38 kHz e passada pelo
+modelo do ir_carrier.pio (test_ir_schedule --raw), volta com uma duração
+por duração da captura mais o espaço final, cada uma a menos de um período
+da portadora da capturada.
+
+Imprime o erro máximo de cada captura e o que o buffer de antes (uma
+entrada por período de 26 us, até 2048) faria com ela.
+
+uso: test_ir_schedule.py <caminho do test_ir_schedule>
+"""
+import os
+import subprocess
+import sys
+
+REPO = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+sys.path.insert(0, os.path.join(REPO, 'tools'))
+
+import ir_infer  # noqa: E402
+
+GAP_US = 100000
+PERIOD_US = 1e6 / 38000
+OLD_MAX = 2048
+
+
+def old_samples(raw):
+    """Entradas de prepare_pwm_buffer() sem o limite, e as durações que
+    cabiam inteiras nas 2048."""
+    total, whole = 0, 0
+    for d in raw:
+        total += max(1, d // 26)
+        if total <= OLD_MAX:
+            whole += 1
+    return total, whole
+
+
+def main():
+    harness = sys.argv[1]
+    failures = 0
+    captures = ir_infer.load_captures(ir_infer.DEFAULT_CAPTURES)
+    if not captures:
+        print('nenhuma captura em %s' % ir_infer.DEFAULT_CAPTURES)
+        failures += 1
+    for name, raw in captures:
+        out = subprocess.check_output([harness, '--raw'] + [str(d) for d in raw], text=True)
+        got = [int(v) for v in out.split()]
+        entries = len(raw) + len(raw) % 2
+        if len(got) != entries:
+            print('%s: %d durações, esperava %d' % (name, len(got), entries))
+            failures += 1
+            continue
+        want = list(raw) + [GAP_US] * (entries - len(raw))
+        want[-1] = max(want[-1], GAP_US)
+        worst = max(abs(g - w) for g, w in zip(got, want))
+        if worst > PERIOD_US:
+            print('%s: %d us da captura' % (name, worst))
+            failures += 1
+        total, whole = old_samples(raw)
+        print('%-14s %3d durações, %3d entradas (%4d bytes), erro máximo %2d us; '
+              'antes %4d amostras, %3d durações inteiras em %d'
+              % (name, len(raw), entries, 4 * entries, worst, total, whole, OLD_MAX))
+
+    print('test_ir_schedule.py: ' + ('%d failure(s)' % failures if failures else 'ok'))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
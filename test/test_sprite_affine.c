@@ -0,0 +1,201 @@
+#include <string.h>
+
+#include "pico.h"
+#include "hardware/interp.h"
+#include "host_test.h"
+#include "sprite.h"
+#include "sprite_ref.h"
+#include "affine_transform.h"
+
+// Checks sprite_asprite8/16() and the prepared versions against
+// sprite_ref.c, for rotations, shears and pure scale/flip transforms,
+// including samples off every edge of the texture (which are clipped, not
+// wrapped). The affine loops here are the C stand-ins from
+// sprite_blit_host.c, which honour OVERF as the asm does.
+//
+// "--dump seed" instead prints the affine loop calls (the INTERP0 state
+// sprite.c set up, and the loop arguments) with sprite_ref.c's output for
+// each, for test_sprite_affine.py to run through the sprite.S loops.
+
+#define LINE_W 320
+#define MIN_LOG_SIZE 2
+#define MAX_LOG_SIZE 6
+
+static uint8_t line8[3][LINE_W];
+static uint16_t line16[3][LINE_W];
+static uint8_t img8[1 << 2 * MAX_LOG_SIZE];
+static uint16_t img16[1 << 2 * MAX_LOG_SIZE];
+
+extern void (*sprite_host_ablit_hook)(void *dst, uint len, uint pixel_bytes, bool alpha);
+
+static void random_images(void) {
+	// Mostly opaque, so both alpha outcomes are common
+	for (uint i = 0; i < count_of(img8); ++i) {
+		img8[i] = test_rand() | (test_rand() % 4 ? 0x20 : 0);
+		img16[i] = test_rand() | (test_rand() % 4 ? 0x20 : 0);
+	}
+}
+
+static int32_t random_scale(void) {
+	static const int32_t scales[] = {AF_ONE, AF_ONE / 4, AF_ONE / 2, AF_ONE * 3 / 4, AF_ONE * 3 / 2, AF_ONE * 2, AF_ONE * 4};
+	int32_t s = test_rand() % 4 ? scales[test_rand() % count_of(scales)] : test_rand_range(AF_ONE / 8, AF_ONE * 4);
+	return test_rand() & 1 ? -s : s;
+}
+
+// Texture to screen: move the centre to the origin, rotate and scale, then
+// move back with some slop, so parts of the sprite sample off the texture.
+// One in three is a pure scale/flip, for the prepared fast path.
+static void random_transform(affine_transform_t atrans, uint log_size, bool *scale_only) {
+	int32_t half = (AF_ONE << log_size) / 2;
+	int slop = 1 << log_size;
+	*scale_only = test_rand() % 3 == 0;
+	affine_identity(atrans);
+	affine_translate(atrans, half / AF_ONE + test_rand_range(-slop, slop), half / AF_ONE + test_rand_range(-slop, slop));
+	if (!*scale_only)
+		affine_rotate(atrans, test_rand());
+	affine_scale(atrans, random_scale(), random_scale());
+	affine_translate(atrans, -half / AF_ONE, -half / AF_ONE);
+	atrans[2] += test_rand_range(-AF_ONE, AF_ONE);
+	atrans[5] += test_rand_range(-AF_ONE, AF_ONE);
+	// A rotation by a multiple of a quarter turn has zero cross terms too
+	*scale_only = atrans[1] == 0 && atrans[3] == 0;
+}
+
+static void random_sprite(sprite_t *sp, bool bpp16) {
+	sp->log_size = test_rand_range(MIN_LOG_SIZE, MAX_LOG_SIZE);
+	int size = 1 << sp->log_size;
+	sp->x = test_rand_range(-size, LINE_W);
+	sp->y = test_rand_range(-size / 2, 64);
+	sp->img = bpp16 ? (const void*)img16 : (const void*)img8;
+}
+
+static void random_lines(void) {
+	for (uint x = 0; x < LINE_W; ++x) {
+		line8[0][x] = line8[1][x] = line8[2][x] = test_rand();
+		line16[0][x] = line16[1][x] = line16[2][x] = test_rand();
+	}
+}
+
+static void test_matches_ref(void) {
+	uint n_scale_only = 0;
+	for (int trial = 0; trial < 600; ++trial) {
+		bool bpp16 = trial & 1;
+		sprite_t sp;
+		random_sprite(&sp, bpp16);
+		affine_transform_t atrans;
+		bool scale_only;
+		random_transform(atrans, sp.log_size, &scale_only);
+		sprite_affine_t aff;
+		if (bpp16)
+			sprite_affine_prepare16(&aff, &sp, atrans);
+		else
+			sprite_affine_prepare8(&aff, &sp, atrans);
+		CHECK(aff.scale_only == scale_only);
+		n_scale_only += scale_only;
+		// Every row, plus one either side
+		for (int y = sp.y - 1; y <= sp.y + (1 << sp.log_size); ++y) {
+			if (y < 0)
+				continue;
+			random_lines();
+			if (bpp16) {
+				sprite_asprite16_ref(line16[0], &sp, atrans, y, LINE_W);
+				sprite_asprite16(line16[1], &sp, atrans, y, LINE_W);
+				sprite_asprite16_prepared(line16[2], &aff, y, LINE_W);
+				CHECK(!memcmp(line16[0], line16[1], sizeof(line16[0])));
+				CHECK(!memcmp(line16[0], line16[2], sizeof(line16[0])));
+			}
+			else {
+				sprite_asprite8_ref(line8[0], &sp, atrans, y, LINE_W);
+				sprite_asprite8(line8[1], &sp, atrans, y, LINE_W);
+				sprite_asprite8_prepared(line8[2], &aff, y, LINE_W);
+				CHECK(!memcmp(line8[0], line8[1], sizeof(line8[0])));
+				CHECK(!memcmp(line8[0], line8[2], sizeof(line8[0])));
+			}
+		}
+	}
+	// Both paths through the prepared functions got a good workout
+	CHECK(n_scale_only > 100 && n_scale_only < 500);
+}
+
+static const void *dump_img;
+
+static void dump_hex(const char *tag, const void *data, uint n, uint pixel_bytes) {
+	printf("%s", tag);
+	for (uint i = 0; i < n; ++i)
+		printf(" %x", pixel_bytes == 2 ? ((const uint16_t*)data)[i] : ((const uint8_t*)data)[i]);
+	printf("\n");
+}
+
+static void dump_call(void *dst, uint len, uint pixel_bytes, bool alpha) {
+	const interp_hw_t *i0 = interp0_hw;
+	const void *line = pixel_bytes == 2 ? (const void*)line16[1] : (const void*)line8[1];
+	printf("call %u %u %u %u %08x %08x %u %u %u %u %u\n", pixel_bytes * 8, alpha,
+		(uint)((const uint8_t*)dst - (const uint8_t*)line) / pixel_bytes, len,
+		i0->ctrl[0], i0->ctrl[1], i0->accum[0], i0->accum[1],
+		(uint32_t)i0->base[0], (uint32_t)i0->base[1], (uint)(i0->base[2] - (uintptr_t)dump_img));
+}
+
+// The general path only: scale-only transforms on the prepared path don't
+// use the loops. The first sprites are fully on screen, for the cycle counts.
+static void dump(void) {
+	sprite_host_ablit_hook = dump_call;
+	for (int trial = 0; trial < 60; ++trial) {
+		bool bpp16 = trial & 1;
+		uint pixel_bytes = bpp16 ? 2 : 1;
+		sprite_t sp;
+		random_sprite(&sp, bpp16);
+		affine_transform_t atrans;
+		bool scale_only;
+		do
+			random_transform(atrans, sp.log_size, &scale_only);
+		while (scale_only);
+		if (trial < 10) {
+			sp.log_size = MIN_LOG_SIZE + trial / 2;
+			sp.x = 100;
+		}
+		dump_img = sp.img;
+		sprite_affine_t aff;
+		if (bpp16)
+			sprite_affine_prepare16(&aff, &sp, atrans);
+		else
+			sprite_affine_prepare8(&aff, &sp, atrans);
+		printf("sprite %u %u\n", pixel_bytes * 8, sp.log_size);
+		dump_hex("img", sp.img, 1u << 2 * sp.log_size, pixel_bytes);
+		for (int i = 0; i < 4; ++i) {
+			int y = sp.y + test_rand_range(0, (1 << sp.log_size) - 1);
+			if (y < 0)
+				continue;
+			random_lines();
+			if (bpp16) {
+				dump_hex("line", line16[1], LINE_W, 2);
+				if (i & 1)
+					sprite_asprite16_prepared(line16[1], &aff, y, LINE_W);
+				else
+					sprite_asprite16(line16[1], &sp, atrans, y, LINE_W);
+				sprite_asprite16_ref(line16[0], &sp, atrans, y, LINE_W);
+				dump_hex("expect", line16[0], LINE_W, 2);
+			}
+			else {
+				dump_hex("line", line8[1], LINE_W, 1);
+				if (i & 1)
+					sprite_asprite8_prepared(line8[1], &aff, y, LINE_W);
+				else
+					sprite_asprite8(line8[1], &sp, atrans, y, LINE_W);
+				sprite_asprite8_ref(line8[0], &sp, atrans, y, LINE_W);
+				dump_hex("expect", line8[0], LINE_W, 1);
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc == 3 && !strcmp(argv[1], "--dump")) {
+		test_rand_state = strtoul(argv[2], NULL, 0);
+		random_images();
+		dump();
+		return 0;
+	}
+	random_images();
+	test_matches_ref();
+	return test_result("test_sprite_affine");
+}
@@ -0,0 +1,337 @@
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "sprite_atlas.h"
+
+// Checks the sprite_atlas.c cache (LRU eviction, pinning of images bound
+// this frame, prefetch) on small atlases built here, and that a packed image
+// whose last run is too long is cut short instead of overrunning its slot.
+//
+// test_sprite_atlas.py also runs this on atlases from sprite_atlas_pack.py:
+//
+//   --check <atlas.bin> <image.bin>...  unpack every entry and compare it
+//                                       with the original image, with
+//                                       opacity metadata worked out here
+//   --scene <atlas.bin>                 cache hit rates for a synthetic
+//                                       scene, with and without prefetch
+
+#define MAX_ATLAS_BYTES (256 * 1024)
+// 64x64 at 16bpp, with metadata
+#define MAX_IMAGE_BYTES (2 * 64 * 64 + 64 * 4)
+#define GUARD_BYTES 64
+#define GUARD 0xa5
+
+static uint32_t atlas_words[MAX_ATLAS_BYTES / 4];
+static const sprite_atlas_t *atlas = (const sprite_atlas_t*)atlas_words;
+// Slots, then guard bytes which must never be written
+static uint8_t slot_mem[SPRITE_ATLAS_MAX_SLOTS * MAX_IMAGE_BYTES + GUARD_BYTES] __attribute__((aligned(4)));
+
+static bool guard_intact(uint32_t slot_end) {
+	for (uint i = 0; i < GUARD_BYTES; ++i)
+		if (slot_mem[slot_end + i] != GUARD)
+			return false;
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// Hand-built atlases
+
+typedef struct {
+	uint8_t log_size;
+	uint8_t flags;
+	const uint8_t *data;
+	uint32_t bytes;
+} build_entry_t;
+
+static void build_atlas(bool bpp16, const build_entry_t *e, uint n) {
+	sprite_atlas_t *a = (sprite_atlas_t*)atlas_words;
+	memset(atlas_words, 0, sizeof(atlas_words));
+	a->magic = SPRITE_ATLAS_MAGIC;
+	a->n_entries = n;
+	a->flags = bpp16 ? SPRITE_ATLAS_16BPP : 0;
+	uint32_t offset = sizeof(sprite_atlas_t) + n * sizeof(sprite_atlas_entry_t);
+	for (uint i = 0; i < n; ++i) {
+		a->entries[i] = (sprite_atlas_entry_t){
+			.offset = offset,
+			.packed_bytes = e[i].bytes,
+			.log_size = e[i].log_size,
+			.flags = e[i].flags
+		};
+		memcpy((uint8_t*)atlas_words + offset, e[i].data, e[i].bytes);
+		offset += (e[i].bytes + 3) & ~3u;
+	}
+}
+
+// A 4x4 image whose last repeat run (8bpp) or literal run (16bpp) is longer
+// than the pixels left, in a slot with guard bytes straight after it
+static void test_overlong_run(void) {
+	static const uint8_t repeat8[] = {
+		3, 1, 2, 3, 4,   // 4 literals
+		128 + 127, 0x20, // 129 repeats, 12 wanted
+	};
+	static uint8_t literal16[1 + 2 * 4 + 1 + 2 * 128];
+	uint i = 0;
+	literal16[i++] = 128 + 2;  // 4 repeats
+	literal16[i++] = 0x34;
+	literal16[i++] = 0x12;
+	literal16[i++] = 127;      // 128 literals, 12 wanted
+	for (uint k = 0; k < 128; ++k) {
+		literal16[i++] = k;
+		literal16[i++] = 0x80;
+	}
+	for (int bpp16 = 0; bpp16 < 2; ++bpp16) {
+		build_entry_t e = {
+			.log_size = 2,
+			.flags = SPRITE_ATLAS_ENTRY_RLE,
+			.data = bpp16 ? literal16 : repeat8,
+			.bytes = bpp16 ? i : sizeof(repeat8)
+		};
+		build_atlas(bpp16, &e, 1);
+		uint32_t slot_bytes = sprite_atlas_max_image_bytes(atlas);
+		CHECK(slot_bytes == (bpp16 ? 32u : 16u));
+		memset(slot_mem, GUARD, sizeof(slot_mem));
+		sprite_atlas_cache_t cache;
+		sprite_atlas_cache_init(&cache, atlas, slot_mem, slot_bytes, 1);
+		const void *img = sprite_atlas_get(&cache, 0);
+		CHECK(img == slot_mem);
+		CHECK(guard_intact(slot_bytes));
+		if (bpp16) {
+			const uint16_t *p = img;
+			CHECK(p[0] == 0x1234 && p[3] == 0x1234);
+			CHECK(p[4] == 0x8000 && p[15] == 0x800b);
+		}
+		else {
+			const uint8_t *p = img;
+			CHECK(p[0] == 1 && p[3] == 4);
+			CHECK(p[4] == 0x20 && p[15] == 0x20);
+		}
+	}
+}
+
+// Four raw 8bpp 1x1 images with metadata, each pixel its own entry number
+static void build_tiny_atlas(void) {
+	static uint8_t raw[4][1 + 4];
+	build_entry_t e[4];
+	for (uint i = 0; i < 4; ++i) {
+		raw[i][0] = i;
+		e[i] = (build_entry_t){.log_size = 0, .flags = SPRITE_ATLAS_ENTRY_METADATA, .data = raw[i], .bytes = 5};
+	}
+	build_atlas(false, e, 4);
+}
+
+static void test_lru_and_pinning(void) {
+	build_tiny_atlas();
+	CHECK(sprite_atlas_max_image_bytes(atlas) == 8);
+	sprite_atlas_cache_t cache;
+	sprite_atlas_cache_init(&cache, atlas, slot_mem, 8, 2);
+
+	// Out of range
+	CHECK(!sprite_atlas_get(&cache, 4));
+
+	const uint8_t *a = sprite_atlas_get(&cache, 0);
+	const uint8_t *b = sprite_atlas_get(&cache, 1);
+	CHECK(a && b && a != b && *a == 0 && *b == 1);
+	CHECK(cache.stats.misses == 2 && cache.stats.hits == 0);
+	// Both slots are in use this frame, so there's no room for a third
+	CHECK(!sprite_atlas_get(&cache, 2));
+	CHECK(cache.stats.full == 1);
+	CHECK(sprite_atlas_get(&cache, 0) == a);
+	CHECK(cache.stats.hits == 1);
+
+	// Next frame: use 1, so 0 is the least recently used and goes first
+	sprite_atlas_frame(&cache);
+	CHECK(sprite_atlas_get(&cache, 1) == b);
+	const uint8_t *c = sprite_atlas_get(&cache, 2);
+	CHECK(c == a && *c == 2);
+	CHECK(cache.stats.evictions == 1);
+
+	// bind() fills in the sprite from the entry, and takes the slot not in
+	// use this frame
+	sprite_atlas_frame(&cache);
+	CHECK(sprite_atlas_get(&cache, 2) == c);
+	sprite_t sp = {.log_size = 5};
+	CHECK(sprite_atlas_bind(&cache, &sp, 3));
+	CHECK(sp.img == b && *b == 3 && sp.log_size == 0 && sp.has_opacity_metadata);
+	// Failure leaves the sprite alone
+	sp.log_size = 5;
+	CHECK(!sprite_atlas_bind(&cache, &sp, 1));
+	CHECK(sp.img == b && sp.log_size == 5);
+}
+
+static void test_prefetch(void) {
+	build_tiny_atlas();
+	sprite_atlas_cache_t cache;
+	sprite_atlas_cache_init(&cache, atlas, slot_mem, 8, 3);
+	sprite_atlas_get(&cache, 0);
+	// Two free slots: the third (out of range) and fourth entries are
+	// skipped, and the cached one isn't unpacked again
+	static const uint16_t next[] = {0, 1, 7, 2, 3};
+	CHECK(sprite_atlas_prefetch(&cache, next, count_of(next), 4) == 2);
+	CHECK(cache.stats.prefetched == 2 && cache.stats.full == 1);
+	// Nothing in use this frame was evicted
+	CHECK(cache.stats.evictions == 0);
+	sprite_atlas_frame(&cache);
+	uint32_t misses = cache.stats.misses;
+	CHECK(*(const uint8_t*)sprite_atlas_get(&cache, 1) == 1);
+	CHECK(*(const uint8_t*)sprite_atlas_get(&cache, 2) == 2);
+	CHECK(cache.stats.misses == misses);
+	// max_unpack is honoured
+	sprite_atlas_frame(&cache);
+	static const uint16_t all[] = {3, 0};
+	CHECK(sprite_atlas_prefetch(&cache, all, count_of(all), 1) == 1);
+}
+
+// ----------------------------------------------------------------------------
+// Atlases from sprite_atlas_pack.py
+
+static void load_atlas(const char *path) {
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+	size_t n = fread(atlas_words, 1, sizeof(atlas_words), f);
+	fclose(f);
+	CHECK(n >= sizeof(sprite_atlas_t) && n < sizeof(atlas_words));
+	CHECK(atlas->magic == SPRITE_ATLAS_MAGIC);
+}
+
+static uint32_t metadata_word(const uint8_t *row, uint size, uint pixel_bytes) {
+	int start = -1, end = 0;
+	uint n_opaque = 0;
+	for (uint x = 0; x < size; ++x) {
+		if (row[x * pixel_bytes] & 0x20) {
+			if (start < 0)
+				start = x;
+			end = x + 1;
+			++n_opaque;
+		}
+	}
+	if (start < 0)
+		return 0;
+	return (uint32_t)(n_opaque == (uint)(end - start)) << 31 | start << 16 | end;
+}
+
+static void check(const char *atlas_path, char **images, uint n_images) {
+	static uint8_t want[MAX_IMAGE_BYTES];
+	load_atlas(atlas_path);
+	CHECK(atlas->n_entries == n_images);
+	uint pixel_bytes = atlas->flags & SPRITE_ATLAS_16BPP ? 2 : 1;
+	// One slot of exactly the largest image, so the guard checks every unpack
+	uint32_t slot_bytes = sprite_atlas_max_image_bytes(atlas);
+	CHECK(slot_bytes <= sizeof(want));
+	uint n_rle = 0;
+	for (uint i = 0; i < n_images && i < atlas->n_entries; ++i) {
+		const sprite_atlas_entry_t *e = &atlas->entries[i];
+		uint size = 1u << e->log_size;
+		FILE *f = fopen(images[i], "rb");
+		if (!f) {
+			perror(images[i]);
+			exit(EXIT_FAILURE);
+		}
+		uint32_t pix_bytes = fread(want, 1, sizeof(want), f);
+		fclose(f);
+		CHECK(pix_bytes == size * size * pixel_bytes);
+		uint32_t bytes = pix_bytes;
+		if (e->flags & SPRITE_ATLAS_ENTRY_METADATA) {
+			for (uint y = 0; y < size; ++y) {
+				uint32_t w = metadata_word(want + y * size * pixel_bytes, size, pixel_bytes);
+				memcpy(want + bytes, &w, sizeof(w));
+				bytes += sizeof(w);
+			}
+		}
+		n_rle += !!(e->flags & SPRITE_ATLAS_ENTRY_RLE);
+
+		memset(slot_mem, GUARD, sizeof(slot_mem));
+		sprite_atlas_cache_t cache;
+		sprite_atlas_cache_init(&cache, atlas, slot_mem, slot_bytes, 1);
+		sprite_t sp;
+		CHECK(sprite_atlas_bind(&cache, &sp, i));
+		CHECK(sp.log_size == e->log_size);
+		CHECK(sp.has_opacity_metadata == !!(e->flags & SPRITE_ATLAS_ENTRY_METADATA));
+		if (memcmp(sp.img, want, bytes)) {
+			fprintf(stderr, "%s: entry %u differs from %s\n", atlas_path, i, images[i]);
+			++test_failures;
+		}
+		CHECK(guard_intact(slot_bytes));
+	}
+	// Both the RLE and the raw paths were covered
+	CHECK(n_rle > 0 && n_rle < n_images);
+}
+
+// ----------------------------------------------------------------------------
+// Cache benchmark: a scene of objects of a few types, each type cycling
+// through four consecutive atlas entries, a step every 8 frames. Every so
+// often one type in play is swapped for another, so the working set drifts.
+
+#define SCENE_FRAMES 3000
+#define SCENE_OBJECTS 24
+#define SCENE_TYPES 6
+#define ANIM_FRAMES 4
+
+static uint object_entry(uint type, uint frame) {
+	return type * ANIM_FRAMES + (frame / 8 + type) % ANIM_FRAMES;
+}
+
+static void scene(const char *atlas_path) {
+	load_atlas(atlas_path);
+	uint n_types = atlas->n_entries / ANIM_FRAMES;
+	uint32_t slot_bytes = sprite_atlas_max_image_bytes(atlas);
+	static const uint slot_counts[] = {8, 12, 16};
+	printf("%u entries, %u-byte slots, %d frames of %d objects from %d of %u types\n",
+		atlas->n_entries, slot_bytes, SCENE_FRAMES, SCENE_OBJECTS, SCENE_TYPES, n_types);
+	for (uint s = 0; s < count_of(slot_counts); ++s) {
+		uint n_slots = slot_counts[s];
+		if (n_slots * slot_bytes > sizeof(slot_mem) - GUARD_BYTES)
+			continue;
+		for (uint max_prefetch = 0; max_prefetch <= 4; max_prefetch += 4) {
+			test_rand_state = 1;
+			// Object i is of type types[i % SCENE_TYPES]
+			uint types[SCENE_TYPES];
+			for (uint t = 0; t < SCENE_TYPES; ++t)
+				types[t] = t;
+			sprite_atlas_cache_t cache;
+			sprite_atlas_cache_init(&cache, atlas, slot_mem, slot_bytes, n_slots);
+			uint worst = 0;
+			for (uint frame = 0; frame < SCENE_FRAMES; ++frame) {
+				sprite_atlas_frame(&cache);
+				uint32_t misses = cache.stats.misses;
+				for (uint i = 0; i < SCENE_OBJECTS; ++i) {
+					sprite_t sp;
+					sprite_atlas_bind(&cache, &sp, object_entry(types[i % SCENE_TYPES], frame));
+				}
+				if (frame)
+					worst = MAX(worst, cache.stats.misses - misses);
+				if (test_rand() % 50 == 0)
+					types[test_rand() % SCENE_TYPES] = test_rand() % n_types;
+				if (max_prefetch) {
+					uint16_t next[SCENE_OBJECTS];
+					for (uint i = 0; i < SCENE_OBJECTS; ++i)
+						next[i] = object_entry(types[i % SCENE_TYPES], frame + 1);
+					sprite_atlas_prefetch(&cache, next, SCENE_OBJECTS, max_prefetch);
+				}
+			}
+			const sprite_atlas_stats_t *st = &cache.stats;
+			printf("%2u slots, prefetch %u: %6.2f%% hits, %4u in-frame misses (worst frame %u), "
+				"%4u prefetched, %u full\n",
+				n_slots, max_prefetch, 100.0 * st->hits / (st->hits + st->misses), st->misses, worst,
+				st->prefetched, st->full);
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc >= 3 && !strcmp(argv[1], "--check")) {
+		check(argv[2], argv + 3, argc - 3);
+		return test_result("test_sprite_atlas --check");
+	}
+	if (argc == 3 && !strcmp(argv[1], "--scene")) {
+		scene(argv[2]);
+		return test_result("test_sprite_atlas --scene");
+	}
+	test_overlong_run();
+	test_lru_and_pinning();
+	test_prefetch();
+	return test_result("test_sprite_atlas");
+}
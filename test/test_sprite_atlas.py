@@ -0,0 +1,114 @@
+"""Pack synthetic sprites with libsprite/sprite_atlas_pack.py (the command
+line tool, C header and all), then have test_sprite_atlas unpack every entry
+through the sprite_atlas.c cache and compare it with the original image.
+Also reports cache hit rates for a synthetic scene on a 16bpp atlas.
+
+usage: test_sprite_atlas.py <path to test_sprite_atlas>
+"""
+import os
+import random
+import re
+import subprocess
+import sys
+import tempfile
+
+REPO = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+PACKER = os.path.join(REPO, 'libsprite', 'sprite_atlas_pack.py')
+ALPHA = 1 << 5
+
+
+def image(rng, kind, size, bpp):
+    """size x size pixels of one of the kinds of art the packer sees."""
+    mask = (1 << bpp) - 1
+
+    def colour():
+        return (rng.getrandbits(bpp) | ALPHA) & mask
+
+    if kind == 'noise':
+        # Incompressible, so stored raw
+        return [rng.getrandbits(bpp) for _ in range(size * size)]
+    if kind == 'flat':
+        # Runs longer than one control byte can hold
+        return [colour()] * (size * size)
+    # A disc or ring on a transparent background, with some speckle
+    fill, r = colour(), size / 2
+    inner = r / 2 if kind == 'ring' else -1
+    pixels = []
+    for y in range(size):
+        for x in range(size):
+            d = ((x + 0.5 - r) ** 2 + (y + 0.5 - r) ** 2) ** 0.5
+            if inner < d < r:
+                pixels.append(colour() if rng.random() < 0.1 else fill)
+            else:
+                pixels.append(0)
+    return pixels
+
+
+def write_images(rng, tmp, tag, bpp, n):
+    paths = []
+    for i in range(n):
+        kind = rng.choice(['disc', 'disc', 'ring', 'flat', 'noise'])
+        size = 1 << rng.randint(0, 6)
+        path = os.path.join(tmp, '%s_%s%d.bin' % (tag, kind, i))
+        with open(path, 'wb') as f:
+            f.write(b''.join(p.to_bytes(bpp // 8, 'little') for p in image(rng, kind, size, bpp)))
+        paths.append(path)
+    return paths
+
+
+def pack(tmp, tag, bpp, metadata, paths):
+    """Run the packer, and turn the header it writes back into a binary."""
+    header = os.path.join(tmp, tag + '.h')
+    args = [sys.executable, PACKER, '--bpp', str(bpp), '--name', tag, '-o', header] + paths
+    if metadata:
+        args.append('--metadata')
+    subprocess.check_output(args)
+    text = open(header).read()
+    failures = 0
+    for i, path in enumerate(paths):
+        stem = os.path.splitext(os.path.basename(path))[0]
+        if not re.search(r'^#define %s_%s %d$' % (tag.upper(), stem.upper(), i), text, re.M):
+            print('%s: no #define for entry %d' % (header, i))
+            failures += 1
+    body = text[text.index('{') + 1:text.index('};')]
+    atlas = os.path.join(tmp, tag + '.bin')
+    with open(atlas, 'wb') as f:
+        f.write(bytes(int(x, 16) for x in re.findall(r'0x([0-9a-f]{2}),', body)))
+    return atlas, failures
+
+
+def main():
+    harness = sys.argv[1]
+    rng = random.Random(1)
+    failures = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        for bpp in (8, 16):
+            for metadata in (False, True):
+                tag = 'atlas%d%s' % (bpp, '_meta' if metadata else '')
+                paths = write_images(rng, tmp, tag, bpp, 40)
+                atlas, f = pack(tmp, tag, bpp, metadata, paths)
+                failures += f
+                r = subprocess.run([harness, '--check', atlas] + paths, text=True,
+                                   stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+                if r.returncode:
+                    print('%s:\n%s' % (tag, r.stdout))
+                    failures += 1
+        # 12 animated types of 4 frames each, 16x16 to 32x32
+        paths = []
+        for i in range(48):
+            size = 16 << (i // 4 % 2)
+            path = os.path.join(tmp, 'scene%d.bin' % i)
+            with open(path, 'wb') as f:
+                f.write(b''.join(p.to_bytes(2, 'little') for p in image(rng, 'disc', size, 16)))
+            paths.append(path)
+        atlas, f = pack(tmp, 'scene', 16, True, paths)
+        failures += f
+        r = subprocess.run([harness, '--scene', atlas], text=True, stdout=subprocess.PIPE)
+        print(r.stdout, end='')
+        failures += r.returncode != 0
+    print('test_sprite_atlas.py: ' + ('%d failure(s)' % failures if failures else 'ok'))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,185 @@
+#include <string.h>
+#include <time.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "sprite.h"
+#include "sprite_bins.h"
+
+// Renders random sprite lists through sprite_bins and by calling
+// sprite_sprite8/16 for every sprite on every line, and compares the frames.
+// Then times both at 64, 256 and 1024 sprites. The sprite visit counts are
+// what matters on the RP2040 (each visit is an intersection test, plus a blit
+// if the sprite is on the line); host times are only a rough guide.
+
+#define FRAME_W 640
+#define FRAME_H 480
+#define MAX_SPRITES 1024
+#define MAX_LOG_SIZE 5
+#define MAX_BANDS (FRAME_H >> 2)
+// Bands of 2^log_band_height lines, enough to cover the frame
+#define N_BANDS(log_band_height) ((FRAME_H + (1 << (log_band_height)) - 1) >> (log_band_height))
+// Enough for every sprite to touch as many bands as it can at the smallest
+// band height tested
+#define MAX_ENTRIES (MAX_SPRITES * ((1 << MAX_LOG_SIZE >> 2) + 1))
+
+static uint8_t frame8[2][FRAME_H][FRAME_W];
+static uint16_t frame16[2][FRAME_H][FRAME_W];
+
+static sprite_t sprites[MAX_SPRITES];
+// Room for the largest sprite, at 16bpp, plus its opacity metadata
+static uint16_t imgs[MAX_LOG_SIZE + 1][(1 << 2 * MAX_LOG_SIZE) + 2 * (1 << MAX_LOG_SIZE)];
+
+static uint16_t band_start[MAX_BANDS + 1];
+static uint16_t entries[MAX_ENTRIES];
+
+// Random pixels, about half transparent, and a random opaque span per row
+static void random_images(void) {
+	for (uint log_size = 0; log_size <= MAX_LOG_SIZE; ++log_size) {
+		uint size = 1u << log_size;
+		for (uint i = 0; i < size * size; ++i)
+			imgs[log_size][i] = test_rand();
+		uint32_t *meta8 = (uint32_t*)((uint8_t*)imgs[log_size] + size * size);
+		uint32_t *meta16 = (uint32_t*)(imgs[log_size] + size * size);
+		uint32_t meta[1 << MAX_LOG_SIZE];
+		for (uint y = 0; y < size; ++y) {
+			uint start = test_rand_range(0, size);
+			uint end = test_rand_range(start, size);
+			meta[y] = (test_rand() & 1u) << 31 | start << 16 | end;
+		}
+		// The 8bpp metadata overlaps the 16bpp pixels, which only makes
+		// those pixels a little less random
+		memcpy(meta16, meta, size * sizeof(uint32_t));
+		memcpy(meta8, meta, size * sizeof(uint32_t));
+	}
+}
+
+static void random_sprites(uint n) {
+	for (uint i = 0; i < n; ++i) {
+		sprite_t *sp = &sprites[i];
+		sp->log_size = test_rand_range(0, MAX_LOG_SIZE);
+		int size = 1 << sp->log_size;
+		sp->x = test_rand_range(-size - 8, FRAME_W + 8);
+		sp->y = test_rand_range(-size - 8, FRAME_H + 8);
+		sp->img = imgs[sp->log_size];
+		sp->has_opacity_metadata = test_rand() & 1;
+		sp->hflip = test_rand() & 1;
+		sp->vflip = test_rand() & 1;
+	}
+}
+
+static void render_naive8(uint8_t (*frame)[FRAME_W], uint n) {
+	for (uint y = 0; y < FRAME_H; ++y)
+		for (uint i = 0; i < n; ++i)
+			sprite_sprite8(frame[y], &sprites[i], y, FRAME_W);
+}
+
+static void render_naive16(uint16_t (*frame)[FRAME_W], uint n) {
+	for (uint y = 0; y < FRAME_H; ++y)
+		for (uint i = 0; i < n; ++i)
+			sprite_sprite16(frame[y], &sprites[i], y, FRAME_W);
+}
+
+static void render_bins8(uint8_t (*frame)[FRAME_W], sprite_bins_t *bins, uint n) {
+	sprite_bins_build(bins, sprites, n);
+	for (uint y = 0; y < FRAME_H; ++y)
+		sprite_bins_render8(frame[y], bins, y, FRAME_W);
+}
+
+static void render_bins16(uint16_t (*frame)[FRAME_W], sprite_bins_t *bins, uint n) {
+	sprite_bins_build(bins, sprites, n);
+	for (uint y = 0; y < FRAME_H; ++y)
+		sprite_bins_render16(frame[y], bins, y, FRAME_W);
+}
+
+static void clear_frames(void) {
+	memset(frame8, 0, sizeof(frame8));
+	memset(frame16, 0, sizeof(frame16));
+}
+
+static void test_matches_naive(void) {
+	for (int trial = 0; trial < 40; ++trial) {
+		uint n = test_rand_range(0, 200);
+		uint log_band_height = test_rand_range(2, 6);
+		sprite_bins_t bins;
+		sprite_bins_init(&bins, log_band_height, N_BANDS(log_band_height), band_start, entries, MAX_ENTRIES);
+		random_sprites(n);
+		clear_frames();
+		render_naive8(frame8[0], n);
+		render_bins8(frame8[1], &bins, n);
+		CHECK(bins.n_dropped == 0);
+		CHECK(!memcmp(frame8[0], frame8[1], sizeof(frame8[0])));
+		render_naive16(frame16[0], n);
+		render_bins16(frame16[1], &bins, n);
+		CHECK(!memcmp(frame16[0], frame16[1], sizeof(frame16[0])));
+	}
+}
+
+// With too few entries, the frontmost sprites are dropped, and the rest are
+// drawn as if the list were that much shorter.
+static void test_dropped(void) {
+	for (int trial = 0; trial < 20; ++trial) {
+		uint n = test_rand_range(20, 200);
+		uint max_entries = test_rand_range(0, n);
+		sprite_bins_t bins;
+		sprite_bins_init(&bins, 4, N_BANDS(4), band_start, entries, max_entries);
+		random_sprites(n);
+		clear_frames();
+		render_bins8(frame8[1], &bins, n);
+		CHECK(bins.n_dropped <= n);
+		CHECK(bins.band_start[bins.n_bands] <= max_entries);
+		render_naive8(frame8[0], n - bins.n_dropped);
+		CHECK(!memcmp(frame8[0], frame8[1], sizeof(frame8[0])));
+	}
+}
+
+static double now_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// 16x16 sprites spread over the screen, as in a typical game scene
+static void bench(void) {
+	static const uint counts[] = {64, 256, 1024};
+	const uint log_band_height = 4;
+	const int reps = 5;
+	printf("sprites  visits/frame (naive, bins)  host us/frame 8bpp (naive, bins)\n");
+	for (uint c = 0; c < count_of(counts); ++c) {
+		uint n = counts[c];
+		random_sprites(n);
+		for (uint i = 0; i < n; ++i) {
+			sprites[i].log_size = 4;
+			sprites[i].img = imgs[4];
+			sprites[i].x = test_rand_range(-8, FRAME_W - 8);
+			sprites[i].y = test_rand_range(-8, FRAME_H - 8);
+		}
+		sprite_bins_t bins;
+		sprite_bins_init(&bins, log_band_height, N_BANDS(log_band_height), band_start, entries, MAX_ENTRIES);
+
+		double t0 = now_us();
+		for (int r = 0; r < reps; ++r)
+			render_naive8(frame8[0], n);
+		double t1 = now_us();
+		for (int r = 0; r < reps; ++r)
+			render_bins8(frame8[1], &bins, n);
+		double t2 = now_us();
+		CHECK(!memcmp(frame8[0], frame8[1], sizeof(frame8[0])));
+
+		uint visits = 0;
+		for (uint y = 0; y < FRAME_H; ++y) {
+			uint band = y >> log_band_height;
+			visits += bins.band_start[band + 1] - bins.band_start[band];
+		}
+		printf("%7u  %12u %12u  %14.0f %8.0f\n", n, n * FRAME_H, visits,
+			(t1 - t0) / reps, (t2 - t1) / reps);
+	}
+}
+
+int main(int argc, char **argv) {
+	random_images();
+	test_matches_naive();
+	test_dropped();
+	bench();
+	return test_result("test_sprite_bins");
+}
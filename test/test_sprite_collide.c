@@ -0,0 +1,263 @@
+#include <string.h>
+#include <time.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "sprite.h"
+#include "sprite_collide.h"
+
+// Checks sprite_collide_pair() against a brute-force pixel overlap, and
+// sprite_collide_find() against testing every pair, including sprites off
+// the edges of the grid and storage too small for the scene. Then counts
+// pair tests and times the grid against all pairs, for 64 to 512 sprites.
+// As with test_sprite_bins, the pair counts are what carry over to the
+// RP2040; host times are only a rough guide.
+
+#define SCREEN_W 320
+#define SCREEN_H 240
+#define MAX_SPRITES 512
+#define MAX_LOG_SIZE 5
+#define MIN_LOG_CELL 3
+#define MAX_CELLS ((SCREEN_W >> MIN_LOG_CELL) * (SCREEN_H >> MIN_LOG_CELL))
+// Every sprite touching as many cells as it can, at the smallest cell size
+#define MAX_ENTRIES (MAX_SPRITES * ((1 << MAX_LOG_SIZE >> MIN_LOG_CELL) + 1) * ((1 << MAX_LOG_SIZE >> MIN_LOG_CELL) + 1))
+#define MAX_CONTACTS (MAX_SPRITES * 16)
+
+static sprite_t sprites[MAX_SPRITES];
+// Pixels then opacity metadata, at 8bpp and 16bpp, two images per size
+#define IMG_WORDS ((1 << 2 * MAX_LOG_SIZE) + 2 * (1 << MAX_LOG_SIZE))
+static uint8_t imgs8[MAX_LOG_SIZE + 1][2][IMG_WORDS * 2] __attribute__((aligned(4)));
+static uint16_t imgs16[MAX_LOG_SIZE + 1][2][IMG_WORDS];
+
+static uint16_t cell_start[MAX_CELLS + 1];
+static uint16_t entries[MAX_ENTRIES];
+static sprite_contact_t contacts[MAX_CONTACTS];
+// All-pairs result, as a bit per pair
+static uint8_t expect[MAX_SPRITES][MAX_SPRITES];
+
+static bool alpha_at(const void *img, uint idx, uint pixel_bytes) {
+	return pixel_bytes == 2 ? ((const uint16_t*)img)[idx] & 0x20 : ((const uint8_t*)img)[idx] & 0x20;
+}
+
+// A blob with ragged edges and the odd hole, so rows come both solid and
+// not, and metadata worked out from the pixels as sprite_atlas_pack.py does
+static void random_image(void *img, uint log_size, uint pixel_bytes) {
+	uint size = 1u << log_size;
+	for (uint y = 0; y < size; ++y) {
+		int x0 = test_rand_range(0, size / 2);
+		int x1 = test_rand_range(size / 2, size);
+		bool empty = test_rand() % 8 == 0;
+		for (uint x = 0; x < size; ++x) {
+			bool opaque = !empty && (int)x >= x0 && (int)x < x1 && test_rand() % 6;
+			uint16_t v = (test_rand() & ~0x20u) | (opaque ? 0x20 : 0);
+			if (pixel_bytes == 2)
+				((uint16_t*)img)[y * size + x] = v;
+			else
+				((uint8_t*)img)[y * size + x] = v;
+		}
+	}
+	uint32_t *meta = (uint32_t*)((uint8_t*)img + size * size * pixel_bytes);
+	for (uint y = 0; y < size; ++y) {
+		int start = -1, end = 0;
+		uint n = 0;
+		for (uint x = 0; x < size; ++x) {
+			if (alpha_at(img, y * size + x, pixel_bytes)) {
+				if (start < 0)
+					start = x;
+				end = x + 1;
+				++n;
+			}
+		}
+		meta[y] = start < 0 ? 0 : (uint32_t)(n == (uint)(end - start)) << 31 | start << 16 | end;
+	}
+}
+
+static void random_images(void) {
+	for (uint log_size = 0; log_size <= MAX_LOG_SIZE; ++log_size) {
+		for (uint k = 0; k < 2; ++k) {
+			random_image(imgs8[log_size][k], log_size, 1);
+			random_image(imgs16[log_size][k], log_size, 2);
+		}
+	}
+}
+
+static void random_sprite(sprite_t *sp, uint pixel_bytes, int w, int h) {
+	sp->log_size = test_rand_range(0, MAX_LOG_SIZE);
+	int size = 1 << sp->log_size;
+	sp->x = test_rand_range(-size - 8, w + 8);
+	sp->y = test_rand_range(-size - 8, h + 8);
+	uint k = test_rand() & 1;
+	sp->img = pixel_bytes == 2 ? (const void*)imgs16[sp->log_size][k] : (const void*)imgs8[sp->log_size][k];
+	sp->has_opacity_metadata = test_rand() % 4 != 0;
+	sp->hflip = test_rand() & 1;
+	sp->vflip = test_rand() & 1;
+}
+
+// What the narrowphase approximates: some screen pixel opaque in both. A
+// sprite without metadata is a solid square.
+static bool opaque_at(const sprite_t *sp, int sx, int sy, uint pixel_bytes) {
+	int size = 1 << sp->log_size;
+	int x = sx - sp->x, y = sy - sp->y;
+	if (x < 0 || x >= size || y < 0 || y >= size)
+		return false;
+	if (!sp->has_opacity_metadata)
+		return true;
+	if (sp->hflip)
+		x = size - 1 - x;
+	if (sp->vflip)
+		y = size - 1 - y;
+	return alpha_at(sp->img, y * size + x, pixel_bytes);
+}
+
+static bool brute_force_pair(const sprite_t *a, const sprite_t *b, uint pixel_bytes) {
+	for (int y = MAX(a->y, b->y); y < MIN(a->y + (1 << a->log_size), b->y + (1 << b->log_size)); ++y)
+		for (int x = MAX(a->x, b->x); x < MIN(a->x + (1 << a->log_size), b->x + (1 << b->log_size)); ++x)
+			if (opaque_at(a, x, y, pixel_bytes) && opaque_at(b, x, y, pixel_bytes))
+				return true;
+	return false;
+}
+
+static void test_pair(void) {
+	uint n_hits = 0, n_span_only = 0;
+	for (int trial = 0; trial < 50000; ++trial) {
+		uint pb = trial & 1 ? 2 : 1;
+		sprite_t a, b;
+		random_sprite(&a, pb, 0, 0);
+		random_sprite(&b, pb, 0, 0);
+		// Close enough that the boxes usually overlap
+		b.x = a.x + test_rand_range(-(1 << b.log_size), 1 << a.log_size);
+		b.y = a.y + test_rand_range(-(1 << b.log_size), 1 << a.log_size);
+		bool want = brute_force_pair(&a, &b, pb);
+		bool exact = sprite_collide_pair(&a, &b, pb, true);
+		bool span = sprite_collide_pair(&a, &b, pb, false);
+		CHECK(exact == want);
+		CHECK(sprite_collide_pair(&b, &a, pb, true) == want);
+		// Span mode may report near misses, never miss a hit
+		CHECK(span || !want);
+		n_hits += want;
+		n_span_only += span && !want;
+	}
+	// Plenty of both outcomes, and span mode does approximate
+	CHECK(n_hits > 10000 && n_hits < 40000 && n_span_only > 100);
+}
+
+static uint all_pairs(uint n, uint pixel_bytes, bool pixel_exact) {
+	uint count = 0;
+	for (uint i = 0; i < n; ++i) {
+		for (uint j = i + 1; j < n; ++j) {
+			expect[i][j] = sprite_collide_pair(&sprites[i], &sprites[j], pixel_bytes, pixel_exact);
+			count += expect[i][j];
+		}
+	}
+	return count;
+}
+
+// Every contact is an expected one, listed once with a < b; returns how many
+static uint check_contacts(const sprite_contact_t *c, uint n_contacts, uint n) {
+	static uint8_t seen[MAX_SPRITES][MAX_SPRITES];
+	memset(seen, 0, sizeof(seen));
+	uint bad = 0;
+	for (uint k = 0; k < n_contacts; ++k) {
+		uint a = c[k].a, b = c[k].b;
+		if (a >= b || b >= n || !expect[a][b] || seen[a][b])
+			++bad;
+		else
+			seen[a][b] = 1;
+	}
+	CHECK(bad == 0);
+	return n_contacts - bad;
+}
+
+static void test_find(void) {
+	for (int trial = 0; trial < 100; ++trial) {
+		uint pb = trial & 1 ? 2 : 1;
+		uint log_cell = test_rand_range(MIN_LOG_CELL, 6);
+		uint cells_x = SCREEN_W >> log_cell, cells_y = SCREEN_H >> log_cell;
+		uint n = test_rand_range(0, 300);
+		for (uint i = 0; i < n; ++i)
+			random_sprite(&sprites[i], pb, SCREEN_W, SCREEN_H);
+		sprite_collide_t coll;
+		sprite_collide_init(&coll, log_cell, cells_x, cells_y, cell_start, entries, MAX_ENTRIES, pb);
+		coll.pixel_exact = trial & 2;
+		uint want = all_pairs(n, pb, coll.pixel_exact);
+		uint got = sprite_collide_find(&coll, sprites, n, contacts, MAX_CONTACTS);
+		CHECK(coll.n_dropped == 0);
+		CHECK(got == want && coll.stats.contacts == want && coll.stats.contacts_dropped == 0);
+		CHECK(check_contacts(contacts, got, n) == want);
+		CHECK(coll.stats.pairs_narrow <= coll.stats.pairs_checked);
+	}
+}
+
+// Too few entries: the highest-index sprites are left out, and the rest
+// collide as if the list were that much shorter. Too few contacts: the
+// first max_contacts are written and the rest counted.
+static void test_storage_full(void) {
+	for (int trial = 0; trial < 40; ++trial) {
+		uint n = test_rand_range(50, 300);
+		for (uint i = 0; i < n; ++i)
+			random_sprite(&sprites[i], 2, SCREEN_W, SCREEN_H);
+		sprite_collide_t coll;
+		uint max_entries = test_rand_range(0, 2 * n);
+		sprite_collide_init(&coll, 4, SCREEN_W >> 4, SCREEN_H >> 4, cell_start, entries, max_entries, 2);
+		uint got = sprite_collide_find(&coll, sprites, n, contacts, MAX_CONTACTS);
+		CHECK(coll.n_dropped <= n && coll.cell_start[coll.cells_x * coll.cells_y] <= max_entries);
+		uint want = all_pairs(n - coll.n_dropped, 2, false);
+		CHECK(got == want && check_contacts(contacts, got, n - coll.n_dropped) == want);
+
+		sprite_collide_init(&coll, 4, SCREEN_W >> 4, SCREEN_H >> 4, cell_start, entries, MAX_ENTRIES, 2);
+		want = all_pairs(n, 2, false);
+		uint max_contacts = test_rand_range(0, want);
+		got = sprite_collide_find(&coll, sprites, n, contacts, max_contacts);
+		CHECK(got == max_contacts && coll.stats.contacts == want);
+		CHECK(coll.stats.contacts_dropped == want - max_contacts);
+		check_contacts(contacts, got, n);
+	}
+}
+
+static double now_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// 16x16 sprites with metadata spread over the screen, 16-pixel cells
+static void bench(void) {
+	static const uint counts[] = {64, 128, 256, 512};
+	const int reps = 20;
+	printf("sprites  pair tests (all pairs, grid)  contacts  host us (all pairs, grid)\n");
+	for (uint c = 0; c < count_of(counts); ++c) {
+		uint n = counts[c];
+		for (uint i = 0; i < n; ++i) {
+			random_sprite(&sprites[i], 2, SCREEN_W, SCREEN_H);
+			sprites[i].log_size = 4;
+			sprites[i].img = imgs16[4][i & 1];
+			sprites[i].has_opacity_metadata = true;
+			sprites[i].x = test_rand_range(-8, SCREEN_W - 8);
+			sprites[i].y = test_rand_range(-8, SCREEN_H - 8);
+		}
+		sprite_collide_t coll;
+		sprite_collide_init(&coll, 4, SCREEN_W >> 4, SCREEN_H >> 4, cell_start, entries, MAX_ENTRIES, 2);
+
+		double t0 = now_us();
+		uint want = 0;
+		for (int r = 0; r < reps; ++r)
+			want = all_pairs(n, 2, false);
+		double t1 = now_us();
+		uint got = 0;
+		for (int r = 0; r < reps; ++r)
+			got = sprite_collide_find(&coll, sprites, n, contacts, MAX_CONTACTS);
+		double t2 = now_us();
+		CHECK(got == want);
+		printf("%7u  %12u %10u  %9u  %12.1f %7.1f\n", n, n * (n - 1) / 2, coll.stats.pairs_checked, got,
+			(t1 - t0) / reps, (t2 - t1) / reps);
+	}
+}
+
+int main(int argc, char **argv) {
+	random_images();
+	test_pair();
+	test_find();
+	test_storage_full();
+	bench();
+	return test_result("test_sprite_collide");
+}
@@ -0,0 +1,216 @@
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "sprite.h"
+#include "sprite_bins.h"
+#include "sprite_cull.h"
+#include "tile.h"
+
+// Checks the occlusion-culled compositor against the painter's algorithm
+// (tile16() then sprite_sprite8/16() for every sprite, back to front), with
+// and without a tile background, through an order list, and through
+// sprite_bins. Also built with tiny scratch lists, to cover the overflow
+// paths. Then reports pixels written per line with and without culling.
+
+#define FRAME_W 640
+#define FRAME_H 480
+#define MAX_SPRITES 256
+#define MAX_LOG_SIZE 6
+
+static uint8_t line8[2][FRAME_W];
+static uint16_t line16[2][FRAME_W];
+
+static sprite_t sprites[MAX_SPRITES];
+static uint16_t order[MAX_SPRITES];
+static uint16_t imgs[MAX_LOG_SIZE + 1][(1 << 2 * MAX_LOG_SIZE) + 2 * (1 << MAX_LOG_SIZE)];
+
+static sprite_cull_scratch_t scratch;
+
+// 16x16 tiles, 16bpp, on a 1024 x 512 px map
+#define TILE_LOG_MAP_W 10
+#define TILE_LOG_MAP_H 9
+static uint16_t tileset[16 * 16 * 16];
+static uint8_t tilemap[(1 << TILE_LOG_MAP_W >> 4) * (1 << TILE_LOG_MAP_H >> 4)];
+static int16_t xscroll_line[FRAME_H];
+static tilebg_t bg;
+
+// Random pixels, and per row a random opaque span which is solid with
+// probability solid_percent
+static void random_images(uint solid_percent) {
+	for (uint log_size = 0; log_size <= MAX_LOG_SIZE; ++log_size) {
+		uint size = 1u << log_size;
+		for (uint i = 0; i < size * size; ++i)
+			imgs[log_size][i] = test_rand();
+		uint32_t meta[1 << MAX_LOG_SIZE];
+		for (uint y = 0; y < size; ++y) {
+			uint start = test_rand_range(0, size / 4);
+			uint end = test_rand_range(size - size / 4, size);
+			meta[y] = (test_rand() % 100 < solid_percent) << 31 | start << 16 | end;
+		}
+		// 8bpp metadata lands inside the 16bpp pixels, which is harmless
+		memcpy(imgs[log_size] + size * size, meta, size * sizeof(uint32_t));
+		memcpy((uint8_t*)imgs[log_size] + size * size, meta, size * sizeof(uint32_t));
+	}
+}
+
+static void random_sprites(uint n, uint min_log_size, uint max_log_size) {
+	for (uint i = 0; i < n; ++i) {
+		sprite_t *sp = &sprites[i];
+		sp->log_size = test_rand_range(min_log_size, max_log_size);
+		int size = 1 << sp->log_size;
+		sp->x = test_rand_range(-size, FRAME_W);
+		sp->y = test_rand_range(-size, FRAME_H);
+		sp->img = imgs[sp->log_size];
+		sp->has_opacity_metadata = test_rand() % 4 != 0;
+		sp->hflip = test_rand() & 1;
+		sp->vflip = test_rand() & 1;
+		order[i] = i;
+	}
+	for (uint i = n; i > 1; --i) {
+		uint j = test_rand() % i;
+		uint16_t t = order[i - 1];
+		order[i - 1] = order[j];
+		order[j] = t;
+	}
+}
+
+static void random_bg(void) {
+	for (uint i = 0; i < count_of(tileset); ++i)
+		tileset[i] = test_rand();
+	for (uint i = 0; i < count_of(tilemap); ++i)
+		tilemap[i] = test_rand() % 16;
+	for (uint y = 0; y < FRAME_H; ++y)
+		xscroll_line[y] = test_rand_range(-100, 100);
+	bg = (tilebg_t){
+		.xscroll = test_rand(),
+		.yscroll = test_rand(),
+		.tileset = tileset,
+		.tilemap = tilemap,
+		.xscroll_line = test_rand() & 1 ? xscroll_line : NULL,
+		.log_size_x = TILE_LOG_MAP_W,
+		.log_size_y = TILE_LOG_MAP_H,
+		.tilesize = TILESIZE_16,
+		.fill_loop = (tile_loop_t)tile16_16px_loop
+	};
+}
+
+static const sprite_t *nth(const uint16_t *ord, uint i) {
+	return &sprites[ord ? ord[i] : i];
+}
+
+static void painter8(uint8_t *scanbuf, const uint16_t *ord, uint n, uint y) {
+	for (uint i = 0; i < n; ++i)
+		sprite_sprite8(scanbuf, nth(ord, i), y, FRAME_W);
+}
+
+static void painter16(uint16_t *scanbuf, const tilebg_t *tbg, const uint16_t *ord, uint n, uint y) {
+	if (tbg)
+		tile16(scanbuf, tbg, y, FRAME_W);
+	for (uint i = 0; i < n; ++i)
+		sprite_sprite16(scanbuf, nth(ord, i), y, FRAME_W);
+}
+
+// Pixels the painter's algorithm writes: the whole background, plus each
+// sprite row clipped to the raster and its opaque span
+static uint painter_written(const tilebg_t *tbg, const uint16_t *ord, uint n, uint y, uint pixel_bytes) {
+	uint written = tbg ? FRAME_W : 0;
+	for (uint i = 0; i < n; ++i) {
+		const sprite_t *sp = nth(ord, i);
+		int size = 1 << sp->log_size;
+		int ty = (int)y - sp->y;
+		if (ty < 0 || ty >= size)
+			continue;
+		int x0 = MAX(0, sp->x);
+		int x1 = MIN(sp->x + size, FRAME_W);
+		if (sp->has_opacity_metadata) {
+			ty = sp->vflip ? size - 1 - ty : ty;
+			uint32_t meta = ((const uint32_t*)((const uint8_t*)sp->img + size * size * pixel_bytes))[ty];
+			if (sp->hflip)
+				meta = sprite_mirror_metadata(meta, size);
+			x0 = MAX(x0, sp->x + (int)((meta >> 16) & 0x7fff));
+			x1 = MIN(x1, sp->x + (int)(meta & 0xffff));
+		}
+		written += MAX(0, x1 - x0);
+	}
+	return written;
+}
+
+static void test_matches_painter(void) {
+	for (int trial = 0; trial < 30; ++trial) {
+		random_images(test_rand_range(0, 100));
+		uint n = test_rand_range(0, 120);
+		random_sprites(n, 2, MAX_LOG_SIZE);
+		random_bg();
+		const uint16_t *ord = trial & 1 ? order : NULL;
+		for (uint y = 0; y < FRAME_H; ++y) {
+			memset(line8, 0, sizeof(line8));
+			painter8(line8[0], ord, n, y);
+			uint written = sprite_cull_render8(line8[1], &scratch, sprites, ord, n, y, FRAME_W);
+			CHECK(!memcmp(line8[0], line8[1], sizeof(line8[0])));
+			CHECK(written <= painter_written(NULL, ord, n, y, sizeof(uint8_t)));
+
+			const tilebg_t *tbg = y & 1 ? &bg : NULL;
+			memset(line16, 0, sizeof(line16));
+			painter16(line16[0], tbg, ord, n, y);
+			written = sprite_cull_render16(line16[1], &scratch, tbg, sprites, ord, n, y, FRAME_W);
+			CHECK(!memcmp(line16[0], line16[1], sizeof(line16[0])));
+			// Background gaps are widened to whole tiles, but never overlap
+			CHECK(written <= painter_written(tbg, ord, n, y, sizeof(uint16_t)));
+		}
+	}
+}
+
+static uint16_t band_start[(FRAME_H >> 4) + 1];
+static uint16_t entries[MAX_SPRITES * ((1 << MAX_LOG_SIZE >> 4) + 1)];
+
+static void test_bins(void) {
+	for (int trial = 0; trial < 10; ++trial) {
+		random_images(test_rand_range(0, 100));
+		uint n = test_rand_range(0, MAX_SPRITES);
+		random_sprites(n, 2, MAX_LOG_SIZE);
+		random_bg();
+		sprite_bins_t bins;
+		sprite_bins_init(&bins, 4, FRAME_H >> 4, band_start, entries, count_of(entries));
+		sprite_bins_build(&bins, sprites, n);
+		for (uint y = 0; y < FRAME_H; ++y) {
+			memset(line8, 0, sizeof(line8));
+			sprite_bins_render8(line8[0], &bins, y, FRAME_W);
+			sprite_bins_cull_render8(line8[1], &scratch, &bins, y, FRAME_W);
+			CHECK(!memcmp(line8[0], line8[1], sizeof(line8[0])));
+
+			memset(line16, 0, sizeof(line16));
+			tile16(line16[0], &bg, y, FRAME_W);
+			sprite_bins_render16(line16[0], &bins, y, FRAME_W);
+			sprite_bins_cull_render16(line16[1], &scratch, &bg, &bins, y, FRAME_W);
+			CHECK(!memcmp(line16[0], line16[1], sizeof(line16[0])));
+		}
+	}
+}
+
+// Mostly-solid 16x16 and 32x32 sprites over a tile background
+static void bench(void) {
+	static const uint counts[] = {16, 64, 256};
+	printf("sprites  16bpp pixels written/line (painter, culled)  scratch: %u spans, %u pieces\n",
+		SPRITE_CULL_MAX_COVERED, SPRITE_CULL_MAX_PIECES);
+	random_images(90);
+	random_bg();
+	bg.xscroll_line = NULL;
+	for (uint c = 0; c < count_of(counts); ++c) {
+		uint n = counts[c];
+		random_sprites(n, 4, 5);
+		uint64_t painter = 0, culled = 0;
+		for (uint y = 0; y < FRAME_H; ++y) {
+			painter += painter_written(&bg, NULL, n, y, sizeof(uint16_t));
+			culled += sprite_cull_render16(line16[1], &scratch, &bg, sprites, NULL, n, y, FRAME_W);
+		}
+		printf("%7u  %20.1f %10.1f\n", n, (double)painter / FRAME_H, (double)culled / FRAME_H);
+	}
+}
+
+int main(int argc, char **argv) {
+	test_matches_painter();
+	test_bins();
+	bench();
+	return test_result("test_sprite_cull");
+}
@@ -0,0 +1,187 @@
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "sprite.h"
+#include "sprite_ref.h"
+
+// Checks sprite_sprite8/16() against sprite_ref.c with every combination of
+// hflip, vflip and opacity metadata, clipped at both raster edges, and that
+// an hflipped sprite draws the same as a mirrored copy of its image. The
+// blits here are the C stand-ins from sprite_blit_host.c.
+//
+// "--dump seed" instead prints random spans for the forward and mirrored
+// blits, with the C stand-ins' output as the golden result, for
+// test_sprite_flip.py to run through the sprite.S loops.
+
+#define LINE_W 320
+#define MAX_LOG_SIZE 6
+#define IMG_WORDS ((1 << 2 * MAX_LOG_SIZE) + (1 << MAX_LOG_SIZE) * 2)
+
+static uint8_t line8[2][LINE_W];
+static uint16_t line16[2][LINE_W];
+// Pixels then metadata; the 8bpp image uses the first half of the bytes
+static uint16_t img[2][IMG_WORDS];
+
+static uint32_t *metadata(uint16_t *pixels, uint log_size, uint pixel_bytes) {
+	return (uint32_t*)((uint8_t*)pixels + (pixel_bytes << 2 * log_size));
+}
+
+static void random_image(uint log_size, uint pixel_bytes) {
+	uint size = 1u << log_size;
+	uint8_t *p = (uint8_t*)img[0];
+	for (uint i = 0; i < (pixel_bytes << 2 * log_size); ++i)
+		p[i] = test_rand() | (test_rand() % 3 ? 0x20 : 0);
+	uint32_t *meta = metadata(img[0], log_size, pixel_bytes);
+	for (uint y = 0; y < size; ++y) {
+		uint start = test_rand_range(0, size / 2);
+		uint end = test_rand_range(start, size);
+		meta[y] = (test_rand() % 3 == 0) << 31 | start << 16 | end;
+	}
+}
+
+// img[1] = img[0] mirrored left to right, metadata included
+static void mirror_image(uint log_size, uint pixel_bytes) {
+	uint size = 1u << log_size;
+	const uint8_t *src = (const uint8_t*)img[0];
+	uint8_t *dst = (uint8_t*)img[1];
+	for (uint y = 0; y < size; ++y)
+		for (uint x = 0; x < size; ++x)
+			memcpy(dst + ((y * size + x) * pixel_bytes), src + ((y * size + size - 1 - x) * pixel_bytes), pixel_bytes);
+	const uint32_t *meta = metadata(img[0], log_size, pixel_bytes);
+	uint32_t *mmeta = metadata(img[1], log_size, pixel_bytes);
+	for (uint y = 0; y < size; ++y)
+		mmeta[y] = sprite_mirror_metadata(meta[y], size);
+}
+
+static void random_lines(void) {
+	for (uint x = 0; x < LINE_W; ++x) {
+		line8[0][x] = line8[1][x] = test_rand();
+		line16[0][x] = line16[1][x] = test_rand();
+	}
+}
+
+static void test_matches_ref(void) {
+	for (int trial = 0; trial < 2000; ++trial) {
+		bool bpp16 = trial & 1;
+		uint pixel_bytes = bpp16 ? 2 : 1;
+		sprite_t sp = {
+			.log_size = test_rand_range(0, MAX_LOG_SIZE),
+			.img = img[0],
+			.has_opacity_metadata = test_rand() & 1,
+			.hflip = test_rand() & 1,
+			.vflip = test_rand() & 1
+		};
+		int size = 1 << sp.log_size;
+		sp.x = test_rand_range(-size, LINE_W);
+		sp.y = test_rand_range(-1, 1);
+		random_image(sp.log_size, pixel_bytes);
+		for (int y = 0; y <= size; ++y) {
+			random_lines();
+			if (bpp16) {
+				sprite_sprite16(line16[0], &sp, y, LINE_W);
+				sprite_sprite16_ref(line16[1], &sp, y, LINE_W);
+				CHECK(!memcmp(line16[0], line16[1], sizeof(line16[0])));
+			}
+			else {
+				sprite_sprite8(line8[0], &sp, y, LINE_W);
+				sprite_sprite8_ref(line8[1], &sp, y, LINE_W);
+				CHECK(!memcmp(line8[0], line8[1], sizeof(line8[0])));
+			}
+		}
+	}
+}
+
+static void test_matches_mirrored_copy(void) {
+	for (int trial = 0; trial < 500; ++trial) {
+		bool bpp16 = trial & 1;
+		uint pixel_bytes = bpp16 ? 2 : 1;
+		sprite_t flipped = {
+			.log_size = test_rand_range(0, MAX_LOG_SIZE),
+			.img = img[0],
+			.has_opacity_metadata = test_rand() & 1,
+			.hflip = true,
+			.vflip = test_rand() & 1
+		};
+		int size = 1 << flipped.log_size;
+		flipped.x = test_rand_range(-size, LINE_W);
+		sprite_t copy = flipped;
+		copy.img = img[1];
+		copy.hflip = false;
+		random_image(flipped.log_size, pixel_bytes);
+		mirror_image(flipped.log_size, pixel_bytes);
+		for (int y = 0; y < size; ++y) {
+			random_lines();
+			if (bpp16) {
+				sprite_sprite16(line16[0], &flipped, y, LINE_W);
+				sprite_sprite16(line16[1], &copy, y, LINE_W);
+				CHECK(!memcmp(line16[0], line16[1], sizeof(line16[0])));
+			}
+			else {
+				sprite_sprite8(line8[0], &flipped, y, LINE_W);
+				sprite_sprite8(line8[1], &copy, y, LINE_W);
+				CHECK(!memcmp(line8[0], line8[1], sizeof(line8[0])));
+			}
+		}
+	}
+}
+
+typedef void (*blit_t)(void *dst, const void *src, uint len);
+
+static const struct {
+	const char *name;
+	blit_t blit;
+	uint pixel_bytes;
+} blits[] = {
+	{"sprite_blit8", (blit_t)sprite_blit8, 1},
+	{"sprite_blit8_hflip", (blit_t)sprite_blit8_hflip, 1},
+	{"sprite_blit8_alpha", (blit_t)sprite_blit8_alpha, 1},
+	{"sprite_blit8_alpha_hflip", (blit_t)sprite_blit8_alpha_hflip, 1},
+	{"sprite_blit16", (blit_t)sprite_blit16, 2},
+	{"sprite_blit16_hflip", (blit_t)sprite_blit16_hflip, 2},
+	{"sprite_blit16_alpha", (blit_t)sprite_blit16_alpha, 2},
+	{"sprite_blit16_alpha_hflip", (blit_t)sprite_blit16_alpha_hflip, 2},
+};
+
+#define DUMP_PIX 96
+
+static void dump_hex(const char *tag, const void *data, uint n, uint pixel_bytes) {
+	printf("%s", tag);
+	for (uint i = 0; i < n; ++i)
+		printf(" %x", pixel_bytes == 2 ? ((const uint16_t*)data)[i] : ((const uint8_t*)data)[i]);
+	printf("\n");
+}
+
+// A 64-pixel span first (for the cycle counts), then random ones, including
+// odd alignments of src and dst
+static void dump(void) {
+	uint16_t src[DUMP_PIX], dst[DUMP_PIX];
+	for (uint b = 0; b < count_of(blits); ++b) {
+		uint pb = blits[b].pixel_bytes;
+		for (int trial = 0; trial < 200; ++trial) {
+			uint src_offs = trial ? test_rand_range(0, 15) : 0;
+			uint dst_offs = trial ? test_rand_range(0, 15) : 0;
+			uint len = trial ? test_rand_range(1, DUMP_PIX - 16) : 64;
+			for (uint i = 0; i < DUMP_PIX; ++i) {
+				src[i] = test_rand() | (test_rand() % 3 ? 0x20 : 0);
+				dst[i] = test_rand();
+			}
+			printf("call %s %u %u %u %u\n", blits[b].name, pb * 8, dst_offs, src_offs, len);
+			dump_hex("src", src, DUMP_PIX, pb);
+			dump_hex("dst", dst, DUMP_PIX, pb);
+			blits[b].blit((uint8_t*)dst + dst_offs * pb, (const uint8_t*)src + src_offs * pb, len);
+			dump_hex("expect", dst, DUMP_PIX, pb);
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc == 3 && !strcmp(argv[1], "--dump")) {
+		test_rand_state = strtoul(argv[2], NULL, 0);
+		dump();
+		return 0;
+	}
+	test_matches_ref();
+	test_matches_mirrored_copy();
+	return test_result("test_sprite_flip");
+}
@@ -0,0 +1,103 @@
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "sprite.h"
+#include "sprite_ref.h"
+
+// Checks the C version of the word-at-a-time alpha blits (sprite_ref.c)
+// against the per-pixel ones, on spans of every alignment, with transparency
+// in runs (as in sprite art) and pixel by pixel.
+//
+// "--dump seed" instead prints random spans with the per-pixel result as
+// the golden output, for test_sprite_swar.py to run through both sets of
+// sprite.S loops.
+
+#define MAX_PIX 160
+// Room for any offset within a word either side
+#define BUF_PIX (MAX_PIX + 8)
+
+static uint16_t src[BUF_PIX], dst[2][BUF_PIX];
+
+// Alpha in runs of 1-12 pixels, or independently per pixel, with the
+// opaque fraction itself random
+static void random_src(uint pixel_bytes) {
+	uint p_opaque = test_rand_range(0, 100);
+	bool runs = test_rand() & 1;
+	bool opaque = false;
+	uint run = 0;
+	for (uint i = 0; i < BUF_PIX; ++i) {
+		if (!run) {
+			opaque = test_rand_range(1, 100) <= (int)p_opaque;
+			run = runs ? test_rand_range(1, 12) : 1;
+		}
+		--run;
+		uint16_t v = test_rand() & ~0x20u;
+		v |= opaque ? 0x20 : 0;
+		if (pixel_bytes == 1)
+			((uint8_t*)src)[i] = v;
+		else
+			src[i] = v;
+	}
+}
+
+static void random_dst(void) {
+	for (uint i = 0; i < BUF_PIX; ++i)
+		dst[0][i] = dst[1][i] = test_rand();
+}
+
+static void blit(bool swar, uint pixel_bytes, void *d, const void *s, uint len) {
+	if (pixel_bytes == 1)
+		(swar ? sprite_blit8_alpha_swar_ref : sprite_blit8_alpha)(d, s, len);
+	else
+		(swar ? sprite_blit16_alpha_swar_ref : sprite_blit16_alpha)(d, s, len);
+}
+
+static void test_matches_per_pixel(void) {
+	for (int trial = 0; trial < 100000; ++trial) {
+		uint pb = trial & 1 ? 2 : 1;
+		uint src_offs = test_rand_range(0, 4 / pb - 1);
+		uint dst_offs = test_rand_range(0, 4 / pb - 1);
+		uint len = test_rand_range(0, MAX_PIX);
+		random_src(pb);
+		random_dst();
+		for (uint k = 0; k < 2; ++k)
+			blit(k, pb, (uint8_t*)dst[k] + dst_offs * pb, (const uint8_t*)src + src_offs * pb, len);
+		CHECK(!memcmp(dst[0], dst[1], sizeof(dst[0])));
+	}
+}
+
+static void dump_hex(const char *tag, const void *data, uint n, uint pixel_bytes) {
+	printf("%s", tag);
+	for (uint i = 0; i < n; ++i)
+		printf(" %x", pixel_bytes == 2 ? ((const uint16_t*)data)[i] : ((const uint8_t*)data)[i]);
+	printf("\n");
+}
+
+// Same format as test_sprite_flip --dump; each span is run through both
+// the per-pixel and the word-at-a-time loop
+static void dump(void) {
+	for (int trial = 0; trial < 400; ++trial) {
+		uint pb = trial & 1 ? 2 : 1;
+		uint src_offs = test_rand_range(0, 7);
+		uint dst_offs = test_rand_range(0, 7);
+		uint len = test_rand_range(0, MAX_PIX);
+		random_src(pb);
+		random_dst();
+		printf("call sprite_blit%u_alpha %u %u %u %u\n", pb * 8, pb * 8, dst_offs, src_offs, len);
+		dump_hex("src", src, BUF_PIX, pb);
+		dump_hex("dst", dst[0], BUF_PIX, pb);
+		blit(false, pb, (uint8_t*)dst[0] + dst_offs * pb, (const uint8_t*)src + src_offs * pb, len);
+		dump_hex("expect", dst[0], BUF_PIX, pb);
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc == 3 && !strcmp(argv[1], "--dump")) {
+		test_rand_state = strtoul(argv[2], NULL, 0);
+		dump();
+		return 0;
+	}
+	test_matches_per_pixel();
+	return test_result("test_sprite_swar");
+}
@@ -0,0 +1,115 @@
+"""Run the per-pixel and word-at-a-time alpha blits from libsprite/sprite.S on
+spans from test_sprite_swar --dump, and compare both with the golden output.
+Then report emulated cycles per pixel for each, by span length, for spans
+with src and dst co-aligned and misaligned. The spans have transparency in
+runs, as sprite art does; these are what the SPRITE_BLIT8/16_SWAR_MIN_LEN
+thresholds in sprite.h are based on. Transparency that changes pixel by
+pixel is the worst case for the word loops, and is reported separately.
+
+usage: test_sprite_swar.py <path to test_sprite_swar>
+"""
+import os
+import random
+import subprocess
+import sys
+
+from thumb_emu import Machine, assemble
+
+REPO = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+ALPHA = 1 << 5
+LENGTHS = (8, 16, 24, 32, 48, 64, 96, 128)
+# (fraction of runs which are opaque, longest run)
+SPRITE_PATTERNS = ((0.5, 12), (0.9, 12), (1.0, 1))
+NOISE_PATTERNS = ((0.5, 1),)
+SAMPLES = 6
+
+
+def pack(values, bpp):
+    return b''.join(v.to_bytes(bpp // 8, 'little') for v in values)
+
+
+def check(harness, m, seed):
+    lines = subprocess.check_output([harness, '--dump', str(seed)], text=True).splitlines()
+    src = m.alloc(bytes(512))
+    dst = m.alloc(bytes(512))
+    failures = 0
+    for text in lines:
+        f = text.split()
+        if f[0] == 'call':
+            name = f[1]
+            bpp, dst_offs, src_offs, n = map(int, f[2:6])
+        elif f[0] == 'src':
+            m.mem.write_bytes(src, pack([int(x, 16) for x in f[1:]], bpp))
+        elif f[0] == 'dst':
+            before = pack([int(x, 16) for x in f[1:]], bpp)
+        elif f[0] == 'expect':
+            want = pack([int(x, 16) for x in f[1:]], bpp)
+            for loop in (name, name + '_swar'):
+                m.mem.write_bytes(dst, before)
+                m.call(loop, dst + dst_offs * bpp // 8, src + src_offs * bpp // 8, n)
+                got = m.mem.read_bytes(dst, len(want))
+                if got != want:
+                    if failures < 5:
+                        x = next(i for i in range(len(want)) if got[i] != want[i]) * 8 // bpp
+                        print('%s seed %d, dst +%d src +%d len %d: wrong pixel at x = %d'
+                              % (loop, seed, dst_offs, src_offs, n, x))
+                    failures += 1
+    return failures
+
+
+def random_pixels(rng, bpp, n, p_opaque, max_run):
+    pixels = []
+    while len(pixels) < n:
+        alpha = ALPHA if rng.random() < p_opaque else 0
+        for _ in range(rng.randint(1, max_run)):
+            pixels.append(rng.getrandbits(bpp) & ~ALPHA | alpha)
+    return pixels[:n]
+
+
+def bench(m, patterns):
+    """Mean cycles per pixel over the patterns, {(bpp, aligned, n): (per-pixel, swar)}."""
+    rng = random.Random(1)
+    src = m.alloc(bytes(512))
+    dst = m.alloc(bytes(512))
+    result = {}
+    for bpp in (8, 16):
+        pb = bpp // 8
+        for aligned in (True, False):
+            for n in LENGTHS:
+                total = [0, 0]
+                for p_opaque, max_run in patterns:
+                    for _ in range(SAMPLES):
+                        m.mem.write_bytes(src, pack(random_pixels(rng, bpp, 256 // pb, p_opaque, max_run), bpp))
+                        dst_offs = rng.randrange(0, 4, pb)
+                        src_offs = dst_offs if aligned else (dst_offs + rng.randrange(pb, 4, pb)) % 4
+                        for k, loop in enumerate(('sprite_blit%d_alpha' % bpp, 'sprite_blit%d_alpha_swar' % bpp)):
+                            _, cyc = m.call(loop, dst + dst_offs, src + src_offs, n)
+                            total[k] += cyc
+                runs = len(patterns) * SAMPLES * n
+                result[(bpp, aligned, n)] = (total[0] / runs, total[1] / runs)
+    return result
+
+
+def main():
+    harness = sys.argv[1]
+    obj = assemble(os.path.join(REPO, 'libsprite', 'sprite.S'))
+    m = Machine()
+    m.link([obj])
+    failures = 0
+    for seed in (1, 2):
+        failures += check(harness, m, seed)
+    for title, patterns in (('sprite-like', SPRITE_PATTERNS), ('per-pixel noise', NOISE_PATTERNS)):
+        cycles = bench(m, patterns)
+        for bpp in (8, 16):
+            for aligned in (True, False):
+                print('%s, %2dbpp, src and dst %s, cycles/pixel per-pixel vs swar:'
+                      % (title, bpp, 'co-aligned' if aligned else 'misaligned'))
+                for row in (LENGTHS[:4], LENGTHS[4:]):
+                    print('   ' + '  '.join('%3d: %5.2f %5.2f' % ((n,) + cycles[(bpp, aligned, n)]) for n in row))
+    os.unlink(obj)
+    print('test_sprite_swar.py: ' + ('%d failure(s)' % failures if failures else 'ok'))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
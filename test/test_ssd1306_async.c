@@ -0,0 +1,170 @@
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "ssd1306.h"
+#include "ssd1306_host.h"
+
+// Confere a semântica de ssd1306_send_data_async() no painel virtual de
+// ssd1306_host.c, com o envio andando poucos bytes por consulta:
+// - quando o envio termina, o painel mostra a ram_buffer do momento em que
+//   ele começou, mesmo que o quadro seguinte já esteja sendo desenhado;
+// - com um envio em andamento, send_data_async() retorna false sem começar
+//   outro, e as alterações vão no próximo;
+// - ssd1306_send_data() e ssd1306_command() esperam o envio em andamento,
+//   então nada se sobrepõe no barramento;
+// - um envio interrompido (NACK) conta em stats.aborts e faz o próximo
+//   reenviar a tela inteira, mesmo que tenha parado entre um comando e seus
+//   argumentos;
+// - sem stream_start no transporte, send_data_async() envia na hora.
+
+static ssd1306_t ssd;
+#define dev ssd1306_host_dev
+
+// Transporte do painel virtual que interrompe alguns envios no meio
+static uint32_t abort_after;
+
+static int flaky_poll(void *ctx) {
+  if (abort_after && !--abort_after) {
+    dev.stream_pos = dev.stream_len;
+    return SSD1306_STREAM_ABORTED;
+  }
+  return ssd1306_transport_host.stream_poll(ctx);
+}
+
+static ssd1306_transport_t flaky;
+
+static bool panel_is(const uint8_t *buf) {
+  for (uint page = 0; page < ssd.pages; ++page)
+    if (memcmp(dev.gram[page], &buf[1 + page * ssd.width], ssd.width))
+      return false;
+  return true;
+}
+
+// Interrompido: o painel está pela metade, e o próximo envio é a tela
+// inteira (se já não foi, num envio que esperava este)
+static uint32_t aborts;
+static bool in_flight;
+
+static void note_aborts(void) {
+  if (ssd.stats.aborts == aborts)
+    return;
+  aborts = ssd.stats.aborts;
+  abort_after = 0;
+  in_flight = false;
+  for (uint page = 0; page < ssd.pages && !ssd.shadow_valid; ++page)
+    CHECK(ssd.dirty_x0[page] == 0 && ssd.dirty_x1[page] == ssd.width);
+}
+
+static void random_draw(void) {
+  uint8_t x = test_rand_range(0, WIDTH - 1), y = test_rand_range(0, HEIGHT - 1);
+  switch (test_rand() % 4) {
+    case 0:
+      ssd1306_pixel(&ssd, x, y, test_rand() & 1);
+      break;
+    case 1:
+      ssd1306_rect(&ssd, y, x, test_rand_range(1, 60), test_rand_range(1, 30), test_rand() & 1, test_rand() & 1);
+      break;
+    case 2:
+      ssd1306_draw_string(&ssd, test_rand() & 1 ? "OPS: 1234" : "AC: 22C", x, y);
+      break;
+    default:
+      if (test_rand() % 10 == 0)
+        ssd1306_fill(&ssd, test_rand() & 1);
+      break;
+  }
+}
+
+static void test_async(void) {
+  static uint8_t expected[WIDTH * HEIGHT / 8 + 1];
+  flaky = ssd1306_transport_host;
+  flaky.stream_poll = flaky_poll;
+  ssd1306_host_reset(&dev, 0);
+  ssd1306_init(&ssd, WIDTH, HEIGHT, false, 0x3c, NULL);
+  ssd1306_set_transport(&ssd, &flaky, &dev);
+  ssd1306_config(&ssd);
+  uint32_t refused = 0, completed = 0;
+  for (int step = 0; step < 20000; ++step) {
+    if (step % 500 == 0)
+      dev.bytes_per_poll = test_rand_range(1, 200);
+    uint n = test_rand_range(0, 3);
+    for (uint i = 0; i < n; ++i)
+      random_draw();
+
+    switch (test_rand() % 10) {
+      case 7:
+        ssd1306_send_data(&ssd);
+        CHECK(panel_is(ssd.ram_buffer));
+        in_flight = false;
+        break;
+      case 8:
+        // Um comando no meio: espera o envio, que termina inteiro
+        ssd1306_command(&ssd, SET_NORM_INV | (test_rand() & 1));
+        CHECK(!ssd1306_busy(&ssd));
+        if (in_flight && ssd.stats.aborts == aborts)
+          CHECK(panel_is(expected));
+        in_flight = false;
+        break;
+      case 9:
+        ssd1306_wait(&ssd);
+        if (in_flight && ssd.stats.aborts == aborts)
+          CHECK(panel_is(expected));
+        in_flight = false;
+        break;
+      default: {
+        uint32_t flushes = ssd.stats.flushes;
+        size_t pos = dev.stream_pos;
+        if (ssd1306_send_data_async(&ssd)) {
+          // O anterior terminou (na consulta de send_data_async(), talvez), e
+          // stream_start() não envia nada antes da próxima consulta
+          if (in_flight && ssd.stats.aborts == aborts) {
+            CHECK(panel_is(expected));
+            ++completed;
+          }
+          note_aborts();
+          memcpy(expected, ssd.ram_buffer, ssd.bufsize);
+          in_flight = ssd1306_busy(&ssd);
+          if (!in_flight && ssd.stats.aborts == aborts)
+            CHECK(panel_is(expected));
+          if (test_rand() % 30 == 0)
+            abort_after = test_rand_range(1, 5);
+        } else {
+          CHECK(in_flight && dev.stream_pos < dev.stream_len);
+          // Nada planejado nem reiniciado; o envio só andou
+          CHECK(ssd.stats.flushes == flushes && dev.stream_pos >= pos);
+          ++refused;
+        }
+        break;
+      }
+    }
+    note_aborts();
+    CHECK(dev.overlap_errors == 0);
+  }
+  ssd1306_wait(&ssd);
+  abort_after = 0;
+  ssd1306_send_data(&ssd);
+  CHECK(panel_is(ssd.ram_buffer));
+  CHECK(aborts > 50 && refused > 1000 && completed > 1000);
+  printf("%u envios completos, %u recusados com outro no ar, %u interrompidos\n", completed, refused, aborts);
+}
+
+static void test_without_stream(void) {
+  ssd1306_wait(&ssd);
+  static ssd1306_transport_t write_only;
+  write_only = ssd1306_transport_host;
+  write_only.stream_start = NULL;
+  write_only.stream_poll = NULL;
+  ssd1306_set_transport(&ssd, &write_only, &dev);
+  for (int step = 0; step < 200; ++step) {
+    random_draw();
+    CHECK(ssd1306_send_data_async(&ssd));
+    CHECK(!ssd1306_busy(&ssd));
+    CHECK(panel_is(ssd.ram_buffer));
+  }
+}
+
+int main(void) {
+  test_async();
+  test_without_stream();
+  return test_result("test_ssd1306_async");
+}
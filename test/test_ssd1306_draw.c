@@ -0,0 +1,215 @@
+#include <string.h>
+#include <time.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "ssd1306.h"
+#include "font.h"
+
+// Compara as primitivas de lib/ssd1306.c, que desenham um byte (8 linhas) por
+// vez, com versões pixel a pixel equivalentes ao código anterior: fill, rect
+// (com e sem preenchimento), hline, vline, draw_char e draw_string, com
+// coordenadas fora da tela e y fora do múltiplo de 8. Confere também que
+// tudo o que mudou na ram_buffer está dentro das faixas marcadas como
+// alteradas. Depois mede, no host, a tela de operação do Transmissor
+// desenhada dos dois jeitos.
+
+static uint32_t ref_pixels;
+
+static void ref_pixel(ssd1306_t *ssd, int x, int y, bool value) {
+  ++ref_pixels;
+  if (x < 0 || y < 0 || x > 0xff || y > 0xff)
+    return;
+  ssd1306_pixel(ssd, x, y, value);
+}
+
+static void ref_fill(ssd1306_t *ssd, bool value) {
+  for (int y = 0; y < ssd->height; ++y)
+    for (int x = 0; x < ssd->width; ++x)
+      ref_pixel(ssd, x, y, value);
+}
+
+// Como o código anterior, mas com laços em int (os de uint8_t não terminavam
+// para x1 = 255) e sem desenhar nada com largura ou altura 0
+static void ref_rect(ssd1306_t *ssd, int top, int left, int width, int height, bool value, bool fill) {
+  if (!width || !height)
+    return;
+  for (int x = left; x < left + width; ++x) {
+    ref_pixel(ssd, x, top, value);
+    ref_pixel(ssd, x, top + height - 1, value);
+  }
+  for (int y = top; y < top + height; ++y) {
+    ref_pixel(ssd, left, y, value);
+    ref_pixel(ssd, left + width - 1, y, value);
+  }
+  if (fill) {
+    for (int x = left + 1; x < left + width - 1; ++x)
+      for (int y = top + 1; y < top + height - 1; ++y)
+        ref_pixel(ssd, x, y, value);
+  }
+}
+
+static void ref_hline(ssd1306_t *ssd, int x0, int x1, int y, bool value) {
+  for (int x = x0; x <= x1; ++x)
+    ref_pixel(ssd, x, y, value);
+}
+
+static void ref_vline(ssd1306_t *ssd, int x, int y0, int y1, bool value) {
+  for (int y = y0; y <= y1; ++y)
+    ref_pixel(ssd, x, y, value);
+}
+
+static void ref_draw_char(ssd1306_t *ssd, char c, int x, int y) {
+  uint16_t index = (c >= ' ' && c <= '~') ? (c - ' ') * 8 : 0;
+  for (int i = 0; i < 8; ++i) {
+    uint8_t line = font[index + i];
+    for (int j = 0; j < 8; ++j)
+      ref_pixel(ssd, x + i, y + j, line & (1 << j));
+  }
+}
+
+static void ref_draw_string(ssd1306_t *ssd, const char *str, uint8_t x, uint8_t y) {
+  while (*str) {
+    ref_draw_char(ssd, *str++, x, y);
+    x += 8;
+    if (x + 8 >= ssd->width) {
+      x = 0;
+      y += 8;
+    }
+    if (y + 8 >= ssd->height)
+      break;
+  }
+}
+
+static void clear_dirty(ssd1306_t *ssd) {
+  for (uint8_t page = 0; page < SSD1306_MAX_PAGES; ++page) {
+    ssd->dirty_x0[page] = 0xff;
+    ssd->dirty_x1[page] = 0;
+  }
+}
+
+// Coordenada quase sempre perto da tela, às vezes em qualquer lugar
+static uint8_t random_coord(int size) {
+  return test_rand() % 8 ? test_rand_range(-4 & 0xff, size + 4) & 0xff : test_rand() & 0xff;
+}
+
+static void random_string(char *s, uint n) {
+  for (uint i = 0; i < n; ++i)
+    s[i] = test_rand() % 16 ? test_rand_range(' ', '~') : test_rand_range(1, 255);
+  s[n] = 0;
+}
+
+static void test_matches_per_pixel(void) {
+  ssd1306_t a, b;
+  ssd1306_init(&a, WIDTH, HEIGHT, false, 0x3c, NULL);
+  ssd1306_init(&b, WIDTH, HEIGHT, false, 0x3c, NULL);
+  static uint8_t before[WIDTH * HEIGHT / 8 + 1];
+  for (int op = 0; op < 20000; ++op) {
+    bool value = test_rand() & 1;
+    uint8_t x0 = random_coord(WIDTH), y0 = random_coord(HEIGHT);
+    uint8_t x1 = random_coord(WIDTH), y1 = random_coord(HEIGHT);
+    char s[24];
+    memcpy(before, a.ram_buffer, a.bufsize);
+    clear_dirty(&a);
+    switch (test_rand() % 7) {
+    case 0:
+      if (test_rand() % 50 == 0) {
+        ssd1306_fill(&a, value);
+        ref_fill(&b, value);
+      }
+      break;
+    case 1:
+    case 2: {
+      bool fill = test_rand() & 1;
+      uint8_t w = test_rand() % 8 ? test_rand_range(0, WIDTH) : test_rand() & 0xff;
+      uint8_t h = test_rand() % 8 ? test_rand_range(0, HEIGHT) : test_rand() & 0xff;
+      ssd1306_rect(&a, y0, x0, w, h, value, fill);
+      ref_rect(&b, y0, x0, w, h, value, fill);
+      break;
+    }
+    case 3:
+      ssd1306_hline(&a, x0, x1, y0, value);
+      ref_hline(&b, x0, x1, y0, value);
+      break;
+    case 4:
+      ssd1306_vline(&a, x0, y0, y1, value);
+      ref_vline(&b, x0, y0, y1, value);
+      break;
+    case 5:
+      random_string(s, 1);
+      ssd1306_draw_char(&a, s[0], x0, y0);
+      ref_draw_char(&b, s[0], x0, y0);
+      break;
+    case 6:
+      random_string(s, test_rand_range(0, sizeof(s) - 1));
+      ssd1306_draw_string(&a, s, x0, y0);
+      ref_draw_string(&b, s, x0, y0);
+      break;
+    }
+    CHECK(!memcmp(a.ram_buffer, b.ram_buffer, a.bufsize));
+    for (uint page = 0; page < a.pages; ++page)
+      for (uint x = 0; x < a.width; ++x)
+        if (a.ram_buffer[1 + page * a.width + x] != before[1 + page * a.width + x])
+          CHECK(x >= a.dirty_x0[page] && x < a.dirty_x1[page]);
+  }
+  free(a.ram_buffer);
+  free(a.shadow);
+  free(a.tx_stream);
+  free(b.ram_buffer);
+  free(b.shadow);
+  free(b.tx_stream);
+}
+
+// ----------------------------------------------------------------------------
+// Tela de operação: moldura, duas divisórias e cinco linhas de texto, como
+// draw_frame_base() e show_running_state() faziam antes dos widgets
+
+static const char *const running_lines[] = {"AC  TRANSMISSOR", "Estado: LIGADO", "OPS: 1234", "RST: 2", "TX: ok"};
+
+static void running_screen(ssd1306_t *ssd) {
+  ssd1306_fill(ssd, false);
+  ssd1306_rect(ssd, 0, 0, WIDTH, HEIGHT, true, false);
+  ssd1306_hline(ssd, 1, WIDTH - 2, 12, true);
+  ssd1306_hline(ssd, 1, WIDTH - 2, 52, true);
+  for (uint i = 0; i < count_of(running_lines); ++i)
+    ssd1306_draw_string(ssd, running_lines[i], 4, 3 + 10 * i);
+}
+
+static void ref_running_screen(ssd1306_t *ssd) {
+  ref_fill(ssd, false);
+  ref_rect(ssd, 0, 0, WIDTH, HEIGHT, true, false);
+  ref_hline(ssd, 1, WIDTH - 2, 12, true);
+  ref_hline(ssd, 1, WIDTH - 2, 52, true);
+  for (uint i = 0; i < count_of(running_lines); ++i)
+    ref_draw_string(ssd, running_lines[i], 4, 3 + 10 * i);
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench(void) {
+  const int reps = 20000;
+  ssd1306_t a, b;
+  ssd1306_init(&a, WIDTH, HEIGHT, false, 0x3c, NULL);
+  ssd1306_init(&b, WIDTH, HEIGHT, false, 0x3c, NULL);
+  double t0 = now_ns();
+  for (int r = 0; r < reps; ++r)
+    running_screen(&a);
+  double t1 = now_ns();
+  ref_pixels = 0;
+  for (int r = 0; r < reps; ++r)
+    ref_running_screen(&b);
+  double t2 = now_ns();
+  CHECK(!memcmp(a.ram_buffer, b.ram_buffer, a.bufsize));
+  printf("tela de operação: %.0f ns por byte, %.0f ns pixel a pixel (%u chamadas de pixel)\n",
+         (t1 - t0) / reps, (t2 - t1) / reps, ref_pixels / reps);
+}
+
+int main(void) {
+  test_matches_per_pixel();
+  bench();
+  return test_result("test_ssd1306_draw");
+}
@@ -0,0 +1,194 @@
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "ssd1306.h"
+#include "ssd1306_host.h"
+
+// Confere o envio parcial de ssd1306_send_data() no painel virtual de
+// ssd1306_host.c: depois de cada envio, a GRAM do painel é igual à
+// ram_buffer e as faixas sujas ficam vazias; sem mudança nada vai ao
+// barramento; e os bytes enviados nunca passam do custo de uma janela por
+// página alterada, só com as colunas que diferem do que já está no painel.
+// Depois mede os bytes por atualização das telas do Transmissor.
+
+static ssd1306_t ssd;
+#define dev ssd1306_host_dev
+
+static bool panel_matches(void) {
+  for (uint page = 0; page < ssd.pages; ++page)
+    if (memcmp(dev.gram[page], &ssd.ram_buffer[1 + page * ssd.width], ssd.width))
+      return false;
+  return true;
+}
+
+// Pior caso aceitável: cada página com alguma diferença em relação ao
+// painel numa janela própria (transação de comandos, 8 bytes, mais a de
+// dados, 2 bytes além das colunas)
+static uint32_t flush_bound(void) {
+  uint32_t bound = 0;
+  for (uint page = 0; page < ssd.pages; ++page) {
+    const uint8_t *buf = &ssd.ram_buffer[1 + page * ssd.width];
+    int x0 = 0, x1 = ssd.width;
+    while (x0 < x1 && buf[x0] == dev.gram[page][x0])
+      ++x0;
+    while (x1 > x0 && buf[x1 - 1] == dev.gram[page][x1 - 1])
+      --x1;
+    if (x0 < x1)
+      bound += x1 - x0 + 10;
+  }
+  return bound;
+}
+
+// Envia e confere. Retorna os bytes que foram ao barramento.
+static uint32_t flush(bool panel_known) {
+  uint32_t bound = flush_bound();
+  uint32_t before = dev.bytes, stats_before = ssd.stats.bus_bytes;
+  ssd1306_send_data(&ssd);
+  uint32_t sent = dev.bytes - before;
+  CHECK(sent == ssd.stats.bus_bytes - stats_before);
+  CHECK(panel_matches());
+  for (uint page = 0; page < ssd.pages; ++page)
+    CHECK(ssd.dirty_x0[page] >= ssd.dirty_x1[page]);
+  if (panel_known)
+    CHECK(sent <= bound);
+  return sent;
+}
+
+static void random_draw(void) {
+  uint8_t x0 = test_rand_range(0, WIDTH - 1), y0 = test_rand_range(0, HEIGHT - 1);
+  uint8_t x1 = test_rand_range(0, WIDTH - 1), y1 = test_rand_range(0, HEIGHT - 1);
+  bool value = test_rand() & 1;
+  switch (test_rand() % 6) {
+    case 0:
+      ssd1306_pixel(&ssd, x0, y0, value);
+      break;
+    case 1:
+      ssd1306_rect(&ssd, y0, x0, test_rand_range(1, 40), test_rand_range(1, 24), value, test_rand() & 1);
+      break;
+    case 2:
+      ssd1306_line(&ssd, x0, y0, x1, y1, value);
+      break;
+    case 3:
+      ssd1306_draw_string(&ssd, "OPS: 42", x0, y0);
+      break;
+    case 4:
+      // Direto na ram_buffer, marcando a faixa à mão
+      ssd.ram_buffer[1 + y0 / 8 * ssd.width + x0] = test_rand();
+      ssd1306_mark_dirty(&ssd, y0 / 8, x0, x0 + 1);
+      break;
+    default:
+      if (test_rand() % 20 == 0)
+        ssd1306_fill(&ssd, value);
+      break;
+  }
+}
+
+static void test_random_flushes(void) {
+  ssd1306_host_reset(&dev, 0);
+  ssd1306_init(&ssd, WIDTH, HEIGHT, false, 0x3c, NULL);
+  ssd1306_config(&ssd);
+  flush(false);
+  for (int step = 0; step < 5000; ++step) {
+    uint n = test_rand_range(0, 6);
+    for (uint i = 0; i < n; ++i)
+      random_draw();
+    // Às vezes desenha e desfaz: marcado, mas igual ao painel
+    if (test_rand() % 8 == 0) {
+      uint8_t x = test_rand_range(0, WIDTH - 1), y = test_rand_range(0, HEIGHT - 1);
+      bool old = ssd.ram_buffer[1 + y / 8 * ssd.width + x] >> (y & 7) & 1;
+      ssd1306_pixel(&ssd, x, y, !old);
+      ssd1306_pixel(&ssd, x, y, old);
+    }
+    bool same = panel_matches();
+    // Depois de um reset do display, o painel é desconhecido para o driver
+    bool reset = test_rand() % 50 == 0;
+    if (reset) {
+      memset(dev.gram, 0xA5, sizeof(dev.gram));
+      ssd1306_invalidate(&ssd);
+    }
+    uint32_t sent = flush(!reset);
+    if (same && !reset)
+      CHECK(sent == 0);
+  }
+  free(ssd.ram_buffer);
+  free(ssd.shadow);
+  free(ssd.tx_stream);
+}
+
+// ----------------------------------------------------------------------------
+// Telas de Transmissor.c, redesenhadas inteiras a cada atualização
+
+static void frame_base(void) {
+  ssd1306_fill(&ssd, false);
+  ssd1306_rect(&ssd, 3, 3, 122, 60, true, false);
+  ssd1306_line(&ssd, 3, 25, 123, 25, true);
+  ssd1306_line(&ssd, 3, 37, 123, 37, true);
+}
+
+static void boot_diag(void) {
+  frame_base();
+  ssd1306_draw_string(&ssd, "IR+WDT+UART", 20, 6);
+  ssd1306_draw_string(&ssd, "RST: WATCHDOG", 10, 16);
+  ssd1306_draw_string(&ssd, "CNT: 3", 10, 28);
+  ssd1306_draw_string(&ssd, "FLT: 0x02", 10, 40);
+  ssd1306_draw_string(&ssd, "WDT: 5000ms", 10, 52);
+}
+
+static void running_state(const char *state, uint32_t ops) {
+  char line[22];
+  frame_base();
+  ssd1306_draw_string(&ssd, "AC+WDT+UART", 20, 6);
+  ssd1306_draw_string(&ssd, state, 10, 16);
+  snprintf(line, sizeof(line), "OPS: %lu", (unsigned long)ops);
+  ssd1306_draw_string(&ssd, line, 10, 28);
+  ssd1306_draw_string(&ssd, "RST: 3", 10, 40);
+  ssd1306_draw_string(&ssd, "TX: ATIVO", 10, 52);
+}
+
+static void fault_mode(void) {
+  frame_base();
+  ssd1306_draw_string(&ssd, "FALHA INDUZIDA", 12, 6);
+  ssd1306_draw_string(&ssd, "LOOP INFINITO", 10, 16);
+  ssd1306_draw_string(&ssd, "Cmd 'F'", 10, 28);
+  ssd1306_draw_string(&ssd, "Aguard. reset", 10, 40);
+  ssd1306_draw_string(&ssd, "WDT ~5 seg...", 10, 52);
+}
+
+static void report(const char *what, uint32_t bytes) {
+  // 9 bits por byte a 400 kHz
+  printf("%4u bytes, %5.2f ms: %s\n", bytes, bytes * 9 / 400.0, what);
+}
+
+static void bench(void) {
+  ssd1306_host_reset(&dev, 0);
+  ssd1306_init(&ssd, WIDTH, HEIGHT, false, 0x3c, NULL);
+  ssd1306_config(&ssd);
+  // Antes: seis comandos, cada um na sua transação, e a ram_buffer inteira
+  report("tela inteira (antes)", 6 * 3 + ssd.bufsize + 1);
+  boot_diag();
+  report("boot", flush(false));
+  running_state("AC: OFF", 0);
+  report("boot -> operação", flush(true));
+  uint32_t total = 0;
+  for (uint32_t ops = 1; ops <= 100; ++ops) {
+    running_state("AC: OFF", ops);
+    total += flush(true);
+  }
+  report("operação, OPS + 1 (média)", total / 100);
+  running_state("AC: OFF", 100);
+  report("operação, nada mudou", flush(true));
+  running_state("AC: 22C", 100);
+  report("operação, troca de estado", flush(true));
+  fault_mode();
+  report("operação -> falha", flush(true));
+  free(ssd.ram_buffer);
+  free(ssd.shadow);
+  free(ssd.tx_stream);
+}
+
+int main(void) {
+  test_random_flushes();
+  bench();
+  return test_result("test_ssd1306_flush");
+}
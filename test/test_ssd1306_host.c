@@ -0,0 +1,388 @@
+#include <string.h>
+#include <time.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "ssd1306.h"
+#include "ssd1306_host.h"
+#include "ssd1306_widget.h"
+
+// Confere o painel virtual de ssd1306_host.c contra um modelo à parte:
+// - rodadas aleatórias de comandos (modo de endereçamento, janela, página e
+//   coluna, contraste no meio) e dados, em endereçamento horizontal, vertical
+//   e de página, com as transações divididas de vários jeitos: tudo numa só,
+//   um byte por transação com Co (como ssd1306_command()), Co encadeado numa
+//   transação, argumentos separados do comando;
+// - o mesmo pelo envio assíncrono, em fila de IC_DATA_CMD com STOP e
+//   bytes_per_poll aleatório, dá a mesma GRAM, transações e bytes;
+// - escritas com um envio em andamento contam em overlap_errors;
+// - ssd1306_config() deixa o painel em endereçamento horizontal, ligado;
+// - modo invertido em ssd1306_host_pixel(), e o PBM lido de volta.
+// Depois mede as telas de boot, operação e falha do Transmissor, desenhadas
+// e enviadas como em Transmissor.c. Com um diretório como argumento, salva
+// as três como PBM nele.
+
+static ssd1306_host_dev_t a, b;
+static uint8_t ref[8][128];
+
+static bool gram_is(const ssd1306_host_dev_t *dev, const uint8_t gram[8][128]) {
+  return !memcmp(dev->gram, gram, sizeof(dev->gram));
+}
+
+// ----------------------------------------------------------------------------
+// Transações: em a por write, e na fila de b
+
+static uint16_t stream[4096];
+static size_t stream_len;
+static uint32_t sent_bytes;
+
+static void transaction(const uint8_t *buf, size_t len) {
+  ssd1306_transport_host.write(&a, buf, len);
+  for (size_t i = 0; i < len; ++i)
+    stream[stream_len++] = buf[i];
+  stream[stream_len - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+  sent_bytes += len + 1;
+}
+
+// Envia a fila em b, poucos bytes por consulta
+static void flush_stream(void) {
+  if (!stream_len)
+    return;
+  b.bytes_per_poll = test_rand_range(0, 40);
+  ssd1306_transport_host.stream_start(&b, stream, stream_len);
+  uint polls = 1;
+  while (ssd1306_transport_host.stream_poll(&b) == SSD1306_STREAM_BUSY)
+    ++polls;
+  if (b.bytes_per_poll)
+    CHECK(polls == (stream_len + b.bytes_per_poll - 1) / b.bytes_per_poll);
+  stream_len = 0;
+}
+
+// Comandos e argumentos, divididos em transações de um jeito aleatório
+static void send_commands(const uint8_t *cmds, size_t n) {
+  uint8_t buf[64];
+  size_t len = 0;
+  switch (test_rand() % 4) {
+    case 0:
+      buf[len++] = 0x00;
+      memcpy(&buf[len], cmds, n);
+      transaction(buf, len + n);
+      break;
+    case 1:
+      for (size_t i = 0; i < n; ++i) {
+        buf[0] = 0x80;
+        buf[1] = cmds[i];
+        transaction(buf, 2);
+      }
+      break;
+    case 2:
+      // Co encadeado; o último com Co = 0 às vezes
+      for (size_t i = 0; i < n; ++i) {
+        buf[len++] = i + 1 == n && (test_rand() & 1) ? 0x00 : 0x80;
+        buf[len++] = cmds[i];
+      }
+      transaction(buf, len);
+      break;
+    default: {
+      size_t cut = test_rand_range(0, n);
+      buf[0] = 0x00;
+      if (cut) {
+        memcpy(&buf[1], cmds, cut);
+        transaction(buf, cut + 1);
+      }
+      if (cut < n) {
+        memcpy(&buf[1], &cmds[cut], n - cut);
+        transaction(buf, n - cut + 1);
+      }
+      break;
+    }
+  }
+}
+
+// Dados em uma transação, em várias, ou byte a byte com Co
+static void send_data(const uint8_t *data, size_t n) {
+  uint8_t buf[1 + 8 * 128];
+  size_t done = 0;
+  uint style = test_rand() % 3;
+  while (done < n) {
+    size_t len = style == 0 ? n - done : style == 1 ? test_rand_range(1, n - done) : 1;
+    buf[0] = style == 2 ? 0xC0 : 0x40;
+    memcpy(&buf[1], &data[done], len);
+    transaction(buf, len + 1);
+    done += len;
+  }
+}
+
+// Endereço do i-ésimo byte de dados numa janela, voltando ao início no fim
+static void window_addr(uint mode, uint c0, uint c1, uint p0, uint p1, uint i, uint *col, uint *page) {
+  uint cols = c1 - c0 + 1, pages = p1 - p0 + 1;
+  i %= cols * pages;
+  if (mode == 0) {
+    *page = p0 + i / cols;
+    *col = c0 + i % cols;
+  } else {
+    *col = c0 + i / pages;
+    *page = p0 + i % pages;
+  }
+}
+
+static void test_decoder(void) {
+  ssd1306_host_reset(&a, 0);
+  ssd1306_host_reset(&b, 0);
+  memset(ref, 0, sizeof(ref));
+  sent_bytes = 0;
+  for (int round = 0; round < 3000; ++round) {
+    uint8_t cmds[16], data[2 * 8 * 128];
+    size_t n = 0;
+    uint mode = test_rand_range(0, 2);
+    if (test_rand() % 3 == 0) {
+      // Argumento com cara de comando: não pode ser executado
+      cmds[n++] = SET_CONTRAST;
+      cmds[n++] = test_rand() & 1 ? SET_COL_ADDR : test_rand();
+    }
+    cmds[n++] = SET_MEM_ADDR;
+    cmds[n++] = mode;
+    uint c0, c1, p0, p1, len;
+    if (mode < 2) {
+      c0 = test_rand_range(0, 127);
+      c1 = test_rand_range(c0, 127);
+      p0 = test_rand_range(0, 7);
+      p1 = test_rand_range(p0, 7);
+      bool page_first = test_rand() & 1;
+      uint8_t col_cmd[] = {SET_COL_ADDR, c0, c1}, page_cmd[] = {SET_PAGE_ADDR, p0, p1};
+      memcpy(&cmds[n], page_first ? page_cmd : col_cmd, 3);
+      memcpy(&cmds[n + 3], page_first ? col_cmd : page_cmd, 3);
+      n += 6;
+      uint size = (c1 - c0 + 1) * (p1 - p0 + 1);
+      // Às vezes passa do fim da janela e dá a volta
+      len = test_rand_range(1, test_rand() % 4 ? size : MIN(2 * size, sizeof(data)));
+    } else {
+      // Endereçamento de página: 0xB0 + página e os nibbles da coluna,
+      // sem passar da coluna 127
+      c0 = test_rand_range(0, 127);
+      p0 = test_rand_range(0, 7);
+      cmds[n++] = 0xB0 | p0;
+      cmds[n++] = 0x00 | (c0 & 0x0F);
+      cmds[n++] = 0x10 | (c0 >> 4);
+      c1 = 127;
+      p1 = p0;
+      len = test_rand_range(1, 128 - c0);
+    }
+    send_commands(cmds, n);
+    for (uint i = 0; i < len; ++i)
+      data[i] = test_rand();
+    send_data(data, len);
+    for (uint i = 0; i < len; ++i) {
+      uint col, page;
+      window_addr(mode, c0, c1, p0, p1, i, &col, &page);
+      ref[page][col] = data[i];
+    }
+    uint32_t transactions = a.transactions;
+    flush_stream();
+
+    CHECK(a.mem_mode == mode && b.mem_mode == mode);
+    CHECK(gram_is(&a, ref) && gram_is(&b, ref));
+    CHECK(b.transactions == transactions && a.bytes == sent_bytes && b.bytes == sent_bytes);
+    CHECK(a.overlap_errors == 0 && b.overlap_errors == 0);
+  }
+}
+
+// Escrever ou iniciar outro envio com um em andamento é erro do driver
+static void test_overlap(void) {
+  static const uint8_t on[] = {0x80, SET_DISP | 0x01};
+  static const uint16_t twice[] = {0x80, SET_DISP | 0x01, 0x80, SET_DISP | 0x01 | I2C_IC_DATA_CMD_STOP_BITS};
+  ssd1306_host_reset(&a, 1);
+  ssd1306_transport_host.stream_start(&a, twice, count_of(twice));
+  CHECK(ssd1306_transport_host.stream_poll(&a) == SSD1306_STREAM_BUSY);
+  ssd1306_transport_host.write(&a, on, sizeof(on));
+  CHECK(a.overlap_errors == 1);
+  ssd1306_transport_host.stream_start(&a, twice, count_of(twice));
+  CHECK(a.overlap_errors == 2);
+  while (ssd1306_transport_host.stream_poll(&a) == SSD1306_STREAM_BUSY)
+    ;
+  ssd1306_transport_host.write(&a, on, sizeof(on));
+  CHECK(a.overlap_errors == 2 && a.display_on);
+}
+
+// ----------------------------------------------------------------------------
+// Pelo driver: configuração, modo invertido e PBM
+
+static ssd1306_t ssd;
+#define dev ssd1306_host_dev
+
+// Lê o PBM de volta e compara com ssd1306_host_pixel()
+static bool pbm_matches(const char *path) {
+  static const char header[] = "P4\n128 64\n";
+  uint8_t data[sizeof(header) - 1 + 64 * 16 + 1];
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return false;
+  size_t n = fread(data, 1, sizeof(data), f);
+  fclose(f);
+  remove(path);
+  if (n != sizeof(data) - 1 || memcmp(data, header, sizeof(header) - 1))
+    return false;
+  const uint8_t *rows = &data[sizeof(header) - 1];
+  for (uint y = 0; y < 64; ++y)
+    for (uint x = 0; x < 128; ++x)
+      if (((rows[y * 16 + x / 8] >> (7 - x % 8)) & 1) != ssd1306_host_pixel(&dev, x, y))
+        return false;
+  return true;
+}
+
+static void test_driver(void) {
+  ssd1306_host_reset(&dev, 0);
+  ssd1306_init(&ssd, WIDTH, HEIGHT, false, 0x3c, NULL);
+  ssd1306_config(&ssd);
+  CHECK(dev.mem_mode == 0 && dev.display_on && !dev.inverted);
+  CHECK(dev.col0 == 0 && dev.col1 == 127 && dev.page0 == 0 && dev.page1 == 7);
+  for (int round = 0; round < 20; ++round) {
+    for (uint i = 0; i < 40; ++i)
+      ssd1306_pixel(&ssd, test_rand_range(0, WIDTH - 1), test_rand_range(0, HEIGHT - 1), test_rand() & 1);
+    ssd1306_rect(&ssd, test_rand_range(0, 40), test_rand_range(0, 80), 40, 20, true, test_rand() & 1);
+    ssd1306_send_data(&ssd);
+    bool inverted = test_rand() & 1;
+    ssd1306_command(&ssd, SET_NORM_INV | inverted);
+    CHECK(dev.inverted == inverted);
+    bool ok = true;
+    for (uint y = 0; y < HEIGHT; ++y)
+      for (uint x = 0; x < WIDTH; ++x)
+        ok &= ssd1306_host_pixel(&dev, x, y) == (((ssd.ram_buffer[1 + y / 8 * WIDTH + x] >> (y & 7)) & 1) != inverted);
+    CHECK(ok);
+    char path[64];
+    snprintf(path, sizeof(path), "test_ssd1306_host_%d.pbm", round);
+    CHECK(ssd1306_host_write_pbm(&dev, path));
+    CHECK(pbm_matches(path));
+  }
+  CHECK(!ssd1306_host_write_pbm(&dev, "/nonexistent/dir/tela.pbm"));
+  ssd1306_command(&ssd, SET_NORM_INV);
+}
+
+// ----------------------------------------------------------------------------
+// Telas de Transmissor.c: boot e falha desenhadas inteiras e enviadas com
+// ssd1306_send_data(), operação como widgets retidos e
+// ssd1306_send_data_async()
+
+static void draw_frame_base(void) {
+  ssd1306_fill(&ssd, false);
+  ssd1306_rect(&ssd, 3, 3, 122, 60, true, false);
+  ssd1306_line(&ssd, 3, 25, 123, 25, true);
+  ssd1306_line(&ssd, 3, 37, 123, 37, true);
+}
+
+static void show_boot_diag(bool reboot_wdt, uint32_t count, uint32_t fault) {
+  char line[22];
+  draw_frame_base();
+  ssd1306_draw_string(&ssd, "IR+WDT+UART", 20, 6);
+  ssd1306_draw_string(&ssd, reboot_wdt ? "RST: WATCHDOG" : "RST: NORMAL", 10, 16);
+  snprintf(line, sizeof(line), "CNT: %lu", (unsigned long)count);
+  ssd1306_draw_string(&ssd, line, 10, 28);
+  snprintf(line, sizeof(line), "FLT: 0x%02lX", (unsigned long)fault);
+  ssd1306_draw_string(&ssd, line, 10, 40);
+  ssd1306_draw_string(&ssd, "WDT: 5000ms", 10, 52);
+  ssd1306_send_data(&ssd);
+}
+
+static const char *const states[] = {"AC: OFF", "AC: ON", "AC: 20C", "AC: 22C", "AC: FAN 1", "AC: FAN 2"};
+static ssd1306_screen_t running_screen;
+static ssd1306_widget_t running_widgets[8];
+static ssd1306_widget_t *running_state, *running_ops, *running_rst;
+
+static void show_running_state(uint state, uint32_t ops, uint32_t rst) {
+  if (!running_screen.ssd) {
+    ssd1306_screen_init(&running_screen, &ssd, running_widgets, count_of(running_widgets), false);
+    ssd1306_screen_frame(&running_screen, 3, 3, 122, 60, true);
+    ssd1306_screen_hline(&running_screen, 3, 123, 25, true);
+    ssd1306_screen_hline(&running_screen, 3, 123, 37, true);
+    ssd1306_screen_label(&running_screen, &ssd1306_font_8x8, 20, 6, "AC+WDT+UART");
+    running_state = ssd1306_screen_label(&running_screen, &ssd1306_font_8x8, 10, 16, states[state]);
+    running_ops = ssd1306_screen_counter(&running_screen, &ssd1306_font_8x8, 10, 28, "OPS: ", ops);
+    running_rst = ssd1306_screen_counter(&running_screen, &ssd1306_font_8x8, 10, 40, "RST: ", rst);
+    ssd1306_screen_label(&running_screen, &ssd1306_font_8x8, 10, 52, "TX: ATIVO");
+  }
+  ssd1306_label_set(&running_screen, running_state, states[state]);
+  ssd1306_counter_set(&running_screen, running_ops, ops);
+  ssd1306_counter_set(&running_screen, running_rst, rst);
+  ssd1306_screen_compose(&running_screen);
+  ssd1306_send_data_async(&ssd);
+}
+
+static void show_fault_mode(const char *msg, const char *detail) {
+  draw_frame_base();
+  ssd1306_draw_string(&ssd, "FALHA INDUZIDA", 12, 6);
+  ssd1306_draw_string(&ssd, msg, 10, 16);
+  ssd1306_draw_string(&ssd, detail, 10, 28);
+  ssd1306_draw_string(&ssd, "Aguard. reset", 10, 40);
+  ssd1306_draw_string(&ssd, "WDT ~5 seg...", 10, 52);
+  ssd1306_send_data(&ssd);
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static bool panel_matches(void) {
+  for (uint page = 0; page < ssd.pages; ++page)
+    if (memcmp(dev.gram[page], &ssd.ram_buffer[1 + page * ssd.width], ssd.width))
+      return false;
+  return true;
+}
+
+static const char *snapshot_dir;
+
+// Chama a tela reps vezes (i = 0 .. reps - 1), esperando o fim do envio, e
+// imprime o tempo e os bytes por chamada
+static void bench_screen(const char *name, void (*show)(uint i)) {
+  const uint reps = 2000;
+  // A primeira chamada desenha a tela inteira, fora da medida
+  show(0);
+  ssd1306_wait(&ssd);
+  uint32_t bytes = ssd.stats.bus_bytes;
+  double t0 = now_ns();
+  for (uint i = 1; i <= reps; ++i) {
+    show(i);
+    ssd1306_wait(&ssd);
+  }
+  double t1 = now_ns();
+  CHECK(panel_matches() && dev.overlap_errors == 0);
+  printf("%7.0f ns, %4u bytes: %s\n", (t1 - t0) / reps, (ssd.stats.bus_bytes - bytes) / reps, name);
+  if (snapshot_dir) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.pbm", snapshot_dir, name);
+    CHECK(ssd1306_host_write_pbm(&dev, path));
+  }
+}
+
+static void boot(uint i) {
+  show_boot_diag(i & 1, i, i & 0xFF);
+}
+
+static void running(uint i) {
+  show_running_state(i / 100 % count_of(states), i, i / 500);
+}
+
+static void fault(uint i) {
+  static const char *const msgs[][2] = {{"CMD 22C", "Travamento IR"}, {"LOOP INFINITO", "Cmd 'F'"},
+                                        {"UART TRAVADA", "Cmd 'U'"}};
+  show_fault_mode(msgs[i % 3][0], msgs[i % 3][1]);
+}
+
+static void bench(void) {
+  ssd1306_host_reset(&dev, 0);
+  ssd1306_init(&ssd, WIDTH, HEIGHT, false, 0x3c, NULL);
+  ssd1306_config(&ssd);
+  bench_screen("boot", boot);
+  bench_screen("operacao", running);
+  bench_screen("falha", fault);
+}
+
+int main(int argc, char **argv) {
+  snapshot_dir = argc > 1 ? argv[1] : NULL;
+  test_decoder();
+  test_overlap();
+  test_driver();
+  bench();
+  return test_result("test_ssd1306_host");
+}
@@ -0,0 +1,215 @@
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "ssd1306.h"
+#include "font.h"
+#include "font_large.h"
+
+// Confere as fontes de lib/ssd1306.c e ssd1306_text():
+// - font_large é a fonte 8x8 com cada pixel dobrado, e as métricas das duas
+//   fontes proporcionais saem das colunas usadas de cada glifo;
+// - ssd1306_text() com ssd1306_font_8x8 desenha o mesmo que
+//   ssd1306_draw_string();
+// - com as três fontes, o mesmo que um desenho pixel a pixel feito aqui a
+//   partir do ssd1306_font_t, em qualquer x e y, inclusive cortado na borda;
+// - redesenhar do cache (antes e depois de sair dele) dá o mesmo resultado;
+// - uma string de referência fixa em cada fonte proporcional;
+// - fontes com mais de SSD1306_FONT_MAX_PAGES páginas não desenham nada.
+
+static ssd1306_t a, b;
+
+static void clear(void) {
+  ssd1306_fill(&a, false);
+  ssd1306_fill(&b, false);
+}
+
+static bool glyph8_pixel(uint8_t c, int x, int y) {
+  return font[(c - ' ') * 8 + x] >> y & 1;
+}
+
+static void test_font_data(void) {
+  for (uint c = ' '; c <= '~'; ++c) {
+    for (int y = 0; y < 16; ++y) {
+      for (int x = 0; x < 16; ++x) {
+        bool large = font_large[(c - ' ') * 32 + (y >> 3) * 16 + x] >> (y & 7) & 1;
+        CHECK(large == glyph8_pixel(c, x / 2, y / 2));
+      }
+    }
+    uint i = c - ' ';
+    CHECK(font_large_metrics[2 * i] == 2 * font_metrics[2 * i]);
+    CHECK(font_large_metrics[2 * i + 1] == 2 * font_metrics[2 * i + 1]);
+    // O espaço não tem colunas usadas, e tem largura própria
+    if (c == ' ')
+      continue;
+    int first = -1, last = -1;
+    for (int x = 0; x < 8; ++x) {
+      if (font[i * 8 + x]) {
+        if (first < 0)
+          first = x;
+        last = x;
+      }
+    }
+    CHECK(font_metrics[2 * i] == first && font_metrics[2 * i + 1] == last - first + 1);
+  }
+}
+
+static void random_string(char *s, uint n) {
+  for (uint i = 0; i < n; ++i)
+    s[i] = test_rand() % 16 ? test_rand_range(' ', '~') : test_rand_range(1, 255);
+  s[n] = 0;
+}
+
+static void test_matches_draw_string(void) {
+  for (int trial = 0; trial < 5000; ++trial) {
+    char s[16];
+    uint n = test_rand_range(0, 14);
+    random_string(s, n);
+    // Numa linha só, sem a quebra de draw_string
+    uint8_t x = test_rand_range(0, WIDTH - 8 * (n + 1) - 1);
+    uint8_t y = test_rand_range(0, HEIGHT - 9);
+    clear();
+    uint8_t end = ssd1306_text(&a, &ssd1306_font_8x8, s, x, y);
+    ssd1306_draw_string(&b, s, x, y);
+    CHECK(end == x + 8 * n);
+    CHECK(!memcmp(a.ram_buffer, b.ram_buffer, a.bufsize));
+  }
+}
+
+// Pixel a pixel, a partir da descrição da fonte: cada caractere é a faixa
+// de colunas das métricas, mais spacing colunas em branco; o fundo da altura
+// da fonte é apagado. Retorna a largura desenhada.
+static uint ref_text(ssd1306_t *ssd, const ssd1306_font_t *f, const char *s, uint8_t x, uint8_t y) {
+  uint w = 0;
+  for (; *s; ++s) {
+    uint8_t c = *s;
+    uint i = c >= f->first && c <= f->last ? c - f->first : 0;
+    uint col0 = f->metrics ? f->metrics[2 * i] : 0;
+    uint n = f->metrics ? f->metrics[2 * i + 1] : f->cell_w;
+    uint advance = f->metrics ? n + f->spacing : n;
+    for (uint k = 0; k < advance && w < SSD1306_TEXT_MAX_W; ++k, ++w) {
+      for (uint r = 0; r < 8u * f->pages; ++r) {
+        bool on = k < n && f->glyphs[i * f->cell_w * f->pages + (r >> 3) * f->cell_w + col0 + k] >> (r & 7) & 1;
+        if (x + w < 0x100 && y + r < 0x100)
+          ssd1306_pixel(ssd, x + w, y + r, on);
+      }
+    }
+  }
+  return w;
+}
+
+static const ssd1306_font_t *const fonts[] = {&ssd1306_font_8x8, &ssd1306_font_prop, &ssd1306_font_large};
+
+static void test_matches_ref(void) {
+  for (int trial = 0; trial < 6000; ++trial) {
+    const ssd1306_font_t *f = fonts[trial % count_of(fonts)];
+    char s[32];
+    // Às vezes longas demais para o cache
+    random_string(s, test_rand_range(0, sizeof(s) - 1));
+    uint8_t x = test_rand() % 8 ? test_rand_range(0, WIDTH - 1) : test_rand() & 0xff;
+    uint8_t y = test_rand() % 8 ? test_rand_range(0, HEIGHT - 1) : test_rand() & 0xff;
+    clear();
+    uint8_t end = ssd1306_text(&a, f, s, x, y);
+    uint w = ref_text(&b, f, s, x, y);
+    CHECK(!memcmp(a.ram_buffer, b.ram_buffer, a.bufsize));
+    if (x < WIDTH && y < HEIGHT)
+      CHECK(end == MIN(x + w, 0xFF));
+    if (ssd1306_text_width(f, s) < SSD1306_TEXT_MAX_W)
+      CHECK(w == ssd1306_text_width(f, s));
+  }
+}
+
+// Desenha sobre um fundo aleatório (o texto também apaga o seu fundo, e o
+// que está fora dele tem que ficar)
+static void random_background(void) {
+  for (size_t i = 1; i < a.bufsize; ++i)
+    a.ram_buffer[i] = b.ram_buffer[i] = test_rand();
+}
+
+static void test_cache(void) {
+  static const char *const words[] = {"OPS: 12", "RST: 3", "LIGADO", "DESLIGADO", "TX: ok", "Erro", "AC", "16 C",
+                                      "Modo: frio", "Vent: 2"};
+  for (int trial = 0; trial < 2000; ++trial) {
+    const ssd1306_font_t *f = fonts[test_rand() % count_of(fonts)];
+    // Mais palavras que entradas no cache, para haver substituição
+    const char *s = words[test_rand() % count_of(words)];
+    uint8_t x = test_rand_range(0, WIDTH - 1), y = test_rand_range(0, HEIGHT - 1);
+    random_background();
+    ssd1306_stats_t before = a.stats;
+    ssd1306_text(&a, f, s, x, y);
+    ref_text(&b, f, s, x, y);
+    CHECK(!memcmp(a.ram_buffer, b.ram_buffer, a.bufsize));
+    CHECK(a.stats.text_hits + a.stats.text_misses == before.text_hits + before.text_misses + 1);
+    // Logo em seguida, em outro lugar com o mesmo y % 8, sempre acha no cache
+    random_background();
+    before = a.stats;
+    x = test_rand_range(0, WIDTH - 1);
+    y = (y & 7) + 8 * test_rand_range(0, HEIGHT / 8 - 1);
+    ssd1306_text(&a, f, s, x, y);
+    ref_text(&b, f, s, x, y);
+    CHECK(a.stats.text_hits == before.text_hits + 1);
+    CHECK(!memcmp(a.ram_buffer, b.ram_buffer, a.bufsize));
+  }
+  CHECK(a.stats.text_misses > 100 && a.stats.text_hits > 2000);
+}
+
+// Os buffers de render não cabem uma fonte mais alta: nada é desenhado nem
+// vai para o cache
+static void test_font_too_tall(void) {
+  ssd1306_font_t tall = ssd1306_font_large;
+  tall.pages = SSD1306_FONT_MAX_PAGES + 1;
+  random_background();
+  ssd1306_stats_t before = a.stats;
+  for (uint8_t y = 0; y < 8; ++y)
+    CHECK(ssd1306_text(&a, &tall, "Hi, 8!", 10, y) == 10);
+  CHECK(!memcmp(a.ram_buffer, b.ram_buffer, a.bufsize));
+  CHECK(a.stats.text_hits == before.text_hits && a.stats.text_misses == before.text_misses);
+}
+
+// Referências fixas: "Hi, 8!" nas fontes proporcionais em (0, 0), como
+// ficam na tela (uma linha de texto por linha de pixels)
+static const char *const golden_prop[8] = {
+  "##...##..##...........#####..##.",
+  "##...##..............##...##.##.",
+  "##...##.###..........##...##.##.",
+  "#######..##...........#####..##.",
+  "##...##..##..........##...##.##.",
+  "##...##..##...##.....##...##....",
+  "##...##.####..##......#####..##.",
+  ".............##.................",
+};
+
+static void check_golden(const ssd1306_font_t *f, uint scale, const char *const *golden) {
+  clear();
+  ssd1306_text(&a, f, "Hi, 8!", 0, 0);
+  uint bad = 0;
+  for (uint y = 0; y < 8 * scale; ++y) {
+    for (uint x = 0; x < 32 * scale; ++x) {
+      bool want = golden[y / scale][x / scale] == '#';
+      bool got = a.ram_buffer[1 + (y >> 3) * a.width + x] >> (y & 7) & 1;
+      bad += want != got;
+    }
+  }
+  if (bad) {
+    fprintf(stderr, "golden text differs in %u pixels:\n", bad);
+    for (uint y = 0; y < 8 * scale; ++y) {
+      for (uint x = 0; x < 32 * scale; ++x)
+        fputc(a.ram_buffer[1 + (y >> 3) * a.width + x] >> (y & 7) & 1 ? '#' : '.', stderr);
+      fputc('\n', stderr);
+    }
+  }
+  CHECK(!bad);
+}
+
+int main(void) {
+  ssd1306_init(&a, WIDTH, HEIGHT, false, 0x3c, NULL);
+  ssd1306_init(&b, WIDTH, HEIGHT, false, 0x3c, NULL);
+  test_font_data();
+  test_matches_draw_string();
+  test_matches_ref();
+  test_cache();
+  test_font_too_tall();
+  check_golden(&ssd1306_font_prop, 1, golden_prop);
+  check_golden(&ssd1306_font_large, 2, golden_prop);
+  return test_result("test_ssd1306_text");
+}
@@ -0,0 +1,278 @@
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "ssd1306.h"
+#include "ssd1306_widget.h"
+
+// Compara a tela retida de lib/ssd1306_widget.c com o desenho imediato: a
+// cada passo, outra ssd1306_t é apagada e recebe todos os widgets, na ordem
+// de criação, com as primitivas de ssd1306.c. Telas aleatórias (widgets que
+// se sobrepõem, cortados na borda, fundo aceso ou apagado) recebem rajadas
+// de atualizações aleatórias antes de cada composição, inclusive mais áreas
+// sujas que SSD1306_SCREEN_MAX_DIRTY. Depois mede quantos pixels a tela de
+// operação do Transmissor recompõe por atualização.
+
+#define MAX_WIDGETS 16
+
+// O que se espera de cada widget, guardado aqui à parte
+typedef struct {
+  uint8_t type;
+  bool value;
+  uint8_t x, y, w, h;
+  const ssd1306_font_t *font;
+  const char *prefix;
+  uint32_t count;
+  char text[SSD1306_WIDGET_TEXT];
+} model_t;
+
+static ssd1306_t a, b;
+static ssd1306_screen_t scr;
+static ssd1306_widget_t widgets[MAX_WIDGETS];
+static ssd1306_widget_t *handles[MAX_WIDGETS];
+static model_t model[MAX_WIDGETS];
+static uint n_model;
+static bool background;
+// Widgets de texto curtos, um por célula de 32x16: muitas áreas sujas
+// separadas
+static bool grid;
+
+static const ssd1306_font_t *const fonts[] = {&ssd1306_font_8x8, &ssd1306_font_prop, &ssd1306_font_large};
+static const char *const prefixes[] = {"", "OPS: ", "RST: ", "T="};
+
+static void redraw(void) {
+  ssd1306_fill(&b, background);
+  for (uint i = 0; i < n_model; ++i) {
+    const model_t *m = &model[i];
+    switch (m->type) {
+      case SSD1306_WIDGET_FRAME:
+        ssd1306_rect(&b, m->y, m->x, m->w, m->h, m->value, false);
+        break;
+      case SSD1306_WIDGET_HLINE:
+        ssd1306_hline(&b, m->x, m->x + m->w - 1, m->y, m->value);
+        break;
+      default:
+        ssd1306_text(&b, m->font, m->text, m->x, m->y);
+        break;
+    }
+  }
+}
+
+static void compare(void) {
+  redraw();
+  CHECK(!memcmp(a.ram_buffer, b.ram_buffer, a.bufsize));
+}
+
+static void random_text(char *s) {
+  uint n = grid ? test_rand_range(0, 3) : test_rand() % 8 ? test_rand_range(0, 12) : test_rand_range(0, 30);
+  for (uint i = 0; i < n; ++i)
+    s[i] = test_rand_range(' ', '~');
+  s[n] = 0;
+}
+
+static void set_text(model_t *m, const char *text) {
+  snprintf(m->text, sizeof(m->text), "%s", text);
+}
+
+static void set_count(model_t *m, uint32_t count) {
+  char text[SSD1306_WIDGET_TEXT];
+  m->count = count;
+  snprintf(text, sizeof(text), "%s%lu", m->prefix, (unsigned long)count);
+  set_text(m, text);
+}
+
+static void new_screen(void) {
+  background = test_rand() % 4 == 0;
+  grid = test_rand() % 2;
+  // Restos da tela anterior, que a primeira composição tem que cobrir
+  for (size_t i = 1; i < a.bufsize; ++i)
+    a.ram_buffer[i] = test_rand();
+  free(scr.scratch);
+  ssd1306_screen_init(&scr, &a, widgets, MAX_WIDGETS, background);
+  n_model = test_rand_range(1, MAX_WIDGETS);
+  for (uint i = 0; i < n_model; ++i) {
+    model_t *m = &model[i];
+    memset(m, 0, sizeof(*m));
+    m->x = grid ? i % 4 * 32 + test_rand_range(0, 4) : test_rand_range(0, WIDTH - 1);
+    m->y = grid ? i / 4 * 16 + test_rand_range(0, 4) : test_rand_range(0, HEIGHT - 1);
+    m->value = test_rand() % 4 != 0;
+    switch (grid ? test_rand_range(2, 3) : test_rand() % 4) {
+      case 0:
+        m->type = SSD1306_WIDGET_FRAME;
+        m->w = test_rand_range(1, WIDTH);
+        m->h = test_rand_range(1, HEIGHT);
+        handles[i] = ssd1306_screen_frame(&scr, m->x, m->y, m->w, m->h, m->value);
+        break;
+      case 1: {
+        m->type = SSD1306_WIDGET_HLINE;
+        uint8_t x1 = test_rand_range(m->x, WIDTH - 1);
+        m->w = x1 - m->x + 1;
+        m->h = 1;
+        handles[i] = ssd1306_screen_hline(&scr, m->x, x1, m->y, m->value);
+        break;
+      }
+      case 2: {
+        char text[32];
+        m->type = SSD1306_WIDGET_LABEL;
+        m->font = fonts[test_rand() % (grid ? 2 : count_of(fonts))];
+        random_text(text);
+        set_text(m, text);
+        handles[i] = ssd1306_screen_label(&scr, m->font, m->x, m->y, text);
+        break;
+      }
+      default:
+        m->type = SSD1306_WIDGET_COUNTER;
+        m->font = fonts[test_rand() % (grid ? 2 : count_of(fonts))];
+        m->prefix = grid ? "" : prefixes[test_rand() % count_of(prefixes)];
+        set_count(m, grid || test_rand() % 2 ? test_rand_range(0, 200) : test_rand());
+        handles[i] = ssd1306_screen_counter(&scr, m->font, m->x, m->y, m->prefix, m->count);
+        break;
+    }
+    CHECK(handles[i] == &widgets[i]);
+  }
+  CHECK(ssd1306_screen_compose(&scr) > 0);
+  compare();
+}
+
+// Troca o texto ou o valor de um widget, às vezes pelo mesmo. Retorna se
+// algo mudou.
+static bool random_update(void) {
+  uint i = test_rand() % n_model;
+  model_t *m = &model[i];
+  if (m->type == SSD1306_WIDGET_LABEL) {
+    char text[32];
+    if (test_rand() % 4)
+      random_text(text);
+    else
+      strcpy(text, m->text);
+    bool changed = strncmp(m->text, text, sizeof(m->text) - 1);
+    set_text(m, text);
+    ssd1306_label_set(&scr, handles[i], text);
+    return changed;
+  }
+  if (m->type == SSD1306_WIDGET_COUNTER) {
+    uint32_t count = m->count;
+    switch (test_rand() % 4) {
+      case 0:
+        break;
+      case 1:
+        count = grid ? test_rand_range(0, 999) : test_rand();
+        break;
+      default:
+        ++count;
+        break;
+    }
+    bool changed = count != m->count;
+    set_count(m, count);
+    ssd1306_counter_set(&scr, handles[i], count);
+    return changed;
+  }
+  return false;
+}
+
+static void test_random_screens(void) {
+  uint full_dirty = 0;
+  for (int screen = 0; screen < 400; ++screen) {
+    new_screen();
+    for (int step = 0; step < 40; ++step) {
+      uint n = test_rand() % 8 ? test_rand_range(1, 3) : test_rand_range(4, 20);
+      bool changed = false;
+      for (uint k = 0; k < n; ++k)
+        changed |= random_update();
+      full_dirty += scr.n_dirty == SSD1306_SCREEN_MAX_DIRTY;
+      uint32_t touched = ssd1306_screen_compose(&scr);
+      // Sem mudança, nada é recomposto
+      if (!changed)
+        CHECK(!touched);
+      CHECK(scr.n_dirty == 0);
+      compare();
+      // Alguém desenha direto na ram_buffer e pede tudo de novo
+      if (test_rand() % 20 == 0) {
+        ssd1306_rect(&a, test_rand_range(0, HEIGHT - 1), test_rand_range(0, WIDTH - 1), test_rand_range(1, WIDTH),
+                     test_rand_range(1, HEIGHT), test_rand() & 1, true);
+        ssd1306_screen_invalidate(&scr);
+        CHECK(ssd1306_screen_compose(&scr) == WIDTH * HEIGHT);
+        compare();
+      }
+    }
+  }
+  // A lista de áreas sujas encheu (e as seguintes foram juntadas à última)
+  CHECK(full_dirty > 100);
+}
+
+static void test_full(void) {
+  free(scr.scratch);
+  ssd1306_screen_init(&scr, &a, widgets, 0, false);
+  CHECK(ssd1306_screen_frame(&scr, 0, 0, 10, 10, true) == NULL);
+  free(scr.scratch);
+  ssd1306_screen_init(&scr, &a, widgets, 2, false);
+  CHECK(ssd1306_screen_hline(&scr, 0, 10, 0, true) == &widgets[0]);
+  CHECK(ssd1306_screen_hline(&scr, 0, 10, 1, true) == &widgets[1]);
+  CHECK(ssd1306_screen_hline(&scr, 0, 10, 2, true) == NULL);
+  CHECK(ssd1306_screen_label(&scr, &ssd1306_font_8x8, 0, 8, "x") == NULL);
+  CHECK(ssd1306_screen_counter(&scr, &ssd1306_font_8x8, 0, 8, "", 0) == NULL);
+  CHECK(scr.n_widgets == 2);
+}
+
+// ----------------------------------------------------------------------------
+// Tela de operação, montada como em Transmissor.c
+
+static void running_bench(void) {
+  static const char *const states[] = {"Estado: LIGADO", "Estado: DESLIGADO", "Estado: ERRO"};
+  free(scr.scratch);
+  ssd1306_screen_init(&scr, &a, widgets, MAX_WIDGETS, false);
+  background = false;
+  n_model = 0;
+  model[n_model++] = (model_t){SSD1306_WIDGET_FRAME, true, 3, 3, 122, 60};
+  ssd1306_screen_frame(&scr, 3, 3, 122, 60, true);
+  model[n_model++] = (model_t){SSD1306_WIDGET_HLINE, true, 3, 25, 121, 1};
+  ssd1306_screen_hline(&scr, 3, 123, 25, true);
+  model[n_model++] = (model_t){SSD1306_WIDGET_HLINE, true, 3, 37, 121, 1};
+  ssd1306_screen_hline(&scr, 3, 123, 37, true);
+  model[n_model++] = (model_t){SSD1306_WIDGET_LABEL, true, 20, 6, 0, 8, &ssd1306_font_8x8, NULL, 0, "AC+WDT+UART"};
+  ssd1306_screen_label(&scr, &ssd1306_font_8x8, 20, 6, "AC+WDT+UART");
+  model[n_model++] = (model_t){SSD1306_WIDGET_LABEL, true, 10, 16, 0, 8, &ssd1306_font_8x8};
+  set_text(&model[n_model - 1], states[0]);
+  ssd1306_widget_t *state = ssd1306_screen_label(&scr, &ssd1306_font_8x8, 10, 16, states[0]);
+  model[n_model++] = (model_t){SSD1306_WIDGET_COUNTER, true, 10, 28, 0, 8, &ssd1306_font_8x8, "OPS: "};
+  set_count(&model[n_model - 1], 0);
+  ssd1306_widget_t *ops = ssd1306_screen_counter(&scr, &ssd1306_font_8x8, 10, 28, "OPS: ", 0);
+  model[n_model++] = (model_t){SSD1306_WIDGET_COUNTER, true, 10, 40, 0, 8, &ssd1306_font_8x8, "RST: "};
+  set_count(&model[n_model - 1], 0);
+  ssd1306_widget_t *rst = ssd1306_screen_counter(&scr, &ssd1306_font_8x8, 10, 40, "RST: ", 0);
+  model[n_model++] = (model_t){SSD1306_WIDGET_LABEL, true, 10, 52, 0, 8, &ssd1306_font_8x8, NULL, 0, "TX: ATIVO"};
+  ssd1306_screen_label(&scr, &ssd1306_font_8x8, 10, 52, "TX: ATIVO");
+  ssd1306_screen_compose(&scr);
+  compare();
+
+  // Uma operação a cada atualização, um reset de vez em quando, o estado
+  // trocando de vez em quando
+  const uint updates = 1000;
+  uint32_t touched = 0;
+  for (uint i = 1; i <= updates; ++i) {
+    set_count(&model[5], i);
+    ssd1306_counter_set(&scr, ops, i);
+    if (i % 100 == 0) {
+      set_count(&model[6], i / 100);
+      ssd1306_counter_set(&scr, rst, i / 100);
+    }
+    if (i % 50 == 0) {
+      set_text(&model[4], states[i / 50 % count_of(states)]);
+      ssd1306_label_set(&scr, state, model[4].text);
+    }
+    touched += ssd1306_screen_compose(&scr);
+    compare();
+  }
+  printf("tela de operação: %u pixels recompostos por atualização, de %u\n", touched / updates, WIDTH * HEIGHT);
+  CHECK(touched / updates < WIDTH * HEIGHT / 8);
+  free(scr.scratch);
+}
+
+int main(void) {
+  ssd1306_init(&a, WIDTH, HEIGHT, false, 0x3c, NULL);
+  ssd1306_init(&b, WIDTH, HEIGHT, false, 0x3c, NULL);
+  test_random_screens();
+  test_full();
+  running_bench();
+  return test_result("test_ssd1306_widget");
+}
@@ -0,0 +1,97 @@
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+
+// Two-thread model of the text plane double buffer in hdmi_Fonte_Original.c.
+// text_commit() and text_frame_start() come from include/text_double_buffer.h,
+// shared with the demo, with one thread standing in for each core:
+//
+// - "core 0" fills the whole back buffer with a frame number and commits it;
+// - "core 1" adopts pending buffers at frame start, then reads its front
+//   buffer twice, as the encoder would over one frame.
+//
+// A frame is torn if the reader sees two frame numbers in one buffer, or the
+// buffer changes while it is being read. Commits must also be seen in order,
+// and the last one must be seen.
+
+#define CHAR_COLS 80
+#define CHAR_ROWS 60
+#define N_COMMITS 500
+
+#include "text_double_buffer.h"
+
+static volatile bool writer_done;
+static int torn_frames;
+static int out_of_order;
+static uint32_t last_seen;
+
+static void fill(struct text_planes *p, uint32_t frame) {
+    memset(p->charbuf, frame & 0xff, sizeof(p->charbuf));
+    for (uint i = 0; i < count_of(p->colourbuf); ++i)
+        p->colourbuf[i] = frame;
+}
+
+// Frame number if the whole buffer holds one, else ~0u
+static uint32_t read_frame(const struct text_planes *p) {
+    uint32_t frame = p->colourbuf[0];
+    for (uint i = 0; i < count_of(p->colourbuf); ++i)
+        if (p->colourbuf[i] != frame)
+            return ~0u;
+    for (uint i = 0; i < count_of(p->charbuf); ++i)
+        if ((uint8_t)p->charbuf[i] != (frame & 0xff))
+            return ~0u;
+    return frame;
+}
+
+static void *core0(void *arg) {
+    (void)arg;
+    for (uint32_t frame = 1; frame <= N_COMMITS; ++frame) {
+        // Scribble over the back buffer first, as partial updates would
+        fill(planes_back, ~frame);
+        sched_yield();
+        fill(planes_back, frame);
+        text_commit();
+    }
+    writer_done = true;
+    return NULL;
+}
+
+static void *core1(void *arg) {
+    (void)arg;
+    struct text_planes *front = &planes[0];
+    while (true) {
+        bool done = writer_done;
+        front = text_frame_start(front);
+        uint32_t first = read_frame(front);
+        // Let the writer run mid-frame, as the other core would
+        sched_yield();
+        uint32_t second = read_frame(front);
+        if (first == ~0u || first != second)
+            ++torn_frames;
+        else if (first < last_seen)
+            ++out_of_order;
+        else
+            last_seen = first;
+        if (done && !planes_pending)
+            break;
+        // The encoder spends most of a frame waiting on the DVI queues
+        sched_yield();
+    }
+    return NULL;
+}
+
+int main(void) {
+    pthread_t t0, t1;
+    pthread_create(&t1, NULL, core1, NULL);
+    pthread_create(&t0, NULL, core0, NULL);
+    pthread_join(t0, NULL);
+    pthread_join(t1, NULL);
+    CHECK(torn_frames == 0);
+    CHECK(out_of_order == 0);
+    CHECK(last_seen == N_COMMITS);
+    printf("%d commits: %d torn frames, %d out of order\n", N_COMMITS, torn_frames, out_of_order);
+    return test_result("test_text_double_buffer");
+}
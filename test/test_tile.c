@@ -0,0 +1,241 @@
+#include <string.h>
+
+#include "pico.h"
+#include "hardware/interp.h"
+#include "host_test.h"
+#include "tile.h"
+#include "tile_ref.h"
+
+// Checks tile8/16_span() and the layer functions against tile_ref.c, for
+// every combination of pixel size, tile size and alpha, with random scroll
+// and per-line scroll tables. The fill loops here are the C stand-ins from
+// tile_loop_host.c.
+//
+// "--dump seed" instead prints spans set up by the real tile.c (the
+// interp1 state and loop arguments), with tile_ref.c's output for each, for
+// test_tile.py to run through the tile.S loops.
+
+#define LINE_W 640
+#define N_TILES 16
+#define MAX_LOG_MAP_W 10
+#define MAX_LOG_MAP_H 9
+
+static uint8_t line8[2][LINE_W];
+static uint16_t line16[2][LINE_W];
+static uint8_t tileset8[N_TILES * 16 * 16];
+static uint16_t tileset16[N_TILES * 16 * 16];
+static uint8_t tilemap[(1 << MAX_LOG_MAP_W >> 3) * (1 << MAX_LOG_MAP_H >> 3)];
+static int16_t xscroll_line[LINE_W];
+
+typedef struct {
+	const char *name;
+	tile_loop_t loop;
+	uint bpp;
+	tilesize_t tilesize;
+	bool alpha;
+} loop_info_t;
+
+static const loop_info_t loops[] = {
+	{"tile16_16px_alpha_loop", (tile_loop_t)tile16_16px_alpha_loop, 16, TILESIZE_16, true},
+	{"tile16_16px_loop", (tile_loop_t)tile16_16px_loop, 16, TILESIZE_16, false},
+	{"tile16_8px_alpha_loop", (tile_loop_t)tile16_8px_alpha_loop, 16, TILESIZE_8, true},
+	{"tile16_8px_loop", (tile_loop_t)tile16_8px_loop, 16, TILESIZE_8, false},
+	{"tile8_16px_alpha_loop", (tile_loop_t)tile8_16px_alpha_loop, 8, TILESIZE_16, true},
+	{"tile8_16px_loop", (tile_loop_t)tile8_16px_loop, 8, TILESIZE_16, false},
+	{"tile8_8px_alpha_loop", (tile_loop_t)tile8_8px_alpha_loop, 8, TILESIZE_8, true},
+	{"tile8_8px_loop", (tile_loop_t)tile8_8px_loop, 8, TILESIZE_8, false},
+};
+
+static bool is_alpha_loop(tile_loop_t loop) {
+	for (uint l = 0; l < count_of(loops); ++l)
+		if (loops[l].loop == loop)
+			return loops[l].alpha;
+	return false;
+}
+
+static void random_tiles(void) {
+	for (uint i = 0; i < count_of(tileset8); ++i)
+		tileset8[i] = test_rand();
+	for (uint i = 0; i < count_of(tileset16); ++i)
+		tileset16[i] = test_rand();
+	for (uint i = 0; i < count_of(tilemap); ++i)
+		tilemap[i] = test_rand() % N_TILES;
+	for (uint i = 0; i < count_of(xscroll_line); ++i)
+		xscroll_line[i] = test_rand_range(-300, 300);
+}
+
+static tilebg_t random_bg(const loop_info_t *info) {
+	uint log_tile = 3 + (uint)info->tilesize;
+	return (tilebg_t){
+		.xscroll = test_rand(),
+		.yscroll = test_rand(),
+		.tileset = info->bpp == 16 ? (const void*)tileset16 : (const void*)tileset8,
+		.tilemap = tilemap,
+		.xscroll_line = test_rand() & 1 ? xscroll_line : NULL,
+		// At least two tiles wide, as the interpolator mask needs a bit
+		.log_size_x = test_rand_range(log_tile + 1, MAX_LOG_MAP_W),
+		.log_size_y = test_rand_range(log_tile, MAX_LOG_MAP_H),
+		.priority = test_rand() % 4,
+		.tilesize = info->tilesize,
+		.fill_loop = info->loop
+	};
+}
+
+// A span which meets the tile*_span() contract: x0 on a tile boundary in tile
+// space, or 0 with x1 past the first boundary
+static void random_span(const tilebg_t *bg, uint y, uint *x0, uint *x1) {
+	uint tile_mask = (8u << bg->tilesize) - 1;
+	uint to_boundary = (0u - tile_xscroll(bg, y)) & tile_mask;
+	if (test_rand() & 1) {
+		*x0 = 0;
+		*x1 = test_rand_range(to_boundary, LINE_W);
+	}
+	else {
+		uint log_tile = 3 + (uint)bg->tilesize;
+		*x0 = to_boundary + (test_rand_range(0, (LINE_W - to_boundary) >> log_tile) << log_tile);
+		*x1 = test_rand_range(*x0, LINE_W);
+	}
+}
+
+static void random_lines(void) {
+	for (uint x = 0; x < LINE_W; ++x) {
+		line8[0][x] = line8[1][x] = test_rand();
+		line16[0][x] = line16[1][x] = test_rand();
+	}
+}
+
+static void test_spans(void) {
+	for (uint l = 0; l < count_of(loops); ++l) {
+		for (int trial = 0; trial < 400; ++trial) {
+			tilebg_t bg = random_bg(&loops[l]);
+			uint y = test_rand_range(0, LINE_W - 1);
+			uint x0, x1;
+			random_span(&bg, y, &x0, &x1);
+			random_lines();
+			if (loops[l].bpp == 16) {
+				tile16_span(line16[0], &bg, y, x0, x1);
+				tile16_span_ref(line16[1], &bg, y, x0, x1, loops[l].alpha);
+				CHECK(!memcmp(line16[0], line16[1], sizeof(line16[0])));
+			}
+			else {
+				tile8_span(line8[0], &bg, y, x0, x1);
+				tile8_span_ref(line8[1], &bg, y, x0, x1, loops[l].alpha);
+				CHECK(!memcmp(line8[0], line8[1], sizeof(line8[0])));
+			}
+		}
+	}
+}
+
+// Four layers at random priorities, composited in two priority ranges as if
+// sprites were drawn in between
+static void test_layers(void) {
+	for (int trial = 0; trial < 100; ++trial) {
+		uint bpp = trial & 1 ? 16 : 8;
+		tilebg_t bgs[4];
+		const tilebg_t *layers[4];
+		for (uint i = 0; i < 4; ++i) {
+			// Rearmost layer opaque, the rest alpha
+			const loop_info_t *info = &loops[(bpp == 16 ? 0 : 4) + (test_rand() & 2) + (i == 0)];
+			bgs[i] = random_bg(info);
+			layers[i] = &bgs[i];
+		}
+		tile_layers_sort(layers, 4);
+		for (uint i = 1; i < 4; ++i) {
+			CHECK(layers[i - 1]->priority <= layers[i]->priority);
+			if (layers[i - 1]->priority == layers[i]->priority)
+				CHECK(layers[i - 1] < layers[i]);
+		}
+		uint split = test_rand() % 4;
+		uint y = test_rand_range(0, LINE_W - 1);
+		uint32_t cycles[4];
+		random_lines();
+		if (bpp == 16) {
+			tile16_layers(line16[0], layers, 4, 0, split, y, LINE_W, cycles);
+			tile16_layers(line16[0], layers, 4, split + 1, 3, y, LINE_W, NULL);
+		}
+		else {
+			tile8_layers(line8[0], layers, 4, 0, split, y, LINE_W, cycles);
+			tile8_layers(line8[0], layers, 4, split + 1, 3, y, LINE_W, NULL);
+		}
+		for (uint i = 0; i < 4; ++i) {
+			bool alpha = is_alpha_loop(layers[i]->fill_loop);
+			if (bpp == 16)
+				tile16_span_ref(line16[1], layers[i], y, 0, LINE_W, alpha);
+			else
+				tile8_span_ref(line8[1], layers[i], y, 0, LINE_W, alpha);
+			// The host SysTick doesn't count, so every layer measures 0
+			CHECK(cycles[i] == 0);
+		}
+		if (bpp == 16)
+			CHECK(!memcmp(line16[0], line16[1], sizeof(line16[0])));
+		else
+			CHECK(!memcmp(line8[0], line8[1], sizeof(line8[0])));
+	}
+}
+
+static const loop_info_t *dump_loop;
+
+static void dump_hex(const char *tag, const void *data, uint n, uint bpp) {
+	printf("%s", tag);
+	for (uint i = 0; i < n; ++i)
+		printf(" %x", bpp == 16 ? ((const uint16_t*)data)[i] : ((const uint8_t*)data)[i]);
+	printf("\n");
+}
+
+// Stands in for the fill loop during --dump
+static void dump_call(void *dst, const void *tileset, uint x0, uint x1) {
+	const interp_hw_t *i1 = interp1_hw;
+	uint pixel_bytes = dump_loop->bpp / 8;
+	const void *line = dump_loop->bpp == 16 ? (const void*)line16[0] : (const void*)line8[0];
+	const void *ts = dump_loop->bpp == 16 ? (const void*)tileset16 : (const void*)tileset8;
+	printf("call %u %u %u %u %08x %08x %u %u %u %u %u\n",
+		(uint)((const uint8_t*)dst - (const uint8_t*)line) / pixel_bytes,
+		(uint)((const uint8_t*)tileset - (const uint8_t*)ts) / pixel_bytes,
+		x0, x1, i1->ctrl[0], i1->ctrl[1], i1->accum[0], i1->accum[1],
+		(uint)i1->base[0], (uint)i1->base[1], (uint)(i1->base[2] - (uintptr_t)tilemap));
+}
+
+// Full-width spans first (for the cycle counts), then random ones
+static void dump(void) {
+	for (uint l = 0; l < count_of(loops); ++l) {
+		dump_loop = &loops[l];
+		printf("loop %s %u %u %u\n", loops[l].name, loops[l].bpp, 3 + (uint)loops[l].tilesize, loops[l].alpha);
+		for (int trial = 0; trial < 20; ++trial) {
+			tilebg_t bg = random_bg(&loops[l]);
+			bg.fill_loop = (tile_loop_t)dump_call;
+			uint y = test_rand_range(0, LINE_W - 1);
+			uint x0 = 0, x1 = LINE_W;
+			if (trial)
+				random_span(&bg, y, &x0, &x1);
+			random_lines();
+			if (loops[l].bpp == 16) {
+				dump_hex("line", line16[0], LINE_W, 16);
+				tile16_span(line16[0], &bg, y, x0, x1);
+				tile16_span_ref(line16[1], &bg, y, x0, x1, loops[l].alpha);
+				dump_hex("expect", line16[1], LINE_W, 16);
+			}
+			else {
+				dump_hex("line", line8[0], LINE_W, 8);
+				tile8_span(line8[0], &bg, y, x0, x1);
+				tile8_span_ref(line8[1], &bg, y, x0, x1, loops[l].alpha);
+				dump_hex("expect", line8[1], LINE_W, 8);
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc == 3 && !strcmp(argv[1], "--dump")) {
+		test_rand_state = strtoul(argv[2], NULL, 0);
+		random_tiles();
+		dump_hex("tileset8", tileset8, count_of(tileset8), 8);
+		dump_hex("tileset16", tileset16, count_of(tileset16), 16);
+		dump_hex("tilemap", tilemap, count_of(tilemap), 8);
+		dump();
+		return 0;
+	}
+	random_tiles();
+	test_spans();
+	test_layers();
+	return test_result("test_tile");
+}
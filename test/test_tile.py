@@ -0,0 +1,77 @@
+"""Run the libsprite/tile.S fill loops on spans set up by the real tile.c
+(test_tile --dump), and compare each output line with tile_ref.c's. Also
+reports emulated cycles per 640-pixel line for each loop, i.e. the cost of one
+full-width layer.
+
+usage: test_tile.py <path to test_tile>
+"""
+import os
+import subprocess
+import sys
+
+from thumb_emu import Machine, assemble
+
+REPO = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+
+
+def pack(values, bpp):
+    return b''.join(v.to_bytes(bpp // 8, 'little') for v in values)
+
+
+def run(harness, obj, seed):
+    lines = subprocess.check_output([harness, '--dump', str(seed)], text=True).splitlines()
+    m = Machine()
+    m.link([obj])
+    data = {}
+    failures = 0
+    cycles = {}
+    loop = None
+    for text in lines:
+        f = text.split()
+        if f[0] in ('tileset8', 'tileset16', 'tilemap'):
+            bpp = 16 if f[0] == 'tileset16' else 8
+            data[f[0]] = m.alloc(pack([int(x, 16) for x in f[1:]], bpp))
+        elif f[0] == 'loop':
+            loop, bpp = f[1], int(f[2])
+            line = m.alloc(bytes(640 * bpp // 8))
+        elif f[0] == 'line':
+            m.mem.write_bytes(line, pack([int(x, 16) for x in f[1:]], bpp))
+        elif f[0] == 'call':
+            dst, ts, x0, x1 = map(int, f[1:5])
+            ctrl0, ctrl1 = int(f[5], 16), int(f[6], 16)
+            accum0, accum1, base0, base1, base2 = map(int, f[7:12])
+            i1 = m.interp[1]
+            i1.ctrl = [ctrl0, ctrl1]
+            i1.accum = [accum0, accum1]
+            i1.base = [base0, base1, data['tilemap'] + base2]
+            tileset = data['tileset%d' % bpp] + ts * bpp // 8
+            _, cyc = m.call(loop, line + dst * bpp // 8, tileset, x0, x1)
+            if loop not in cycles:
+                cycles[loop] = (x1 - x0, cyc)
+        elif f[0] == 'expect':
+            want = pack([int(x, 16) for x in f[1:]], bpp)
+            got = m.mem.read_bytes(line, len(want))
+            if got != want:
+                x = next(i for i in range(len(want)) if got[i] != want[i]) * 8 // bpp
+                if failures < 5:
+                    print('%s seed %d: output differs from tile_ref.c at x = %d' % (loop, seed, x))
+                failures += 1
+    return failures, cycles
+
+
+def main():
+    harness = sys.argv[1]
+    obj = assemble(os.path.join(REPO, 'libsprite', 'tile.S'))
+    failures = 0
+    for seed in (1, 2, 3):
+        f, cycles = run(harness, obj, seed)
+        failures += f
+    for loop, (n, cyc) in cycles.items():
+        print('%-24s %5d cycles per %d-pixel line (%.2f per pixel)' % (loop, cyc, n, cyc / n))
+    os.unlink(obj)
+    print('test_tile.py: ' + ('%d failure(s)' % failures if failures else 'ok'))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
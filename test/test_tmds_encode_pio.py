@@ -0,0 +1,132 @@
+"""Run the PIO TMDS encoders (libdvi/tmds_encode_*.pio) in pio_emu.py and
+check their symbols against the CPU encoders in tmds_encode.S and
+libtmds/tmds_encode_font_2bpp.S, run in thumb_emu.py. Reports cycles per
+640-pixel line for both.
+
+usage: test_tmds_encode_pio.py <path to test_font_expand_2bpp>
+"""
+import os
+import random
+import subprocess
+import sys
+
+from pio_emu import StateMachine, assemble_pio
+from thumb_emu import Machine, assemble
+
+REPO = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+LIBDVI = os.path.join(REPO, 'libdvi')
+N_PIX = 640
+
+# Only 20 bits of each word reach the serialiser
+SYMBOL_PAIR_MASK = 0xfffff
+MASK_ALL = 0xffffffff
+
+
+def first_mismatch(got, want):
+    return next(i for i in range(len(want)) if i >= len(got) or got[i] != want[i])
+
+
+def cpu_encode(m, func, pixels, n_pix):
+    pixbuf = m.alloc_words(pixels)
+    symbuf = m.alloc(bytes(2 * n_pix))
+    _, cycles = m.call(func, pixbuf, symbuf, n_pix)
+    return m.mem.read_words(symbuf, n_pix // 2), cycles
+
+
+def check_1bpp(m, rng):
+    sm = StateMachine(assemble_pio(os.path.join(LIBDVI, 'tmds_encode_1bpp.pio'), 'tmds_encode_1bpp'),
+                      pull_thresh=32, push_thresh=24)
+    failures = 0
+    # Several lines through one SM, as the encoder keeps running between calls
+    for line in range(8):
+        pixels = [rng.getrandbits(32) for _ in range(N_PIX // 32)]
+        if line == 0:
+            pixels = [0, MASK_ALL, 0x55555555, 0xaaaaaaaa] + pixels[4:]
+        start = sm.cycles
+        got = [w & SYMBOL_PAIR_MASK for w in sm.run(pixels)]
+        pio_cycles = sm.cycles - start
+        want, cpu_cycles = cpu_encode(m, 'tmds_encode_1bpp', pixels, N_PIX)
+        if got != want:
+            bad = first_mismatch(got, want)
+            print('1bpp line %d: word %d is %s, want %05x'
+                  % (line, bad, '%05x' % got[bad] if bad < len(got) else 'missing', want[bad]))
+            failures += 1
+    print('1bpp: PIO %d cycles per line, CPU %d' % (pio_cycles, cpu_cycles))
+    return failures
+
+
+def sm_2bpp():
+    return StateMachine(assemble_pio(os.path.join(LIBDVI, 'tmds_encode_2bpp.pio'), 'tmds_encode_2bpp'),
+                        pull_thresh=32, push_thresh=32)
+
+
+def check_2bpp(m, rng):
+    sm = sm_2bpp()
+    failures = 0
+    worst = 0
+    for line in range(8):
+        pixels = [rng.getrandbits(32) for _ in range(N_PIX // 16)]
+        if line == 0:
+            pixels = [0, MASK_ALL, 0x55555555, 0xaaaaaaaa, 0x1b1b1b1b] + pixels[5:]
+        start = sm.cycles
+        got = [w & SYMBOL_PAIR_MASK for w in sm.run(pixels)]
+        worst = max(worst, sm.cycles - start)
+        want, cpu_cycles = cpu_encode(m, 'tmds_encode_2bpp', pixels, N_PIX)
+        if got != want:
+            print('2bpp line %d: mismatch at word %d' % (line, first_mismatch(got, want)))
+            failures += 1
+    print('2bpp: PIO up to %d cycles per line per plane, CPU %d' % (worst, cpu_cycles))
+    return failures
+
+
+def parse_font_dump(text):
+    d = {}
+    for line in text.splitlines():
+        f = line.split()
+        d[f[0]] = [int(x, 16) for x in f[1:]] if f[0] != 'stride' else int(f[1])
+    return d
+
+
+def check_font(m, expand):
+    """font_expand_2bpp() + three PIO encoders vs tmds_encode_font_2bpp()"""
+    failures = 0
+    for seed in range(1, 6):
+        d = parse_font_dump(subprocess.check_output([expand, '--dump', str(seed)], text=True))
+        stride = d['stride']
+        chars = m.alloc(bytes(d['chars']))
+        colours = m.alloc_words(d['colours'])
+        font = m.alloc(bytes(d['font']))
+        symbuf = m.alloc(bytes(2 * N_PIX))
+        levels = d['levels']
+        cpu_cycles = 0
+        for plane in range(3):
+            _, cyc = m.call('tmds_encode_font_2bpp', chars, colours + 4 * plane * stride, symbuf, N_PIX, font)
+            cpu_cycles += cyc
+            want = m.mem.read_words(symbuf, N_PIX // 2)
+            sm = sm_2bpp()
+            got = [w & SYMBOL_PAIR_MASK for w in sm.run(levels[plane * N_PIX // 16:(plane + 1) * N_PIX // 16])]
+            if got != want:
+                print('font seed %d plane %d: mismatch at word %d' % (seed, plane, first_mismatch(got, want)))
+                failures += 1
+    print('font: CPU encode %d cycles per line (3 planes)' % cpu_cycles)
+    return failures
+
+
+def main():
+    expand = sys.argv[1]
+    rng = random.Random(1)
+    m = Machine()
+    objs = [assemble(os.path.join(LIBDVI, 'tmds_encode.S')),
+            assemble(os.path.join(REPO, 'libtmds', 'tmds_encode_font_2bpp.S'))]
+    m.link(objs)
+    for o in objs:
+        os.unlink(o)
+    failures = check_1bpp(m, rng)
+    failures += check_2bpp(m, rng)
+    failures += check_font(m, expand)
+    print('test_tmds_encode_pio.py: ' + ('%d failure(s)' % failures if failures else 'ok'))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
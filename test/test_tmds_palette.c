@@ -0,0 +1,173 @@
+#include <string.h>
+
+#include "pico.h"
+#include "host_test.h"
+#include "tmds_encode.h"
+
+// Host checks for the palette encode path. The C setup (TMDS palette, pixel
+// unpack, interpolator configuration) runs natively; the asm loops don't.
+// The palette loops record the interpolator state they were called with, so
+// that "--dump" can hand a whole scanline to test_tmds_palette.py, which runs
+// tmds_palette_encode_loop_x/y in thumb_emu.py and decodes the result.
+
+#define N_PIX 640
+
+static uint32_t *dump_symbuf;
+static const uint32_t *dump_palette;
+
+static uint32_t palette_offset(uint32_t base) {
+	return (base - (uint32_t)(uintptr_t)dump_palette) / 4;
+}
+
+static void record_palette_loop(uint core, const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) {
+	(void)pixbuf;
+	const interp_hw_t *i0 = interp0_hw, *i1 = interp1_hw;
+	printf("call %u %u %u %08x %08x %u %08x %08x %u\n", core, (uint)(symbuf - dump_symbuf), (uint)n_pix,
+		i0->ctrl[0], i0->ctrl[1], palette_offset(i0->base[2]),
+		i1->ctrl[0], i1->ctrl[1], palette_offset(i1->base[2]));
+}
+
+void tmds_palette_encode_loop_x(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) {
+	record_palette_loop(1, pixbuf, symbuf, n_pix);
+}
+
+void tmds_palette_encode_loop_y(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) {
+	record_palette_loop(0, pixbuf, symbuf, n_pix);
+}
+
+// The other loops in tmds_encode.S are only here to satisfy the linker
+#define HOST_UNAVAILABLE(name) panic(#name " is asm-only")
+void tmds_encode_1bpp(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) { HOST_UNAVAILABLE(tmds_encode_1bpp); }
+void tmds_encode_2bpp(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) { HOST_UNAVAILABLE(tmds_encode_2bpp); }
+void tmds_encode_loop_16bpp(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) { HOST_UNAVAILABLE(tmds_encode_loop_16bpp); }
+void tmds_encode_loop_16bpp_leftshift(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix, uint leftshift) { HOST_UNAVAILABLE(tmds_encode_loop_16bpp_leftshift); }
+void tmds_encode_loop_8bpp(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) { HOST_UNAVAILABLE(tmds_encode_loop_8bpp); }
+void tmds_encode_loop_8bpp_leftshift(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix, uint leftshift) { HOST_UNAVAILABLE(tmds_encode_loop_8bpp_leftshift); }
+void tmds_fullres_encode_loop_16bpp_x(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) { HOST_UNAVAILABLE(tmds_fullres_encode_loop_16bpp_x); }
+void tmds_fullres_encode_loop_16bpp_y(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) { HOST_UNAVAILABLE(tmds_fullres_encode_loop_16bpp_y); }
+void tmds_fullres_encode_loop_16bpp_leftshift_x(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix, uint leftshift) { HOST_UNAVAILABLE(tmds_fullres_encode_loop_16bpp_leftshift_x); }
+void tmds_fullres_encode_loop_16bpp_leftshift_y(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix, uint leftshift) { HOST_UNAVAILABLE(tmds_fullres_encode_loop_16bpp_leftshift_y); }
+
+static void random_words(uint32_t *buf, uint n) {
+	for (uint i = 0; i < n; ++i)
+		buf[i] = test_rand();
+}
+
+static uint packed_pixel(const uint32_t *src, uint i, uint bits) {
+	return (src[i * bits / 32] >> (i * bits % 32)) & ((1u << bits) - 1);
+}
+
+static void test_unpack(uint bits) {
+	uint32_t src[N_PIX / 8];
+	uint32_t dst[N_PIX / 4 + 1];
+	for (int trial = 0; trial < 50; ++trial) {
+		random_words(src, count_of(src));
+		dst[N_PIX / 4] = 0x5a5a5a5a;
+		tmds_unpack_palette_pixels(src, dst, N_PIX, bits);
+		const uint8_t *pix = (const uint8_t*)dst;
+		for (uint i = 0; i < N_PIX; ++i)
+			CHECK(pix[i] == packed_pixel(src, i, bits));
+		CHECK(dst[N_PIX / 4] == 0x5a5a5a5a);
+	}
+}
+
+// Each palette entry gets a negative- and a positive-balance symbol per
+// channel. Both must carry the entry's colour, and bits 31:26 must hold the
+// symbol's disparity for the encode loop to accumulate.
+static uint tmds_decode(uint32_t sym) {
+	uint d = sym & 0xff;
+	if (sym & 0x200)
+		d ^= 0xff;
+	uint out = d & 1;
+	for (int i = 1; i < 8; ++i) {
+		uint bit = ((d >> i) ^ (d >> (i - 1))) & 1;
+		if (!(sym & 0x100))
+			bit ^= 1;
+		out |= bit << i;
+	}
+	return out;
+}
+
+static int tmds_disparity(uint32_t sym) {
+	return 2 * __builtin_popcount(sym & 0x3ff) - 10;
+}
+
+static int balance_field(uint32_t sym) {
+	return (int)((sym >> 26) ^ 32) - 32;
+}
+
+static void test_palette_symbols(void) {
+	enum {n = 256};
+	uint16_t palette[n];
+	static uint32_t tmds_palette[6 * n];
+	for (int i = 0; i < n; ++i)
+		palette[i] = test_rand();
+	tmds_setup_palette_symbols(palette, tmds_palette, n);
+	for (int i = 0; i < n; ++i) {
+		const uint channel[3] = {
+			(palette[i] << 3) & 0xf8,
+			(palette[i] >> 3) & 0xfc,
+			(palette[i] >> 8) & 0xf8,
+		};
+		for (int c = 0; c < 3; ++c) {
+			uint32_t neg = tmds_palette[2 * c * n + i];
+			uint32_t pos = tmds_palette[2 * c * n + n + i];
+			CHECK(tmds_decode(neg) == channel[c]);
+			CHECK(tmds_decode(pos) == channel[c]);
+			CHECK(tmds_disparity(neg) <= 0);
+			CHECK(tmds_disparity(pos) >= 0);
+			CHECK(balance_field(neg) == tmds_disparity(neg));
+			CHECK(balance_field(pos) == tmds_disparity(pos));
+		}
+	}
+}
+
+// Print everything test_tmds_palette.py needs to run one scanline through the
+// asm on each core.
+static void dump(uint bits, uint32_t seed) {
+	test_rand_state = seed;
+	uint n = 1u << bits;
+	static uint16_t palette[256];
+	static uint32_t tmds_palette[6 * 256];
+	static uint32_t packed[N_PIX / 4];
+	static uint32_t linebuf[N_PIX / 4];
+	static uint32_t symbuf[3 * N_PIX / 2];
+	for (uint i = 0; i < n; ++i)
+		palette[i] = test_rand();
+	tmds_setup_palette_symbols(palette, tmds_palette, n);
+	random_words(packed, N_PIX * bits / 32);
+	const uint32_t *pixbuf = packed;
+	if (bits != 8) {
+		tmds_unpack_palette_pixels(packed, linebuf, N_PIX, bits);
+		pixbuf = linebuf;
+	}
+
+	printf("bits %u\n", bits);
+	printf("palette");
+	for (uint i = 0; i < n; ++i)
+		printf(" %04x", palette[i]);
+	printf("\ntmds");
+	for (uint i = 0; i < 6 * n; ++i)
+		printf(" %08x", tmds_palette[i]);
+	printf("\npixels");
+	for (uint i = 0; i < N_PIX; ++i)
+		printf(" %02x", ((const uint8_t*)pixbuf)[i]);
+	printf("\n");
+	dump_symbuf = symbuf;
+	dump_palette = tmds_palette;
+	for (uint core = 0; core < NUM_CORES; ++core) {
+		host_core_num = core;
+		tmds_encode_palette_data(pixbuf, tmds_palette, symbuf, N_PIX, bits);
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc == 4 && !strcmp(argv[1], "--dump")) {
+		dump(atoi(argv[2]), strtoul(argv[3], NULL, 0));
+		return 0;
+	}
+	test_unpack(2);
+	test_unpack(4);
+	test_palette_symbols();
+	return test_result("test_tmds_palette");
+}
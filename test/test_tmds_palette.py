@@ -0,0 +1,114 @@
+"""Run tmds_palette_encode_loop_x/y from libdvi/tmds_encode.S on scanlines
+prepared by the real C setup (test_tmds_palette --dump), decode the TMDS
+output and check it against the palette. Also reports emulated cycles per
+640-pixel scanline for each palette depth.
+
+usage: test_tmds_palette.py <path to test_tmds_palette>
+"""
+import os
+import subprocess
+import sys
+
+from thumb_emu import Machine, assemble
+
+REPO = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+
+# The balance feedback keeps each lane (even and odd pixels are balanced
+# separately) within a couple of symbols' worth of disparity from zero
+MAX_RUNNING_DISPARITY = 2 * 2 * 10
+
+
+def tmds_decode(sym):
+    d = sym & 0xff
+    if sym & 0x200:
+        d ^= 0xff
+    out = d & 1
+    for i in range(1, 8):
+        bit = ((d >> i) ^ (d >> (i - 1))) & 1
+        if not sym & 0x100:
+            bit ^= 1
+        out |= bit << i
+    return out
+
+
+def disparity(sym):
+    return 2 * bin(sym & 0x3ff).count('1') - 10
+
+
+def parse_dump(text):
+    d = {'calls': []}
+    for line in text.splitlines():
+        f = line.split()
+        if f[0] == 'bits':
+            d['bits'] = int(f[1])
+        elif f[0] in ('palette', 'tmds', 'pixels'):
+            d[f[0]] = [int(x, 16) for x in f[1:]]
+        elif f[0] == 'call':
+            core, symoff, n_pix = map(int, f[1:4])
+            i0 = (int(f[4], 16), int(f[5], 16), int(f[6]))
+            i1 = (int(f[7], 16), int(f[8], 16), int(f[9]))
+            d['calls'].append((core, symoff, n_pix, i0, i1))
+    return d
+
+
+def run(harness, obj, bits, seed):
+    d = parse_dump(subprocess.check_output([harness, '--dump', str(bits), str(seed)], text=True))
+    n_pix = len(d['pixels'])
+    m = Machine()
+    m.link([obj])
+    tmds = m.alloc_words(d['tmds'])
+    pixbuf = m.alloc(bytes(d['pixels']))
+    failures = 0
+    cycles = {}
+    for core in (0, 1):
+        symbuf = m.alloc(bytes(4 * 3 * n_pix // 2))
+        cycles[core] = 0
+        for c, symoff, n, i0, i1 in d['calls']:
+            if c != core:
+                continue
+            for interp, (ctrl0, ctrl1, base2) in zip(m.interp, (i0, i1)):
+                interp.ctrl = [ctrl0, ctrl1]
+                interp.base[2] = tmds + 4 * base2
+            loop = 'tmds_palette_encode_loop_x' if core else 'tmds_palette_encode_loop_y'
+            _, cyc = m.call(loop, pixbuf, symbuf + 4 * symoff, n)
+            cycles[core] += cyc
+        words = m.mem.read_words(symbuf, 3 * n_pix // 2)
+        for ch in range(3):
+            syms = []
+            for w in words[ch * n_pix // 2:(ch + 1) * n_pix // 2]:
+                syms += [w & 0x3ff, (w >> 10) & 0x3ff]
+            running = 0
+            worst = 0
+            for x, sym in enumerate(syms):
+                rgb = d['palette'][d['pixels'][x]]
+                want = [(rgb << 3) & 0xf8, (rgb >> 3) & 0xfc, (rgb >> 8) & 0xf8][ch]
+                if tmds_decode(sym) != want:
+                    if failures < 5:
+                        print('bits %d core %d channel %d pixel %d: decoded %02x, want %02x'
+                              % (bits, core, ch, x, tmds_decode(sym), want))
+                    failures += 1
+                running += disparity(sym)
+                worst = max(worst, abs(running))
+            if worst > MAX_RUNNING_DISPARITY:
+                print('bits %d core %d channel %d: running disparity reached %d' % (bits, core, ch, worst))
+                failures += 1
+    return failures, cycles
+
+
+def main():
+    harness = sys.argv[1]
+    obj = assemble(os.path.join(REPO, 'libdvi', 'tmds_encode.S'))
+    failures = 0
+    for bits in (2, 4, 8):
+        for seed in (1, 2, 3):
+            f, cycles = run(harness, obj, bits, seed)
+            failures += f
+        print('%dbpp palette encode: %d cycles per 640-pixel scanline (core 0), %d (core 1)'
+              % (bits, cycles[0], cycles[1]))
+    os.unlink(obj)
+    print('test_tmds_palette.py: ' + ('%d failure(s)' % failures if failures else 'ok'))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
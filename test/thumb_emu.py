@@ -0,0 +1,566 @@
+"""Small ARMv6-M (Cortex-M0+) interpreter for running the libraries' asm
+loops on the host.
+
+The asm is preprocessed with the native C compiler against the shims in
+test/include, assembled with llvm-mc, and linked here from the ELF object:
+every allocated section is placed in one flat region and the relocations the
+loops use (ABS32, Thumb calls and branches) are applied. The interpolators
+are modelled at their SIO addresses, including the OVERF flags.
+
+Cycle counts follow the Cortex-M0+ timings (1-cycle ALU, 2-cycle loads and
+stores, 1-cycle SIO access, 2-cycle taken branches, 3-cycle BL) with
+zero-wait-state memory, i.e. code and data in SRAM. Treat them as estimates.
+"""
+import os
+import shutil
+import struct
+import subprocess
+import tempfile
+
+MASK = 0xffffffff
+
+SIO_BASE = 0xd0000000
+INTERP_BASE = [SIO_BASE + 0x80, SIO_BASE + 0xc0]
+
+
+class Mem:
+    def __init__(self):
+        self.regions = []  # (base, bytearray)
+        self.mmio_read = {}
+        self.mmio_write = {}
+
+    def add(self, base, data):
+        self.regions.append((base, bytearray(data)))
+        return self.regions[-1][1]
+
+    def _find(self, addr, n):
+        for base, buf in self.regions:
+            if base <= addr and addr + n <= base + len(buf):
+                return buf, addr - base
+        raise Exception("bad access %08x" % addr)
+
+    def read(self, addr, n):
+        if addr in self.mmio_read:
+            return self.mmio_read[addr]() & ((1 << (8 * n)) - 1)
+        if addr % n:
+            raise Exception("unaligned read %08x size %d" % (addr, n))
+        buf, o = self._find(addr, n)
+        return int.from_bytes(buf[o:o + n], 'little')
+
+    def write(self, addr, n, v):
+        if addr in self.mmio_write:
+            self.mmio_write[addr](v & MASK)
+            return
+        if addr % n:
+            raise Exception("unaligned write %08x size %d" % (addr, n))
+        buf, o = self._find(addr, n)
+        buf[o:o + n] = (v & ((1 << (8 * n)) - 1)).to_bytes(n, 'little')
+
+    def read_words(self, addr, n):
+        return [self.read(addr + 4 * i, 4) for i in range(n)]
+
+    def write_bytes(self, addr, data):
+        buf, o = self._find(addr, len(data))
+        buf[o:o + len(data)] = data
+
+    def read_bytes(self, addr, n):
+        buf, o = self._find(addr, n)
+        return bytes(buf[o:o + n])
+
+
+class Interp:
+    """One RP2040 interpolator (BLEND and CLAMP not modelled)"""
+
+    def __init__(self):
+        self.accum = [0, 0]
+        self.base = [0, 0, 0]
+        self.ctrl = [0, 0]
+
+    def _fields(self, lane):
+        c = self.ctrl[lane]
+        shift = c & 0x1f
+        lsb = (c >> 5) & 0x1f
+        msb = (c >> 10) & 0x1f
+        return c, shift, lsb, msb
+
+    def _input(self, lane):
+        c = self.ctrl[lane]
+        return self.accum[lane ^ 1] if c & (1 << 16) else self.accum[lane]
+
+    def masked(self, lane):
+        c, shift, lsb, msb = self._fields(lane)
+        mask = ((2 << msb) - 1) & ~((1 << lsb) - 1) & MASK
+        v = (self._input(lane) >> shift) & mask
+        if c & (1 << 15) and msb < 31 and (v >> msb) & 1:
+            v |= (MASK << msb) & MASK
+        return v
+
+    def overflow(self, lane):
+        # Set if any masked-off MSBs of the accumulator are set
+        c, shift, lsb, msb = self._fields(lane)
+        return int(bool((self.accum[lane] >> shift) >> (msb + 1))) if msb < 31 else 0
+
+    def lane_result(self, lane):
+        c = self.ctrl[lane]
+        add = self._input(lane) if c & (1 << 18) else self.masked(lane)
+        return ((self.base[lane] + add) & MASK) | (((c >> 19) & 3) << 28)
+
+    def full_result(self):
+        return (self.base[2] + self.masked(0) + self.masked(1)) & MASK
+
+    def _writeback(self):
+        r = [self.lane_result(0), self.lane_result(1)]
+        for lane in range(2):
+            cross = self.ctrl[lane] & (1 << 17)
+            self.accum[lane] = r[lane ^ 1] if cross else r[lane]
+
+    def _pop(self, value):
+        self._writeback()
+        return value
+
+    def _ctrl0(self):
+        o0, o1 = self.overflow(0), self.overflow(1)
+        return self.ctrl[0] | o0 << 23 | o1 << 24 | (o0 | o1) << 25
+
+    def _set(self, name, i):
+        # Look the list up on each write, as scripts may replace it
+        def f(v):
+            getattr(self, name)[i] = v & MASK
+        return f
+
+    def _add(self, lane):
+        def f(v):
+            self.accum[lane] = (self.accum[lane] + v) & MASK
+        return f
+
+    def _base01(self, v):
+        def sext16(x, lane):
+            return (x - 0x10000) & MASK if (self.ctrl[lane] & (1 << 15)) and x & 0x8000 else x
+        self.base[0] = sext16(v & 0xffff, 0)
+        self.base[1] = sext16(v >> 16, 1)
+
+    def attach(self, mem, base):
+        r = {
+            0x00: lambda: self.accum[0], 0x04: lambda: self.accum[1],
+            0x08: lambda: self.base[0], 0x0c: lambda: self.base[1], 0x10: lambda: self.base[2],
+            0x14: lambda: self._pop(self.lane_result(0)),
+            0x18: lambda: self._pop(self.lane_result(1)),
+            0x1c: lambda: self._pop(self.full_result()),
+            0x20: lambda: self.lane_result(0), 0x24: lambda: self.lane_result(1),
+            0x28: self.full_result,
+            0x2c: self._ctrl0, 0x30: lambda: self.ctrl[1],
+        }
+        w = {
+            0x00: self._set('accum', 0), 0x04: self._set('accum', 1),
+            0x08: self._set('base', 0), 0x0c: self._set('base', 1), 0x10: self._set('base', 2),
+            0x2c: self._set('ctrl', 0), 0x30: self._set('ctrl', 1),
+            0x34: self._add(0), 0x38: self._add(1), 0x3c: self._base01,
+        }
+        for off, f in r.items():
+            mem.mmio_read[base + off] = f
+        for off, f in w.items():
+            mem.mmio_write[base + off] = f
+
+
+class CPU:
+    RET = 0xfffffff0
+    def __init__(self, mem):
+        self.m = mem
+        self.r = [0]*16
+        self.n = self.z = self.c = self.v = 0
+        self.cycles = 0
+    @staticmethod
+    def access_cycles(addr):
+        # Single-cycle IOPORT for SIO (interpolators), else 2-cycle AHB
+        return 1 if addr >> 28 == 0xd else 2
+    def setnz(self, x):
+        x &= MASK
+        self.n = x >> 31; self.z = int(x == 0)
+        return x
+    def addc(self, a, b, cin):
+        res = a + b + cin
+        r = res & MASK
+        self.c = int(res > MASK)
+        self.v = int(((a ^ r) & (b ^ r)) >> 31 & 1)
+        self.setnz(r)
+        return r
+    def sub(self, a, b):
+        return self.addc(a, (~b) & MASK, 1)
+    def cond(self, c):
+        n, z, cc, v = self.n, self.z, self.c, self.v
+        return [z, not z, cc, not cc, n, not n, v, not v, cc and not z, (not cc) or z,
+                n == v, n != v, (not z) and n == v, z or n != v, True][c]
+    def call(self, addr, args, sp=None, max_steps=10_000_000):
+        for i, a in enumerate(args[:4]):
+            self.r[i] = a & MASK
+        if sp is not None:
+            self.r[13] = sp
+        self.r[14] = self.RET | 1
+        self.r[15] = addr & ~1
+        steps = 0
+        while self.r[15] != self.RET:
+            self.step()
+            steps += 1
+            if steps > max_steps:
+                raise Exception("runaway")
+        return self.r[0]
+    def step(self):
+        r = self.r; m = self.m
+        pc = r[15]
+        ins = m.read(pc, 2)
+        npc = pc + 2
+        pcv = pc + 4
+        cyc = 1
+        top5 = ins >> 11
+        if top5 in (0, 1, 2):  # shift imm
+            op = top5; imm = (ins >> 6) & 31; rm = (ins >> 3) & 7; rd = ins & 7
+            x = r[rm]
+            if op == 0:
+                if imm: self.c = (x >> (32 - imm)) & 1; x = (x << imm) & MASK
+            elif op == 1:
+                if imm == 0: imm = 32
+                self.c = (x >> (imm - 1)) & 1; x = x >> imm if imm < 32 else 0
+            else:
+                if imm == 0: imm = 32
+                sx = x - (1 << 32) if x >> 31 else x
+                self.c = (sx >> (imm - 1)) & 1; x = (sx >> min(imm, 31)) & MASK
+            r[rd] = self.setnz(x)
+        elif top5 == 3:
+            op = (ins >> 9) & 3; rn = (ins >> 3) & 7; rd = ins & 7; f = (ins >> 6) & 7
+            b = f if op & 2 else r[f]
+            r[rd] = self.sub(r[rn], b) if op & 1 else self.addc(r[rn], b, 0)
+        elif (ins >> 13) == 1:
+            op = (ins >> 11) & 3; rd = (ins >> 8) & 7; imm = ins & 0xff
+            if op == 0: r[rd] = self.setnz(imm)
+            elif op == 1: self.sub(r[rd], imm)
+            elif op == 2: r[rd] = self.addc(r[rd], imm, 0)
+            else: r[rd] = self.sub(r[rd], imm)
+        elif (ins >> 10) == 0x10:
+            op = (ins >> 6) & 15; rm = (ins >> 3) & 7; rd = ins & 7
+            a, b = r[rd], r[rm]
+            if op == 0: r[rd] = self.setnz(a & b)
+            elif op == 1: r[rd] = self.setnz(a ^ b)
+            elif op in (2, 3, 4, 7):
+                s = b & 0xff
+                if op == 2:
+                    if s: self.c = (a >> (32 - s)) & 1 if s <= 32 else 0; a = (a << s) & MASK if s < 32 else 0
+                elif op == 3:
+                    if s: self.c = (a >> (s - 1)) & 1 if s <= 32 else 0; a = a >> s if s < 32 else 0
+                elif op == 4:
+                    sa = a - (1 << 32) if a >> 31 else a
+                    if s: self.c = (sa >> min(s - 1, 31)) & 1; a = (sa >> min(s, 31)) & MASK
+                else:
+                    if s: s2 = s & 31; a = ((a >> s2) | (a << (32 - s2))) & MASK; self.c = a >> 31
+                r[rd] = self.setnz(a)
+            elif op == 5: r[rd] = self.addc(a, b, self.c)
+            elif op == 6: r[rd] = self.addc(a, (~b) & MASK, self.c)
+            elif op == 8: self.setnz(a & b)
+            elif op == 9: r[rd] = self.sub(0, b)
+            elif op == 10: self.sub(a, b)
+            elif op == 11: self.addc(a, b, 0)
+            elif op == 12: r[rd] = self.setnz(a | b)
+            elif op == 13: r[rd] = self.setnz((a * b) & MASK)
+            elif op == 14: r[rd] = self.setnz(a & ~b & MASK)
+            elif op == 15: r[rd] = self.setnz(~b & MASK)
+        elif (ins >> 10) == 0x11:
+            op = (ins >> 8) & 3; rm = (ins >> 3) & 15; rd = (ins & 7) | ((ins >> 4) & 8)
+            val = pcv if rm == 15 else r[rm]
+            if op == 0:
+                res = ((pcv if rd == 15 else r[rd]) + val) & MASK
+                if rd == 15: npc = res & ~1; cyc = 2
+                else: r[rd] = res
+            elif op == 1:
+                self.sub(pcv if rd == 15 else r[rd], val)
+            elif op == 2:
+                if rd == 15: npc = val & ~1; cyc = 2
+                else: r[rd] = val
+            else:
+                npc = val & ~1; cyc = 2
+                if ins & 0x80:
+                    r[14] = (pc + 2) | 1
+        elif top5 == 9:
+            rd = (ins >> 8) & 7; addr = (pcv & ~3) + (ins & 0xff) * 4
+            r[rd] = m.read(addr, 4); cyc = 2
+        elif (ins >> 12) == 5:
+            op = (ins >> 9) & 7; rm = (ins >> 6) & 7; rn = (ins >> 3) & 7; rd = ins & 7
+            addr = (r[rn] + r[rm]) & MASK; cyc = self.access_cycles(addr)
+            if op == 0: m.write(addr, 4, r[rd])
+            elif op == 1: m.write(addr, 2, r[rd])
+            elif op == 2: m.write(addr, 1, r[rd])
+            elif op == 3: v = m.read(addr, 1); r[rd] = v - 256 if v & 0x80 else v; r[rd] &= MASK
+            elif op == 4: r[rd] = m.read(addr, 4)
+            elif op == 5: r[rd] = m.read(addr, 2)
+            elif op == 6: r[rd] = m.read(addr, 1)
+            else: v = m.read(addr, 2); r[rd] = (v - 65536 if v & 0x8000 else v) & MASK
+        elif (ins >> 13) == 3:
+            b = (ins >> 12) & 1; l = (ins >> 11) & 1; imm = (ins >> 6) & 31; rn = (ins >> 3) & 7; rd = ins & 7
+            n = 1 if b else 4
+            addr = (r[rn] + imm * n) & MASK; cyc = self.access_cycles(addr)
+            if l: r[rd] = m.read(addr, n)
+            else: m.write(addr, n, r[rd])
+        elif (ins >> 12) == 8:
+            l = (ins >> 11) & 1; imm = (ins >> 6) & 31; rn = (ins >> 3) & 7; rd = ins & 7
+            addr = (r[rn] + imm * 2) & MASK; cyc = self.access_cycles(addr)
+            if l: r[rd] = m.read(addr, 2)
+            else: m.write(addr, 2, r[rd])
+        elif (ins >> 12) == 9:
+            l = (ins >> 11) & 1; rd = (ins >> 8) & 7; addr = (r[13] + (ins & 0xff) * 4) & MASK; cyc = 2
+            if l: r[rd] = m.read(addr, 4)
+            else: m.write(addr, 4, r[rd])
+        elif (ins >> 12) == 10:
+            rd = (ins >> 8) & 7
+            r[rd] = (((pcv & ~3) if not (ins & 0x800) else r[13]) + (ins & 0xff) * 4) & MASK
+        elif (ins >> 8) == 0xb0:
+            imm = (ins & 0x7f) * 4
+            r[13] = (r[13] - imm if ins & 0x80 else r[13] + imm) & MASK
+        elif (ins >> 9) == 0x5a:  # push
+            regs = [i for i in range(8) if ins & (1 << i)] + ([14] if ins & 0x100 else [])
+            sp = r[13] - 4 * len(regs)
+            for i, reg in enumerate(regs): m.write(sp + 4 * i, 4, r[reg])
+            r[13] = sp; cyc = 1 + len(regs)
+        elif (ins >> 9) == 0x5e:  # pop
+            regs = [i for i in range(8) if ins & (1 << i)]
+            sp = r[13]
+            for i, reg in enumerate(regs): r[reg] = m.read(sp + 4 * i, 4)
+            sp += 4 * len(regs); cyc = 1 + len(regs)
+            if ins & 0x100:
+                npc = m.read(sp, 4) & ~1; sp += 4; cyc += 3
+            r[13] = sp
+        elif (ins >> 6) in (0x2c8, 0x2c9, 0x2ca, 0x2cb):  # sxth sxtb uxth uxtb
+            op = (ins >> 6) & 3; rm = (ins >> 3) & 7; rd = ins & 7; x = r[rm]
+            if op == 0: x = x & 0xffff; x = (x - 0x10000 if x & 0x8000 else x) & MASK
+            elif op == 1: x = x & 0xff; x = (x - 0x100 if x & 0x80 else x) & MASK
+            elif op == 2: x &= 0xffff
+            else: x &= 0xff
+            r[rd] = x
+        elif (ins >> 6) in (0x2e8, 0x2e9, 0x2eb):  # rev rev16 revsh
+            op = (ins >> 6) & 3; rm = (ins >> 3) & 7; rd = ins & 7; x = r[rm]
+            if op == 0: x = int.from_bytes(x.to_bytes(4, 'little'), 'big')
+            elif op == 1: x = ((x & 0x00ff00ff) << 8 | (x >> 8) & 0x00ff00ff) & MASK
+            else:
+                x = ((x & 0xff) << 8) | ((x >> 8) & 0xff); x = (x - 0x10000 if x & 0x8000 else x) & MASK
+            r[rd] = x
+        elif (ins >> 12) == 12:
+            l = (ins >> 11) & 1; rn = (ins >> 8) & 7
+            regs = [i for i in range(8) if ins & (1 << i)]
+            addr = r[rn]
+            for reg in regs:
+                if l: r[reg] = m.read(addr, 4)
+                else: m.write(addr, 4, r[reg])
+                addr += 4
+            if not (l and rn in regs):
+                r[rn] = addr & MASK
+            cyc = 1 + len(regs)
+        elif (ins >> 12) == 13:
+            c = (ins >> 8) & 15
+            if c == 15: raise Exception("svc")
+            if c == 14: raise Exception("udf at %08x" % pc)
+            off = ins & 0xff; off = off - 256 if off & 0x80 else off
+            if self.cond(c): npc = pcv + off * 2; cyc = 2
+        elif top5 == 0x1c:
+            off = ins & 0x7ff; off = off - 2048 if off & 0x400 else off
+            npc = pcv + off * 2; cyc = 2
+        elif top5 == 0x1e:
+            ins2 = m.read(pc + 2, 2)
+            s = (ins >> 10) & 1; imm10 = ins & 0x3ff; j1 = (ins2 >> 13) & 1; j2 = (ins2 >> 11) & 1; imm11 = ins2 & 0x7ff
+            i1 = 1 - (j1 ^ s); i2 = 1 - (j2 ^ s)
+            off = (s << 24) | (i1 << 23) | (i2 << 22) | (imm10 << 12) | (imm11 << 1)
+            if s: off -= 1 << 25
+            r[14] = (pc + 4) | 1
+            npc = pc + 4 + off; cyc = 3
+        elif ins == 0xbf00:
+            pass
+        else:
+            raise Exception("unhandled %04x at %08x" % (ins, pc))
+        r[15] = npc & MASK
+        self.cycles += cyc
+
+
+class Machine:
+    """Memory, both interpolators and a CPU, with objects linked into flat RAM"""
+
+    # Addresses are arbitrary, apart from staying clear of SIO
+    CODE = 0x20000000
+    STACK_TOP = 0x20100000
+    DATA = 0x21000000
+
+    def __init__(self, data_size=0x100000):
+        self.mem = Mem()
+        self.mem.add(self.STACK_TOP - 0x2000, bytes(0x2000))
+        self.data = self.mem.add(self.DATA, bytes(data_size))
+        self.data_top = self.DATA
+        self.interp = [Interp(), Interp()]
+        for i, b in zip(self.interp, INTERP_BASE):
+            i.attach(self.mem, b)
+        self.cpu = CPU(self.mem)
+        self.symbols = {}
+
+    def alloc(self, data, align=4):
+        """Copy bytes into the data region, return their address"""
+        self.data_top = (self.data_top + align - 1) & ~(align - 1)
+        addr = self.data_top
+        self.mem.write_bytes(addr, bytes(data))
+        self.data_top += len(data)
+        return addr
+
+    def alloc_words(self, words):
+        return self.alloc(b''.join(struct.pack('<I', w & MASK) for w in words))
+
+    def link(self, objs, extern=None):
+        self.symbols = link(objs, self.mem, self.CODE, extern or {})
+        return self.symbols
+
+    def call(self, name, *args):
+        """Call a function by symbol name, return (r0, cycles). Arguments
+        after the fourth go on the stack, as per the AAPCS."""
+        sp = self.STACK_TOP - 16 - 4 * max(0, len(args) - 4)
+        sp &= ~7
+        for i, a in enumerate(args[4:]):
+            self.mem.write(sp + 4 * i, 4, a)
+        self.cpu.cycles = 0
+        ret = self.cpu.call(self.symbols[name], list(args), sp=sp)
+        return ret, self.cpu.cycles
+
+
+def find_tool(name):
+    """Tool path from the environment (as set by CMake), else from PATH"""
+    return os.environ.get(name.upper().replace('-', '_')) or shutil.which(name)
+
+
+def assemble(src, includes=(), defines=()):
+    """Preprocess and assemble a .S file for Cortex-M0+, return the .o path"""
+    cc = os.environ.get('CC') or shutil.which('cc')
+    mc = find_tool('llvm-mc')
+    here = os.path.dirname(os.path.abspath(__file__))
+    fd, out = tempfile.mkstemp(suffix='.o')
+    os.close(fd)
+    pp = out + '.s'
+    flags = ['-I' + os.path.join(here, 'include'), '-I' + os.path.dirname(os.path.abspath(src))]
+    flags += ['-I' + i for i in includes] + ['-D' + d for d in defines]
+    subprocess.check_call([cc, '-E', '-P', '-x', 'assembler-with-cpp', *flags, src, '-o', pp])
+    subprocess.check_call([mc, '-triple=thumbv6m-none-eabi', '-mcpu=cortex-m0plus',
+                           '-filetype=obj', pp, '-o', out])
+    os.unlink(pp)
+    return out
+
+
+class Elf:
+    """Just enough of a 32-bit little-endian ELF relocatable object"""
+
+    def __init__(self, path):
+        d = open(path, 'rb').read()
+        self.data = d
+        shoff, = struct.unpack_from('<I', d, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from('<HHH', d, 0x2e)
+        self.sections = []
+        for i in range(shnum):
+            f = struct.unpack_from('<10I', d, shoff + i * shentsize)
+            self.sections.append(dict(zip(
+                ('name', 'type', 'flags', 'addr', 'offset', 'size', 'link', 'info', 'align', 'entsize'), f)))
+        names = self.sections[shstrndx]
+        for s in self.sections:
+            s['name'] = self._str(names, s['name'])
+        self.symbols = []
+        for s in self.sections:
+            if s['type'] == 2:  # SHT_SYMTAB
+                strtab = self.sections[s['link']]
+                for o in range(s['offset'], s['offset'] + s['size'], 16):
+                    name, value, size, info, other, shndx = struct.unpack_from('<IIIBBH', d, o)
+                    self.symbols.append(dict(name=self._str(strtab, name), value=value,
+                                             info=info, shndx=shndx))
+
+    def _str(self, sec, off):
+        o = sec['offset'] + off
+        return self.data[o:self.data.index(b'\0', o)].decode()
+
+    def contents(self, s):
+        if s['type'] == 8:  # SHT_NOBITS
+            return bytes(s['size'])
+        return self.data[s['offset']:s['offset'] + s['size']]
+
+    def rels(self):
+        for s in self.sections:
+            if s['type'] == 9:  # SHT_REL
+                for o in range(s['offset'], s['offset'] + s['size'], 8):
+                    off, info = struct.unpack_from('<II', self.data, o)
+                    yield s['info'], off, info >> 8, info & 0xff
+
+
+def _thumb_bl(hi, lo, value):
+    """Re-encode the offset of a 32-bit Thumb BL/B.W, keeping its opcode bits"""
+    s = (value >> 24) & 1
+    j1 = (1 - ((value >> 23) & 1)) ^ s
+    j2 = (1 - ((value >> 22) & 1)) ^ s
+    hi = (hi & 0xf800) | s << 10 | (value >> 12) & 0x3ff
+    lo = (lo & 0xd000) | j1 << 13 | j2 << 11 | (value >> 1) & 0x7ff
+    return hi, lo
+
+
+def link(objs, mem, base, extern):
+    """Place the allocated sections of objs from base, resolve symbols and
+    apply relocations. Returns {global symbol: address} (Thumb functions
+    have bit 0 set). extern supplies addresses for undefined symbols."""
+    elfs = [Elf(o) for o in objs]
+    placed = {}
+    image = bytearray()
+    for n, e in enumerate(elfs):
+        for i, s in enumerate(e.sections):
+            if s['flags'] & 2 and s['type'] in (1, 8):  # SHF_ALLOC; PROGBITS or NOBITS
+                align = max(s['align'], 4)
+                image += bytes(-len(image) % align)
+                placed[(n, i)] = base + len(image)
+                image += e.contents(s)
+    image += bytes(16)
+    buf = mem.add(base, image)
+
+    def sym_addr(n, sym):
+        if sym['shndx'] == 0:
+            if sym['name'] in symbols:
+                return symbols[sym['name']]
+            if sym['name'] in extern:
+                return extern[sym['name']]
+            raise Exception("undefined symbol " + sym['name'])
+        return placed[(n, sym['shndx'])] + sym['value']
+
+    symbols = {}
+    for n, e in enumerate(elfs):
+        for sym in e.symbols:
+            if sym['info'] >> 4 == 1 and sym['shndx'] and (n, sym['shndx']) in placed:
+                symbols[sym['name']] = sym_addr(n, sym)
+    for n, e in enumerate(elfs):
+        for sec, off, symi, typ in e.rels():
+            if (n, sec) not in placed:
+                continue
+            p = placed[(n, sec)] + off
+            o = p - base
+            s = sym_addr(n, e.symbols[symi])
+            if typ == 2:  # R_ARM_ABS32
+                a, = struct.unpack_from('<I', buf, o)
+                struct.pack_into('<I', buf, o, (s + a) & MASK)
+            elif typ == 3:  # R_ARM_REL32
+                a, = struct.unpack_from('<I', buf, o)
+                struct.pack_into('<I', buf, o, (s + a - p) & MASK)
+            elif typ in (10, 30):  # R_ARM_THM_CALL, R_ARM_THM_JUMP24
+                hi, lo = struct.unpack_from('<HH', buf, o)
+                sgn = (hi >> 10) & 1
+                i1 = 1 - (((lo >> 13) & 1) ^ sgn)
+                i2 = 1 - (((lo >> 11) & 1) ^ sgn)
+                a = sgn << 24 | i1 << 23 | i2 << 22 | (hi & 0x3ff) << 12 | (lo & 0x7ff) << 1
+                if sgn:
+                    a -= 1 << 25
+                v = ((s & ~1) + a - p) & MASK
+                struct.pack_into('<HH', buf, o, *_thumb_bl(hi, lo, v))
+            elif typ in (102, 103):  # R_ARM_THM_JUMP11, R_ARM_THM_JUMP8
+                ins, = struct.unpack_from('<H', buf, o)
+                bits = 11 if typ == 102 else 8
+                a = (ins & ((1 << bits) - 1)) << 1
+                if a >> bits:
+                    a -= 1 << (bits + 1)
+                v = (s & ~1) + a - p
+                if not -(1 << bits) <= v < (1 << bits):
+                    raise Exception("branch out of range at %08x" % p)
+                ins = (ins & ~((1 << bits) - 1)) | ((v >> 1) & ((1 << bits) - 1))
+                struct.pack_into('<H', buf, o, ins)
+            elif typ not in (0, 40):  # R_ARM_NONE, R_ARM_V4BX
+                raise Exception("unsupported relocation type %d" % typ)
+    return symbols
@@ -0,0 +1,86 @@
+#include <assert.h>
+
+#include "pico.h"
+#include "hardware/interp.h"
+#include "tile.h"
+
+// Portable C versions of the tile.S fill loops. Like the asm, they take each
+// tilemap pointer from an interp1 full-result pop (set up by tile.c), copy
+// pixels up to the first tile boundary without checking x1, and pop once
+// more for the runt tile at the end.
+
+// Alpha is bit 5 in both formats (see sprite_asm_const.h, which is asm-only)
+#define TILE_HOST_ALPHA_MASK (1u << 5)
+
+static inline const uint8_t *tile_host_next_tile(const uint8_t *tileset, uint log_tilebytes) {
+	const uint8_t *tilemap_ptr = (const uint8_t*)interp_pop_full_result(interp1_hw);
+	return tileset + (*tilemap_ptr << log_tilebytes);
+}
+
+static inline void tile_host_pixel(uint8_t *dst, const uint8_t *src, uint pixel_bytes, bool alpha) {
+	uint pix = pixel_bytes == 2 ? *(const uint16_t*)src : *src;
+	if (alpha && !(pix & TILE_HOST_ALPHA_MASK))
+		return;
+	if (pixel_bytes == 2)
+		*(uint16_t*)dst = pix;
+	else
+		*dst = pix;
+}
+
+static void tile_host_loop(void *dst, const void *tileset, uint x0, uint x1, uint log_tile, uint pixel_bytes,
+		bool alpha) {
+	uint8_t *d = dst;
+	const uint8_t *src;
+	uint tile_mask = (1u << log_tile) - 1;
+	uint log_tilebytes = 2 * log_tile + (pixel_bytes == 2);
+	if (x0 & tile_mask) {
+		src = tile_host_next_tile(tileset, log_tilebytes) + (x0 & tile_mask) * pixel_bytes;
+		for (; x0 & tile_mask; ++x0, src += pixel_bytes, d += pixel_bytes)
+			tile_host_pixel(d, src, pixel_bytes, alpha);
+	}
+	// The asm would run off the end here, see tile16_span()
+	assert((int)(x1 - x0) >= 0);
+	uint n = x1 - x0;
+	uint8_t *tiles_end = d + (n >> log_tile << log_tile) * pixel_bytes;
+	uint8_t *end = d + n * pixel_bytes;
+	while (d < tiles_end) {
+		src = tile_host_next_tile(tileset, log_tilebytes);
+		for (uint i = 0; i <= tile_mask; ++i, src += pixel_bytes, d += pixel_bytes)
+			tile_host_pixel(d, src, pixel_bytes, alpha);
+	}
+	src = tile_host_next_tile(tileset, log_tilebytes);
+	for (; d < end; src += pixel_bytes, d += pixel_bytes)
+		tile_host_pixel(d, src, pixel_bytes, alpha);
+}
+
+void tile16_16px_alpha_loop(uint16_t *dst, const uint16_t *tileset, uint x0, uint x1) {
+	tile_host_loop(dst, tileset, x0, x1, 4, sizeof(uint16_t), true);
+}
+
+void tile16_16px_loop(uint16_t *dst, const uint16_t *tileset, uint x0, uint x1) {
+	tile_host_loop(dst, tileset, x0, x1, 4, sizeof(uint16_t), false);
+}
+
+void tile16_8px_alpha_loop(uint16_t *dst, const uint16_t *tileset, uint x0, uint x1) {
+	tile_host_loop(dst, tileset, x0, x1, 3, sizeof(uint16_t), true);
+}
+
+void tile16_8px_loop(uint16_t *dst, const uint16_t *tileset, uint x0, uint x1) {
+	tile_host_loop(dst, tileset, x0, x1, 3, sizeof(uint16_t), false);
+}
+
+void tile8_16px_alpha_loop(uint8_t *dst, const uint8_t *tileset, uint x0, uint x1) {
+	tile_host_loop(dst, tileset, x0, x1, 4, sizeof(uint8_t), true);
+}
+
+void tile8_16px_loop(uint8_t *dst, const uint8_t *tileset, uint x0, uint x1) {
+	tile_host_loop(dst, tileset, x0, x1, 4, sizeof(uint8_t), false);
+}
+
+void tile8_8px_alpha_loop(uint8_t *dst, const uint8_t *tileset, uint x0, uint x1) {
+	tile_host_loop(dst, tileset, x0, x1, 3, sizeof(uint8_t), true);
+}
+
+void tile8_8px_loop(uint8_t *dst, const uint8_t *tileset, uint x0, uint x1) {
+	tile_host_loop(dst, tileset, x0, x1, 3, sizeof(uint8_t), false);
+}
@@ -0,0 +1,40 @@
+#include "tile_ref.h"
+
+// Reference versions of the tile span functions. These do the same job as the
+// interpolator setup in tile.c plus the asm fill loops in tile.S, one pixel at
+// a time, and only depend on the tilebg_t definition.
+
+// Must match ALPHA_SHIFT_8BPP/ALPHA_SHIFT_16BPP in sprite_asm_const.h (which
+// is asm-only). The asm tests the carry out of this shift, i.e. bit 5.
+#define TILE_REF_ALPHA_SHIFT 6
+
+// Index of the tileset pixel at (tx, ty) in tile space
+static uint tile_ref_pixel_index(const tilebg_t *bg, uint tx, uint ty) {
+	uint log_tile = 3 + (uint)bg->tilesize;
+	uint tile_mask = (1u << log_tile) - 1;
+	tx &= (1u << bg->log_size_x) - 1;
+	uint tile = bg->tilemap[((ty >> log_tile) << (bg->log_size_x - log_tile)) + (tx >> log_tile)];
+	return (tile << 2 * log_tile) + ((ty & tile_mask) << log_tile) + (tx & tile_mask);
+}
+
+void tile16_span_ref(uint16_t *scanbuf, const tilebg_t *bg, uint raster_y, uint x0, uint x1, bool alpha) {
+	const uint16_t *tileset = (const uint16_t*)bg->tileset;
+	uint ty = (bg->yscroll + raster_y) & ((1u << bg->log_size_y) - 1);
+	uint tx = tile_xscroll(bg, raster_y) + x0;
+	for (uint x = x0; x < x1; ++x, ++tx) {
+		uint16_t pix = tileset[tile_ref_pixel_index(bg, tx, ty)];
+		if (!alpha || (pix & (1u << (TILE_REF_ALPHA_SHIFT - 1))))
+			scanbuf[x] = pix;
+	}
+}
+
+void tile8_span_ref(uint8_t *scanbuf, const tilebg_t *bg, uint raster_y, uint x0, uint x1, bool alpha) {
+	const uint8_t *tileset = (const uint8_t*)bg->tileset;
+	uint ty = (bg->yscroll + raster_y) & ((1u << bg->log_size_y) - 1);
+	uint tx = tile_xscroll(bg, raster_y) + x0;
+	for (uint x = x0; x < x1; ++x, ++tx) {
+		uint8_t pix = tileset[tile_ref_pixel_index(bg, tx, ty)];
+		if (!alpha || (pix & (1u << (TILE_REF_ALPHA_SHIFT - 1))))
+			scanbuf[x] = pix;
+	}
+}
@@ -0,0 +1,11 @@
+#ifndef _TILE_REF_H
+#define _TILE_REF_H
+
+#include "tile.h"
+
+// Plain C equivalents of tile*_span() with no interpolator or asm, which the
+// tile tests check the library against. Slow.
+void tile16_span_ref(uint16_t *scanbuf, const tilebg_t *bg, uint raster_y, uint x0, uint x1, bool alpha);
+void tile8_span_ref(uint8_t *scanbuf, const tilebg_t *bg, uint raster_y, uint x0, uint x1, bool alpha);
+
+#endif
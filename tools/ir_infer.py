@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+"""
+Infere o protocolo IR (cabeçalho, bits, bytes e checksum) a partir de
+capturas RAW e confere se os quadros gerados com ele reproduzem as capturas.
+
+Uso: tools/ir_infer.py [--tol PCT] [--slack US] [capturas.txt ...]
+     (sem arquivos, lê tools/ir_captures.txt)
+
+Uma duração capturada bate com a gerada se a diferença for no máximo PCT%
+da gerada (padrão 25) ou US microsegundos (padrão 100), o critério usual
+dos receptores, que têm atraso próprio na demodulação.
+
+Formato das capturas: "nome:" seguido das durações em microsegundos,
+começando por uma marca; linhas com # são comentários.
+
+Saída: o ir_protocol_t e os payloads (sem o checksum) prontos para colar em
+lib/custom_ir.c, e uma tabela com o erro de cada captura em relação ao
+quadro gerado. Capturas que não seguem o protocolo (tamanho diferente ou
+checksum errado) são ignoradas; as que decodificam mas têm durações fora da
+tolerância entram na saída, marcadas, mas não no cálculo dos tempos. O
+código de saída é 1 se nenhuma captura estiver dentro da tolerância.
+"""
+
+import os
+import statistics
+import sys
+
+DEFAULT_CAPTURES = os.path.join(os.path.dirname(os.path.abspath(__file__)), "ir_captures.txt")
+
+
+def load_captures(path):
+    captures = []
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            if line.endswith(":"):
+                captures.append((line[:-1], []))
+            else:
+                captures[-1][1].extend(int(v) for v in line.split())
+    return captures
+
+
+def split_two(values):
+    """Separa valores em dois grupos (k-means em 1D), devolve o limiar."""
+    lo, hi = min(values), max(values)
+    for _ in range(20):
+        limit = (lo + hi) / 2
+        short = [v for v in values if v < limit]
+        long_ = [v for v in values if v >= limit]
+        if not short or not long_:
+            break
+        lo, hi = statistics.mean(short), statistics.mean(long_)
+    return (lo + hi) / 2
+
+
+def bits_of(raw, limit):
+    # raw[0:2] é o cabeçalho, depois marca/espaço por bit e a marca final
+    return [1 if s >= limit else 0 for s in raw[3:-1:2]]
+
+
+def to_bytes(bits, lsb_first):
+    out = []
+    for i in range(0, len(bits) - 7, 8):
+        chunk = bits[i:i + 8]
+        if not lsb_first:
+            chunk = chunk[::-1]
+        out.append(sum(b << j for j, b in enumerate(chunk)))
+    return out
+
+
+CHECKSUMS = {
+    "IR_CHECKSUM_SUM": lambda data: sum(data) & 0xFF,
+    "IR_CHECKSUM_XOR": lambda data: _xor(data),
+}
+
+
+def _xor(data):
+    x = 0
+    for b in data:
+        x ^= b
+    return x
+
+
+def encode(proto, payload):
+    """Durações em microsegundos do quadro, como ir_protocol_encode()."""
+    data = list(payload)
+    if proto["checksum"]:
+        data.append(CHECKSUMS[proto["checksum"]](data))
+    raw = [proto["header_mark"], proto["header_space"]]
+    for byte in data:
+        for j in range(8):
+            bit = (byte >> j) & 1 if proto["lsb_first"] else (byte >> (7 - j)) & 1
+            raw += [proto["bit_mark"], proto["one_space"] if bit else proto["zero_space"]]
+    raw.append(proto["footer_mark"])
+    return raw
+
+
+def max_error(generated, captured):
+    """Maior erro absoluto e relativo (à duração gerada)."""
+    worst_us, worst_pct = 0, 0.0
+    for nominal, got in zip(generated, captured):
+        err = abs(got - nominal)
+        worst_us = max(worst_us, err)
+        worst_pct = max(worst_pct, 100.0 * err / nominal)
+    return worst_us, worst_pct
+
+
+def matches(generated, captured, tol, slack):
+    return all(abs(got - nominal) <= max(tol * nominal / 100.0, slack)
+               for nominal, got in zip(generated, captured))
+
+
+def timings(raws, limit):
+    med = statistics.median
+    return {
+        "header_mark": round(med(raw[0] for raw in raws)),
+        "header_space": round(med(raw[1] for raw in raws)),
+        "bit_mark": round(med(m for raw in raws for m in raw[2:-1:2])),
+        "zero_space": round(med(s for raw in raws for s in raw[3:-1:2] if s < limit)),
+        "one_space": round(med(s for raw in raws for s in raw[3:-1:2] if s >= limit)),
+        "footer_mark": round(med(raw[-1] for raw in raws)),
+    }
+
+
+def infer(captures, tol, slack):
+    # Só capturas com o tamanho mais comum entram na primeira estimativa
+    lengths = [len(raw) for _, raw in captures]
+    length = max(set(lengths), key=lengths.count)
+    if length < 19 or (length - 3) % 16:
+        sys.exit("tamanho %d não é cabeçalho + bytes + marca final" % length)
+    usable = [raw for _, raw in captures if len(raw) == length]
+
+    limit = split_two([s for raw in usable for s in raw[3:-1:2]])
+    proto = timings(usable, limit)
+    proto["length"] = (length - 3) // 16
+
+    # Ordem dos bits e checksum: a combinação que mais capturas confirmam
+    best = None
+    for lsb_first in (True, False):
+        for name in [None] + list(CHECKSUMS):
+            ok = 0
+            for raw in usable:
+                data = to_bytes(bits_of(raw, limit), lsb_first)
+                if name is None or CHECKSUMS[name](data[:-1]) == data[-1]:
+                    ok += 1
+            # Sem checksum só vence se nenhum checksum bater
+            score = (ok, name is not None)
+            if best is None or score > best[0]:
+                best = (score, lsb_first, name)
+    proto["lsb_first"] = best[1]
+    proto["checksum"] = best[2]
+
+    # Aceita as capturas que batem, reestima os tempos só com elas e repete
+    # até o conjunto aceito parar de mudar. results: (nome, durações,
+    # payload ou None, motivo da recusa ou None, dentro da tolerância)
+    accepted = None
+    for _ in range(5):
+        results = []
+        for name, raw in captures:
+            reason = None
+            payload = None
+            in_tol = False
+            if len(raw) != length:
+                reason = "%d durações, esperado %d" % (len(raw), length)
+            else:
+                data = to_bytes(bits_of(raw, limit), proto["lsb_first"])
+                payload = data[:-1] if proto["checksum"] else data
+                if proto["checksum"] and CHECKSUMS[proto["checksum"]](payload) != data[-1]:
+                    reason = "checksum errado"
+                    payload = None
+                else:
+                    in_tol = matches(encode(proto, payload), raw, tol, slack)
+            results.append((name, raw, payload, reason, in_tol))
+        good = [raw for _, raw, _, _, in_tol in results if in_tol]
+        if not good or good == accepted:
+            break
+        accepted = good
+        proto.update(timings(good, limit))
+    return proto, results
+
+
+def main(argv):
+    tol = 25.0
+    slack = 100
+    paths = []
+    args = iter(argv)
+    for arg in args:
+        if arg == "--tol":
+            tol = float(next(args))
+        elif arg == "--slack":
+            slack = int(next(args))
+        else:
+            paths.append(arg)
+    captures = []
+    for path in paths or [DEFAULT_CAPTURES]:
+        captures += load_captures(path)
+
+    proto, results = infer(captures, tol, slack)
+
+    print("const ir_protocol_t ir_protocol_x = {")
+    for key in ("header_mark", "header_space", "bit_mark", "zero_space", "one_space", "footer_mark"):
+        print("    .%s = %d," % (key, proto[key]))
+    print("    .length = %d," % proto["length"])
+    print("    .lsb_first = %s," % ("true" if proto["lsb_first"] else "false"))
+    print("    .checksum = %s" % (proto["checksum"] or "IR_CHECKSUM_NONE"))
+    print("};\n")
+
+    for name, raw, payload, reason, in_tol in results:
+        if payload is not None:
+            if not in_tol:
+                print("// %s: fora da tolerância" % name)
+            print("static const uint8_t %s[%d] = {" % (name, len(payload)))
+            print("    " + ", ".join("0x%02X" % b for b in payload))
+            print("};")
+    print()
+
+    print("%-16s %6s  %s" % ("captura", "durs", "erro máximo do quadro gerado"))
+    for name, raw, payload, reason, in_tol in results:
+        if payload is None:
+            print("%-16s %6d  IGNORADA: %s" % (name, len(raw), reason))
+            continue
+        err_us, err_pct = max_error(encode(proto, payload), raw)
+        print("%-16s %6d  %d us (%.1f%%)%s" % (name, len(raw), err_us, err_pct,
+                                             "" if in_tol else "  FORA DA TOLERÂNCIA"))
+    return 0 if any(in_tol for *_, in_tol in results) else 1
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))